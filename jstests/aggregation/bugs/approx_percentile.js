@@ -0,0 +1,53 @@
+// $approxPercentile under $group:  p may be a number or an array of numbers, including 0.
+
+t = db.jstests_aggregation_approx_percentile;
+t.drop();
+
+for ( var i = 1; i <= 100; ++i ) {
+    t.save( { x:i, g:i % 2 } );
+}
+t.save( { x:'not a number' } );
+
+function percentiles( p ) {
+    var result =
+        t.aggregate( { $group:{ _id:null, r:{ $approxPercentile:{ input:'$x', p:p } } } } ).toArray();
+    assert.eq( 1, result.length );
+    return result[ 0 ].r;
+}
+
+function assertClose( expected, actual ) {
+    assert( Math.abs( expected - actual ) <= 2, tojson( { expected:expected, actual:actual } ) );
+}
+
+// An array of percentiles gives an array of estimates.
+var r = percentiles( [ 0.5, 0.9 ] );
+assert.eq( 2, r.length );
+assertClose( 50, r[ 0 ] );
+assertClose( 90, r[ 1 ] );
+
+// A single percentile gives a single estimate.
+assertClose( 50, percentiles( 0.5 ) );
+assert.eq( 1, percentiles( 0 ) );
+assert.eq( 100, percentiles( 1 ) );
+
+// $literal is accepted too.
+assertClose( 90, percentiles( { $literal:0.9 } ) );
+
+// Grouped by a key.
+var grouped = t.aggregate( { $match:{ g:{ $exists:true } } },
+                           { $group:{ _id:'$g',
+                                      r:{ $approxPercentile:{ input:'$x', p:[ 0, 1 ] } } } },
+                           { $sort:{ _id:1 } } ).toArray();
+assert.eq( [ { _id:0, r:[ 2, 100 ] }, { _id:1, r:[ 1, 99 ] } ], grouped );
+
+function assertException( code, operand ) {
+    var res = t.runCommand( 'aggregate',
+                            { pipeline:[ { $group:{ _id:null, r:{ $approxPercentile:operand } } } ] } );
+    assert.commandFailed( res );
+    assert.eq( code, res.code, tojson( res ) );
+}
+
+assertException( 17534, { input:'$x', p:0.5, q:1 } );
+assertException( 17535, { input:'$x' } );
+assertException( 17487, { input:'$x', p:1.5 } );
+assertException( 17488, { input:'$x', p:[] } );
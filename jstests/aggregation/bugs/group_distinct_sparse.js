@@ -0,0 +1,32 @@
+// A {$group: {_id: "$field"}} answered from an index must still put documents missing the field in
+// the null group, so a sparse index on the field can't be used.
+
+t = db.jstests_aggregation_group_distinct_sparse;
+t.drop();
+
+t.save( { a:1 } );
+t.save( { a:2 } );
+t.save( { a:2 } );
+t.save( { b:1 } );
+
+function groupIds() {
+    return t.aggregate( { $group:{ _id:'$a' } } ).toArray().map( function( doc ) {
+        return doc._id;
+    } ).sort();
+}
+
+var expected = [ 1, 2, null ].sort();
+assert.eq( expected, groupIds() );
+
+t.ensureIndex( { a:1 }, { sparse:true } );
+assert.eq( expected, groupIds() );
+
+// A non-sparse index has a key for every document.
+t.dropIndexes();
+t.ensureIndex( { a:1 } );
+assert.eq( expected, groupIds() );
+
+// A collection that doesn't exist has no groups.
+var missing = db.jstests_aggregation_group_distinct_missing;
+missing.drop();
+assert.eq( [], missing.aggregate( { $group:{ _id:'$a' } } ).toArray() );
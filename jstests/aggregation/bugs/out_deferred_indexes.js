@@ -0,0 +1,40 @@
+// $out builds most of the target's secondary indexes after loading the temp collection.  They must
+// still be enforced, and a failed build must leave the old target untouched.
+load('jstests/aggregation/extras/utils.js');
+
+var input = db.out_deferred_indexes_in;
+var output = db.out_deferred_indexes_out;
+
+input.drop();
+output.drop();
+
+function getOutputIndexes() {
+    return db.system.indexes.find({ns: output.getFullName()}).sort({"key":1}).toArray();
+}
+
+input.insert({_id:1});
+input.insert({_id:2});
+input.insert({_id:3});
+
+output.ensureIndex({a:1});
+output.ensureIndex({d:1}, {unique: true});
+output.ensureIndex({e:1}, {background: true});
+assert.eq(output.getIndexes().length, 4);
+var indexes = getOutputIndexes();
+
+// deferred and up-front indexes are all recreated on the new collection
+assert.eq(input.aggregate([{$project: {a: "$_id", d: "$_id", e: "$_id"}},
+                           {$out: output.getName()}]).itcount(), 0);
+assert.eq(output.find().sort({_id:1}).toArray(),
+          [{_id:1, a:1, d:1, e:1}, {_id:2, a:2, d:2, e:2}, {_id:3, a:3, d:3, e:3}]);
+assert.eq(getOutputIndexes(), indexes);
+assert.eq(output.find({a: 2}).hint({a:1}).itcount(), 1);
+
+// unique indexes are built after the documents are inserted, but are still enforced
+assertErrorCode(input, [{$project: {d: {$literal: 1}}}, {$out: output.getName()}], 16995);
+assert.eq(output.find().sort({_id:1}).toArray(),  // old result is left alone
+          [{_id:1, a:1, d:1, e:1}, {_id:2, a:2, d:2, e:2}, {_id:3, a:3, d:3, e:3}]);
+assert.eq(getOutputIndexes(), indexes);
+
+// no temp collections are left behind
+assert.eq([], db.system.namespaces.find({name: /tmp\.agg_out/}).toArray());
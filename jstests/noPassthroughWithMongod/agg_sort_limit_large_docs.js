@@ -0,0 +1,34 @@
+// A $sort+$limit over large documents must not be handed to the query system's top-K sort, which
+// fails at 32MB, when $sort itself can hold the kept documents.
+
+var t = db.agg_sort_limit_large_docs;
+t.drop();
+
+var big = new Array(1024 * 1024).join('x');
+for (var i = 0; i < 80; i++) {
+    t.insert({_id: i, big: big});
+}
+assert.eq(null, db.getLastError());
+
+// Fifty 1MB documents are more than the query system's sort can buffer.
+var res = t.aggregate([{$sort: {_id: -1}}, {$limit: 50}, {$project: {_id: 1}}]).toArray();
+assert.eq(50, res.length);
+assert.eq(79, res[0]._id);
+assert.eq(30, res[49]._id);
+
+// With allowDiskUse the sort is always left to $sort.
+res = t.aggregate([{$sort: {_id: -1}}, {$limit: 50}, {$project: {_id: 1}}],
+                  {allowDiskUse: true}).toArray();
+assert.eq(50, res.length);
+
+// Small documents are still sorted by the query system, which gives the same answer.
+var small = db.agg_sort_limit_small_docs;
+small.drop();
+for (var i = 0; i < 100; i++) {
+    small.insert({_id: i, a: i % 10});
+}
+res = small.aggregate([{$sort: {a: 1, _id: 1}}, {$limit: 3}]).toArray();
+assert.eq([{_id: 0, a: 0}, {_id: 10, a: 0}, {_id: 20, a: 0}], res);
+
+t.drop();
+small.drop();
@@ -0,0 +1,40 @@
+// An awaitData cursor on a capped collection sleeps until something is inserted, up to
+// awaitDataMaxTimeMS, instead of polling.
+
+var t = db.awaitdata_notifier;
+t.drop();
+db.createCollection(t.getName(), { capped: true, size: 100000 });
+t.insert({ _id: 0 });
+
+var oldMaxTime = db.adminCommand({ getParameter: 1, awaitDataMaxTimeMS: 1 }).awaitDataMaxTimeMS;
+assert.commandWorked(db.adminCommand({ setParameter: 1, awaitDataMaxTimeMS: 2000 }));
+
+function awaitDataMetrics() {
+    return db.serverStatus().metrics.cursor.awaitData;
+}
+
+var cursor = t.find().addOption(DBQuery.Option.tailable).addOption(DBQuery.Option.awaitData);
+assert.eq(0, cursor.next()._id);
+
+// nothing is inserted: the getMore waits out awaitDataMaxTimeMS and comes back empty
+var before = awaitDataMetrics();
+var start = new Date();
+assert(!cursor.hasNext());
+assert.gte(new Date() - start, 1500);
+var after = awaitDataMetrics();
+assert.gt(after.timeouts, before.timeouts, tojson(after));
+assert.eq(0, after.waiting, tojson(after));
+
+// an insert wakes the waiting getMore right away
+var s = startParallelShell('sleep(500); db.awaitdata_notifier.insert({ _id: 1 });');
+before = awaitDataMetrics();
+start = new Date();
+assert(cursor.hasNext());
+assert.lt(new Date() - start, 1900);
+assert.eq(1, cursor.next()._id);
+after = awaitDataMetrics();
+assert.gt(after.wakeups, before.wakeups, tojson(after));
+s();
+
+assert.commandWorked(db.adminCommand({ setParameter: 1, awaitDataMaxTimeMS: oldMaxTime }));
+t.drop();
@@ -0,0 +1,94 @@
+// Initial sync that copies the data files of a secondary instead of cloning collections.
+
+load("jstests/replsets/rslib.js");
+var basename = "jstests_initsync_filecopy";
+
+print("1. Bring up set");
+var replTest = new ReplSetTest({ name: basename, nodes: 2 });
+replTest.startSet();
+replTest.initiate();
+
+var m = replTest.getMaster();
+var mc = m.getDB("d")["c"];
+
+print("2. Insert some data");
+var N = 5000;
+mc.ensureIndex({ x: 1 });
+var bulk = mc.initializeUnorderedBulkOp();
+for (var i = 0; i < N; ++i) {
+    bulk.insert({ _id: i, x: i });
+}
+assert.writeOK(bulk.execute());
+replTest.awaitReplication();
+var secondary = replTest.liveNodes.slaves[0];
+
+print("3. Bring up a new node that copies data files");
+var ports = allocatePorts(3);
+var hostname = getHostName();
+var s = startMongodTest(ports[2], basename, false,
+                        { replSet: basename, oplogSize: 2,
+                          setParameter: "initialSyncFromDataFiles=true" });
+
+var config = replTest.getReplSetConfig();
+var secondaryHost = config.members[replTest.getNodeId(secondary)].host;
+
+// Only a secondary is copied from.  Until the new node has picked its sync source, it can't
+// reach the primary, so the secondary is the only choice.  It still gets the config from the
+// heartbeats the others send it.
+var primaryHost = config.members[replTest.getNodeId(m)].host;
+assert.commandWorked(s.getDB("admin").runCommand({ configureFailPoint: "rsStopHeartbeatRequest",
+                                                   mode: "alwaysOn",
+                                                   data: { member: primaryHost } }));
+
+config.version = 2;
+config.members.push({ _id: 2, host: hostname + ":" + ports[2] });
+try {
+    m.getDB("admin").runCommand({ replSetReconfig: config });
+}
+catch (e) {
+    print(e);
+}
+reconnect(s);
+
+wait(function() {
+    var status = s.getDB("admin").runCommand({ replSetGetStatus: 1 });
+    printjson(status);
+    return status.initialSyncFileCopyStatus != undefined;
+});
+assert.commandWorked(s.getDB("admin").runCommand({ configureFailPoint: "rsStopHeartbeatRequest",
+                                                   mode: "off" }));
+
+print("4. Write while the new node syncs");
+for (i = N; i < N * 2; i++) {
+    mc.insert({ _id: i, x: i });
+}
+
+print("5. Wait for new node to become SECONDARY");
+wait(function() {
+    var status = s.getDB("admin").runCommand({ replSetGetStatus: 1 });
+    printjson(status);
+    return status.members && status.members[2].state == 2;
+});
+
+var status = s.getDB("admin").runCommand({ replSetGetStatus: 1 });
+var copy = status.initialSyncFileCopyStatus;
+assert(copy, tojson(status));
+assert.eq(secondaryHost, copy.source, tojson(copy));
+assert(!copy.inProgress, tojson(copy));
+assert.eq(copy.files, copy.filesDone, tojson(copy));
+assert.eq(copy.bytes, copy.bytesCopied, tojson(copy));
+assert.eq(undefined, status.initialSyncStatus, tojson(status));
+
+print("6. Wait for new node to have all the data");
+s.setSlaveOk();
+var sc = s.getDB("d")["c"];
+wait(function() {
+    return sc.count() == mc.count();
+});
+assert.eq(mc.getIndexKeys().length, sc.getIndexKeys().length);
+assert.eq(N * 2, sc.find().hint({ x: 1 }).itcount());
+
+// the source was unlocked after the copy
+assert.writeOK(mc.insert({ _id: "last" }, { writeConcern: { w: 3, wtimeout: 60000 } }));
+
+replTest.stopSet(15);
@@ -0,0 +1,93 @@
+// Initial sync that clones several databases and collections at once, and splits up the large
+// ones with parallelCollectionScan.
+
+load("jstests/replsets/rslib.js");
+var basename = "jstests_initsync_parallel";
+
+print("1. Bring up set");
+var replTest = new ReplSetTest({ name: basename, nodes: 1 });
+replTest.startSet();
+replTest.initiate();
+
+var m = replTest.getMaster();
+
+print("2. Insert some data");
+// Big enough to take up several extents, so that parallelCollectionScan can split it.
+var N = 5000;
+var pad = new Array(1024).join("x");
+var big = m.getDB("d1").big;
+big.ensureIndex({ x: 1 });
+var bulk = big.initializeUnorderedBulkOp();
+for (var i = 0; i < N; ++i) {
+    bulk.insert({ _id: i, x: i, pad: pad });
+}
+assert.writeOK(bulk.execute());
+
+var small = ["d1.a", "d1.b", "d2.a", "d2.b", "d3.a"];
+small.forEach(function(ns) {
+    var c = m.getCollection(ns);
+    c.ensureIndex({ y: 1 }, { unique: true });
+    for (var i = 0; i < 10; ++i) {
+        assert.writeOK(c.insert({ _id: i, y: i }));
+    }
+});
+
+print("3. Bring up a new node that splits up collections over 1KB");
+var ports = allocatePorts(2);
+var hostname = getHostName();
+var s = startMongodTest(ports[1], basename, false,
+                        { replSet: basename, oplogSize: 2,
+                          setParameter: "initialSyncSplitCollectionBytes=1024" });
+
+var config = replTest.getReplSetConfig();
+config.version = 2;
+config.members.push({ _id: 1, host: hostname + ":" + ports[1] });
+try {
+    m.getDB("admin").runCommand({ replSetReconfig: config });
+}
+catch (e) {
+    print(e);
+}
+reconnect(s);
+
+print("4. Wait for new node to become SECONDARY");
+wait(function() {
+    var status = s.getDB("admin").runCommand({ replSetGetStatus: 1 });
+    printjson(status);
+    return status.members && status.members[1].state == 2;
+});
+
+print("5. Check the data and the progress report");
+s.setSlaveOk();
+assert.eq(N, s.getDB("d1").big.count());
+assert.eq(N, s.getDB("d1").big.find().hint({ x: 1 }).itcount());
+small.forEach(function(ns) {
+    var c = s.getCollection(ns);
+    assert.eq(10, c.count(), ns);
+    assert.eq(2, c.getIndexKeys().length, ns);
+});
+
+var status = s.getDB("admin").runCommand({ replSetGetStatus: 1 });
+var clone = status.initialSyncStatus;
+assert(clone, tojson(status));
+assert.eq(config.members[0].host, clone.source, tojson(clone));
+assert.lt(1, clone.threads, tojson(clone));
+assert(!clone.inProgress, tojson(clone));
+assert.eq(0, clone.collectionsPending, tojson(clone));
+assert.eq(clone.collections.length, clone.collectionsDone, tojson(clone));
+assert.lte(N + small.length * 10, clone.documentsCopied, tojson(clone));
+
+var byNs = {};
+clone.collections.forEach(function(c) {
+    assert.eq("done", c.state, tojson(c));
+    byNs[c.ns] = c;
+});
+assert(byNs["d1.big"], tojson(clone));
+assert.eq(N, byNs["d1.big"].documents, tojson(clone));
+assert.lt(1, byNs["d1.big"].parts, tojson(clone));
+small.forEach(function(ns) {
+    assert(byNs[ns], ns + " " + tojson(clone));
+    assert.eq(10, byNs[ns].documents, tojson(byNs[ns]));
+});
+
+replTest.stopSet(15);
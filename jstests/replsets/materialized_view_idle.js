@@ -0,0 +1,42 @@
+// A materialized view whose source is quiet still advances its appliedThrough as the oplog grows,
+// so that a busy server rolling its oplog over doesn't force a rebuild.
+
+var replTest = new ReplSetTest({name: 'materialized_view_idle', nodes: 1,
+                                nodeOptions: {setParameter:
+                                              "materializedViewMonitorSleepMillis=100"}});
+replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getPrimary();
+assert.commandWorked(primary.adminCommand({setParameter: 1,
+                                           materializedViewIdleProgressSecs: 0}));
+var testDB = primary.getDB('test');
+var oplog = primary.getDB('local').oplog.rs;
+
+function viewStats() {
+    return testDB.serverStatus().materializedViews['test.view'];
+}
+
+function tsGte(a, b) {
+    return a.t > b.t || (a.t == b.t && a.i >= b.i);
+}
+
+testDB.source.insert({k: 'a'});
+assert.commandWorked(testDB.runCommand({createMaterializedView: 'view',
+                                        source: 'source',
+                                        pipeline: [{$group: {_id: '$k', n: {$sum: 1}}}]}));
+
+// Only other collections are written to.
+for (var i = 0; i < 100; i++) {
+    testDB.other.insert({i: i});
+}
+assert.eq(null, testDB.getLastError());
+var last = oplog.find({ns: 'test.other'}).sort({$natural: -1}).limit(1).next().ts;
+
+var rebuilds = viewStats().rebuilds;
+assert.soon(function() { return tsGte(viewStats().appliedThrough, last); },
+            'appliedThrough did not advance past ops on other collections');
+assert.eq(rebuilds, viewStats().rebuilds);
+assert.eq(1, testDB.view.findOne({_id: 'a'}).n);
+
+replTest.stopSet();
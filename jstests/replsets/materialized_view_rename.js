@@ -0,0 +1,56 @@
+// Renaming a materialized view's source, away or onto it, rebuilds the view.  renameCollection is
+// logged to admin.$cmd rather than to the source's database.
+
+var replTest = new ReplSetTest({name: 'materialized_view_rename', nodes: 1,
+                                nodeOptions: {setParameter:
+                                              "materializedViewMonitorSleepMillis=100"}});
+replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getPrimary();
+var testDB = primary.getDB('test');
+
+function group(key) {
+    var doc = testDB.view.findOne({_id: key});
+    return doc ? doc.n : 0;
+}
+
+function rebuilds() {
+    var stats = testDB.serverStatus().materializedViews['test.view'];
+    return stats ? stats.rebuilds : 0;
+}
+
+testDB.source.insert([{k: 'a'}, {k: 'a'}, {k: 'a'}]);
+assert.commandWorked(testDB.runCommand({createMaterializedView: 'view',
+                                        source: 'source',
+                                        pipeline: [{$group: {_id: '$k', n: {$sum: 1}}}]}));
+assert.eq(3, group('a'));
+
+// Renaming the source away leaves nothing to aggregate.
+var before = rebuilds();
+assert.commandWorked(testDB.source.renameCollection('source_old'));
+assert.soon(function() { return group('a') == 0; }, 'view not rebuilt after renaming the source');
+assert.gt(rebuilds(), before);
+
+// Renaming another collection onto the source replaces its contents.
+testDB.other.insert([{k: 'b'}, {k: 'b'}]);
+before = rebuilds();
+assert.commandWorked(testDB.other.renameCollection('source'));
+assert.soon(function() { return group('b') == 2; },
+            'view not rebuilt after renaming onto the source');
+assert.gt(rebuilds(), before);
+assert.eq(0, group('a'));
+
+// A rename across databases is logged the same way.
+var otherDB = primary.getDB('test_other');
+otherDB.elsewhere.insert({k: 'c'});
+before = rebuilds();
+assert.commandWorked(primary.getDB('admin').runCommand({renameCollection: 'test_other.elsewhere',
+                                                        to: 'test.source',
+                                                        dropTarget: true}));
+assert.soon(function() { return group('c') == 1; },
+            'view not rebuilt after renaming across databases');
+assert.gt(rebuilds(), before);
+assert.eq(0, group('b'));
+
+replTest.stopSet();
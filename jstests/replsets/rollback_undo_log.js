@@ -0,0 +1,102 @@
+// Rollback with the local undo log turned on: the documents the old primary updated or deleted
+// are put back from their pre-images instead of being refetched from the new primary.
+
+function wait(f) {
+    var n = 0;
+    while (!f()) {
+        assert(n++ < 200, 'tried 200 times, giving up');
+        sleep(1000);
+    }
+}
+
+function reconnect(a, b) {
+    wait(function() {
+        try {
+            a.bar.stats();
+            b.bar.stats();
+            return true;
+        }
+        catch(e) {
+            print(e);
+            return false;
+        }
+    });
+}
+
+function rollbackMetrics(admin) {
+    return admin.runCommand({ serverStatus: 1 }).metrics.repl.rollback;
+}
+
+var replTest = new ReplSetTest({ name: 'rollbackUndoLog', nodes: 3,
+                                 nodeOptions: { setParameter: "rollbackUndoLogSizeMB=16" } });
+var nodes = replTest.nodeList();
+var conns = replTest.startSet();
+replTest.initiate({ "_id": "rollbackUndoLog",
+                    "members": [
+                        { "_id": 0, "host": nodes[0] },
+                        { "_id": 1, "host": nodes[1] },
+                        { "_id": 2, "host": nodes[2], arbiterOnly: true }]
+                  });
+
+var master = replTest.getMaster();
+assert(master == conns[0], "conns[0] assumed to be master");
+
+var A = conns[0].getDB("admin");
+var B = conns[1].getDB("admin");
+conns[0].setSlaveOk();
+conns[1].setSlaveOk();
+var a = conns[0].getDB("foo");
+var b = conns[1].getDB("foo");
+
+wait(function() { return A.runCommand({ replSetGetStatus: 1 }).members[1].state == 2; });
+
+// replicated everywhere
+a.bar.insert({ _id: 1, q: 1 });
+a.bar.insert({ _id: 2, q: 2 });
+a.bar.insert({ _id: 3, q: 3, a: [1, 2] });
+a.bar.insert({ _id: 4, q: 4 });
+replTest.awaitReplication();
+
+// make B primary with A unable to see it
+A.runCommand({ replSetTest: 1, blind: true });
+reconnect(a, b);
+wait(function() { return B.isMaster().ismaster; });
+
+// these will be rolled back
+b.bar.update({ _id: 1 }, { $set: { rb: true } });
+b.bar.update({ _id: 1 }, { $inc: { q: 10 } });
+b.bar.update({ _id: 3 }, { $push: { a: 3 } });
+b.bar.remove({ _id: 2 });
+b.bar.insert({ _id: 5, q: 5 });
+b.bar.update({ _id: 5 }, { $set: { rb: true } });
+assert.eq(null, b.getLastError());
+
+// switch back to A and write there
+B.runCommand({ replSetTest: 1, blind: true });
+reconnect(a, b);
+A.runCommand({ replSetTest: 1, blind: false });
+reconnect(a, b);
+wait(function() { try { return !B.isMaster().ismaster; } catch(e) { return false; } });
+wait(function() { try { return A.isMaster().ismaster; } catch(e) { return false; } });
+
+a.bar.update({ _id: 4 }, { $set: { kept: true } });
+
+// B rolls back
+var before = rollbackMetrics(B);
+B.runCommand({ replSetTest: 1, blind: false });
+reconnect(a, b);
+wait(function() { return B.isMaster().secondary; });
+replTest.awaitReplication();
+
+var after = rollbackMetrics(B);
+assert.eq(4, after.undoLogDocs - before.undoLogDocs, tojson(after));
+assert.eq(before.refetchedDocs, after.refetchedDocs, tojson(after));
+
+assert.eq(a.bar.find().sort({ _id: 1 }).toArray(), b.bar.find().sort({ _id: 1 }).toArray());
+assert.eq({ _id: 1, q: 1 }, b.bar.findOne({ _id: 1 }));
+assert.eq({ _id: 2, q: 2 }, b.bar.findOne({ _id: 2 }));
+assert.eq({ _id: 3, q: 3, a: [1, 2] }, b.bar.findOne({ _id: 3 }));
+assert.eq(null, b.bar.findOne({ _id: 5 }));
+assert.eq({ _id: 4, q: 4, kept: true }, b.bar.findOne({ _id: 4 }));
+
+replTest.stopSet(15);
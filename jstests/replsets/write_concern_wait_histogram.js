@@ -0,0 +1,38 @@
+// Writes that wait for replication are counted by w in serverStatus, and a w:2 write returns as
+// soon as the secondary has it.
+
+var replTest = new ReplSetTest({ name: 'wtimeByW', nodes: 3 });
+replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var coll = primary.getDB("test").wtimeByW;
+
+function wtimeByW() {
+    return primary.getDB("admin").serverStatus().metrics.getLastError.wtimeByW;
+}
+
+var before = wtimeByW();
+for (var i = 0; i < 20; i++) {
+    assert.writeOK(coll.insert({ _id: i }, { writeConcern: { w: 2, wtimeout: 60000 } }));
+}
+assert.writeOK(coll.insert({ _id: "majority" }, { writeConcern: { w: "majority", wtimeout: 60000 } }));
+var after = wtimeByW();
+printjson(after);
+
+var before2 = before["2"] ? before["2"].count : 0;
+assert.eq(before2 + 20, after["2"].count, tojson(after));
+var beforeMajority = before.majority ? before.majority.count : 0;
+assert.eq(beforeMajority + 1, after.majority.count, tojson(after));
+
+var total = 0;
+after["2"].buckets.forEach(function(b) { total += b.count; });
+assert.eq(after["2"].count, total, tojson(after));
+
+// nothing to wait for: a w:3 write with a secondary down times out, and is counted too
+replTest.stop(2);
+var res = coll.insert({ _id: "timeout" }, { writeConcern: { w: 3, wtimeout: 1000 } });
+assert(res.hasWriteConcernError(), tojson(res));
+assert.eq(1, wtimeByW()["3"].count, tojson(wtimeByW()));
+
+replTest.stopSet();
@@ -0,0 +1,74 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/catalog/capped_insert_notifier.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace mongo {
+
+    CappedInsertNotifier::CappedInsertNotifier()
+        : _mutex("CappedInsertNotifier"),
+          _version(0),
+          _dead(false) {
+    }
+
+    void CappedInsertNotifier::notifyOfInsert() {
+        scoped_lock lk(_mutex);
+        _version++;
+        _notifier.notify_all();
+    }
+
+    uint64_t CappedInsertNotifier::getVersion() const {
+        scoped_lock lk(_mutex);
+        return _version;
+    }
+
+    bool CappedInsertNotifier::waitForInsert(uint64_t prevVersion, int timeoutMillis) const {
+        scoped_lock lk(_mutex);
+        while (!_dead && _version == prevVersion) {
+            if (!_notifier.timed_wait(lk.boost(),
+                                      boost::posix_time::milliseconds(timeoutMillis))) {
+                return _dead || _version != prevVersion;
+            }
+        }
+        return true;
+    }
+
+    void CappedInsertNotifier::kill() {
+        scoped_lock lk(_mutex);
+        _dead = true;
+        _notifier.notify_all();
+    }
+
+    bool CappedInsertNotifier::isDead() const {
+        scoped_lock lk(_mutex);
+        return _dead;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,86 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/cstdint.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * Lets tailable awaitData cursors on a capped collection sleep until something is inserted
+     * into it, instead of polling.
+     *
+     * The Collection of every capped collection owns one and bumps its version after each
+     * insert.  A getMore that hits EOF notes the version while it still holds the collection
+     * lock, then, having released the lock, waits for the version to move on.  Waiters keep a
+     * shared_ptr to the notifier so that it outlives a dropped collection; the Collection kills
+     * it on the way out, which wakes them.
+     */
+    class CappedInsertNotifier {
+        MONGO_DISALLOW_COPYING(CappedInsertNotifier);
+    public:
+        CappedInsertNotifier();
+
+        /**
+         * Wakes every waiter.  Called with the collection write-locked.
+         */
+        void notifyOfInsert();
+
+        /**
+         * The number of inserts seen so far.  Read it with the collection locked to get a
+         * version consistent with what a query saw.
+         */
+        uint64_t getVersion() const;
+
+        /**
+         * Waits up to 'timeoutMillis' for the version to go past 'prevVersion'.  Returns true if
+         * it did or the notifier was killed, false on timeout.
+         */
+        bool waitForInsert(uint64_t prevVersion, int timeoutMillis) const;
+
+        /**
+         * Wakes every waiter for good.  Called when the collection goes away.
+         */
+        void kill();
+
+        bool isDead() const;
+
+    private:
+        mutable mutex _mutex;
+        mutable boost::condition _notifier;
+
+        uint64_t _version;
+        bool _dead;
+    };
+
+}  // namespace mongo
@@ -40,6 +40,7 @@
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/ops/update.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/transaction.h"
 #include "mongo/db/structure/catalog/namespace_details.h"
 #include "mongo/db/structure/catalog/namespace_details_rsv1_metadata.h"
@@ -95,6 +96,7 @@ namespace mongo {
                                                          new NamespaceDetailsRSV1MetaData( details ),
                                                          database->getExtentManager(),
                                                          _ns.coll() == "system.indexes" ) );
+            _cappedNotifier.reset( new CappedInsertNotifier() );
         }
         else {
             _recordStore.reset( new SimpleRecordStoreV1( txn,
@@ -103,12 +105,17 @@ namespace mongo {
                                                          database->getExtentManager(),
                                                          _ns.coll() == "system.indexes" ) );
         }
+        if ( _ns.isOplog() )
+            _oplogStartIndex.reset( new OplogStartIndex( this ) );
+
         _magic = 1357924;
         _indexCatalog.init(txn);
     }
 
     Collection::~Collection() {
         verify( ok() );
+        if ( _cappedNotifier )
+            _cappedNotifier->kill();
         _magic = 0;
     }
 
@@ -182,9 +189,38 @@ namespace mongo {
         if ( !loc.isOK() )
             return loc;
 
+        if ( _oplogStartIndex )
+            _oplogStartIndex->noteInsert( loc.getValue(), doc->documentSize() );
+
+        if ( _cappedNotifier )
+            _cappedNotifier->notifyOfInsert();
+
         return StatusWith<DiskLoc>( loc );
     }
 
+    Status Collection::insertDocuments( TransactionExperiment* txn,
+                                        const std::vector<const DocWriter*>& docs,
+                                        bool enforceQuota,
+                                        std::vector<DiskLoc>* locs ) {
+        verify( _indexCatalog.numIndexesTotal() == 0 );
+
+        const size_t numBefore = locs->size();
+        Status status = _recordStore->insertRecords( txn,
+                                                     docs,
+                                                     enforceQuota ? largestFileNumberInQuota() : 0,
+                                                     locs );
+
+        if ( _oplogStartIndex ) {
+            for ( size_t i = numBefore; i < locs->size(); i++ )
+                _oplogStartIndex->noteInsert( (*locs)[i], docs[i - numBefore]->documentSize() );
+        }
+
+        if ( _cappedNotifier && locs->size() > numBefore )
+            _cappedNotifier->notifyOfInsert();
+
+        return status;
+    }
+
     StatusWith<DiskLoc> Collection::insertDocument( TransactionExperiment* txn,
                                                     const BSONObj& docToInsert,
                                                     bool enforceQuota ) {
@@ -251,6 +287,9 @@ namespace mongo {
 
         _infoCache.notifyOfWriteOp();
 
+        if ( _oplogStartIndex )
+            _oplogStartIndex->noteInsert( loc.getValue(), docToInsert.objsize() );
+
         try {
             _indexCatalog.indexRecord(txn, docToInsert, loc.getValue());
         }
@@ -268,6 +307,9 @@ namespace mongo {
             return StatusWith<DiskLoc>( e.toStatus( "insertDocument" ) );
         }
 
+        if ( _cappedNotifier )
+            _cappedNotifier->notifyOfInsert();
+
         return loc;
     }
 
@@ -275,6 +317,9 @@ namespace mongo {
 
         BSONObj doc = docFor( loc );
 
+        if ( _oplogStartIndex )
+            _oplogStartIndex->noteCappedDelete( loc );
+
         /* check if any cursors point to us.  if so, advance them. */
         _cursorCache.invalidateDocument(loc, INVALIDATION_DELETION);
 
@@ -453,6 +498,9 @@ namespace mongo {
             std::memcpy(targetPtr, sourcePtr, where->size);
         }
 
+        // In-place updates don't change which plans are good, but they do change results.
+        _infoCache.getResultCache()->invalidate();
+
         return Status::OK();
     }
 
@@ -492,6 +540,10 @@ namespace mongo {
             result->appendBool( "capped", true );
             result->appendNumber( "max", _details->maxCappedDocs() );
         }
+
+        if ( internalQueryResultCacheMaxBytes > 0 ) {
+            result->append( "queryResultCache", _infoCache.getResultCache()->getStats().toBSON() );
+        }
     }
 
     bool Collection::isCapped() const {
@@ -532,6 +584,8 @@ namespace mongo {
             return status;
         _cursorCache.invalidateAll( false );
         _infoCache.reset();
+        if ( _oplogStartIndex )
+            _oplogStartIndex->reset();
 
         // 3) truncate record store
         status = _recordStore->truncate(txn);
@@ -554,6 +608,9 @@ namespace mongo {
         invariant( isCapped() );
         reinterpret_cast<CappedRecordStoreV1*>(
             _recordStore.get())->temp_cappedTruncateAfter( txn, end, inclusive );
+        _infoCache.getResultCache()->invalidate();
+        if ( _oplogStartIndex )
+            _oplogStartIndex->reset();
     }
 
     namespace {
@@ -32,6 +32,8 @@
 
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 #include "mongo/base/string_data.h"
 #include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/db/catalog/collection_cursor_cache.h"
@@ -41,7 +43,9 @@
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/structure/capped_callback.h"
 #include "mongo/db/structure/record_store.h"
+#include "mongo/db/catalog/capped_insert_notifier.h"
 #include "mongo/db/catalog/collection_info_cache.h"
+#include "mongo/db/catalog/oplog_start_index.h"
 #include "mongo/platform/cstdint.h"
 
 namespace mongo {
@@ -117,6 +121,20 @@ namespace mongo {
         CollectionInfoCache* infoCache() { return &_infoCache; }
         const CollectionInfoCache* infoCache() const { return &_infoCache; }
 
+        /**
+         * The timestamp index used by OplogStart.  NULL unless this collection is an oplog.
+         */
+        OplogStartIndex* getOplogStartIndex() const { return _oplogStartIndex.get(); }
+
+        /**
+         * Signalled on every insert, for awaitData cursors to wait on.  Empty unless this
+         * collection is capped.  The notifier is shared so that a waiter can hold on to it
+         * after releasing its lock.
+         */
+        boost::shared_ptr<CappedInsertNotifier> getCappedInsertNotifier() const {
+            return _cappedNotifier;
+        }
+
         const NamespaceString& ns() const { return _ns; }
 
         const IndexCatalog* getIndexCatalog() const { return &_indexCatalog; }
@@ -172,6 +190,15 @@ namespace mongo {
                                             const DocWriter* doc,
                                             bool enforceQuota );
 
+        /**
+         * Inserts a run of documents in order, letting the record store reserve space for them
+         * together.  Like the DocWriter insertDocument, only for collections without indexes.
+         */
+        Status insertDocuments( TransactionExperiment* txn,
+                                const std::vector<const DocWriter*>& docs,
+                                bool enforceQuota,
+                                std::vector<DiskLoc>* locs );
+
         StatusWith<DiskLoc> insertDocument( TransactionExperiment* txn,
                                             const BSONObj& doc,
                                             MultiIndexBlock& indexBlock );
@@ -312,6 +339,12 @@ namespace mongo {
         CollectionInfoCache _infoCache;
         IndexCatalog _indexCatalog;
 
+        // only for oplogs
+        scoped_ptr<OplogStartIndex> _oplogStartIndex;
+
+        // only for capped collections
+        boost::shared_ptr<CappedInsertNotifier> _cappedNotifier;
+
         // this is mutable because read only users of the Collection class
         // use it keep state.  This seems valid as const correctness of Collection
         // should be about the data.
@@ -43,7 +43,8 @@ namespace mongo {
         : _collection( collection ),
           _keysComputed( false ),
           _planCache(new PlanCache(collection->ns().ns())),
-          _querySettings(new QuerySettings()) { }
+          _querySettings(new QuerySettings()),
+          _resultCache(new QueryResultCache(collection->ns().ns())) { }
 
     void CollectionInfoCache::reset() {
         Lock::assertWriteLocked( _collection->ns().ns() );
@@ -77,12 +78,18 @@ namespace mongo {
         if (NULL != _planCache.get()) {
             _planCache->notifyOfWriteOp();
         }
+        if (NULL != _resultCache.get()) {
+            _resultCache->invalidate();
+        }
     }
 
     void CollectionInfoCache::clearQueryCache() {
         if (NULL != _planCache.get()) {
             _planCache->clear();
         }
+        if (NULL != _resultCache.get()) {
+            _resultCache->clear();
+        }
     }
 
     PlanCache* CollectionInfoCache::getPlanCache() const {
@@ -93,4 +100,8 @@ namespace mongo {
         return _querySettings.get();
     }
 
+    QueryResultCache* CollectionInfoCache::getResultCache() const {
+        return _resultCache.get();
+    }
+
 }
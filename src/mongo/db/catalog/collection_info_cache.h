@@ -35,6 +35,7 @@
 #include "mongo/db/index_set.h"
 #include "mongo/db/query/query_settings.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/query_result_cache.h"
 
 namespace mongo {
 
@@ -68,6 +69,11 @@ namespace mongo {
          */
         QuerySettings* getQuerySettings() const;
 
+        /**
+         * Get the QueryResultCache for this collection.
+         */
+        QueryResultCache* getResultCache() const;
+
         // -------------------
 
         /* get set of index keys for this namespace.  handy to quickly check if a given
@@ -88,7 +94,8 @@ namespace mongo {
 
         void clearQueryCache();
 
-        /* you must notify the cache if you are doing writes, as query plan utility will change */
+        /* you must notify the cache if you are doing writes, as query plan utility will change
+           and cached query results become stale */
         void notifyOfWriteOp();
 
     private:
@@ -106,6 +113,9 @@ namespace mongo {
         // Includes index filters.
         boost::scoped_ptr<QuerySettings> _querySettings;
 
+        // Results of recent queries, thrown away on every write.
+        boost::scoped_ptr<QueryResultCache> _resultCache;
+
         void computeIndexKeys();
     };
 
@@ -0,0 +1,187 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/catalog/oplog_start_index.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/base/counter.h"
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/structure/record_store.h"
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER(oplogStartIndexSampleBytes, int, 1024 * 1024);
+
+    static Counter64 lookupsCounter;
+    static ServerStatusMetricField<Counter64> displayLookups("repl.oplogStartIndex.lookups",
+                                                            &lookupsCounter);
+    // lookups the index answered, and lookups left to the backwards scan
+    static Counter64 hitsCounter;
+    static ServerStatusMetricField<Counter64> displayHits("repl.oplogStartIndex.hits",
+                                                         &hitsCounter);
+    static Counter64 missesCounter;
+    static ServerStatusMetricField<Counter64> displayMisses("repl.oplogStartIndex.misses",
+                                                           &missesCounter);
+    static Counter64 seedsCounter;
+    static ServerStatusMetricField<Counter64> displaySeeds("repl.oplogStartIndex.seeds",
+                                                          &seedsCounter);
+
+    OplogStartIndex::OplogStartIndex(const Collection* collection)
+        : _collection(collection),
+          _mutex("OplogStartIndex"),
+          _seeded(false),
+          _bytesSinceSample(0) {
+    }
+
+    DiskLoc OplogStartIndex::findStart(const MatchExpression* tsFilter) {
+        lookupsCounter.increment();
+
+        scoped_lock lk(_mutex);
+        if (!_seeded) {
+            _seed_inlock();
+        }
+
+        // The entries are in timestamp order and tsFilter is a lower bound on the timestamp, so
+        // the entries it matches are a suffix.  Find where the suffix begins.
+        size_t lo = 0;
+        size_t hi = _entries.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (tsFilter->matchesBSON(_collection->docFor(_entries[mid].second))) {
+                hi = mid;
+            }
+            else {
+                lo = mid + 1;
+            }
+        }
+
+        if (0 == lo) {
+            missesCounter.increment();
+            return DiskLoc();
+        }
+
+        hitsCounter.increment();
+        return _entries[lo - 1].second;
+    }
+
+    void OplogStartIndex::noteInsert(const DiskLoc& loc, int size) {
+        scoped_lock lk(_mutex);
+        if (!_seeded) {
+            return;
+        }
+
+        _bytesSinceSample += size;
+        if (_bytesSinceSample < oplogStartIndexSampleBytes) {
+            return;
+        }
+
+        OpTime ts;
+        if (!_tsFor(loc, &ts)) {
+            return;
+        }
+
+        // An entry out of order would break the binary search.
+        if (!_entries.empty() && !(_entries.back().first < ts)) {
+            return;
+        }
+
+        _entries.push_back(Entry(ts, loc));
+        _bytesSinceSample = 0;
+    }
+
+    void OplogStartIndex::noteCappedDelete(const DiskLoc& loc) {
+        scoped_lock lk(_mutex);
+        if (_entries.empty()) {
+            return;
+        }
+
+        if (_entries.front().second == loc) {
+            _entries.pop_front();
+            return;
+        }
+
+        // The capped collection deletes its oldest records first, so every entry up to the
+        // deleted record's timestamp is gone or about to be.
+        OpTime ts;
+        if (!_tsFor(loc, &ts)) {
+            return;
+        }
+        while (!_entries.empty() && !(ts < _entries.front().first)) {
+            _entries.pop_front();
+        }
+    }
+
+    void OplogStartIndex::reset() {
+        scoped_lock lk(_mutex);
+        _entries.clear();
+        _seeded = false;
+        _bytesSinceSample = 0;
+    }
+
+    size_t OplogStartIndex::numEntries() const {
+        scoped_lock lk(_mutex);
+        return _entries.size();
+    }
+
+    void OplogStartIndex::_seed_inlock() {
+        seedsCounter.increment();
+
+        // One iterator per extent.  The first record of an extent is the oldest one in it.
+        OwnedPointerVector<RecordIterator> iterators(_collection->getManyIterators());
+
+        std::vector<Entry> firsts;
+        for (size_t i = 0; i < iterators.size(); i++) {
+            DiskLoc loc = iterators[i]->getNext();
+            OpTime ts;
+            if (!loc.isNull() && _tsFor(loc, &ts)) {
+                firsts.push_back(Entry(ts, loc));
+            }
+        }
+        std::sort(firsts.begin(), firsts.end());
+
+        _entries.assign(firsts.begin(), firsts.end());
+        _bytesSinceSample = 0;
+        _seeded = true;
+    }
+
+    bool OplogStartIndex::_tsFor(const DiskLoc& loc, OpTime* ts) const {
+        BSONElement tsElt = _collection->docFor(loc)["ts"];
+        if (Timestamp != tsElt.type()) {
+            return false;
+        }
+        *ts = tsElt._opTime();
+        return true;
+    }
+
+}  // namespace mongo
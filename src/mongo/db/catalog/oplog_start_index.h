@@ -0,0 +1,112 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <utility>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/optime.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class Collection;
+    class MatchExpression;
+
+    // About how many bytes of oplog are inserted between two indexed entries.
+    extern int oplogStartIndexSampleBytes;
+
+    /**
+     * A sparse, in-memory map from oplog timestamp to the DiskLoc of the oplog entry with that
+     * timestamp.  The Collection of an oplog keeps one so that OplogStart can position a
+     * tailing query with a binary search instead of walking the oplog backwards.
+     *
+     * The index is seeded on the first lookup with the first entry of every extent, then
+     * samples about one inserted entry per oplogStartIndexSampleBytes.  Entries are dropped as
+     * the capped oplog deletes them, and the whole index starts over when the oplog is
+     * truncated (e.g. by rollback).
+     *
+     * Lookups run under a read lock on the local database and so can be concurrent with each
+     * other; maintenance runs under the write lock.  A mutex covers both.
+     */
+    class OplogStartIndex {
+        MONGO_DISALLOW_COPYING(OplogStartIndex);
+    public:
+        explicit OplogStartIndex(const Collection* collection);
+
+        /**
+         * Returns the newest indexed entry that 'tsFilter', a $gt or $gte over "ts", does not
+         * match.  A forward scan from there sees every entry that matches.  Returns a null
+         * DiskLoc if there's no such entry, e.g. if every indexed entry matches, in which case the
+         * caller must find the start some other way.
+         */
+        DiskLoc findStart(const MatchExpression* tsFilter);
+
+        /**
+         * Called after the record at 'loc', 'size' bytes long, is inserted.
+         */
+        void noteInsert(const DiskLoc& loc, int size);
+
+        /**
+         * Called before the capped collection deletes its oldest record, at 'loc'.
+         */
+        void noteCappedDelete(const DiskLoc& loc);
+
+        /**
+         * Forgets everything.  The next lookup seeds the index again.
+         */
+        void reset();
+
+        size_t numEntries() const;
+
+    private:
+        typedef std::pair<OpTime, DiskLoc> Entry;
+
+        void _seed_inlock();
+
+        // Returns false if the record at 'loc' has no timestamp "ts".
+        bool _tsFor(const DiskLoc& loc, OpTime* ts) const;
+
+        const Collection* _collection; // owns us
+
+        mutable mutex _mutex;
+
+        // Nothing is indexed until the first lookup.
+        bool _seeded;
+
+        // Ascending by timestamp.
+        std::deque<Entry> _entries;
+
+        // Bytes inserted since the last sampled entry.
+        long long _bytesSinceSample;
+    };
+
+}  // namespace mongo
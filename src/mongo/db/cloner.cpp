@@ -409,8 +409,6 @@ namespace mongo {
             }
         }
 
-        string systemNamespacesNS = opts.fromDB + ".system.namespaces";
-
         list<BSONObj> toClone;
         if ( clonedColls ) clonedColls->clear();
         if ( opts.syncData ) {
@@ -420,60 +418,10 @@ namespace mongo {
             mayInterrupt( opts.mayBeInterrupted );
             dbtempreleaseif r( opts.mayYield );
 
-            // just using exhaust for collection copying right now
-
-            // todo: if snapshot (bool param to this func) is true, we need to snapshot this query?
-            //       only would be relevant if a thousands of collections -- maybe even then it is hard
-            //       to exceed a single cursor batch.
-            //       for repl it is probably ok as we apply oplog section after the clone (i.e. repl
-            //       doesnt not use snapshot=true).
-            auto_ptr<DBClientCursor> cursor = _conn->query(systemNamespacesNS, BSONObj(), 0, 0, 0,
-                                                      opts.slaveOk ? QueryOption_SlaveOk : 0);
-
-            if (!validateQueryResults(cursor, errCode, errmsg)) {
-                errmsg = str::stream() << "index query on ns " << systemNamespacesNS
-                                       << " failed: " << errmsg;
+            if ( !listCollectionsToClone( _conn.get(), opts, &toClone, clonedColls,
+                                          errmsg, errCode ) ) {
                 return false;
             }
-
-            while ( cursor->more() ) {
-                BSONObj collection = cursor->next();
-
-                LOG(2) << "\t cloner got " << collection << endl;
-
-                BSONElement e = collection.getField("name");
-                if ( e.eoo() ) {
-                    string s = "bad system.namespaces object " + collection.toString();
-                    massert( 10290 , s.c_str(), false);
-                }
-                verify( !e.eoo() );
-                verify( e.type() == String );
-                const char *from_name = e.valuestr();
-
-                if( strstr(from_name, ".system.") ) {
-                    /* system.users and s.js is cloned -- but nothing else from system.
-                     * system.indexes is handled specially at the end*/
-                    if( legalClientSystemNS( from_name , true ) == 0 ) {
-                        LOG(2) << "\t\t not cloning because system collection" << endl;
-                        continue;
-                    }
-                }
-                if( ! NamespaceString::normal( from_name ) ) {
-                    LOG(2) << "\t\t not cloning because has $ " << endl;
-                    continue;
-                }
-
-                if( opts.collsToIgnore.find( string( from_name ) ) != opts.collsToIgnore.end() ){
-                    LOG(2) << "\t\t ignoring collection " << from_name << endl;
-                    continue;
-                }
-                else {
-                    LOG(2) << "\t\t not ignoring collection " << from_name << endl;
-                }
-
-                if ( clonedColls ) clonedColls->insert( from_name );
-                toClone.push_back( collection.getOwned() );
-            }
         }
 
         for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
@@ -547,6 +495,71 @@ namespace mongo {
         return true;
     }
 
+    bool Cloner::listCollectionsToClone(DBClientBase* conn,
+                                        const CloneOptions& opts,
+                                        list<BSONObj>* toClone,
+                                        set<string>* clonedColls,
+                                        string& errmsg,
+                                        int* errCode) {
+        string systemNamespacesNS = opts.fromDB + ".system.namespaces";
+
+        // just using exhaust for collection copying right now
+
+        // todo: if snapshot (bool param to this func) is true, we need to snapshot this query?
+        //       only would be relevant if a thousands of collections -- maybe even then it is hard
+        //       to exceed a single cursor batch.
+        //       for repl it is probably ok as we apply oplog section after the clone (i.e. repl
+        //       doesnt not use snapshot=true).
+        auto_ptr<DBClientCursor> cursor = conn->query(systemNamespacesNS, BSONObj(), 0, 0, 0,
+                                                      opts.slaveOk ? QueryOption_SlaveOk : 0);
+
+        if (!validateQueryResults(cursor, errCode, errmsg)) {
+            errmsg = str::stream() << "index query on ns " << systemNamespacesNS
+                                   << " failed: " << errmsg;
+            return false;
+        }
+
+        while ( cursor->more() ) {
+            BSONObj collection = cursor->next();
+
+            LOG(2) << "\t cloner got " << collection << endl;
+
+            BSONElement e = collection.getField("name");
+            if ( e.eoo() ) {
+                string s = "bad system.namespaces object " + collection.toString();
+                massert( 10290 , s.c_str(), false);
+            }
+            verify( !e.eoo() );
+            verify( e.type() == String );
+            const char *from_name = e.valuestr();
+
+            if( strstr(from_name, ".system.") ) {
+                /* system.users and s.js is cloned -- but nothing else from system.
+                 * system.indexes is handled specially at the end*/
+                if( legalClientSystemNS( from_name , true ) == 0 ) {
+                    LOG(2) << "\t\t not cloning because system collection" << endl;
+                    continue;
+                }
+            }
+            if( ! NamespaceString::normal( from_name ) ) {
+                LOG(2) << "\t\t not cloning because has $ " << endl;
+                continue;
+            }
+
+            if( opts.collsToIgnore.find( string( from_name ) ) != opts.collsToIgnore.end() ){
+                LOG(2) << "\t\t ignoring collection " << from_name << endl;
+                continue;
+            }
+            else {
+                LOG(2) << "\t\t not ignoring collection " << from_name << endl;
+            }
+
+            if ( clonedColls ) clonedColls->insert( from_name );
+            toClone->push_back( collection.getOwned() );
+        }
+        return true;
+    }
+
     bool Cloner::cloneFrom(TransactionExperiment* txn,
                            Client::Context& context,
                            const string& masterHost,
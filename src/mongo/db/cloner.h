@@ -93,6 +93,18 @@ namespace mongo {
                               int* errCode = 0,
                               set<string>* clonedCollections = 0);
 
+        /**
+         * Appends to 'toClone' the system.namespaces entries, on 'conn', of the collections in
+         * opts.fromDB that go() copies, and adds their names to 'clonedColls' if it isn't NULL.
+         * Returns false and sets 'errmsg' (and '*errCode' if given) if they can't be read.
+         */
+        static bool listCollectionsToClone(DBClientBase* conn,
+                                           const CloneOptions& opts,
+                                           list<BSONObj>* toClone,
+                                           set<string>* clonedColls,
+                                           string& errmsg,
+                                           int* errCode = 0);
+
         /**
          * Copy a collection (and indexes) from a remote host
          */
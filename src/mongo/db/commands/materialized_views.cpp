@@ -0,0 +1,125 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/materialized_views.h"
+
+namespace mongo {
+
+    /**
+     * { createMaterializedView: <target collection>, source: <collection>, pipeline: [...] }
+     */
+    class CmdCreateMaterializedView : public Command {
+    public:
+        CmdCreateMaterializedView() : Command( "createMaterializedView" ) {}
+        virtual bool slaveOk() const { return false; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help( stringstream &help ) const {
+            help << "{ createMaterializedView:<targetName>, source:<sourceName>, pipeline:[...] }\n"
+                 << "keeps the result of a $match/$group pipeline over source in target, "
+                 << "updated from the oplog";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet sourceActions;
+            sourceActions.addAction(ActionType::find);
+            std::string source = cmdObj.getStringField("source");
+            uassert(17510, "bad 'source' value", !source.empty());
+            out->push_back(Privilege(ResourcePattern::forExactNamespace(
+                                             NamespaceString(dbname, source)),
+                                     sourceActions));
+
+            ActionSet targetActions;
+            targetActions.addAction(ActionType::createCollection);
+            targetActions.addAction(ActionType::insert);
+            targetActions.addAction(ActionType::update);
+            targetActions.addAction(ActionType::remove);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), targetActions));
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            string target = jsobj.getStringField( "createMaterializedView" );
+            string source = jsobj.getStringField( "source" );
+            BSONElement pipeline = jsobj["pipeline"];
+
+            if ( target.empty() || source.empty() || pipeline.type() != Array ) {
+                errmsg = "invalid command spec";
+                return false;
+            }
+
+            DBDirectClient conn;
+            createMaterializedView( &conn,
+                                    NamespaceString( dbname, source ),
+                                    NamespaceString( dbname, target ),
+                                    pipeline.Obj() );
+            return true;
+        }
+    } cmdCreateMaterializedView;
+
+    /**
+     * { dropMaterializedView: <target collection> }
+     */
+    class CmdDropMaterializedView : public Command {
+    public:
+        CmdDropMaterializedView() : Command( "dropMaterializedView" ) {}
+        virtual bool slaveOk() const { return false; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help( stringstream &help ) const {
+            help << "{ dropMaterializedView:<targetName> }\n"
+                 << "stops maintaining a materialized view and drops it";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::dropCollection);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            string target = jsobj.getStringField( "dropMaterializedView" );
+            if ( target.empty() ) {
+                errmsg = "invalid command spec";
+                return false;
+            }
+
+            DBDirectClient conn;
+            if ( !dropMaterializedView( &conn, NamespaceString( dbname, target ) ) ) {
+                errmsg = "no such materialized view";
+                return false;
+            }
+            return true;
+        }
+    } cmdDropMaterializedView;
+
+}  // namespace mongo
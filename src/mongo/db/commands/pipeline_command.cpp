@@ -48,10 +48,14 @@
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/find_constants.h"
 #include "mongo/db/query/get_runner.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 
 namespace mongo {
 
+    // How many threads may a $group use to group its input?  See DocumentSourceGroup::populate().
+    MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceGroupThreads, int, 1);
+
 namespace {
 
     /**
@@ -281,6 +285,7 @@ namespace {
             intrusive_ptr<ExpressionContext> pCtx =
                 new ExpressionContext(InterruptStatusMongod::status, NamespaceString(ns));
             pCtx->tempDir = storageGlobalParams.dbpath + "/_tmp";
+            pCtx->groupThreads = std::max(1, internalDocumentSourceGroupThreads);
 
             /* try to parse the command; if this fails, then we didn't run */
             intrusive_ptr<Pipeline> pPipeline = Pipeline::parseCommand(errmsg, cmdObj, pCtx);
@@ -39,6 +39,7 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/query/explain_plan.h"
 #include "mongo/db/query/plan_ranker.h"
+#include "mongo/db/query/query_solution.h"
 
 namespace {
 
@@ -412,6 +413,18 @@ namespace mongo {
         }
         plansBuilder.doneFast();
 
+        // Usage of the cache by queries of this shape, and the cost estimate that the cached
+        // plan was chosen under.  Runs of the cached plan that do very different amounts of work
+        // send the next query of the shape back to the planner and are counted as replans.
+        BSONObjBuilder shapeBob(bob->subobjStart("shapeStats"));
+        shapeBob.appendNumber("hits", entry->numHits);
+        shapeBob.appendNumber("replans", entry->numReplans);
+        shapeBob.appendNumber("timesPlanned", entry->numPlanned);
+        if (NULL != entry->costEstimate.get()) {
+            shapeBob.append("costEstimate", entry->costEstimate->toBSON());
+        }
+        shapeBob.doneFast();
+
         return Status::OK();
     }
 
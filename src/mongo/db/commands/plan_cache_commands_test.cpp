@@ -380,4 +380,32 @@ namespace {
         ASSERT_EQUALS(plans.size(), 2U);
     }
 
+    TEST(PlanCacheCommandsTest, planCacheListPlansShapeStats) {
+        // Create a canonical query
+        CanonicalQuery* cqRaw;
+        ASSERT_OK(CanonicalQuery::canonicalize(ns, fromjson("{a: 1}"), &cqRaw));
+        auto_ptr<CanonicalQuery> cq(cqRaw);
+
+        PlanCache planCache;
+        QuerySolution qs;
+        qs.cacheData.reset(createSolutionCacheData());
+        qs.costEstimate.reset(new PlanCostEstimate());
+        qs.costEstimate->works = 12;
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+        ASSERT_OK(planCache.recordHit(*cq));
+        ASSERT_OK(planCache.recordHit(*cq));
+        ASSERT_OK(planCache.recordReplan(*cq));
+
+        BSONObjBuilder bob;
+        BSONObj cmdObj = BSON("query" << cq->getQueryObj());
+        ASSERT_OK(PlanCacheListPlans::list(planCache, ns, cmdObj, &bob));
+        BSONObj shapeStats = bob.obj().getObjectField("shapeStats");
+        ASSERT_EQUALS(shapeStats["hits"].numberLong(), 2LL);
+        ASSERT_EQUALS(shapeStats["replans"].numberLong(), 1LL);
+        ASSERT_EQUALS(shapeStats["timesPlanned"].numberLong(), 1LL);
+        ASSERT_EQUALS(shapeStats.getObjectField("costEstimate")["works"].numberDouble(), 12.0);
+    }
+
 }  // namespace
@@ -616,6 +616,7 @@ namespace mongo {
 
     static void singleInsert( const BSONObj& docToInsert,
                               Collection* collection,
+                              std::vector<BSONObj>* pendingLog,
                               WriteOpResult* result );
 
     static void singleCreateIndex( const BSONObj& indexDesc,
@@ -677,6 +678,17 @@ namespace mongo {
          */
         Collection* getCollection() { return _collection; }
 
+        /**
+         * Logs the inserts in pendingLog to the oplog as one run.  Must be called while the
+         * write lock is still held; unlock() does so.
+         */
+        void logPendingInserts();
+
+        // Inserted documents not yet logged to the oplog, and their total size.  Inserts are
+        // logged in runs so the oplog space for a run is reserved once.
+        std::vector<BSONObj> pendingLog;
+        int pendingLogBytes;
+
         // Request object describing the inserts.
         const BatchedCommandRequest* request;
 
@@ -801,26 +813,36 @@ namespace mongo {
 
         ElapsedTracker elapsedTracker(128, 10); // 128 hits or 10 ms, matching RunnerYieldPolicy's
 
-        for (state.currIndex = 0;
-             state.currIndex < state.request->sizeWriteOps();
-             ++state.currIndex) {
+        // Inserts are logged to the oplog in runs (see ExecInsertsState::logPendingInserts), so
+        // the lock must not be dropped here, not even by an exception, before the last run is
+        // logged.
+        try {
+            for (state.currIndex = 0;
+                 state.currIndex < state.request->sizeWriteOps();
+                 ++state.currIndex) {
 
-            if (elapsedTracker.intervalHasElapsed()) {
-                // Consider yielding between inserts.
+                if (elapsedTracker.intervalHasElapsed()) {
+                    // Consider yielding between inserts.
 
-                killCurrentOp.checkForInterrupt();
-                elapsedTracker.resetLastTime();
-            }
+                    killCurrentOp.checkForInterrupt();
+                    elapsedTracker.resetLastTime();
+                }
 
-            WriteErrorDetail* error = NULL;
-            execOneInsert(&state, &error);
-            if (error) {
-                errors->push_back(error);
-                error->setIndex(state.currIndex);
-                if (request.getOrdered())
-                    return;
+                WriteErrorDetail* error = NULL;
+                execOneInsert(&state, &error);
+                if (error) {
+                    errors->push_back(error);
+                    error->setIndex(state.currIndex);
+                    if (request.getOrdered())
+                        break;
+                }
             }
         }
+        catch (...) {
+            state.unlock();
+            throw;
+        }
+        state.unlock();
     }
 
     void WriteBatchExecutor::execUpdate( const BatchItemRef& updateItem,
@@ -878,6 +900,7 @@ namespace mongo {
     WriteBatchExecutor::ExecInsertsState::ExecInsertsState(const BatchedCommandRequest* aRequest) :
         request(aRequest),
         currIndex(0),
+        pendingLogBytes(0),
         _collection(NULL) {
     }
 
@@ -926,7 +949,20 @@ namespace mongo {
         return false;
     }
 
+    void WriteBatchExecutor::ExecInsertsState::logPendingInserts() {
+        if (pendingLog.empty())
+            return;
+        invariant(hasLock());
+
+        DurTransaction txn;
+        logOps(&txn, "i", _collection->ns().ns().c_str(), pendingLog);
+        pendingLog.clear();
+        pendingLogBytes = 0;
+        txn.commitIfNeeded();
+    }
+
     void WriteBatchExecutor::ExecInsertsState::unlock() {
+        logPendingInserts();
         _collection = NULL;
         _context.reset();
         _writeLock.reset();
@@ -948,7 +984,14 @@ namespace mongo {
         try {
             if (state->lockAndCheck(result)) {
                 if (!state->request->isInsertIndexRequest()) {
-                    singleInsert(insertDoc, state->getCollection(), result);
+                    singleInsert(insertDoc, state->getCollection(), &state->pendingLog, result);
+                    if (!result->getError()) {
+                        state->pendingLogBytes += insertDoc.objsize();
+                        if (state->pendingLog.size() >= logOpsMaxRunDocs ||
+                            state->pendingLogBytes >= logOpsMaxRunBytes) {
+                            state->logPendingInserts();
+                        }
+                    }
                 }
                 else {
                     singleCreateIndex(insertDoc, state->getCollection(), result);
@@ -998,12 +1041,14 @@ namespace mongo {
 
     /**
      * Perform a single insert into a collection.  Requires the insert be preprocessed and the
-     * collection already has been created.
+     * collection already has been created.  The inserted document is appended to 'pendingLog'
+     * rather than logged; see ExecInsertsState::logPendingInserts().
      *
      * Might fault or error, otherwise populates the result.
      */
     static void singleInsert( const BSONObj& docToInsert,
                               Collection* collection,
+                              std::vector<BSONObj>* pendingLog,
                               WriteOpResult* result ) {
 
         const string& insertNS = collection->ns().ns();
@@ -1017,8 +1062,7 @@ namespace mongo {
             result->setError(toWriteError(status.getStatus()));
         }
         else {
-            logOp( &txn, "i", insertNS.c_str(), docToInsert );
-            txn.commitIfNeeded();
+            pendingLog->push_back( docToInsert );
             result->getStats().n = 1;
         }
     }
@@ -61,6 +61,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/log_process_details.h"
+#include "mongo/db/materialized_views.h"
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/pdfile_version.h"
 #include "mongo/db/query/internal_plans.h"
@@ -743,6 +744,7 @@ namespace mongo {
         }
         else {
             startTTLBackgroundJob();
+            startMaterializedViewMonitor();
         }
 
 #ifndef _WIN32
@@ -78,7 +78,7 @@ namespace mongo {
     void AndHashStage::addChild(PlanStage* child) { _children.push_back(child); }
 
     size_t AndHashStage::getMemUsage() const {
-        return _memUsage;
+        return _memUsage + _dataMap.memUsage() + _bloomFilter.memUsage();
     }
 
     bool AndHashStage::isEOF() {
@@ -171,10 +171,11 @@ namespace mongo {
         // We read the first child into our hash table.
         if (_hashingChildren) {
             // Check memory usage of previously hashed results.
-            if (_memUsage > _maxMemUsage) {
+            size_t memUsage = getMemUsage();
+            if (memUsage > _maxMemUsage) {
                 mongoutils::str::stream ss;
-                ss << "hashed AND stage buffered data usage of " << _memUsage
-                   << " bytes exceeds internal limit of " << kDefaultMaxMemUsageBytes << " bytes";
+                ss << "hashed AND stage buffered data usage of " << memUsage
+                   << " bytes exceeds internal limit of " << _maxMemUsage << " bytes";
                 Status status(ErrorCodes::Overflow, ss);
                 *out = WorkingSetCommon::allocateStatusMember( _ws, status);
                 return PlanStage::FAILURE;
@@ -219,8 +220,8 @@ namespace mongo {
             return PlanStage::NEED_TIME;
         }
 
-        DataMap::iterator it = _dataMap.find(member->loc);
-        if (_dataMap.end() == it) {
+        DiskLocHashTable::Entry* entry = probe(member->loc);
+        if (NULL == entry) {
             // Child's output wasn't in every previous child.  Throw it out.
             _ws->free(*out);
             ++_commonStats.needTime;
@@ -229,8 +230,8 @@ namespace mongo {
         else {
             // Child's output was in every previous child.  Merge any key data in
             // the child's output and free the child's just-outputted WSM.
-            WorkingSetID hashID = it->second;
-            _dataMap.erase(it);
+            WorkingSetID hashID = entry->id;
+            _dataMap.erase(member->loc);
 
             WorkingSetMember* olderMember = _ws->get(hashID);
             AndCommon::mergeFrom(olderMember, *member);
@@ -262,6 +263,19 @@ namespace mongo {
         }
     }
 
+    DiskLocHashTable::Entry* AndHashStage::probe(const DiskLoc& loc) {
+        if (!_bloomFilter.mayContain(loc)) {
+            ++_specificStats.bloomFilterRejects;
+            return NULL;
+        }
+
+        DiskLocHashTable::Entry* entry = _dataMap.find(loc);
+        if (NULL == entry) {
+            ++_specificStats.bloomFilterFalsePositives;
+        }
+        return entry;
+    }
+
     PlanStage::StageState AndHashStage::readFirstChild(WorkingSetID* out) {
         verify(_currentChild == 0);
 
@@ -279,9 +293,8 @@ namespace mongo {
             }
 
             verify(member->hasLoc());
-            verify(_dataMap.end() == _dataMap.find(member->loc));
-
-            _dataMap[member->loc] = id;
+            bool inserted = _dataMap.insert(member->loc, id);
+            verify(inserted);
 
             // Update memory stats.
             _memUsage += member->getMemUsage();
@@ -299,6 +312,16 @@ namespace mongo {
                 return PlanStage::IS_EOF;
             }
 
+            // Everything the other children produce is checked against this filter before we look
+            // in _dataMap.
+            _bloomFilter.reset(_dataMap.size());
+            std::vector<DiskLoc> locs;
+            _dataMap.getLocs(&locs);
+            for (size_t i = 0; i < locs.size(); ++i) {
+                _bloomFilter.add(locs[i]);
+            }
+            _specificStats.bloomFilterBits = _bloomFilter.numBits();
+
             ++_commonStats.needTime;
             _specificStats.mapAfterChild.push_back(_dataMap.size());
 
@@ -347,13 +370,14 @@ namespace mongo {
             }
 
             verify(member->hasLoc());
-            if (_dataMap.end() == _dataMap.find(member->loc)) {
+            DiskLocHashTable::Entry* entry = probe(member->loc);
+            if (NULL == entry) {
                 // Ignore.  It's not in any previous child.
             }
             else {
                 // We have a hit.  Copy data into the WSM we already have.
-                _seenMap.insert(member->loc);
-                WorkingSetMember* olderMember = _ws->get(_dataMap[member->loc]);
+                entry->marked = true;
+                WorkingSetMember* olderMember = _ws->get(entry->id);
                 size_t memUsageBefore = olderMember->getMemUsage();
 
                 AndCommon::mergeFrom(olderMember, *member);
@@ -369,27 +393,19 @@ namespace mongo {
             // Finished with a child.
             ++_currentChild;
 
-            // Keep elements of _dataMap that are in _seenMap.
-            DataMap::iterator it = _dataMap.begin();
-            while (it != _dataMap.end()) {
-                if (_seenMap.end() == _seenMap.find(it->first)) {
-                    DataMap::iterator toErase = it;
-                    ++it;
-
-                    // Update memory stats.
-                    WorkingSetMember* member = _ws->get(toErase->second);
-                    _memUsage -= member->getMemUsage();
+            // Keep elements of _dataMap that this child marked.
+            std::vector<WorkingSetID> dropped;
+            _dataMap.retainMarked(&dropped);
+            for (size_t i = 0; i < dropped.size(); ++i) {
+                // Update memory stats.
+                WorkingSetMember* member = _ws->get(dropped[i]);
+                _memUsage -= member->getMemUsage();
 
-                    _ws->free(toErase->second);
-                    _dataMap.erase(toErase);
-                }
-                else { ++it; }
+                _ws->free(dropped[i]);
             }
 
             _specificStats.mapAfterChild.push_back(_dataMap.size());
 
-            _seenMap.clear();
-
             // _dataMap is now the intersection of the first _currentChild nodes.
 
             // If we have nothing to AND with after finishing any child, stop.
@@ -477,9 +493,9 @@ namespace mongo {
         // If it's a mutation the predicates implied by the AND-ing may no longer be true.
         //
         // So, we flag and try to pick it up later.
-        DataMap::iterator it = _dataMap.find(dl);
-        if (_dataMap.end() != it) {
-            WorkingSetID id = it->second;
+        DiskLocHashTable::Entry* entry = _dataMap.find(dl);
+        if (NULL != entry) {
+            WorkingSetID id = entry->id;
             WorkingSetMember* member = _ws->get(id);
             verify(member->loc == dl);
 
@@ -500,7 +516,7 @@ namespace mongo {
             _ws->flagForReview(id);
 
             // And don't return it from this stage.
-            _dataMap.erase(it);
+            _dataMap.erase(dl);
         }
     }
 
@@ -508,7 +524,7 @@ namespace mongo {
         _commonStats.isEOF = isEOF();
 
         _specificStats.memLimit = _maxMemUsage;
-        _specificStats.memUsage = _memUsage;
+        _specificStats.memUsage = getMemUsage();
 
         auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_AND_HASH));
         ret->specific.reset(new AndHashStats(_specificStats));
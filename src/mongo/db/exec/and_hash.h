@@ -33,9 +33,9 @@
 
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/exec/diskloc_hash_table.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/matcher/expression.h"
-#include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
@@ -43,6 +43,10 @@ namespace mongo {
      * Reads from N children, each of which must have a valid DiskLoc.  Uses a hash table to
      * intersect the outputs of the N children, and outputs the intersection.
      *
+     * Once the first child is read, a Bloom filter is built over its DiskLocs.  The remaining
+     * children consult the filter before probing the hash table, so most of the DiskLocs that are
+     * not in the intersection are thrown out without touching the table.
+     *
      * Preconditions: Valid DiskLoc.  More than one child.
      *
      * Any DiskLoc that we keep a reference to that is invalidated before we are able to return it
@@ -67,7 +71,7 @@ namespace mongo {
         void addChild(PlanStage* child);
 
         /**
-         * Returns memory usage.
+         * Returns memory usage: buffered WSM data plus the hash table and Bloom filter.
          * For testing only.
          */
         size_t getMemUsage() const;
@@ -88,6 +92,12 @@ namespace mongo {
         StageState hashOtherChildren(WorkingSetID* out);
         StageState workChild(size_t childNo, WorkingSetID* out);
 
+        /**
+         * Returns the _dataMap entry for 'loc', or NULL if there is none.  Checks the Bloom filter
+         * first.
+         */
+        DiskLocHashTable::Entry* probe(const DiskLoc& loc);
+
         // Not owned by us.
         const Collection* _collection;
 
@@ -107,13 +117,14 @@ namespace mongo {
 
         // _dataMap is filled out by the first child and probed by subsequent children.  This is the
         // hash table that we create by intersecting _children and probe with the last child.
-        typedef unordered_map<DiskLoc, WorkingSetID, DiskLoc::Hasher> DataMap;
-        DataMap _dataMap;
+        //
+        // While _hashingChildren, an entry is marked when the current child produces its DiskLoc.
+        // Unmarked entries are dropped once that child is EOF.
+        DiskLocHashTable _dataMap;
 
-        // Keeps track of what elements from _dataMap subsequent children have seen.
-        // Only used while _hashingChildren.
-        typedef unordered_set<DiskLoc, DiskLoc::Hasher> SeenMap;
-        SeenMap _seenMap;
+        // Built over the DiskLocs in _dataMap once the first child is EOF.  Since we only remove
+        // entries from _dataMap afterwards, it never rejects a DiskLoc that is in the table.
+        DiskLocBloomFilter _bloomFilter;
 
         // True if we're still intersecting _children[0..._children.size()-1].
         bool _hashingChildren;
@@ -128,6 +139,7 @@ namespace mongo {
         // The usage in bytes of all buffered data that we're holding.
         // Memory usage is calculated from keys held in _dataMap only.
         // For simplicity, results in _lookAheadResults do not count towards the limit.
+        // The hash table and Bloom filter are accounted for separately; see getMemUsage().
         size_t _memUsage;
 
         // Upper limit for buffered data memory usage.
@@ -35,22 +35,29 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/client.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_cost_model.h"
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
 
 namespace mongo {
 
     CachedPlanStage::CachedPlanStage(const Collection* collection,
                                      CanonicalQuery* cq,
                                      PlanStage* mainChild,
-                                     PlanStage* backupChild)
+                                     PlanStage* backupChild,
+                                     const PlanCostEstimate* cachedEstimate)
         : _collection(collection),
           _canonicalQuery(cq),
           _mainChildPlan(mainChild),
           _backupChildPlan(backupChild),
           _usingBackupChild(false),
           _alreadyProduced(false),
-          _updatedCache(false) { }
+          _updatedCache(false) {
+        if (NULL != cachedEstimate) {
+            _cachedEstimate.reset(new PlanCostEstimate(*cachedEstimate));
+        }
+    }
 
     CachedPlanStage::~CachedPlanStage() {
         // We may have produced all necessary results without hitting EOF.
@@ -143,6 +150,31 @@ namespace mongo {
         feedback->score = PlanRanker::scoreTree(feedback->stats.get());
 
         PlanCache* cache = _collection->infoCache()->getPlanCache();
+
+        // The cached plan was picked for some particular parameter values.  If what it actually
+        // did for this query is far from what was estimated then, the plan may well be the wrong
+        // one for queries like this, so have the next one plan (and estimate) from scratch.  A
+        // run that stopped before EOF only gives a lower bound on the work.
+        if (internalQueryPlannerEnableCostModel
+            && NULL != _cachedEstimate.get()
+            && !_usingBackupChild
+            && !feedback->stats->children.empty()) {
+            const CommonStats& childStats = feedback->stats->children[0]->common;
+            PlanCostEstimate observed;
+            observed.works = childStats.works;
+            observed.exact = childStats.isEOF;
+            if (!PlanCostModel::similarSelectivity(*_cachedEstimate, observed)) {
+                QLOG() << _canonicalQuery->ns() << ": replanning, cached plan did "
+                       << observed.toBSON().toString() << " against cached estimate "
+                       << _cachedEstimate->toBSON().toString() << endl;
+                LOG(1) << _canonicalQuery->ns() << ": replanning "
+                       << _canonicalQuery->toStringShort()
+                       << " - cached plan was chosen for a different selectivity";
+                cache->recordReplan(*_canonicalQuery);
+                return;
+            }
+        }
+
         Status fbs = cache->feedback(*_canonicalQuery, feedback.release());
 
         if (!fbs.isOK()) {
@@ -33,6 +33,7 @@
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_solution.h"
 
 namespace mongo {
 
@@ -45,10 +46,16 @@ namespace mongo {
      */
     class CachedPlanStage : public PlanStage {
     public:
+        /**
+         * If 'cachedEstimate' is not NULL it is the cost estimate the cached plan was chosen
+         * under.  When we report feedback we check what the plan actually did against it, and
+         * drop the cache entry if the query's selectivity was clearly different.
+         */
         CachedPlanStage(const Collection* collection,
                         CanonicalQuery* cq,
                         PlanStage* mainChild,
-                        PlanStage* backupChild=NULL);
+                        PlanStage* backupChild=NULL,
+                        const PlanCostEstimate* cachedEstimate=NULL);
 
         virtual ~CachedPlanStage();
 
@@ -86,6 +93,9 @@ namespace mongo {
         // Have we updated the cache with our plan stats yet?
         bool _updatedCache;
 
+        // Owned here.  NULL if the cache entry had no cost estimate.
+        boost::scoped_ptr<PlanCostEstimate> _cachedEstimate;
+
         // Stats
         CommonStats _commonStats;
         CachedPlanStats _specificStats;
@@ -0,0 +1,263 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/diskloc_hash_table.h"
+
+#include "mongo/util/assert_util.h"
+
+namespace {
+
+    // The table never gets fuller than 3/4.
+    const size_t kMaxLoadNumerator = 3;
+    const size_t kMaxLoadDenominator = 4;
+
+    const size_t kMinCapacity = 16;
+
+    // The MurmurHash3 64-bit finalizer.  DiskLoc::Hasher just xors the file number and offset,
+    // which is fine for chained buckets but clusters badly under linear probing.
+    inline uint64_t mix64(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+} // namespace
+
+namespace mongo {
+
+    //
+    // DiskLocHashTable
+    //
+
+    DiskLocHashTable::DiskLocHashTable() : _mask(0), _size(0) { }
+
+    // static
+    uint64_t DiskLocHashTable::hash(const DiskLoc& loc) {
+        return mix64((static_cast<uint64_t>(static_cast<uint32_t>(loc.a())) << 32)
+                     | static_cast<uint32_t>(loc.getOfs()));
+    }
+
+    // static
+    size_t DiskLocHashTable::capacityFor(size_t n) {
+        size_t capacity = kMinCapacity;
+        while (capacity * kMaxLoadNumerator < n * kMaxLoadDenominator) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    size_t DiskLocHashTable::findSlot(const DiskLoc& loc) const {
+        dassert(!_slots.empty());
+        size_t idx = hash(loc) & _mask;
+        while (!_slots[idx].loc.isNull() && _slots[idx].loc != loc) {
+            idx = (idx + 1) & _mask;
+        }
+        return idx;
+    }
+
+    bool DiskLocHashTable::insert(const DiskLoc& loc, WorkingSetID id) {
+        invariant(!loc.isNull());
+
+        if (_slots.empty() || (_size + 1) * kMaxLoadDenominator > _slots.size() * kMaxLoadNumerator) {
+            rehash(capacityFor(_size + 1));
+        }
+
+        size_t idx = findSlot(loc);
+        if (!_slots[idx].loc.isNull()) {
+            return false;
+        }
+
+        _slots[idx].loc = loc;
+        _slots[idx].id = id;
+        _slots[idx].marked = false;
+        ++_size;
+        return true;
+    }
+
+    DiskLocHashTable::Entry* DiskLocHashTable::find(const DiskLoc& loc) {
+        if (0 == _size) {
+            return NULL;
+        }
+
+        size_t idx = findSlot(loc);
+        if (_slots[idx].loc.isNull()) {
+            return NULL;
+        }
+        return &_slots[idx];
+    }
+
+    bool DiskLocHashTable::erase(const DiskLoc& loc) {
+        if (0 == _size) {
+            return false;
+        }
+
+        size_t hole = findSlot(loc);
+        if (_slots[hole].loc.isNull()) {
+            return false;
+        }
+
+        // Backward-shift deletion.  Walk the cluster following the hole and move back any entry
+        // whose home slot does not lie cyclically in (hole, j].  This keeps every entry reachable
+        // from its home slot without leaving tombstones behind.
+        size_t j = hole;
+        while (true) {
+            j = (j + 1) & _mask;
+            if (_slots[j].loc.isNull()) {
+                break;
+            }
+
+            size_t home = hash(_slots[j].loc) & _mask;
+            bool homeInRange = (hole < j) ? (hole < home && home <= j)
+                                          : (hole < home || home <= j);
+            if (!homeInRange) {
+                _slots[hole] = _slots[j];
+                hole = j;
+            }
+        }
+
+        _slots[hole] = Entry();
+        --_size;
+        return true;
+    }
+
+    void DiskLocHashTable::retainMarked(std::vector<WorkingSetID>* dropped) {
+        std::vector<Entry> oldSlots;
+        oldSlots.swap(_slots);
+        _size = 0;
+
+        size_t numMarked = 0;
+        for (size_t i = 0; i < oldSlots.size(); ++i) {
+            if (!oldSlots[i].loc.isNull() && oldSlots[i].marked) {
+                ++numMarked;
+            }
+        }
+
+        if (numMarked > 0) {
+            size_t capacity = capacityFor(numMarked);
+            _slots.resize(capacity);
+            _mask = capacity - 1;
+        }
+        else {
+            _mask = 0;
+        }
+
+        for (size_t i = 0; i < oldSlots.size(); ++i) {
+            const Entry& entry = oldSlots[i];
+            if (entry.loc.isNull()) {
+                continue;
+            }
+
+            if (entry.marked) {
+                size_t idx = findSlot(entry.loc);
+                _slots[idx].loc = entry.loc;
+                _slots[idx].id = entry.id;
+                ++_size;
+            }
+            else {
+                dropped->push_back(entry.id);
+            }
+        }
+    }
+
+    void DiskLocHashTable::getLocs(std::vector<DiskLoc>* out) const {
+        for (size_t i = 0; i < _slots.size(); ++i) {
+            if (!_slots[i].loc.isNull()) {
+                out->push_back(_slots[i].loc);
+            }
+        }
+    }
+
+    void DiskLocHashTable::clear() {
+        std::vector<Entry>().swap(_slots);
+        _mask = 0;
+        _size = 0;
+    }
+
+    void DiskLocHashTable::rehash(size_t newCapacity) {
+        dassert(0 == (newCapacity & (newCapacity - 1)));
+        dassert(newCapacity * kMaxLoadNumerator >= _size * kMaxLoadDenominator);
+
+        std::vector<Entry> oldSlots(newCapacity);
+        oldSlots.swap(_slots);
+        _mask = newCapacity - 1;
+
+        for (size_t i = 0; i < oldSlots.size(); ++i) {
+            if (!oldSlots[i].loc.isNull()) {
+                _slots[findSlot(oldSlots[i].loc)] = oldSlots[i];
+            }
+        }
+    }
+
+    //
+    // DiskLocBloomFilter
+    //
+
+    DiskLocBloomFilter::DiskLocBloomFilter() : _numBlocks(0) { }
+
+    void DiskLocBloomFilter::reset(size_t expectedEntries) {
+        _numBlocks = (expectedEntries * kBitsPerEntry + kBitsPerBlock - 1) / kBitsPerBlock;
+        if (0 == _numBlocks) {
+            _numBlocks = 1;
+        }
+        std::vector<uint64_t>(_numBlocks * kWordsPerBlock, 0).swap(_blocks);
+    }
+
+    void DiskLocBloomFilter::add(const DiskLoc& loc) {
+        invariant(isInitialized());
+
+        uint64_t h = DiskLocHashTable::hash(loc);
+        uint64_t* block = &_blocks[(mix64(h) % _numBlocks) * kWordsPerBlock];
+
+        // Each probe uses 9 bits of 'h' to pick one of the 512 bits in the block.
+        for (size_t i = 0; i < kNumProbes; ++i) {
+            size_t bit = (h >> (9 * i)) & (kBitsPerBlock - 1);
+            block[bit / 64] |= (1ULL << (bit % 64));
+        }
+    }
+
+    bool DiskLocBloomFilter::mayContain(const DiskLoc& loc) const {
+        if (!isInitialized()) {
+            return true;
+        }
+
+        uint64_t h = DiskLocHashTable::hash(loc);
+        const uint64_t* block = &_blocks[(mix64(h) % _numBlocks) * kWordsPerBlock];
+
+        for (size_t i = 0; i < kNumProbes; ++i) {
+            size_t bit = (h >> (9 * i)) & (kBitsPerBlock - 1);
+            if (0 == (block[bit / 64] & (1ULL << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,164 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * A map from DiskLoc to WorkingSetID using open addressing with linear probing.
+     *
+     * Each entry is stored inline in a single flat array, so unlike a node-based
+     * unordered_map there is no per-entry allocation and a lookup touches (usually) one cache
+     * line.  Every entry also carries a 'marked' bit that callers can use to remember which
+     * entries were seen during a pass; see retainMarked().
+     *
+     * Null DiskLocs cannot be stored; they are used to denote empty slots.
+     */
+    class DiskLocHashTable {
+    public:
+        struct Entry {
+            Entry() : id(WorkingSet::INVALID_ID), marked(false) { }
+
+            DiskLoc loc;
+            WorkingSetID id;
+            bool marked;
+        };
+
+        DiskLocHashTable();
+
+        /**
+         * Inserts 'loc' -> 'id'.  Returns false, and does not modify the table, if 'loc' is
+         * already present.
+         */
+        bool insert(const DiskLoc& loc, WorkingSetID id);
+
+        /**
+         * Returns the entry for 'loc', or NULL if there is none.  The returned pointer is
+         * invalidated by any call that modifies the table.
+         */
+        Entry* find(const DiskLoc& loc);
+
+        /**
+         * Removes 'loc' from the table.  Returns true if it was present.
+         */
+        bool erase(const DiskLoc& loc);
+
+        /**
+         * Drops every entry that is not marked and clears the mark on the surviving entries.
+         * The WorkingSetIDs of the dropped entries are appended to 'dropped'.  The table is
+         * resized to fit the survivors.
+         */
+        void retainMarked(std::vector<WorkingSetID>* dropped);
+
+        /**
+         * Appends every stored DiskLoc to 'out'.
+         */
+        void getLocs(std::vector<DiskLoc>* out) const;
+
+        void clear();
+
+        size_t size() const { return _size; }
+        bool empty() const { return 0 == _size; }
+
+        /**
+         * Bytes used by the slot array.  This does not count whatever the WorkingSetIDs refer to.
+         */
+        size_t memUsage() const { return _slots.capacity() * sizeof(Entry); }
+
+        static uint64_t hash(const DiskLoc& loc);
+
+    private:
+        // Returns the index of the slot holding 'loc', or the index of the empty slot where it
+        // would be inserted.
+        size_t findSlot(const DiskLoc& loc) const;
+
+        // Re-hashes every entry into a table of 'newCapacity' slots, a power of two.
+        void rehash(size_t newCapacity);
+
+        // Smallest power of two capacity that holds 'n' entries under the max load factor.
+        static size_t capacityFor(size_t n);
+
+        std::vector<Entry> _slots;
+
+        // _slots.size() - 1.  _slots.size() is always a power of two.
+        size_t _mask;
+
+        size_t _size;
+    };
+
+    /**
+     * A Bloom filter over DiskLocs, sized once when it is built.
+     *
+     * The filter is blocked: all of the bits for a given DiskLoc fall into the same 64-byte block,
+     * so a probe costs at most one cache miss.  mayContain() never returns a false negative.
+     */
+    class DiskLocBloomFilter {
+    public:
+        DiskLocBloomFilter();
+
+        /**
+         * Discards any previous contents and sizes the filter for 'expectedEntries' DiskLocs.
+         */
+        void reset(size_t expectedEntries);
+
+        void add(const DiskLoc& loc);
+
+        /**
+         * Returns false if 'loc' was definitely never added.  An empty (never reset) filter
+         * answers true for everything.
+         */
+        bool mayContain(const DiskLoc& loc) const;
+
+        bool isInitialized() const { return !_blocks.empty(); }
+
+        size_t numBits() const { return _blocks.size() * 64; }
+
+        size_t memUsage() const { return _blocks.capacity() * sizeof(uint64_t); }
+
+    private:
+        static const size_t kWordsPerBlock = 8;
+        static const size_t kBitsPerBlock = kWordsPerBlock * 64;
+
+        // Roughly a 1% false positive rate at 10 bits per entry.
+        static const size_t kBitsPerEntry = 10;
+        static const size_t kNumProbes = 6;
+
+        // kWordsPerBlock words per block.
+        std::vector<uint64_t> _blocks;
+
+        size_t _numBlocks;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,164 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/exec/diskloc_hash_table.cpp
+ */
+
+#include <set>
+
+#include "mongo/db/exec/diskloc_hash_table.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    TEST(DiskLocHashTableTest, InsertFind) {
+        DiskLocHashTable table;
+        ASSERT_TRUE(table.empty());
+        ASSERT(NULL == table.find(DiskLoc(0, 1)));
+
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(table.insert(DiskLoc(i % 7, i * 16), i));
+        }
+        ASSERT_EQUALS(1000U, table.size());
+
+        // Duplicates are rejected.
+        ASSERT_FALSE(table.insert(DiskLoc(0, 0), 5000));
+        ASSERT_EQUALS(1000U, table.size());
+
+        for (int i = 0; i < 1000; ++i) {
+            DiskLocHashTable::Entry* entry = table.find(DiskLoc(i % 7, i * 16));
+            ASSERT(NULL != entry);
+            ASSERT_EQUALS(WorkingSetID(i), entry->id);
+        }
+        ASSERT(NULL == table.find(DiskLoc(0, 8)));
+        ASSERT(NULL == table.find(DiskLoc(8, 0)));
+    }
+
+    TEST(DiskLocHashTableTest, EraseKeepsOthersReachable) {
+        DiskLocHashTable table;
+        for (int i = 0; i < 500; ++i) {
+            ASSERT_TRUE(table.insert(DiskLoc(1, i), i));
+        }
+
+        // Erasing from the middle of probe clusters must not hide the entries after them.
+        for (int i = 0; i < 500; i += 3) {
+            ASSERT_TRUE(table.erase(DiskLoc(1, i)));
+        }
+        ASSERT_FALSE(table.erase(DiskLoc(1, 0)));
+
+        for (int i = 0; i < 500; ++i) {
+            DiskLocHashTable::Entry* entry = table.find(DiskLoc(1, i));
+            if (0 == i % 3) {
+                ASSERT(NULL == entry);
+            }
+            else {
+                ASSERT(NULL != entry);
+                ASSERT_EQUALS(WorkingSetID(i), entry->id);
+            }
+        }
+        ASSERT_EQUALS(333U, table.size());
+    }
+
+    TEST(DiskLocHashTableTest, RetainMarked) {
+        DiskLocHashTable table;
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_TRUE(table.insert(DiskLoc(2, i), i));
+        }
+        size_t memBefore = table.memUsage();
+
+        for (int i = 0; i < 100; i += 10) {
+            table.find(DiskLoc(2, i))->marked = true;
+        }
+
+        std::vector<WorkingSetID> dropped;
+        table.retainMarked(&dropped);
+        ASSERT_EQUALS(10U, table.size());
+        ASSERT_EQUALS(90U, dropped.size());
+        ASSERT_LESS_THAN(table.memUsage(), memBefore);
+
+        std::set<WorkingSetID> droppedSet(dropped.begin(), dropped.end());
+        for (int i = 0; i < 100; ++i) {
+            DiskLocHashTable::Entry* entry = table.find(DiskLoc(2, i));
+            if (0 == i % 10) {
+                ASSERT(NULL != entry);
+                // Marks are cleared for the next pass.
+                ASSERT_FALSE(entry->marked);
+                ASSERT_EQUALS(0U, droppedSet.count(i));
+            }
+            else {
+                ASSERT(NULL == entry);
+                ASSERT_EQUALS(1U, droppedSet.count(i));
+            }
+        }
+
+        // Nothing marked drops everything.
+        dropped.clear();
+        table.retainMarked(&dropped);
+        ASSERT_TRUE(table.empty());
+        ASSERT_EQUALS(10U, dropped.size());
+        ASSERT(NULL == table.find(DiskLoc(2, 0)));
+        ASSERT_TRUE(table.insert(DiskLoc(2, 0), 0));
+    }
+
+    TEST(DiskLocBloomFilterTest, NoFalseNegatives) {
+        DiskLocBloomFilter filter;
+
+        // An unbuilt filter can't rule anything out.
+        ASSERT_TRUE(filter.mayContain(DiskLoc(0, 0)));
+
+        filter.reset(10000);
+        for (int i = 0; i < 10000; ++i) {
+            filter.add(DiskLoc(i % 3, i * 32));
+        }
+        for (int i = 0; i < 10000; ++i) {
+            ASSERT_TRUE(filter.mayContain(DiskLoc(i % 3, i * 32)));
+        }
+    }
+
+    TEST(DiskLocBloomFilterTest, FalsePositiveRate) {
+        DiskLocBloomFilter filter;
+        filter.reset(10000);
+        for (int i = 0; i < 10000; ++i) {
+            filter.add(DiskLoc(0, i * 32));
+        }
+
+        size_t falsePositives = 0;
+        for (int i = 0; i < 10000; ++i) {
+            if (filter.mayContain(DiskLoc(1, i * 32))) {
+                ++falsePositives;
+            }
+        }
+
+        // The filter is sized for ~1%.  Allow plenty of slack.
+        ASSERT_LESS_THAN(falsePositives, 500U);
+    }
+
+}  // namespace
@@ -41,6 +41,7 @@ namespace mongo {
           _backwardsScanning(false),
           _extentHopping(false),
           _done(false),
+          _usedIndex(false),
           _collection(collection),
           _workingSet(ws),
           _filter(filter) { }
@@ -50,6 +51,11 @@ namespace mongo {
     PlanStage::StageState OplogStart::work(WorkingSetID* out) {
         // We do our (heavy) init in a work(), where work is expected.
         if (_needInit) {
+            if (PlanStage::ADVANCED == workIndexLookup(out)) {
+                _needInit = false;
+                return PlanStage::ADVANCED;
+            }
+
             CollectionScanParams params;
             params.collection = _collection;
             params.direction = CollectionScanParams::BACKWARD;
@@ -74,6 +80,28 @@ namespace mongo {
         return workExtentHopping(out);
     }
 
+    PlanStage::StageState OplogStart::workIndexLookup(WorkingSetID* out) {
+        OplogStartIndex* index = _collection->getOplogStartIndex();
+        if (NULL == index) {
+            return PlanStage::NEED_TIME;
+        }
+
+        DiskLoc loc = index->findStart(_filter);
+        if (loc.isNull()) {
+            return PlanStage::NEED_TIME;
+        }
+
+        _done = true;
+        _usedIndex = true;
+        WorkingSetID id = _workingSet->allocate();
+        WorkingSetMember* member = _workingSet->get(id);
+        member->loc = loc;
+        member->obj = _collection->docFor(member->loc);
+        member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        *out = id;
+        return PlanStage::ADVANCED;
+    }
+
     PlanStage::StageState OplogStart::workExtentHopping(WorkingSetID* out) {
         if (_done || _subIterators.empty()) {
             return PlanStage::IS_EOF;
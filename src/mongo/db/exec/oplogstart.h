@@ -54,6 +54,9 @@ namespace mongo {
      * inserted before documents in a subsequent extent.  As such we can skip through entire extents
      * looking only at the first document.
      *
+     * Before either, if the collection keeps an OplogStartIndex, we ask it.  It answers with a
+     * binary search over sampled entries, and only when it can't do we fall back to scanning.
+     *
      * Why is this a stage?  Because we want to yield, and we want to be notified of DiskLoc
      * invalidations.  :(
      */
@@ -77,7 +80,11 @@ namespace mongo {
         void setBackwardsScanTime(int newTime) { _backwardsScanTime = newTime; }
         bool isExtentHopping() { return _extentHopping; }
         bool isBackwardsScanning() { return _backwardsScanning; }
+        bool usedIndex() { return _usedIndex; }
     private:
+        // Returns ADVANCED with the start in *out if the collection's OplogStartIndex has it.
+        StageState workIndexLookup(WorkingSetID* out);
+
         StageState workBackwardsScan(WorkingSetID* out);
 
         void switchToExtentHopping();
@@ -103,6 +110,9 @@ namespace mongo {
         // Our final state: done.
         bool _done;
 
+        // Whether the OplogStartIndex found the start.
+        bool _usedIndex;
+
         const Collection* _collection;
 
         // We only go backwards via a collscan for a few seconds.
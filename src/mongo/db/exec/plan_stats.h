@@ -131,7 +131,10 @@ namespace mongo {
         AndHashStats() : flaggedButPassed(0),
                          flaggedInProgress(0),
                          memUsage(0),
-                         memLimit(0) { }
+                         memLimit(0),
+                         bloomFilterBits(0),
+                         bloomFilterRejects(0),
+                         bloomFilterFalsePositives(0) { }
 
         virtual ~AndHashStats() { }
 
@@ -160,6 +163,16 @@ namespace mongo {
 
         // What's our memory limit?
         size_t memLimit;
+
+        // How big is the Bloom filter built over the first child's output?
+        size_t bloomFilterBits;
+
+        // How many DiskLocs from the other children did the Bloom filter throw out without a
+        // hash table lookup?
+        size_t bloomFilterRejects;
+
+        // How many DiskLocs passed the Bloom filter but weren't in the hash table?
+        size_t bloomFilterFalsePositives;
     };
 
     struct AndSortedStats : public SpecificStats {
@@ -39,6 +39,7 @@
 #include <sys/file.h>
 #endif
 
+#include "mongo/base/counter.h"
 #include "mongo/base/status.h"
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/db/audit.h"
@@ -48,6 +49,7 @@
 #include "mongo/db/background.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands/fsync.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbhelpers.h"
@@ -76,6 +78,7 @@
 #include "mongo/db/query/new_find.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/platform/process_id.h"
@@ -116,6 +119,21 @@ namespace mongo {
 
     MONGO_FP_DECLARE(rsStopGetMore);
 
+    // How long an awaitData getMore waits for data before returning an empty batch.
+    MONGO_EXPORT_SERVER_PARAMETER(awaitDataMaxTimeMS, int, 4000);
+
+    // awaitData getMores waiting for an insert right now
+    static Counter64 awaitDataWaitingCounter;
+    static ServerStatusMetricField<Counter64> displayAwaitDataWaiting("cursor.awaitData.waiting",
+                                                                      &awaitDataWaitingCounter);
+    // waits ended by an insert, and waits that timed out
+    static Counter64 awaitDataWakeupsCounter;
+    static ServerStatusMetricField<Counter64> displayAwaitDataWakeups("cursor.awaitData.wakeups",
+                                                                      &awaitDataWakeupsCounter);
+    static Counter64 awaitDataTimeoutsCounter;
+    static ServerStatusMetricField<Counter64> displayAwaitDataTimeouts("cursor.awaitData.timeouts",
+                                                                       &awaitDataTimeoutsCounter);
+
     void inProgCmd( Message &m, DbResponse &dbresponse ) {
         DbMessage d(m);
         QueryMessage q(d);
@@ -676,7 +694,8 @@ namespace mongo {
         int pass = 0;
         bool exhaust = false;
         QueryResult* msgdata = 0;
-        OpTime last;
+        boost::shared_ptr<CappedInsertNotifier> notifier;
+        uint64_t notifierVersion = 0;
         while( 1 ) {
             bool isCursorAuthorized = false;
             try {
@@ -692,13 +711,6 @@ namespace mongo {
                     while (MONGO_FAIL_POINT(rsStopGetMore)) {
                         sleepmillis(0);
                     }
-
-                    if (pass == 0) {
-                        last = getLastSetOptime();
-                    }
-                    else {
-                        waitForOptimeChange(last, 1000/*ms*/);
-                    }
                 }
 
                 msgdata = newGetMore(ns,
@@ -707,7 +719,9 @@ namespace mongo {
                                      curop,
                                      pass,
                                      exhaust,
-                                     &isCursorAuthorized);
+                                     &isCursorAuthorized,
+                                     &notifier,
+                                     &notifierVersion);
             }
             catch ( AssertionException& e ) {
                 if ( isCursorAuthorized ) {
@@ -730,21 +744,31 @@ namespace mongo {
                 if ( ! timer ) {
                     timer.reset( new Timer() );
                 }
+
+                const int remainingMillis = awaitDataMaxTimeMS - timer->millis();
+                if ( remainingMillis <= 0 ) {
+                    // after awaitDataMaxTimeMS, return. pass stops at 1000 normally.
+                    // we want to return occasionally so slave can checkpoint.
+                    pass = 10000;
+                }
+                else if ( notifier ) {
+                    // Wait in slices of at most a second so that killOp and shutdown are
+                    // noticed by the next pass.
+                    awaitDataWaitingCounter.increment();
+                    const bool woken = notifier->waitForInsert( notifierVersion,
+                                                                std::min( remainingMillis, 1000 ) );
+                    awaitDataWaitingCounter.decrement();
+                    if ( woken )
+                        awaitDataWakeupsCounter.increment();
+                    else
+                        awaitDataTimeoutsCounter.increment();
+                }
                 else {
-                    if ( timer->seconds() >= 4 ) {
-                        // after about 4 seconds, return. pass stops at 1000 normally.
-                        // we want to return occasionally so slave can checkpoint.
-                        pass = 10000;
-                    }
+                    sleepmillis( 2 );
                 }
                 pass++;
-                if (debug)
-                    sleepmillis(20);
-                else
-                    sleepmillis(2);
-                
-                // note: the 1100 is beacuse of the waitForDifferent above
-                // should eventually clean this up a bit
+
+                // note: the 1100 is because a pass can wait up to a second above
                 curop.setExpectedLatencyMs( 1100 + timer->millis() );
                 
                 continue;
@@ -781,10 +805,16 @@ namespace mongo {
         return ok;
     }
 
+    /**
+     * Inserts 'js' into 'ns' and logs it.  If 'toLog' is given, a plain document insert is
+     * appended to it instead of being logged, for the caller to pass to logOps() later.  Index
+     * builds are always logged right away.
+     */
     void checkAndInsert(TransactionExperiment* txn,
                         Client::Context& ctx,
                         const char *ns,
-                        /*modifies*/BSONObj& js) {
+                        /*modifies*/BSONObj& js,
+                        vector<BSONObj>* toLog = NULL) {
 
         if ( nsToCollectionSubstring( ns ) == "system.indexes" ) {
             string targetNS = js["ns"].String();
@@ -827,7 +857,10 @@ namespace mongo {
 
         StatusWith<DiskLoc> status = collection->insertDocument( txn, js, true );
         uassertStatusOK( status.getStatus() );
-        logOp(txn, "i", ns, js);
+        if ( toLog )
+            toLog->push_back(js);
+        else
+            logOp(txn, "i", ns, js);
     }
 
     NOINLINE_DECL void insertMulti(TransactionExperiment* txn,
@@ -836,19 +869,51 @@ namespace mongo {
                                    const char *ns,
                                    vector<BSONObj>& objs,
                                    CurOp& op) {
+        // Inserted documents are logged in runs so that the oplog space for a run is reserved
+        // once.  A run is always logged before a journal commit and before leaving here, so no
+        // document becomes durable or visible without its oplog entry.  A run is taken out of
+        // toLog before it is logged, so a failure in logOps() never leads to logging it twice.
+        vector<BSONObj> toLog;
+        int toLogBytes = 0;
+
         size_t i;
-        for (i=0; i<objs.size(); i++){
-            try {
-                checkAndInsert(txn, ctx, ns, objs[i]);
-                txn->commitIfNeeded();
-            } catch (const UserException&) {
-                if (!keepGoing || i == objs.size()-1){
-                    globalOpCounters.incInsertInWriteLock(i);
-                    throw;
+        try {
+            for (i=0; i<objs.size(); i++){
+                const size_t numToLog = toLog.size();
+                try {
+                    checkAndInsert(txn, ctx, ns, objs[i], &toLog);
+                } catch (const UserException&) {
+                    if (!keepGoing || i == objs.size()-1){
+                        globalOpCounters.incInsertInWriteLock(i);
+                        throw;
+                    }
+                    // otherwise ignore and keep going
+                    continue;
+                }
+
+                if (toLog.size() == numToLog) {
+                    // an index build, logged already
+                    if (toLog.empty())
+                        txn->commitIfNeeded();
+                    continue;
+                }
+
+                toLogBytes += toLog.back().objsize();
+                if (toLog.size() >= logOpsMaxRunDocs ||
+                    toLogBytes >= logOpsMaxRunBytes) {
+                    vector<BSONObj> run;
+                    run.swap(toLog);
+                    toLogBytes = 0;
+                    logOps(txn, "i", ns, run);
+                    txn->commitIfNeeded();
                 }
-                // otherwise ignore and keep going
             }
         }
+        catch (...) {
+            logOps(txn, "i", ns, toLog);
+            throw;
+        }
+        logOps(txn, "i", ns, toLog);
 
         globalOpCounters.incInsertInWriteLock(i);
         op.debug().ninserted = i;
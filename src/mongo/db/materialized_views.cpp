@@ -0,0 +1,416 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/materialized_views.h"
+
+#include <map>
+
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/pipeline/materialized_view.h"
+#include "mongo/db/repl/is_master.h"
+#include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/repl_settings.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    using namespace mongoutils;
+
+    MONGO_EXPORT_SERVER_PARAMETER( materializedViewMonitorEnabled, bool, true );
+    MONGO_EXPORT_SERVER_PARAMETER( materializedViewMonitorSleepMillis, int, 1000 );
+
+    // Bounds how much of the oplog one pass reads for a single view, so that a view that has
+    // fallen far behind doesn't hold up the others.
+    MONGO_EXPORT_SERVER_PARAMETER( materializedViewMaxOpsPerPass, int, 100000 );
+
+    // A view whose source is quiet still moves its 'appliedThrough' up to the end of the oplog,
+    // so that it doesn't need a rebuild when the oplog rolls over.  Saving that progress is itself
+    // an oplog entry, so an idle view only does it once this many seconds have gone by.
+    MONGO_EXPORT_SERVER_PARAMETER( materializedViewIdleProgressSecs, int, 60 );
+
+namespace {
+
+    const char definitionsNs[] = "admin.materializedViews";
+
+    // Serializes creating, dropping and applying the oplog to views.
+    mongo::mutex viewsMutex( "materializedViews" );
+
+    struct ViewStats {
+        ViewStats() : stalenessSecs(0), lastPassMillis(0), lastPassOps(0), opsApplied(0),
+                      documentsRefreshed(0), rebuilds(0) {}
+
+        OpTime appliedThrough;
+        long long stalenessSecs; // age of the oldest source op not yet applied
+        long long lastPassMillis;
+        long long lastPassOps;
+        long long opsApplied;
+        long long documentsRefreshed;
+        long long rebuilds;
+        string lastError;
+    };
+
+    mongo::mutex statsMutex( "materializedViewStats" );
+    map<string, ViewStats> viewStats; // by target namespace
+
+    const char* oplogNs() {
+        return theReplSet ? rsoplog : "local.oplog.$main";
+    }
+
+    OpTime oplogTime( DBClientBase* conn, int direction ) {
+        BSONObj op = conn->findOne( oplogNs(), Query().sort( BSON( "$natural" << direction ) ),
+                                    NULL, QueryOption_SlaveOk );
+        return op.isEmpty() ? OpTime() : op["ts"]._opTime();
+    }
+
+    // renameCollection is an admin command, so it is logged to admin.$cmd whatever database
+    // the collections are in.
+    const char adminCommandNs[] = "admin.$cmd";
+
+    Query oplogQuery( const MaterializedView& view, const OpTime& after ) {
+        BSONObjBuilder ts;
+        ts.appendTimestamp( "$gt", after.asDate() );
+        const NamespaceString& source = view.getSourceNs();
+        return Query( BSON( "ts" << ts.obj()
+                         << "ns" << BSON( "$in" << BSON_ARRAY( source.ns()
+                                                            << source.getCommandNS()
+                                                            << adminCommandNs ) ) ) );
+    }
+
+    // True if the command 'op' can change the source in ways that aren't reflected in the oplog
+    // one document at a time (drop, rename, ...).
+    bool commandAffects( const BSONObj& op, const NamespaceString& source ) {
+        const BSONObj o = op["o"].Obj();
+        BSONElement first = o.firstElement();
+
+        // Renaming the source away or another collection onto it.  Both names are in full.
+        if ( str::equals( first.fieldName(), "renameCollection" ) )
+            return first.str() == source.ns() || o["to"].str() == source.ns();
+
+        // Any other admin command only matters to a source in the admin database.
+        if ( op["ns"].str() != source.getCommandNS() )
+            return false;
+
+        if ( str::equals( first.fieldName(), "dropDatabase" ) )
+            return true;
+        return first.type() == String &&
+               ( first.String() == source.coll() || first.String() == source.ns() );
+    }
+
+    void saveProgress( DBClientBase* conn,
+                       const string& targetNs,
+                       const OpTime& appliedThrough,
+                       bool applying ) {
+        BSONObjBuilder set;
+        set.appendTimestamp( "appliedThrough", appliedThrough.asDate() );
+        set.append( "applying", applying );
+        conn->update( definitionsNs, QUERY( "_id" << targetNs ), BSON( "$set" << set.obj() ) );
+        const string err = conn->getLastError();
+        uassert( 17504,
+                 str::stream() << "can't save progress of materialized view " << targetNs
+                               << ": " << err,
+                 err.empty() );
+    }
+
+    // Rebuilds 'view' and returns the point in the oplog it is now up to date with.
+    OpTime rebuild( DBClientBase* conn, MaterializedView& view ) {
+        const string targetNs = view.getTargetNs().ns();
+        const OpTime start = oplogTime( conn, -1 );
+
+        // If the rebuild is interrupted, 'applying' makes the next pass start over.
+        saveProgress( conn, targetNs, start, true );
+        view.rebuild( conn );
+        saveProgress( conn, targetNs, start, false );
+
+        log() << "rebuilt materialized view " << targetNs << endl;
+        return start;
+    }
+
+    /**
+     * Applies the source's oplog entries since the view's 'appliedThrough' to the view.
+     */
+    void applyOplog( DBClientBase* conn, const BSONObj& definition ) {
+        const string targetNs = definition["_id"].String();
+        MaterializedView view( NamespaceString( definition["source"].String() ),
+                               NamespaceString( targetNs ),
+                               definition["pipeline"].Obj() );
+
+        Timer timer;
+        OpTime appliedThrough = definition["appliedThrough"]._opTime();
+        long long opsApplied = 0;
+        long long documentsRefreshed = 0;
+        bool needsRebuild = false;
+
+        if ( definition["applying"].trueValue() ) {
+            // The last pass was interrupted part way, so the target may be inconsistent.
+            needsRebuild = true;
+        }
+        else if ( oplogTime( conn, 1 ) > appliedThrough ) {
+            // The oplog has rolled over past ops we haven't applied.
+            warning() << "materialized view " << targetNs << " fell off the oplog" << endl;
+            needsRebuild = true;
+        }
+
+        // Everything up to here has been written by the time we query, so if the query runs
+        // out of ops the view is up to date with it, even if the source had no ops at all.
+        const OpTime newest = oplogTime( conn, -1 );
+
+        BSONObjSet ids;
+        OpTime lastRead = appliedThrough;
+        if ( !needsRebuild ) {
+            auto_ptr<DBClientCursor> cursor =
+                conn->query( oplogNs(), oplogQuery( view, appliedThrough ), 0, 0, NULL,
+                             QueryOption_OplogReplay | QueryOption_SlaveOk );
+            uassert( 17505, "couldn't query the oplog", cursor.get() );
+
+            while ( opsApplied < materializedViewMaxOpsPerPass && cursor->more() ) {
+                BSONObj op = cursor->nextSafe();
+                lastRead = op["ts"]._opTime();
+                opsApplied++;
+
+                BSONElement id;
+                switch ( *op["op"].valuestrsafe() ) {
+                case 'i':
+                case 'd':
+                    id = op["o"]["_id"];
+                    break;
+                case 'u':
+                    id = op["o2"]["_id"];
+                    break;
+                case 'c':
+                    needsRebuild = commandAffects( op, view.getSourceNs() );
+                    break;
+                default:
+                    break;
+                }
+
+                if ( needsRebuild )
+                    break;
+                if ( !id.eoo() )
+                    ids.insert( id.wrap() );
+            }
+
+            if ( !needsRebuild && !cursor->more() && newest > lastRead &&
+                 ( lastRead != appliedThrough ||
+                   newest.getSecs() >= appliedThrough.getSecs() +
+                                       materializedViewIdleProgressSecs ) ) {
+                lastRead = newest;
+            }
+        }
+
+        if ( needsRebuild ) {
+            appliedThrough = rebuild( conn, view );
+        }
+        else if ( lastRead != appliedThrough ) {
+            // Every op up to 'lastRead' is covered by refreshing the documents it touched, since
+            // a refresh reads the current state of the document.
+            if ( !ids.empty() ) {
+                saveProgress( conn, targetNs, appliedThrough, true );
+                for ( BSONObjSet::const_iterator it = ids.begin(); it != ids.end(); ++it ) {
+                    view.refresh( conn, it->firstElement() );
+                    documentsRefreshed++;
+                }
+            }
+            appliedThrough = lastRead;
+            saveProgress( conn, targetNs, appliedThrough, false );
+        }
+
+        // Staleness is measured from the oldest source op that still hasn't been applied.
+        long long stalenessSecs = 0;
+        BSONObj pending = conn->findOne( oplogNs(), oplogQuery( view, appliedThrough ), NULL,
+                                         QueryOption_OplogReplay | QueryOption_SlaveOk );
+        if ( !pending.isEmpty() ) {
+            stalenessSecs = time( 0 ) - pending["ts"]._opTime().getSecs();
+            if ( stalenessSecs < 0 )
+                stalenessSecs = 0;
+        }
+
+        scoped_lock lk( statsMutex );
+        ViewStats& stats = viewStats[targetNs];
+        stats.appliedThrough = appliedThrough;
+        stats.stalenessSecs = stalenessSecs;
+        stats.lastPassMillis = timer.millis();
+        stats.lastPassOps = opsApplied;
+        stats.opsApplied += opsApplied;
+        stats.documentsRefreshed += documentsRefreshed;
+        if ( needsRebuild )
+            stats.rebuilds++;
+        stats.lastError.clear();
+    }
+
+    bool haveOplog() {
+        return theReplSet || replSettings.master;
+    }
+
+    class MaterializedViewMonitor : public BackgroundJob {
+    public:
+        virtual string name() const { return "MaterializedViewMonitor"; }
+
+        virtual void run() {
+            Client::initThread( name().c_str() );
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            while ( !inShutdown() ) {
+                sleepmillis( materializedViewMonitorSleepMillis );
+
+                if ( !materializedViewMonitorEnabled || !haveOplog() )
+                    continue;
+
+                if ( lockedForWriting() )
+                    continue;
+
+                // Only the primary maintains views; secondaries get the results by replication.
+                if ( !isMasterNs( definitionsNs ) )
+                    continue;
+
+                vector<BSONObj> definitions;
+                auto_ptr<DBClientCursor> cursor = _conn.query( definitionsNs, Query() );
+                while ( cursor.get() && cursor->more() )
+                    definitions.push_back( cursor->nextSafe().getOwned() );
+
+                for ( size_t i = 0; i < definitions.size(); i++ ) {
+                    const string targetNs = definitions[i]["_id"].str();
+                    try {
+                        scoped_lock lk( viewsMutex );
+                        applyOplog( &_conn, definitions[i] );
+                    }
+                    catch ( DBException& e ) {
+                        error() << "error maintaining materialized view " << targetNs << ": "
+                                << e << endl;
+                        scoped_lock lk( statsMutex );
+                        viewStats[targetNs].lastError = e.toString();
+                    }
+                }
+            }
+        }
+
+    private:
+        DBDirectClient _conn;
+    };
+
+    class MaterializedViewServerStats : public ServerStatusSection {
+    public:
+        MaterializedViewServerStats() : ServerStatusSection( "materializedViews" ) {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection( const BSONElement& configElement ) const {
+            BSONObjBuilder b;
+            scoped_lock lk( statsMutex );
+            for ( map<string, ViewStats>::const_iterator it = viewStats.begin();
+                  it != viewStats.end();
+                  ++it ) {
+                const ViewStats& stats = it->second;
+                BSONObjBuilder view( b.subobjStart( it->first ) );
+                view.appendTimestamp( "appliedThrough", stats.appliedThrough.asDate() );
+                view.appendNumber( "stalenessSecs", stats.stalenessSecs );
+                view.appendNumber( "lastPassMillis", stats.lastPassMillis );
+                view.appendNumber( "lastPassOps", stats.lastPassOps );
+                view.appendNumber( "opsApplied", stats.opsApplied );
+                view.appendNumber( "documentsRefreshed", stats.documentsRefreshed );
+                view.appendNumber( "rebuilds", stats.rebuilds );
+                if ( !stats.lastError.empty() )
+                    view.append( "lastError", stats.lastError );
+                view.doneFast();
+            }
+            return b.obj();
+        }
+    } materializedViewServerStats;
+
+}  // namespace
+
+    void startMaterializedViewMonitor() {
+        MaterializedViewMonitor* monitor = new MaterializedViewMonitor();
+        monitor->go();
+    }
+
+    void createMaterializedView( DBClientBase* conn,
+                                 const NamespaceString& sourceNs,
+                                 const NamespaceString& targetNs,
+                                 const BSONObj& pipeline ) {
+        uassert( 17506, "materialized views are maintained from the oplog, which this node lacks",
+                 haveOplog() );
+
+        // Validates the pipeline.
+        MaterializedView view( sourceNs, targetNs, pipeline );
+
+        scoped_lock lk( viewsMutex );
+        uassert( 17507,
+                 str::stream() << targetNs.ns() << " is already a materialized view",
+                 conn->findOne( definitionsNs, QUERY( "_id" << targetNs.ns() ) ).isEmpty() );
+        uassert( 17508,
+                 str::stream() << "target namespace " << targetNs.ns() << " already exists",
+                 !conn->exists( targetNs.ns() ) &&
+                 !conn->exists( view.getContributionsNs().ns() ) );
+
+        BSONObjBuilder definition;
+        definition.append( "_id", targetNs.ns() );
+        definition.append( "source", sourceNs.ns() );
+        definition.appendArray( "pipeline", pipeline );
+        definition.appendTimestamp( "appliedThrough", 0 );
+        definition.append( "applying", true );
+        conn->insert( definitionsNs, definition.obj() );
+        const string err = conn->getLastError();
+        uassert( 17509, str::stream() << "can't save materialized view definition: " << err,
+                 err.empty() );
+
+        const OpTime appliedThrough = rebuild( conn, view );
+
+        scoped_lock statsLk( statsMutex );
+        viewStats[targetNs.ns()].appliedThrough = appliedThrough;
+    }
+
+    bool dropMaterializedView( DBClientBase* conn, const NamespaceString& targetNs ) {
+        scoped_lock lk( viewsMutex );
+
+        BSONObj definition = conn->findOne( definitionsNs, QUERY( "_id" << targetNs.ns() ) );
+        if ( definition.isEmpty() )
+            return false;
+
+        MaterializedView view( NamespaceString( definition["source"].String() ),
+                               targetNs,
+                               definition["pipeline"].Obj() );
+        conn->remove( definitionsNs, QUERY( "_id" << targetNs.ns() ), true );
+        conn->dropCollection( targetNs.ns() );
+        conn->dropCollection( view.getContributionsNs().ns() );
+
+        scoped_lock statsLk( statsMutex );
+        viewStats.erase( targetNs.ns() );
+        return true;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,62 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+
+namespace mongo {
+
+    class DBClientBase;
+
+    /**
+     * Materialized aggregation views: see MaterializedView.  Definitions are kept in
+     * admin.materializedViews so that they replicate; the primary keeps each view's target up to
+     * date by applying the source collection's oplog entries as deltas.
+     */
+
+    /** Starts the background thread that applies the oplog to materialized views. */
+    void startMaterializedViewMonitor();
+
+    /**
+     * Registers a view of 'sourceNs' through 'pipeline' in 'targetNs' and builds it.  Throws a
+     * UserException if the pipeline can't be maintained incrementally or 'targetNs' is taken.
+     */
+    void createMaterializedView(DBClientBase* conn,
+                                const NamespaceString& sourceNs,
+                                const NamespaceString& targetNs,
+                                const BSONObj& pipeline);
+
+    /**
+     * Stops maintaining the view in 'targetNs' and drops its collections.  Returns false if
+     * there was no such view.
+     */
+    bool dropMaterializedView(DBClientBase* conn, const NamespaceString& targetNs);
+
+}  // namespace mongo
@@ -40,6 +40,7 @@
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/rollback_undo_log.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
 
@@ -143,6 +144,10 @@ namespace mongo {
             }
             BSONObj toDelete;
 
+            BSONObj preImage;
+            if (logop && replset::RollbackUndoLog::enabled())
+                preImage = collection->docFor(rloc).getOwned();
+
             // TODO: do we want to buffer docs and delete them in a group rather than
             // saving/restoring state repeatedly?
             runner->saveState();
@@ -158,7 +163,8 @@ namespace mongo {
                 }
                 else {
                     bool replJustOne = true;
-                    logOp(txn, "d", ns.ns().c_str(), toDelete, 0, &replJustOne);
+                    logOp(txn, "d", ns.ns().c_str(), toDelete, 0, &replJustOne, false,
+                          preImage.isEmpty() ? NULL : &preImage);
                 }
             }
 
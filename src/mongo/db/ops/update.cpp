@@ -49,6 +49,7 @@
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/rollback_undo_log.h"
 #include "mongo/db/storage/mmap_v1/dur_transaction.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/platform/unordered_set.h"
@@ -618,6 +619,12 @@ namespace mongo {
                 }
             }
 
+            // Keep the document as it was for the rollback undo log; an in place update is
+            // about to change oldObj.
+            BSONObj preImage;
+            if (request.shouldCallLogOp() && replset::RollbackUndoLog::enabled())
+                preImage = oldObj.getOwned();
+
             // Save state before making changes
             runner->saveState();
 
@@ -669,7 +676,8 @@ namespace mongo {
             if (request.shouldCallLogOp() && !logObj.isEmpty()) {
                 BSONObj idQuery = driver->makeOplogEntryQuery(newObj, request.isMulti());
                 logOp(txn, "u", nsString.ns().c_str(), logObj , &idQuery,
-                      NULL, request.isFromMigration());
+                      NULL, request.isFromMigration(),
+                      preImage.isEmpty() ? NULL : &preImage);
             }
 
             // Only record doc modifications if they wrote (exclude no-ops)
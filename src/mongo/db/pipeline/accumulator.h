@@ -30,10 +30,10 @@
 
 #include "mongo/pch.h"
 
-#include <boost/unordered_set.hpp>
-
 #include "mongo/bson/bsontypes.h"
+#include "mongo/db/pipeline/flat_value_set.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/platform/cstdint.h"
 
 namespace mongo {
     class Accumulator : public RefCountable {
@@ -83,8 +83,12 @@ namespace mongo {
 
     private:
         AccumulatorAddToSet();
-        typedef boost::unordered_set<Value, Value::Hash> SetType;
-        SetType set;
+
+        // Sets _memUsageBytes from the set's current size.
+        void updateMemUsage();
+
+        FlatValueSet set;
+        int _valuesBytes; // sum of the approximate sizes of the Values in 'set'
     };
 
 
@@ -187,4 +191,96 @@ namespace mongo {
         double _total;
         long long _count;
     };
+
+
+    /**
+     * $approxDistinct: estimates the number of distinct values using a HyperLogLog sketch.
+     *
+     * Memory per group is bounded by kNumRegisters bytes no matter how many values are seen,
+     * unlike $addToSet.  Values that compare equal (e.g. 1 and 1.0) count once.  Sketches from
+     * different shards merge without loss.
+     */
+    class AccumulatorApproxDistinct : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual void reset();
+
+        static intrusive_ptr<Accumulator> create();
+
+        /// Bits of the hash used to pick a register.  The standard error is 1.04/sqrt(2^p).
+        static const int kPrecision = 11;
+        static const size_t kNumRegisters = size_t(1) << kPrecision;
+
+    private:
+        AccumulatorApproxDistinct();
+
+        // Raises register 'index' to at least 'rank'.
+        void updateRegister(size_t index, uint8_t rank);
+
+        void convertToDense();
+
+        long long estimate() const;
+
+        void updateMemUsage();
+
+        // Small sketches are sparse: one (index << 8 | rank) entry per non-zero register, sorted
+        // by index.  Once that would be bigger than one byte per register, _dense holds every
+        // register instead and _sparse is empty.
+        vector<uint32_t> _sparse;
+        vector<uint8_t> _dense;
+    };
+
+
+    /**
+     * $approxPercentile: estimates percentiles of the numeric inputs using a t-digest.
+     *
+     * The operand is an object {input: <expression>, p: <number or array of numbers in [0, 1]>}.
+     * In $group each field is parsed as an operand, so p is normally a constant.
+     * The result is the estimated value at p, or an array of estimates if p is an array.
+     * Non-numeric inputs are ignored.  Accuracy is best near the extremes (p close to 0 or 1),
+     * and memory per group is bounded by roughly kCompression centroids.
+     */
+    class AccumulatorApproxPercentile : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual void reset();
+
+        static intrusive_ptr<Accumulator> create();
+
+        static const int kCompression = 100;
+
+    private:
+        AccumulatorApproxPercentile();
+
+        struct Centroid {
+            Centroid(double mean, double weight) : mean(mean), weight(weight) {}
+            bool operator<(const Centroid& other) const { return mean < other.mean; }
+
+            double mean;
+            double weight;
+        };
+
+        void add(double mean, double weight);
+
+        // Merges the _buffer into _centroids.  This doesn't change what getValue() returns, so
+        // it is const and may be called from getValue().
+        void compress() const;
+
+        // Must be called with an empty _buffer and at least one centroid.
+        double quantile(double q) const;
+
+        void updateMemUsage();
+
+        Value _percentiles; // 'p' as given in the operand
+        double _min;
+        double _max;
+        double _totalWeight;
+
+        mutable vector<Centroid> _centroids; // sorted by mean
+        mutable vector<Centroid> _buffer; // not yet merged into _centroids
+    };
 }
@@ -34,11 +34,12 @@
 
 namespace mongo {
     void AccumulatorAddToSet::processInternal(const Value& input, bool merging) {
+        bool inserted;
         if (!merging) {
             if (!input.missing()) {
-                bool inserted = set.insert(input).second;
+                set.insert(input, &inserted);
                 if (inserted) {
-                    _memUsageBytes += input.getApproximateSize();
+                    _valuesBytes += input.getApproximateSize();
                 }
             }
         }
@@ -51,26 +52,33 @@ namespace mongo {
             
             const vector<Value>& array = input.getArray();
             for (size_t i=0; i < array.size(); i++) {
-                bool inserted = set.insert(array[i]).second;
+                set.insert(array[i], &inserted);
                 if (inserted) {
-                    _memUsageBytes += array[i].getApproximateSize();
+                    _valuesBytes += array[i].getApproximateSize();
                 }
             }
         }
+
+        updateMemUsage();
     }
 
     Value AccumulatorAddToSet::getValue(bool toBeMerged) const {
-        vector<Value> valVec(set.begin(), set.end());
-        return Value::consume(valVec);
+        return Value(set.values());
     }
 
     AccumulatorAddToSet::AccumulatorAddToSet() {
-        _memUsageBytes = sizeof(*this);
+        reset();
     }
 
     void AccumulatorAddToSet::reset() {
-        SetType().swap(set);
-        _memUsageBytes = sizeof(*this);
+        set.clear();
+        _valuesBytes = 0;
+        updateMemUsage();
+    }
+
+    void AccumulatorAddToSet::updateMemUsage() {
+        // The set itself is counted by its memUsage(), which includes sizeof(set).
+        _memUsageBytes = sizeof(*this) - sizeof(set) + set.memUsage() + _valuesBytes;
     }
 
     intrusive_ptr<Accumulator> AccumulatorAddToSet::create() {
@@ -0,0 +1,220 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/platform/bits.h"
+
+namespace mongo {
+
+namespace {
+    // Layout of the BinData exchanged when merging: the precision, then kSparse followed by the
+    // sparse entries or kDense followed by every register.
+    const char kSparse = 0;
+    const char kDense = 1;
+    const size_t kHeaderSize = 2;
+
+    const uint64_t kRankBitsMask =
+        (1ULL << (64 - AccumulatorApproxDistinct::kPrecision)) - 1;
+
+    uint64_t hashValue(const Value& value) {
+        size_t seed = 0;
+        value.hash_combine(seed);
+
+        // hash_combine() only needs to be good enough for a hash table and size_t may be 32
+        // bits, so mix the result (MurmurHash3's finalizer) to spread it over all 64 bits.
+        uint64_t h = seed;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    inline size_t entryIndex(uint32_t entry) { return entry >> 8; }
+    inline uint8_t entryRank(uint32_t entry) { return entry & 0xff; }
+    inline uint32_t makeEntry(size_t index, uint8_t rank) { return (index << 8) | rank; }
+}
+
+    void AccumulatorApproxDistinct::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            if (input.missing())
+                return;
+
+            const uint64_t hash = hashValue(input);
+            const size_t index = hash >> (64 - kPrecision);
+            const uint64_t rest = hash & kRankBitsMask;
+
+            // The rank is the position of the first set bit, so it is i with probability 2^-i.
+            const uint8_t rank = rest ? firstBitSet(rest) : (64 - kPrecision + 1);
+            updateRegister(index, rank);
+        }
+        else {
+            // We expect the BinData that getValue(true) produced below.
+            const BSONBinData binData = input.getBinData();
+            const char* data = static_cast<const char*>(binData.data);
+            verify(binData.length >= int(kHeaderSize));
+            verify(data[0] == kPrecision);
+
+            const char* payload = data + kHeaderSize;
+            const size_t payloadSize = binData.length - kHeaderSize;
+            if (data[1] == kDense) {
+                verify(payloadSize == kNumRegisters);
+                convertToDense();
+                for (size_t i = 0; i < kNumRegisters; i++) {
+                    _dense[i] = std::max(_dense[i], static_cast<uint8_t>(payload[i]));
+                }
+            }
+            else {
+                verify(data[1] == kSparse);
+                verify(payloadSize % sizeof(uint32_t) == 0);
+                for (size_t i = 0; i < payloadSize; i += sizeof(uint32_t)) {
+                    uint32_t entry;
+                    memcpy(&entry, payload + i, sizeof(entry));
+                    updateRegister(entryIndex(entry), entryRank(entry));
+                }
+            }
+        }
+
+        updateMemUsage();
+    }
+
+    void AccumulatorApproxDistinct::updateRegister(size_t index, uint8_t rank) {
+        if (!_dense.empty()) {
+            _dense[index] = std::max(_dense[index], rank);
+            return;
+        }
+
+        vector<uint32_t>::iterator it =
+            std::lower_bound(_sparse.begin(), _sparse.end(), makeEntry(index, 0));
+        if (it != _sparse.end() && entryIndex(*it) == index) {
+            if (rank > entryRank(*it))
+                *it = makeEntry(index, rank);
+            return;
+        }
+
+        _sparse.insert(it, makeEntry(index, rank));
+        if (_sparse.size() * sizeof(uint32_t) > kNumRegisters)
+            convertToDense();
+    }
+
+    void AccumulatorApproxDistinct::convertToDense() {
+        if (!_dense.empty())
+            return;
+
+        _dense.resize(kNumRegisters, 0);
+        for (size_t i = 0; i < _sparse.size(); i++) {
+            _dense[entryIndex(_sparse[i])] = entryRank(_sparse[i]);
+        }
+        vector<uint32_t>().swap(_sparse);
+    }
+
+    long long AccumulatorApproxDistinct::estimate() const {
+        // The harmonic mean of 2^register, as in the HyperLogLog paper.
+        const double m = kNumRegisters;
+        double sum = 0;
+        size_t zeros = 0;
+        if (!_dense.empty()) {
+            for (size_t i = 0; i < kNumRegisters; i++) {
+                sum += ldexp(1.0, -_dense[i]);
+                if (_dense[i] == 0)
+                    zeros++;
+            }
+        }
+        else {
+            // Every register without an entry is zero and contributes 2^0.
+            zeros = kNumRegisters - _sparse.size();
+            sum = zeros;
+            for (size_t i = 0; i < _sparse.size(); i++) {
+                sum += ldexp(1.0, -entryRank(_sparse[i]));
+            }
+        }
+
+        const double alpha = 0.7213 / (1 + 1.079 / m);
+        double estimate = alpha * m * m / sum;
+
+        // The raw estimate is biased for small cardinalities, where linear counting over the
+        // empty registers is more accurate.  With a 64-bit hash no large range correction is
+        // needed.
+        if (estimate <= 2.5 * m && zeros != 0)
+            estimate = m * std::log(m / zeros);
+
+        return static_cast<long long>(estimate + 0.5);
+    }
+
+    Value AccumulatorApproxDistinct::getValue(bool toBeMerged) const {
+        if (!toBeMerged)
+            return Value(estimate());
+
+        string data;
+        data += char(kPrecision);
+        if (!_dense.empty()) {
+            data += kDense;
+            data.append(reinterpret_cast<const char*>(&_dense[0]), _dense.size());
+        }
+        else {
+            data += kSparse;
+            if (!_sparse.empty()) {
+                data.append(reinterpret_cast<const char*>(&_sparse[0]),
+                            _sparse.size() * sizeof(uint32_t));
+            }
+        }
+        return Value(BSONBinData(data.data(), data.size(), BinDataGeneral));
+    }
+
+    AccumulatorApproxDistinct::AccumulatorApproxDistinct() {
+        updateMemUsage();
+    }
+
+    void AccumulatorApproxDistinct::reset() {
+        vector<uint32_t>().swap(_sparse);
+        vector<uint8_t>().swap(_dense);
+        updateMemUsage();
+    }
+
+    void AccumulatorApproxDistinct::updateMemUsage() {
+        _memUsageBytes = sizeof(*this)
+                       + _sparse.capacity() * sizeof(uint32_t)
+                       + _dense.capacity();
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorApproxDistinct::create() {
+        return new AccumulatorApproxDistinct();
+    }
+
+    const char *AccumulatorApproxDistinct::getOpName() const {
+        return "$approxDistinct";
+    }
+}
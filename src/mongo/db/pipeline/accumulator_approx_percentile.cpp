@@ -0,0 +1,282 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+    using namespace mongoutils;
+
+namespace {
+    const char inputName[] = "input";
+    const char percentilesName[] = "p";
+    const char minName[] = "min";
+    const char maxName[] = "max";
+    const char centroidsName[] = "centroids";
+
+    const double kPi = 3.14159265358979323846;
+
+    // Unmerged points are buffered and merged into the centroids in batches.
+    const size_t kBufferSize = 2 * AccumulatorApproxPercentile::kCompression;
+
+    void validatePercentile(const Value& p) {
+        uassert(17487, str::stream() << "$approxPercentile's p must be a number between 0 and 1"
+                                     << " or an array of such numbers, not " << p.toString(),
+                p.numeric() && p.getDouble() >= 0 && p.getDouble() <= 1);
+    }
+
+    void validatePercentiles(const Value& p) {
+        if (p.getType() != Array) {
+            validatePercentile(p);
+            return;
+        }
+
+        const vector<Value>& array = p.getArray();
+        uassert(17488, "$approxPercentile's p must not be an empty array", !array.empty());
+        for (size_t i = 0; i < array.size(); i++) {
+            validatePercentile(array[i]);
+        }
+    }
+
+    /**
+     * The t-digest scale function k1.  Neighbouring points may share a centroid only if the
+     * centroid spans at most one unit of k, which keeps centroids small near q = 0 and q = 1 and
+     * bounds their number by about kCompression.
+     */
+    double scale(double q) {
+        return AccumulatorApproxPercentile::kCompression / (2 * kPi) * std::asin(2 * q - 1);
+    }
+}
+
+    void AccumulatorApproxPercentile::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            uassert(17486, "$approxPercentile's operand must be an object with 'input' and 'p'"
+                           " fields",
+                    input.getType() == Object);
+            const Document spec = input.getDocument();
+
+            if (_percentiles.missing()) {
+                const Value p = spec[percentilesName];
+                validatePercentiles(p);
+                _percentiles = p;
+            }
+
+            // non numeric types are ignored, as by $avg
+            const Value value = spec[inputName];
+            if (value.numeric())
+                add(value.getDouble(), 1);
+        }
+        else {
+            // We expect the document that getValue(true) produced below.
+            verify(input.getType() == Object);
+            const Document partial = input.getDocument();
+
+            if (_percentiles.missing())
+                _percentiles = partial[percentilesName];
+
+            const Value centroids = partial[centroidsName];
+            if (!centroids.missing()) {
+                const BSONBinData binData = centroids.getBinData();
+                const char* data = static_cast<const char*>(binData.data);
+                const size_t size = binData.length;
+                verify(size % (2 * sizeof(double)) == 0);
+                for (size_t i = 0; i < size; i += 2 * sizeof(double)) {
+                    double mean;
+                    double weight;
+                    memcpy(&mean, data + i, sizeof(double));
+                    memcpy(&weight, data + i + sizeof(double), sizeof(double));
+                    add(mean, weight);
+                }
+
+                // The centroid means lie between the partial's true min and max.
+                _min = std::min(_min, partial[minName].getDouble());
+                _max = std::max(_max, partial[maxName].getDouble());
+            }
+        }
+
+        updateMemUsage();
+    }
+
+    void AccumulatorApproxPercentile::add(double mean, double weight) {
+        if (_totalWeight == 0) {
+            _min = mean;
+            _max = mean;
+        }
+        else {
+            _min = std::min(_min, mean);
+            _max = std::max(_max, mean);
+        }
+        _totalWeight += weight;
+
+        _buffer.push_back(Centroid(mean, weight));
+        if (_buffer.size() >= kBufferSize)
+            compress();
+    }
+
+    void AccumulatorApproxPercentile::compress() const {
+        if (_buffer.empty())
+            return;
+
+        _buffer.insert(_buffer.end(), _centroids.begin(), _centroids.end());
+        std::sort(_buffer.begin(), _buffer.end());
+
+        vector<Centroid> merged;
+        merged.reserve(_centroids.size() + 1);
+
+        Centroid current = _buffer[0];
+        double weightSoFar = 0; // weight of the centroids before 'current'
+        for (size_t i = 1; i < _buffer.size(); i++) {
+            const Centroid& next = _buffer[i];
+            const double proposed = current.weight + next.weight;
+            const double qLeft = weightSoFar / _totalWeight;
+            const double qRight = std::min(1.0, (weightSoFar + proposed) / _totalWeight);
+
+            if (scale(qRight) - scale(qLeft) <= 1) {
+                current.mean += (next.mean - current.mean) * next.weight / proposed;
+                current.weight = proposed;
+            }
+            else {
+                merged.push_back(current);
+                weightSoFar += current.weight;
+                current = next;
+            }
+        }
+        merged.push_back(current);
+
+        _centroids.swap(merged);
+        _buffer.clear();
+    }
+
+    double AccumulatorApproxPercentile::quantile(double q) const {
+        dassert(_buffer.empty());
+        dassert(!_centroids.empty());
+
+        const Centroid& first = _centroids.front();
+        const Centroid& last = _centroids.back();
+        if (_centroids.size() == 1)
+            return first.mean;
+
+        // Each centroid's weight is taken to be spread evenly around its mean, so the value at
+        // a given rank is interpolated between the means of the neighbouring centroids, or
+        // between the extreme centroids and the min or max.
+        const double rank = q * _totalWeight;
+        if (rank < first.weight / 2)
+            return _min + (first.mean - _min) * rank / (first.weight / 2);
+
+        if (rank > _totalWeight - last.weight / 2) {
+            const double fromLast = rank - (_totalWeight - last.weight / 2);
+            return last.mean + (_max - last.mean) * fromLast / (last.weight / 2);
+        }
+
+        double center = first.weight / 2; // rank at the mean of _centroids[i]
+        for (size_t i = 0; i + 1 < _centroids.size(); i++) {
+            const double gap = (_centroids[i].weight + _centroids[i + 1].weight) / 2;
+            if (rank <= center + gap) {
+                return _centroids[i].mean
+                     + (_centroids[i + 1].mean - _centroids[i].mean) * (rank - center) / gap;
+            }
+            center += gap;
+        }
+        return last.mean;
+    }
+
+    Value AccumulatorApproxPercentile::getValue(bool toBeMerged) const {
+        compress();
+
+        if (toBeMerged) {
+            MutableDocument partial;
+            if (!_percentiles.missing())
+                partial.addField(percentilesName, _percentiles);
+
+            if (!_centroids.empty()) {
+                string data;
+                for (size_t i = 0; i < _centroids.size(); i++) {
+                    data.append(reinterpret_cast<const char*>(&_centroids[i].mean),
+                                sizeof(double));
+                    data.append(reinterpret_cast<const char*>(&_centroids[i].weight),
+                                sizeof(double));
+                }
+                partial.addField(minName, Value(_min));
+                partial.addField(maxName, Value(_max));
+                partial.addField(centroidsName,
+                                 Value(BSONBinData(data.data(), data.size(), BinDataGeneral)));
+            }
+            return Value(partial.freeze());
+        }
+
+        if (_centroids.empty())
+            return Value(BSONNULL);
+
+        if (_percentiles.getType() != Array)
+            return Value(quantile(_percentiles.getDouble()));
+
+        const vector<Value>& percentiles = _percentiles.getArray();
+        vector<Value> out;
+        out.reserve(percentiles.size());
+        for (size_t i = 0; i < percentiles.size(); i++) {
+            out.push_back(Value(quantile(percentiles[i].getDouble())));
+        }
+        return Value(out);
+    }
+
+    AccumulatorApproxPercentile::AccumulatorApproxPercentile() {
+        reset();
+    }
+
+    void AccumulatorApproxPercentile::reset() {
+        _percentiles = Value();
+        _min = 0;
+        _max = 0;
+        _totalWeight = 0;
+        vector<Centroid>().swap(_centroids);
+        vector<Centroid>().swap(_buffer);
+        updateMemUsage();
+    }
+
+    void AccumulatorApproxPercentile::updateMemUsage() {
+        _memUsageBytes = sizeof(*this)
+                       + (_centroids.capacity() + _buffer.capacity()) * sizeof(Centroid)
+                       + _percentiles.getApproximateSize() - sizeof(Value);
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorApproxPercentile::create() {
+        return new AccumulatorApproxPercentile();
+    }
+
+    const char *AccumulatorApproxPercentile::getOpName() const {
+        return "$approxPercentile";
+    }
+}
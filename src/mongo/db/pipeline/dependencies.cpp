@@ -136,8 +136,14 @@ namespace {
 
     // Handles object-typed values including the top-level for ParsedDeps::extractFields
     Document documentHelper(const BSONObj& bson, const Document& neededFields) {
-        MutableDocument md(neededFields.size());
+        const size_t numNeeded = neededFields.size();
+        if (numNeeded == 0)
+            return Document();
 
+        MutableDocument md(numNeeded);
+
+        // The walk can't stop once every needed field has been seen: BSON doesn't require field
+        // names to be unique, so a needed field may come up again later in the document.
         BSONObjIterator it(bson);
         while (it.more()) {
             BSONElement bsonElement (it.next());
@@ -41,6 +41,7 @@
 #include "mongo/db/pipeline/dependencies.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/flat_value_set.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/s/shard.h"
@@ -428,6 +429,7 @@ namespace mongo {
         virtual GetDepsReturn getDependencies(DepsTracker* deps) const;
         virtual void dispose();
         virtual Value serialize(bool explain = false) const;
+        virtual void serializeToArray(vector<Value>& array, bool explain = false) const;
 
         /**
           Create a new grouping DocumentSource.
@@ -457,6 +459,30 @@ namespace mongo {
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /**
+         * If this $group only collects the distinct values of a single top-level field, that is
+         * it looks like {$group: {_id: "$a"}}, returns that field's name.  Such a $group can be
+         * answered by a distinct scan over an index on the field.  Otherwise returns "".
+         */
+        std::string getDistinctFieldPath() const;
+
+        /**
+         * If this $group's _id is the value of a single top-level field, as in
+         * {$group: {_id: "$a", ...}}, returns that field's name.  Otherwise returns "".
+         */
+        std::string getIdFieldPath() const;
+
+        /**
+         * Makes this $group do the work of an {$unwind: unwindPath} that feeds it.  Each element
+         * of the array is grouped in turn, in place in one copy of the input document rather than
+         * in a new Document per element, and if the _id doesn't depend on the array its group is
+         * looked up once per input document.  Returns false, and does nothing, if this $group
+         * can't absorb an $unwind.
+         *
+         * The $unwind is still serialized, in front of the $group.
+         */
+        bool absorbUnwind(const FieldPath& unwindPath);
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -487,6 +513,60 @@ namespace mongo {
         // Only used by spill. Would be function-local if that were legal in C++03.
         class SpillSTLComparator;
 
+        typedef vector<intrusive_ptr<Accumulator> > Accumulators;
+        typedef intrusive_ptr<Accumulator> (*AccumulatorFactory)();
+
+        /**
+         * The groups built by populate().  Each distinct _id is kept in a FlatValueSet, and the
+         * accumulators of the _id at position i are at accumulators(i)[0 .. numAccumulators).
+         * All groups share one array of accumulator pointers, so a new group costs no allocation
+         * beyond its accumulators rather than a hash node and a vector as well.
+         */
+        class GroupsMap {
+        public:
+            // Out of line since Accumulator is incomplete here.
+            GroupsMap();
+
+            /**
+             * Returns the position of the group for 'id', making the group with an accumulator
+             * from each of 'factories' if there is none.  Sets '*inserted' to whether it did.
+             */
+            size_t insert(const Value& id,
+                          const vector<AccumulatorFactory>& factories,
+                          bool* inserted);
+
+            /**
+             * Adds a group for 'id', which must not have one yet, sharing the 'numAccumulators'
+             * accumulators at 'accums'.
+             */
+            void insertNew(const Value& id,
+                           const intrusive_ptr<Accumulator>* accums,
+                           size_t numAccumulators);
+
+            /// Returns the position of the group for 'id' or FlatValueSet::npos.
+            size_t find(const Value& id) const { return _ids.find(id); }
+
+            const Value& id(size_t pos) const { return _ids[pos]; }
+            intrusive_ptr<Accumulator>* accumulators(size_t pos);
+
+            size_t size() const { return _ids.size(); }
+            bool empty() const { return _ids.empty(); }
+
+            /// Removes every group and releases the memory.
+            void clear();
+
+            /**
+             * Bytes used by the map itself: excludes the memory used by the _id Values and by
+             * the accumulators.
+             */
+            size_t memUsage() const;
+
+        private:
+            FlatValueSet _ids;
+            Accumulators _accumulators;
+            size_t _numAccumulators;
+        };
+
         /*
           Before returning anything, this source must fetch everything from
           the underlying source and group it.  populate() is used to do that
@@ -496,6 +576,46 @@ namespace mongo {
         void populate();
         bool populated;
 
+        /**
+         * populate() for pExpCtx->groupThreads > 1.  Input is read on this thread in batches and
+         * each batch is split into contiguous slices.  Each worker thread groups its slice into
+         * its own map, and the maps are then merged into 'groups' in slice order with the
+         * accumulators' merge semantics (as for sharded $group), so $first, $last and $push see
+         * the input in its original order.
+         */
+        void populateParallel(vector<shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles);
+
+        /**
+         * Groups (*docs)[begin, end) into 'out' with fresh accumulators.  Only reads this
+         * object's state, so several calls may run at once on different threads.  Sets 'status'
+         * to the error if evaluation fails.
+         */
+        void preAggregate(const vector<Document>* docs,
+                          size_t begin,
+                          size_t end,
+                          GroupsMap* out,
+                          Status* status) const;
+
+        /**
+         * Adds 'input' to its group in 'out', or with an absorbed $unwind, adds each document the
+         * $unwind would have made from it.  Evaluates with 'vars'.  Adds the change in memory
+         * used by the groups to '*memoryUsageBytes' unless it is NULL.  Only reads this object's
+         * state, so it is safe for preAggregate().  Returns true if an existing group was added
+         * to.
+         */
+        bool processInput(const Document& input,
+                          Variables* vars,
+                          GroupsMap* out,
+                          int* memoryUsageBytes) const;
+
+        /// Spills 'groups' to a new file in 'sortedFiles' if it has grown past the memory limit.
+        void spillIfOverMemoryLimit(
+                int* memoryUsageBytes,
+                vector<shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles);
+
+        /// How many documents each thread groups per batch in populateParallel().
+        static const size_t kParallelBatchSizePerThread = 1024;
+
         /**
          * Parses the raw id expression into _idExpressions and possibly _idFieldNames.
          */
@@ -504,7 +624,7 @@ namespace mongo {
         /**
          * Computes the internal representation of the group key.
          */
-        Value computeId(Variables* vars);
+        Value computeId(Variables* vars) const;
 
         /**
          * Converts the internal representation of the group key to the _id shape specified by the
@@ -512,9 +632,6 @@ namespace mongo {
          */
         Value expandId(const Value& val);
 
-
-        typedef vector<intrusive_ptr<Accumulator> > Accumulators;
-        typedef boost::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
         GroupsMap groups;
 
         /*
@@ -530,22 +647,29 @@ namespace mongo {
           These three vectors parallel each other.
         */
         vector<string> vFieldName;
-        vector<intrusive_ptr<Accumulator> (*)()> vpAccumulatorFactory;
+        vector<AccumulatorFactory> vpAccumulatorFactory;
         vector<intrusive_ptr<Expression> > vpExpression;
 
 
-        Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
+        Document makeDocument(const Value& id,
+                              const intrusive_ptr<Accumulator>* accums,
+                              bool mergeableOutput);
 
         bool _doingMerge;
         bool _spilled;
         const bool _extSortAllowed;
         const int _maxMemoryUsageBytes;
         boost::scoped_ptr<Variables> _variables;
+        size_t _numVariables; // for making more Variables like _variables
         std::vector<std::string> _idFieldNames; // used when id is a document
         std::vector<intrusive_ptr<Expression> > _idExpressions;
 
-        // only used when !_spilled
-        GroupsMap::iterator groupsIterator;
+        // set by absorbUnwind()
+        scoped_ptr<FieldPath> _unwindPath;
+        bool _idDependsOnUnwound;
+
+        // only used when !_spilled: the position in 'groups' of the next group to return
+        size_t _groupsPosition;
 
         // only used when _spilled
         scoped_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
@@ -594,6 +718,25 @@ namespace mongo {
         static bool isTextQuery(const BSONObj& query);
         bool isTextQuery() const { return _isTextQuery; }
 
+        /**
+         * Adds the top-level field of every path this match examines to 'fields', so {'a.b': 1}
+         * adds "a".  Returns false if some clause isn't tied to a field path, in which case
+         * 'fields' is incomplete.
+         */
+        bool getTopLevelFields(std::set<std::string>* fields) const;
+
+        /** Returns true if this match looks at the BSON types of values, as $type does. */
+        bool isTypeSensitive() const;
+
+        /**
+         * Returns a copy of this match that examines the top-level fields named by the keys of
+         * 'renames' under their mapped names instead.  Other fields are left alone.
+         */
+        intrusive_ptr<DocumentSourceMatch> renameTopLevelFields(
+            const std::map<std::string, std::string>& renames) const;
+
+        bool matches(const BSONObj& doc) const { return matcher->matches(doc); }
+
     private:
         DocumentSourceMatch(const BSONObj &query,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
@@ -637,10 +780,22 @@ namespace mongo {
          */
         static Document nextSafeFrom(DBClientCursor* cursor);
 
+        /**
+         * Returns the connection behind 'cursor', which must have come from getCursors(), to the
+         * pool, killing the cursor on its shard first if it is still open.  A merging consumer
+         * calls this as soon as it is done with one stream so that the shard's resources are not
+         * held until the whole merge finishes.  'cursor' must not be used afterwards.
+         */
+        void releaseCursor(DBClientCursor* cursor);
+
     private:
 
         struct CursorAndConnection {
             CursorAndConnection(ConnectionString host, NamespaceString ns, CursorId id);
+
+            // Kills the cursor if it is still open and returns the connection to the pool.
+            void release();
+
             ScopedDbConnection connection;
             DBClientCursor cursor;
         };
@@ -707,8 +862,15 @@ namespace mongo {
 
         void spill(DBClientBase* conn, const vector<BSONObj>& toInsert);
 
+        // Builds the indexes that prepTempCollection() left in _deferredIndexes.
+        void buildDeferredIndexes(DBClientBase* conn);
+
         bool _done;
 
+        // Specs of the _outputNs indexes that are built on _tempNs after it has been loaded, when
+        // they can be built in bulk from sorted keys instead of maintained on every insert.
+        vector<BSONObj> _deferredIndexes;
+
         NamespaceString _tempNs; // output goes here as it is being processed.
         const NamespaceString _outputNs; // output will go here after all data is processed.
     };
@@ -743,6 +905,12 @@ namespace mongo {
         /** projection as specified by the user */
         BSONObj getRaw() const { return _raw; }
 
+        /**
+         * Returns the output fields that are unchanged copies of input fields, mapped to the
+         * input field's name.  See ExpressionObject::getRenamedFields().
+         */
+        std::map<std::string, std::string> getRenamedFields() const;
+
     private:
         DocumentSourceProject(const intrusive_ptr<ExpressionContext>& pExpCtx,
                               const intrusive_ptr<ExpressionObject>& exprObj);
@@ -862,7 +1030,7 @@ namespace mongo {
         // not.
         class IteratorFromCursor;
         class IteratorFromBsonArray;
-        void populateFromCursors(const vector<DBClientCursor*>& cursors);
+        void populateFromCursors(DocumentSourceMergeCursors* source);
         void populateFromBsonArrays(const vector<BSONArray>& arrays);
 
         /* these two parallel each other */
@@ -1033,6 +1201,9 @@ namespace mongo {
 
         static const char unwindName[];
 
+        /** The path being unwound, without the leading '$'. */
+        std::string getUnwindPath() const { return _unwindPath->getPath(false); }
+
     private:
         DocumentSourceUnwind(const intrusive_ptr<ExpressionContext> &pExpCtx);
 
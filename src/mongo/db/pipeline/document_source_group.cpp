@@ -35,7 +35,9 @@
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
     const char DocumentSourceGroup::groupName[] = "$group";
@@ -92,17 +94,19 @@ namespace mongo {
                 _firstPartOfNextGroup = _sorterIterator->next();
             }
 
-            return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+            return makeDocument(_currentId,
+                                _currentAccumulators.empty() ? NULL : &_currentAccumulators[0],
+                                pExpCtx->inShard);
 
         } else {
             if (groups.empty())
                 return boost::none;
 
-            Document out = makeDocument(groupsIterator->first,
-                                        groupsIterator->second,
+            Document out = makeDocument(groups.id(_groupsPosition),
+                                        groups.accumulators(_groupsPosition),
                                         pExpCtx->inShard);
 
-            if (++groupsIterator == groups.end())
+            if (++_groupsPosition == groups.size())
                 dispose();
 
             return out;
@@ -111,11 +115,11 @@ namespace mongo {
 
     void DocumentSourceGroup::dispose() {
         // free our resources
-        GroupsMap().swap(groups);
+        groups.clear();
         _sorterIterator.reset();
 
         // make us look done
-        groupsIterator = groups.end();
+        _groupsPosition = 0;
 
         // free our source's resources
         pSource->dispose();
@@ -126,11 +130,11 @@ namespace mongo {
         // will only be one group. We should take advantage of that to avoid going through the hash
         // table.
         for (size_t i = 0; i < _idExpressions.size(); i++) {
-            _idExpressions[i] = _idExpressions[i]->optimize();
+            _idExpressions[i] = ExpressionProgram::compile(_idExpressions[i]->optimize());
         }
 
         for (size_t i = 0; i < vFieldName.size(); i++) {
-             vpExpression[i] = vpExpression[i]->optimize();
+             vpExpression[i] = ExpressionProgram::compile(vpExpression[i]->optimize());
         }
     }
 
@@ -170,7 +174,19 @@ namespace mongo {
         return Value(DOC(getSourceName() << insides.freeze()));
     }
 
+    void DocumentSourceGroup::serializeToArray(vector<Value>& array, bool explain) const {
+        if (_unwindPath) {
+            array.push_back(Value(DOC(DocumentSourceUnwind::unwindName
+                                      << _unwindPath->getPath(true))));
+        }
+        DocumentSource::serializeToArray(array, explain);
+    }
+
     DocumentSource::GetDepsReturn DocumentSourceGroup::getDependencies(DepsTracker* deps) const {
+        if (_unwindPath) {
+            deps->fields.insert(_unwindPath->getPath(false));
+        }
+
         // add the _id
         for (size_t i = 0; i < _idExpressions.size(); i++) {
             _idExpressions[i]->addDependencies(deps);
@@ -185,6 +201,62 @@ namespace mongo {
         return EXHAUSTIVE_ALL;
     }
 
+    string DocumentSourceGroup::getDistinctFieldPath() const {
+        return vFieldName.empty() ? getIdFieldPath() : "";
+    }
+
+    string DocumentSourceGroup::getIdFieldPath() const {
+        // With an absorbed $unwind the _id isn't computed from the input documents as they are.
+        if (_doingMerge || _unwindPath || !_idFieldNames.empty() || _idExpressions.size() != 1) {
+            return "";
+        }
+
+        if (!dynamic_cast<ExpressionFieldPath*>(_idExpressions[0].get())) {
+            return "";
+        }
+
+        // Variables such as $$ROOT show up as whole-document or no-field dependencies.
+        DepsTracker deps;
+        _idExpressions[0]->addDependencies(&deps);
+        if (deps.needWholeDocument || deps.needTextScore || deps.fields.size() != 1) {
+            return "";
+        }
+
+        // A dotted path can traverse arrays, so its value isn't just that of one field.
+        const string& field = *deps.fields.begin();
+        if (str::contains(field, '.')) {
+            return "";
+        }
+
+        return field;
+    }
+
+    bool DocumentSourceGroup::absorbUnwind(const FieldPath& unwindPath) {
+        if (_doingMerge || _unwindPath) {
+            return false;
+        }
+
+        _unwindPath.reset(new FieldPath(unwindPath));
+
+        // The _id depends on the unwound value if it examines the array, a field inside its
+        // elements, or a document containing it.
+        DepsTracker deps;
+        for (size_t i = 0; i < _idExpressions.size(); i++) {
+            _idExpressions[i]->addDependencies(&deps);
+        }
+        const string path = unwindPath.getPath(false);
+        _idDependsOnUnwound = deps.needWholeDocument;
+        for (set<string>::const_iterator it = deps.fields.begin(); it != deps.fields.end(); ++it) {
+            if (*it == path
+                    || str::startsWith(*it, path + '.')
+                    || str::startsWith(path, *it + '.')) {
+                _idDependsOnUnwound = true;
+            }
+        }
+
+        return true;
+    }
+
     intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
         intrusive_ptr<DocumentSourceGroup> pSource(
@@ -199,6 +271,9 @@ namespace mongo {
         , _spilled(false)
         , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
         , _maxMemoryUsageBytes(100*1024*1024)
+        , _numVariables(0)
+        , _idDependsOnUnwound(false)
+        , _groupsPosition(0)
     {}
 
     void DocumentSourceGroup::addAccumulator(
@@ -227,6 +302,8 @@ namespace mongo {
     */
     static const GroupOpDesc GroupOpTable[] = {
         {"$addToSet", AccumulatorAddToSet::create},
+        {"$approxDistinct", AccumulatorApproxDistinct::create},
+        {"$approxPercentile", AccumulatorApproxPercentile::create},
         {"$avg", AccumulatorAvg::create},
         {"$first", AccumulatorFirst::create},
         {"$last", AccumulatorLast::create},
@@ -238,6 +315,42 @@ namespace mongo {
 
     static const size_t NGroupOp = sizeof(GroupOpTable)/sizeof(GroupOpTable[0]);
 
+    /**
+     * $approxPercentile's operand {input: <expression>, p: <number or array>} is not a document
+     * expression:  parsed as one, p: 0.5 or p: [0.5, 0.9] would be rejected as a projection.
+     * Each field is parsed as an operand instead, so a literal p becomes a constant.
+     */
+    static intrusive_ptr<Expression> parseApproxPercentileOperand(
+            const BSONObj& operand,
+            const VariablesParseState& vps) {
+        intrusive_ptr<ExpressionObject> pExpression(ExpressionObject::create());
+        bool haveInput = false;
+        bool havePercentiles = false;
+
+        BSONObjIterator it(operand);
+        while (it.more()) {
+            BSONElement elem(it.next());
+            const char* fieldName = elem.fieldName();
+            if (str::equals(fieldName, "input")) {
+                haveInput = true;
+            }
+            else if (str::equals(fieldName, "p")) {
+                havePercentiles = true;
+            }
+            else {
+                uasserted(17534, str::stream() << "unknown field '" << fieldName
+                                               << "' in $approxPercentile's operand");
+            }
+
+            pExpression->addField(string(fieldName), Expression::parseOperand(elem, vps));
+        }
+
+        uassert(17535, "$approxPercentile's operand must have 'input' and 'p' fields",
+                haveInput && havePercentiles);
+
+        return pExpression;
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceGroup::createFromBson(
             BSONElement elem,
             const intrusive_ptr<ExpressionContext> &pExpCtx) {
@@ -307,7 +420,10 @@ namespace mongo {
                     intrusive_ptr<Expression> pGroupExpr;
 
                     BSONType elementType = subElement.type();
-                    if (elementType == Object) {
+                    if (elementType == Object && str::equals(key.name, "$approxPercentile")) {
+                        pGroupExpr = parseApproxPercentileOperand(subElement.Obj(), vps);
+                    }
+                    else if (elementType == Object) {
                         Expression::ObjectCtx oCtx(Expression::ObjectCtx::DOCUMENT_OK);
                         pGroupExpr = Expression::parseObject(subElement.Obj(), &oCtx, vps);
                     }
@@ -332,7 +448,8 @@ namespace mongo {
         uassert(15955, "a group specification must include an _id",
                 !pGroup->_idExpressions.empty());
 
-        pGroup->_variables.reset(new Variables(idGenerator.getIdCount()));
+        pGroup->_numVariables = idGenerator.getIdCount();
+        pGroup->_variables.reset(new Variables(pGroup->_numVariables));
 
         return pGroup;
     }
@@ -355,61 +472,22 @@ namespace mongo {
         vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
         int memoryUsageBytes = 0;
 
+        // The router only merges shard results, which isn't worth spreading across threads.
+        if (pExpCtx->groupThreads > 1 && !_doingMerge && !pExpCtx->inRouter) {
+            populateParallel(&sortedFiles);
+        }
+
         // This loop consumes all input from pSource and buckets it based on pIdExpression.
+        // After populateParallel() there is nothing left; exhausted sources keep returning none.
         while (boost::optional<Document> input = pSource->getNext()) {
-            if (memoryUsageBytes > _maxMemoryUsageBytes) {
-                uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort."
-                               " Pass allowDiskUse:true to opt in.",
-                        _extSortAllowed);
-                sortedFiles.push_back(spill());
-                memoryUsageBytes = 0;
-            }
-
-            _variables->setRoot(*input);
-
-            /* get the _id value */
-            Value id = computeId(_variables.get());
-
-            /* treat missing values the same as NULL SERVER-4674 */
-            if (id.missing())
-                id = Value(BSONNULL);
+            spillIfOverMemoryLimit(&memoryUsageBytes, &sortedFiles);
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            const size_t oldSize = groups.size();
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-            const bool inserted = groups.size() != oldSize;
-
-            if (inserted) {
-                memoryUsageBytes += id.getApproximateSize();
-
-                // Add the accumulators
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    group.push_back(vpAccumulatorFactory[i]());
-                }
-            } else {
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    // subtract old mem usage. New usage added back after processing.
-                    memoryUsageBytes -= group[i]->memUsageForSorter();
-                }
-            }
-
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-                memoryUsageBytes += group[i]->memUsageForSorter();
-            }
-
-            // We are done with the ROOT document so release it.
-            _variables->clearRoot();
+            const bool addedToExistingGroup =
+                processInput(*input, _variables.get(), &groups, &memoryUsageBytes);
 
             DEV {
                 // In debug mode, spill every time we have a duplicate id to stress merge logic.
-                if (!inserted // is a dup
+                if (addedToExistingGroup // is a dup
                         && !pExpCtx->inRouter // can't spill to disk in router
                         && !_extSortAllowed // don't change behavior when testing external sort
                         && sortedFiles.size() < 20 // don't open too many FDs
@@ -427,7 +505,7 @@ namespace mongo {
             }
 
             // We won't be using groups again so free its memory.
-            GroupsMap().swap(groups);
+            groups.clear();
 
             _sorterIterator.reset(
                     Sorter<Value,Value>::Iterator::merge(
@@ -443,50 +521,285 @@ namespace mongo {
             _firstPartOfNextGroup = _sorterIterator->next();
         } else {
             // start the group iterator
-            groupsIterator = groups.begin();
+            _groupsPosition = 0;
         }
 
         populated = true;
     }
 
+    void DocumentSourceGroup::populateParallel(
+            vector<shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles) {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+        const size_t numThreads = pExpCtx->groupThreads;
+        const size_t batchSize = numThreads * kParallelBatchSizePerThread;
+
+        ThreadPool workers(numThreads);
+        vector<Document> batch;
+        batch.reserve(batchSize);
+        vector<GroupsMap> partials(numThreads);
+        int memoryUsageBytes = 0;
+
+        bool sourceExhausted = false;
+        while (!sourceExhausted) {
+            // Reading the source has to stay on this thread: it may yield locks.
+            batch.clear();
+            while (batch.size() < batchSize) {
+                boost::optional<Document> input = pSource->getNext();
+                if (!input) {
+                    sourceExhausted = true;
+                    break;
+                }
+                batch.push_back(*input);
+            }
+
+            if (batch.empty()) {
+                break;
+            }
+
+            const size_t perThread = (batch.size() + numThreads - 1) / numThreads;
+            vector<Status> statuses(numThreads, Status::OK());
+            for (size_t i = 0; i < numThreads; i++) {
+                const size_t begin = i * perThread;
+                const size_t end = std::min(begin + perThread, batch.size());
+                if (begin >= end) {
+                    break;
+                }
+                workers.schedule(boost::bind(&DocumentSourceGroup::preAggregate, this,
+                                             &batch, begin, end, &partials[i], &statuses[i]));
+            }
+            workers.join();
+
+            for (size_t i = 0; i < numThreads; i++) {
+                uassertStatusOK(statuses[i]);
+            }
+
+            // Merge in slice order.  A group that is new to 'groups' takes the slice's
+            // accumulators as they are.
+            for (size_t i = 0; i < numThreads; i++) {
+                GroupsMap& partial = partials[i];
+                for (size_t p = 0; p < partial.size(); p++) {
+                    spillIfOverMemoryLimit(&memoryUsageBytes, sortedFiles);
+
+                    const Value& id = partial.id(p);
+                    const intrusive_ptr<Accumulator>* partialGroup = partial.accumulators(p);
+                    const size_t pos = groups.find(id);
+
+                    if (FlatValueSet::npos == pos) {
+                        memoryUsageBytes += id.getApproximateSize();
+                        groups.insertNew(id, partialGroup, numAccumulators);
+                        for (size_t j = 0; j < numAccumulators; j++) {
+                            memoryUsageBytes += partialGroup[j]->memUsageForSorter();
+                        }
+                        continue;
+                    }
+
+                    intrusive_ptr<Accumulator>* group = groups.accumulators(pos);
+                    for (size_t j = 0; j < numAccumulators; j++) {
+                        memoryUsageBytes -= group[j]->memUsageForSorter();
+                        group[j]->process(partialGroup[j]->getValue(/*toBeMerged=*/true),
+                                          /*merging=*/true);
+                        memoryUsageBytes += group[j]->memUsageForSorter();
+                    }
+                }
+                partial.clear();
+            }
+        }
+    }
+
+    void DocumentSourceGroup::preAggregate(const vector<Document>* docs,
+                                           size_t begin,
+                                           size_t end,
+                                           GroupsMap* out,
+                                           Status* status) const {
+        try {
+            Variables vars(_numVariables);
+            for (size_t i = begin; i < end; i++) {
+                processInput((*docs)[i], &vars, out, NULL);
+            }
+        }
+        catch (const DBException& e) {
+            *status = e.toStatus();
+        }
+        catch (const std::exception& e) {
+            *status = Status(ErrorCodes::InternalError, e.what());
+        }
+    }
+
+    bool DocumentSourceGroup::processInput(const Document& input,
+                                           Variables* vars,
+                                           GroupsMap* out,
+                                           int* memoryUsageBytes) const {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+
+        // Without an absorbed $unwind there is a single "element": the input itself.
+        vector<Position> unwindPositions;
+        Value array;
+        MutableDocument unwound;
+        size_t numElements = 1;
+        if (_unwindPath) {
+            array = input.getNestedField(*_unwindPath, &unwindPositions);
+            if (array.nullish()) {
+                // The path does not exist or is null, so $unwind outputs nothing.
+                return false;
+            }
+
+            uassert(15978, str::stream() << "Value at end of $unwind field path '"
+                    << _unwindPath->getPath(true) << "' must be an Array, but is a "
+                    << typeName(array.getType()),
+                    array.getType() == Array);
+
+            numElements = array.getArrayLength();
+            unwound.reset(input);
+        }
+
+        size_t pos = FlatValueSet::npos;
+        bool addedToExistingGroup = false;
+        for (size_t i = 0; i < numElements; i++) {
+            if (_unwindPath) {
+                // Nothing holds on to 'unwound' from the last element unless an accumulator
+                // kept it, so this normally changes it in place rather than copying it.
+                unwound.setNestedField(unwindPositions, array[i]);
+                vars->setRoot(unwound.peek());
+            }
+            else {
+                vars->setRoot(input);
+            }
+
+            bool inserted = false;
+            if (FlatValueSet::npos == pos || _idDependsOnUnwound) {
+                Value id = computeId(vars);
+
+                // treat missing values the same as NULL SERVER-4674
+                if (id.missing())
+                    id = Value(BSONNULL);
+
+                // Look for the _id value in the map; if it's not there, add a new entry with
+                // blank accumulators.
+                pos = out->insert(id, vpAccumulatorFactory, &inserted);
+                if (inserted && memoryUsageBytes)
+                    *memoryUsageBytes += id.getApproximateSize();
+            }
+            addedToExistingGroup |= !inserted;
+
+            // tickle all the accumulators for the group we found
+            intrusive_ptr<Accumulator>* group = out->accumulators(pos);
+            for (size_t j = 0; j < numAccumulators; j++) {
+                if (memoryUsageBytes && !inserted) {
+                    // subtract old mem usage. New usage added back after processing.
+                    *memoryUsageBytes -= group[j]->memUsageForSorter();
+                }
+
+                group[j]->process(vpExpression[j]->evaluate(vars), _doingMerge);
+
+                if (memoryUsageBytes)
+                    *memoryUsageBytes += group[j]->memUsageForSorter();
+            }
+
+            // We are done with the ROOT document so release it.
+            vars->clearRoot();
+        }
+
+        return addedToExistingGroup;
+    }
+
+    void DocumentSourceGroup::spillIfOverMemoryLimit(
+            int* memoryUsageBytes,
+            vector<shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles) {
+        // The map's own overhead changes as it grows, so it isn't tracked incrementally.
+        if (*memoryUsageBytes + static_cast<long long>(groups.memUsage()) > _maxMemoryUsageBytes) {
+            uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort."
+                           " Pass allowDiskUse:true to opt in.",
+                    _extSortAllowed);
+            sortedFiles->push_back(spill());
+            *memoryUsageBytes = 0;
+        }
+    }
+
+    DocumentSourceGroup::GroupsMap::GroupsMap() : _numAccumulators(0) {}
+
+    size_t DocumentSourceGroup::GroupsMap::insert(const Value& id,
+                                                  const vector<AccumulatorFactory>& factories,
+                                                  bool* inserted) {
+        const size_t pos = _ids.insert(id, inserted);
+        if (*inserted) {
+            _numAccumulators = factories.size();
+            for (size_t i = 0; i < factories.size(); i++) {
+                _accumulators.push_back(factories[i]());
+            }
+        }
+        return pos;
+    }
+
+    void DocumentSourceGroup::GroupsMap::insertNew(const Value& id,
+                                                   const intrusive_ptr<Accumulator>* accums,
+                                                   size_t numAccumulators) {
+        bool inserted;
+        _ids.insert(id, &inserted);
+        invariant(inserted);
+        _numAccumulators = numAccumulators;
+        _accumulators.insert(_accumulators.end(), accums, accums + numAccumulators);
+    }
+
+    intrusive_ptr<Accumulator>* DocumentSourceGroup::GroupsMap::accumulators(size_t pos) {
+        // With no accumulators there is nothing to point at.
+        if (_accumulators.empty())
+            return NULL;
+        return &_accumulators[pos * _numAccumulators];
+    }
+
+    void DocumentSourceGroup::GroupsMap::clear() {
+        _ids.clear();
+        Accumulators().swap(_accumulators);
+    }
+
+    size_t DocumentSourceGroup::GroupsMap::memUsage() const {
+        return _ids.memUsage() + _accumulators.capacity() * sizeof(intrusive_ptr<Accumulator>);
+    }
+
     class DocumentSourceGroup::SpillSTLComparator {
     public:
-        bool operator() (const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
-            return Value::compare(lhs->first, rhs->first) < 0;
+        explicit SpillSTLComparator(const GroupsMap* groups) : _groups(groups) {}
+        bool operator() (size_t lhs, size_t rhs) const {
+            return Value::compare(_groups->id(lhs), _groups->id(rhs)) < 0;
         }
+    private:
+        const GroupsMap* _groups;
     };
 
     shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
-        vector<const GroupsMap::value_type*> ptrs; // using pointers to speed sorting
-        ptrs.reserve(groups.size());
-        for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
-            ptrs.push_back(&*it);
+        vector<size_t> positions; // sorting positions rather than the groups themselves
+        positions.reserve(groups.size());
+        for (size_t i = 0; i < groups.size(); i++) {
+            positions.push_back(i);
         }
 
-        stable_sort(ptrs.begin(), ptrs.end(), SpillSTLComparator());
+        stable_sort(positions.begin(), positions.end(), SpillSTLComparator(&groups));
 
+        const size_t numAccumulators = vpAccumulatorFactory.size();
         SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
-        switch (vpAccumulatorFactory.size()) { // same as ptrs[i]->second.size() for all i.
+        switch (numAccumulators) {
         case 0: // no values, essentially a distinct
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first, Value());
+            for (size_t i=0; i < positions.size(); i++) {
+                writer.addAlreadySorted(groups.id(positions[i]), Value());
             }
             break;
 
         case 1: // just one value, use optimized serialization as single Value
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first,
-                                        ptrs[i]->second[0]->getValue(/*toBeMerged=*/true));
+            for (size_t i=0; i < positions.size(); i++) {
+                writer.addAlreadySorted(
+                        groups.id(positions[i]),
+                        groups.accumulators(positions[i])[0]->getValue(/*toBeMerged=*/true));
             }
             break;
 
         default: // multiple values, serialize as array-typed Value
-            for (size_t i=0; i < ptrs.size(); i++) {
+            for (size_t i=0; i < positions.size(); i++) {
+                const intrusive_ptr<Accumulator>* group = groups.accumulators(positions[i]);
                 vector<Value> accums;
-                for (size_t j=0; j < ptrs[i]->second.size(); j++) {
-                    accums.push_back(ptrs[i]->second[j]->getValue(/*toBeMerged=*/true));
+                for (size_t j=0; j < numAccumulators; j++) {
+                    accums.push_back(group[j]->getValue(/*toBeMerged=*/true));
                 }
-                writer.addAlreadySorted(ptrs[i]->first, Value::consume(accums));
+                writer.addAlreadySorted(groups.id(positions[i]), Value::consume(accums));
             }
             break;
         }
@@ -530,7 +843,7 @@ namespace mongo {
         }
     }
 
-    Value DocumentSourceGroup::computeId(Variables* vars) {
+    Value DocumentSourceGroup::computeId(Variables* vars) const {
         // If only one expression return result directly
         if (_idExpressions.size() == 1)
             return _idExpressions[0]->evaluate(vars);
@@ -564,7 +877,7 @@ namespace mongo {
     }
 
     Document DocumentSourceGroup::makeDocument(const Value& id,
-                                               const Accumulators& accums,
+                                               const intrusive_ptr<Accumulator>* accums,
                                                bool mergeableOutput) {
         const size_t n = vFieldName.size();
         MutableDocument out (1 + n);
@@ -615,7 +928,8 @@ namespace mongo {
                 ExpressionFieldPath::parse("$$ROOT." + vFieldName[i], vps));
         }
 
-        pMerger->_variables.reset(new Variables(idGenerator.getIdCount()));
+        pMerger->_numVariables = idGenerator.getIdCount();
+        pMerger->_variables.reset(new Variables(pMerger->_numVariables));
 
         return pMerger;
     }
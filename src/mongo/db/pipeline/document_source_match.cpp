@@ -341,6 +341,88 @@ namespace {
         return *(matcher->getQuery());
     }
 
+namespace {
+    bool isLogicalOperator(const StringData& fieldName) {
+        return fieldName == "$and" || fieldName == "$or" || fieldName == "$nor";
+    }
+
+    StringData topLevelField(const StringData& path) {
+        const size_t dotPos = path.find('.');
+        return dotPos == string::npos ? path : path.substr(0, dotPos);
+    }
+
+    bool addTopLevelFields(const BSONObj& query, set<string>* fields) {
+        BSONForEach(e, query) {
+            const StringData fieldName = e.fieldNameStringData();
+            if (fieldName[0] != '$') {
+                fields->insert(topLevelField(fieldName).toString());
+            }
+            else if (isLogicalOperator(fieldName)) {
+                BSONForEach(clause, e.Obj()) {
+                    if (!addTopLevelFields(clause.Obj(), fields))
+                        return false;
+                }
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    BSONObj renameTopLevelFieldsIn(const BSONObj& query, const map<string, string>& renames) {
+        BSONObjBuilder out;
+        BSONForEach(e, query) {
+            const StringData fieldName = e.fieldNameStringData();
+            if (fieldName[0] != '$') {
+                const StringData top = topLevelField(fieldName);
+                map<string, string>::const_iterator it = renames.find(top.toString());
+                if (it == renames.end()) {
+                    out.append(e);
+                }
+                else {
+                    out.appendAs(e, it->second + fieldName.substr(top.size()).toString());
+                }
+            }
+            else if (isLogicalOperator(fieldName)) {
+                BSONArrayBuilder clauses(out.subarrayStart(fieldName));
+                BSONForEach(clause, e.Obj()) {
+                    clauses.append(renameTopLevelFieldsIn(clause.Obj(), renames));
+                }
+                clauses.doneFast();
+            }
+            else {
+                out.append(e);
+            }
+        }
+        return out.obj();
+    }
+
+    bool hasTypeOperator(const BSONObj& query) {
+        BSONForEach(e, query) {
+            if (e.fieldNameStringData() == "$type")
+                return true;
+
+            if (e.isABSONObj() && hasTypeOperator(e.Obj()))
+                return true;
+        }
+        return false;
+    }
+}
+
+    bool DocumentSourceMatch::getTopLevelFields(set<string>* fields) const {
+        return addTopLevelFields(getQuery(), fields);
+    }
+
+    bool DocumentSourceMatch::isTypeSensitive() const {
+        return hasTypeOperator(getQuery());
+    }
+
+    intrusive_ptr<DocumentSourceMatch> DocumentSourceMatch::renameTopLevelFields(
+            const map<string, string>& renames) const {
+        return new DocumentSourceMatch(renameTopLevelFieldsIn(getQuery(), renames), pExpCtx);
+    }
+
     DocumentSourceMatch::DocumentSourceMatch(const BSONObj &query,
                                              const intrusive_ptr<ExpressionContext> &pExpCtx)
         : DocumentSource(pExpCtx),
@@ -95,6 +95,15 @@ namespace mongo {
         , cursor(connection.get(), ns, id, 0, 0)
     {}
 
+    void DocumentSourceMergeCursors::CursorAndConnection::release() {
+        // Kill the cursor here rather than in ~DBClientCursor, which would need the connection
+        // after it has gone back to the pool.
+        if (const CursorId id = cursor.getCursorId())
+            connection->killCursor(id);
+        cursor.decouple();
+        connection.done();
+    }
+
     vector<DBClientCursor*> DocumentSourceMergeCursors::getCursors() {
         verify(_unstarted);
         start();
@@ -166,7 +175,31 @@ namespace mongo {
         return next;
     }
 
+    void DocumentSourceMergeCursors::releaseCursor(DBClientCursor* cursor) {
+        for (Cursors::iterator it = _cursors.begin(); it != _cursors.end(); ++it) {
+            if (&(*it)->cursor == cursor) {
+                (*it)->release();
+                _cursors.erase(it);
+                _currentCursor = _cursors.begin();
+                return;
+            }
+        }
+        verify(false); // not one of our cursors
+    }
+
     void DocumentSourceMergeCursors::dispose() {
+        // Release cursors that are still open, e.g. because a $sort or $limit stopped reading
+        // early, so their connections go back to the pool instead of being closed.
+        for (Cursors::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it) {
+            try {
+                (*it)->release();
+            }
+            catch (const DBException& e) {
+                log() << "Couldn't release aggregation cursor on "
+                      << (*it)->cursor.originalHost() << ": " << e.toString();
+            }
+        }
+
         _cursors.clear();
         _currentCursor = _cursors.end();
     }
@@ -30,6 +30,9 @@
 
 #include "mongo/db/pipeline/document_source.h"
 
+#include "mongo/db/server_options.h"
+#include "mongo/util/timer.h"
+
 namespace mongo {
     const char DocumentSourceOut::outName[] = "$out";
 
@@ -47,6 +50,16 @@ namespace mongo {
         return outName;
     }
 
+    static void copyIndex(DBClientBase* conn, const BSONObj& indexBson) {
+        conn->insert(NamespaceString(indexBson["ns"].String()).getSystemIndexesCollection(),
+                     indexBson);
+        BSONObj err = conn->getLastErrorDetailed();
+        uassert(16995, str::stream() << "copying index for $out failed."
+                                     << " index: " << indexBson
+                                     << " error: " <<  err,
+                DBClientWithCommands::getLastErrorString(err).empty());
+    }
+
     static AtomicUInt32 aggOutCounter;
     void DocumentSourceOut::prepTempCollection() {
         verify(_mongod);
@@ -79,7 +92,15 @@ namespace mongo {
                     ok);
         }
 
-        // copy indexes on _outputNs to _tempNs
+        // Copy indexes on _outputNs to _tempNs.  Building an index on a populated collection
+        // sorts all of its keys and builds the btree bottom up, which is much cheaper than
+        // inserting each key as the documents arrive, so most indexes are only built once the
+        // data is in place.  The _id index was made by "create" and is always maintained.
+        // Indexes that build differently on a populated collection are still copied up front:
+        // dropDups would silently drop duplicates that inserts would have rejected, and
+        // background builds don't use the bulk path anyway.  A deferred build is a foreground
+        // build, so it holds the database write lock until it finishes, where the inserts took
+        // it once per batch.
         scoped_ptr<DBClientCursor> indexes(conn->getIndexes(_outputNs));
         while (indexes->more()) {
             MutableDocument index(Document(indexes->nextSafe()));
@@ -87,13 +108,23 @@ namespace mongo {
             index["ns"] = Value(_tempNs.ns());
 
             BSONObj indexBson = index.freeze().toBson();
-            conn->insert(_tempNs.getSystemIndexesCollection(), indexBson);
-            BSONObj err = conn->getLastErrorDetailed();
-            uassert(16995, str::stream() << "copying index for $out failed."
-                                         << " index: " << indexBson
-                                         << " error: " <<  err,
-                    DBClientWithCommands::getLastErrorString(err).empty());
+            if (indexBson["name"].str() == "_id_")
+                continue;
+
+            if (indexBson["dropDups"].trueValue() || indexBson["background"].trueValue()) {
+                copyIndex(conn, indexBson);
+            }
+            else {
+                _deferredIndexes.push_back(indexBson);
+            }
+        }
+    }
+
+    void DocumentSourceOut::buildDeferredIndexes(DBClientBase* conn) {
+        for (size_t i = 0; i < _deferredIndexes.size(); i++) {
+            copyIndex(conn, _deferredIndexes[i]);
         }
+        _deferredIndexes.clear();
     }
 
     void DocumentSourceOut::spill(DBClientBase* conn, const vector<BSONObj>& toInsert) {
@@ -114,9 +145,13 @@ namespace mongo {
         verify(_mongod);
         DBClientBase* conn = _mongod->directClient();
 
+        Timer timer;
         prepTempCollection();
         verify(_tempNs.size() != 0);
+        const int prepMillis = timer.millis();
 
+        // Each spill() is one batched insert of up to BSONObjMaxUserSize bytes.
+        long long numDocs = 0;
         vector<BSONObj> bufferedObjects;
         int bufferedBytes = 0;
         while (boost::optional<Document> next = pSource->getNext()) {
@@ -128,10 +163,16 @@ namespace mongo {
                 bufferedBytes = toInsert.objsize();
             }
             bufferedObjects.push_back(toInsert);
+            numDocs++;
         }
 
         if (!bufferedObjects.empty())
             spill(conn, bufferedObjects);
+        const int insertMillis = timer.millis() - prepMillis;
+
+        const size_t numDeferredIndexes = _deferredIndexes.size();
+        buildDeferredIndexes(conn);
+        const int indexMillis = timer.millis() - prepMillis - insertMillis;
 
         // Checking again to make sure we didn't become sharded while running.
         uassert(17018, str::stream() << "namespace '" << _outputNs.ns()
@@ -150,6 +191,13 @@ namespace mongo {
         // We don't need to drop the temp collection in our destructor if the rename succeeded.
         _tempNs = NamespaceString("");
 
+        const int totalMillis = timer.millis();
+        LOG(totalMillis > serverGlobalParams.slowMS ? 0 : 1)
+            << "$out to " << _outputNs.ns() << " wrote " << numDocs << " documents in "
+            << totalMillis << "ms: prepare " << prepMillis << "ms, insert " << insertMillis
+            << "ms, build " << numDeferredIndexes << " indexes " << indexMillis
+            << "ms, rename " << (totalMillis - prepMillis - insertMillis - indexMillis) << "ms";
+
         // This "DocumentSource" doesn't produce output documents. This can change in the future
         // if we support using $out in "tee" mode.
         return boost::none;
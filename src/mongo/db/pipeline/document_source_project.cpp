@@ -113,6 +113,12 @@ namespace mongo {
         return pProject;
     }
 
+    map<string, string> DocumentSourceProject::getRenamedFields() const {
+        map<string, string> renames;
+        pEO->getRenamedFields(&renames);
+        return renames;
+    }
+
     DocumentSource::GetDepsReturn DocumentSourceProject::getDependencies(DepsTracker* deps) const {
         vector<string> path; // empty == top-level
         pEO->addDependencies(deps, &path);
@@ -49,9 +49,18 @@ namespace mongo {
         if (!populated)
             populate();
 
-        if (!_output || !_output->more())
+        if (!_output)
             return boost::none;
 
+        if (!_output->more()) {
+            // Either every input was consumed or the limit was reached.  In both cases nothing
+            // more is needed from our source, so let it free its resources (when merging from
+            // shards, that kills any cursors still open there) rather than waiting for the
+            // pipeline to finish.
+            dispose();
+            return boost::none;
+        }
+
         return _output->next().second;
     }
 
@@ -221,7 +230,7 @@ namespace mongo {
             typedef DocumentSourceMergeCursors DSCursors;
             typedef DocumentSourceCommandShards DSCommands;
             if (DSCursors* castedSource = dynamic_cast<DSCursors*>(pSource)) {
-                populateFromCursors(castedSource->getCursors());
+                populateFromCursors(castedSource);
             } else if (DSCommands* castedSource = dynamic_cast<DSCommands*>(pSource)) {
                 populateFromBsonArrays(castedSource->getArrays());
             } else {
@@ -233,31 +242,55 @@ namespace mongo {
                 sorter->add(extractKey(*next), *next);
             }
             _output.reset(sorter->done());
+
+            // All of the input is in the sorter now, so the source can free its resources (for
+            // a DocumentSourceCursor, the runner and its ClientCursor) while we stream output.
+            pSource->dispose();
         }
         populated = true;
     }
 
     class DocumentSourceSort::IteratorFromCursor : public MySorter::Iterator {
     public:
-        IteratorFromCursor(DocumentSourceSort* sorter, DBClientCursor* cursor)
+        IteratorFromCursor(DocumentSourceSort* sorter,
+                           DocumentSourceMergeCursors* source,
+                           DBClientCursor* cursor)
             : _sorter(sorter)
+            , _source(source)
             , _cursor(cursor)
         {}
 
-        bool more() { return _cursor->more(); }
+        bool more() {
+            if (!_cursor)
+                return false;
+
+            if (_cursor->more())
+                return true;
+
+            // This shard's stream is exhausted.  Give its connection back now rather than
+            // holding it until every other shard is done too.
+            _source->releaseCursor(_cursor);
+            _cursor = NULL;
+            return false;
+        }
         Data next() {
             const Document doc = DocumentSourceMergeCursors::nextSafeFrom(_cursor);
             return make_pair(_sorter->extractKey(doc), doc);
         }
     private:
         DocumentSourceSort* _sorter;
-        DBClientCursor* _cursor;
+        DocumentSourceMergeCursors* _source;
+        DBClientCursor* _cursor; // NULL once released
     };
 
-    void DocumentSourceSort::populateFromCursors(const vector<DBClientCursor*>& cursors) {
+    void DocumentSourceSort::populateFromCursors(DocumentSourceMergeCursors* source) {
+        // The shards' streams are already sorted, so this is a streaming k-way merge: each
+        // output document only requires the head of every stream, and with a limit the merge
+        // stops (and getNext() releases the shards' cursors) as soon as the limit is reached.
+        const vector<DBClientCursor*> cursors = source->getCursors();
         vector<boost::shared_ptr<MySorter::Iterator> > iterators;
         for (size_t i = 0; i < cursors.size(); i++) {
-            iterators.push_back(boost::make_shared<IteratorFromCursor>(this, cursors[i]));
+            iterators.push_back(boost::make_shared<IteratorFromCursor>(this, source, cursors[i]));
         }
 
         _output.reset(MySorter::Iterator::merge(iterators, makeSortOptions(), Comparator(*this)));
@@ -40,6 +40,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/util/string_map.h"
 #include "mongo/util/mongoutils/str.h"
@@ -842,8 +843,11 @@ namespace {
     /* ----------------------- ExpressionDivide ---------------------------- */
 
     Value ExpressionDivide::evaluateInternal(Variables* vars) const {
-        Value lhs = vpOperand[0]->evaluateInternal(vars);
-        Value rhs = vpOperand[1]->evaluateInternal(vars);
+        return apply(vpOperand[0]->evaluateInternal(vars),
+                     vpOperand[1]->evaluateInternal(vars));
+    }
+
+    Value ExpressionDivide::apply(const Value& lhs, const Value& rhs) {
 
         if (lhs.numeric() && rhs.numeric()) {
             double numer = lhs.coerceToDouble();
@@ -887,12 +891,38 @@ namespace {
     intrusive_ptr<Expression> ExpressionObject::optimize() {
         for (FieldMap::iterator it(_expressions.begin()); it!=_expressions.end(); ++it) {
             if (it->second)
-                it->second = it->second->optimize();
+                it->second = ExpressionProgram::compile(it->second->optimize());
         }
 
         return intrusive_ptr<Expression>(this);
     }
 
+    void ExpressionObject::getRenamedFields(map<string, string>* renames) const {
+        if (_atRoot && !_excludeId && !_expressions.count("_id"))
+            (*renames)["_id"] = "_id";
+
+        for (FieldMap::const_iterator it(_expressions.begin()); it!=_expressions.end(); ++it) {
+            if (!it->second) {
+                (*renames)[it->first] = it->first;
+                continue;
+            }
+
+            if (!dynamic_cast<ExpressionFieldPath*>(it->second.get()))
+                continue;
+
+            // Variables such as $$ROOT show up as whole-document or no-field dependencies, and a
+            // dotted path can traverse arrays, so only a plain top-level field is a copy.
+            DepsTracker deps;
+            it->second->addDependencies(&deps);
+            if (deps.needWholeDocument || deps.needTextScore || deps.fields.size() != 1)
+                continue;
+
+            const string& field = *deps.fields.begin();
+            if (!str::contains(field, '.'))
+                (*renames)[it->first] = field;
+        }
+    }
+
     bool ExpressionObject::isSimple() {
         for (FieldMap::iterator it(_expressions.begin()); it!=_expressions.end(); ++it) {
             if (it->second && !it->second->isSimple())
@@ -1561,8 +1591,11 @@ namespace {
     /* ----------------------- ExpressionMod ---------------------------- */
 
     Value ExpressionMod::evaluateInternal(Variables* vars) const {
-        Value lhs = vpOperand[0]->evaluateInternal(vars);
-        Value rhs = vpOperand[1]->evaluateInternal(vars);
+        return apply(vpOperand[0]->evaluateInternal(vars),
+                     vpOperand[1]->evaluateInternal(vars));
+    }
+
+    Value ExpressionMod::apply(const Value& lhs, const Value& rhs) {
 
         BSONType leftType = lhs.getType();
         BSONType rightType = rhs.getType();
@@ -2216,9 +2249,11 @@ namespace {
     /* ----------------------- ExpressionSubtract ---------------------------- */
 
     Value ExpressionSubtract::evaluateInternal(Variables* vars) const {
-        Value lhs = vpOperand[0]->evaluateInternal(vars);
-        Value rhs = vpOperand[1]->evaluateInternal(vars);
-            
+        return apply(vpOperand[0]->evaluateInternal(vars),
+                     vpOperand[1]->evaluateInternal(vars));
+    }
+
+    Value ExpressionSubtract::apply(const Value& lhs, const Value& rhs) {
         BSONType diffType = Value::getWidestNumeric(rhs.getType(), lhs.getType());
 
         if (diffType == NumberDouble) {
@@ -325,6 +325,9 @@ namespace mongo {
         ExpressionNary() {}
 
         ExpressionVector vpOperand;
+
+    private:
+        friend class ExpressionProgram;
     };
 
     /// Inherit from ExpressionVariadic or ExpressionFixedArity instead of directly from this class.
@@ -442,6 +445,8 @@ namespace mongo {
         ExpressionCompare(CmpOp cmpOp);
 
     private:
+        friend class ExpressionProgram;
+
         CmpOp cmpOp;
     };
 
@@ -524,6 +529,9 @@ namespace mongo {
         // virtuals from ExpressionNary
         virtual Value evaluateInternal(Variables* vars) const;
         virtual const char *getOpName() const;
+
+        /** Computes the result from already evaluated operands. */
+        static Value apply(const Value& lhs, const Value& rhs);
     };
 
 
@@ -689,6 +697,9 @@ namespace mongo {
         // virtuals from ExpressionNary
         virtual Value evaluateInternal(Variables* vars) const;
         virtual const char *getOpName() const;
+
+        /** Computes the result from already evaluated operands. */
+        static Value apply(const Value& lhs, const Value& rhs);
     };
     
 
@@ -811,6 +822,13 @@ namespace mongo {
 
         void excludeId(bool b) { _excludeId = b; }
 
+        /**
+         * Adds every top-level output field that is an unchanged copy of a top-level input
+         * field to 'renames', mapped to the input field's name.  Included fields map to
+         * themselves and {b: "$a"} maps "b" to "a".
+         */
+        void getRenamedFields(map<string, string>* renames) const;
+
     private:
         ExpressionObject(bool atRoot);
 
@@ -921,6 +939,9 @@ namespace mongo {
         // virtuals from ExpressionNary
         virtual Value evaluateInternal(Variables* vars) const;
         virtual const char *getOpName() const;
+
+        /** Computes the result from already evaluated operands. */
+        static Value apply(const Value& lhs, const Value& rhs);
     };
 
 
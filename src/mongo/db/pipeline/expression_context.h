@@ -42,6 +42,7 @@ namespace mongo {
             : inShard(false)
             , inRouter(false)
             , extSortAllowed(false)
+            , groupThreads(1)
             , ns(ns)
             , interruptStatus(status)
             , interruptCounter(interruptCheckPeriod)
@@ -61,6 +62,7 @@ namespace mongo {
         bool inShard;
         bool inRouter;
         bool extSortAllowed;
+        int groupThreads; // threads $group may use to process its input; 1 means just the caller
         NamespaceString ns;
         std::string tempDir; // Defaults to empty to prevent external sorting in mongos.
 
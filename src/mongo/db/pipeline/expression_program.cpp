@@ -0,0 +1,412 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/expression_program.h"
+
+#include "mongo/platform/float_utils.h"
+
+namespace mongo {
+
+namespace {
+    // Same as the cmp() helpers Value::compare() uses for numbers, including the handling of NaN.
+    int compareLongs(long long left, long long right) {
+        return left < right ? -1 : (left == right ? 0 : 1);
+    }
+
+    int compareDoubles(double left, double right) {
+        if (left < right)
+            return -1;
+        if (left == right)
+            return 0;
+        if (isNaN(left))
+            return isNaN(right) ? 0 : -1;
+        return 1;
+    }
+
+    bool compareResult(ExpressionCompare::CmpOp op, int cmp) {
+        switch (op) {
+        case ExpressionCompare::EQ: return cmp == 0;
+        case ExpressionCompare::NE: return cmp != 0;
+        case ExpressionCompare::GT: return cmp > 0;
+        case ExpressionCompare::GTE: return cmp >= 0;
+        case ExpressionCompare::LT: return cmp < 0;
+        case ExpressionCompare::LTE: return cmp <= 0;
+        case ExpressionCompare::CMP: break;
+        }
+        verify(false);
+    }
+}
+
+    ExpressionProgram::ExpressionProgram(const intrusive_ptr<Expression>& tree)
+        : _tree(tree)
+        , _numRegisters(0)
+    {}
+
+    intrusive_ptr<Expression> ExpressionProgram::compile(
+            const intrusive_ptr<Expression>& expression) {
+        if (!isCompilable(expression.get()))
+            return expression;
+
+        intrusive_ptr<ExpressionProgram> program = new ExpressionProgram(expression);
+        if (!program->compileNode(expression, 0))
+            return expression;
+
+        return program;
+    }
+
+    bool ExpressionProgram::isCompilable(const Expression* expression) {
+        return dynamic_cast<const ExpressionAdd*>(expression)
+            || dynamic_cast<const ExpressionSubtract*>(expression)
+            || dynamic_cast<const ExpressionMultiply*>(expression)
+            || dynamic_cast<const ExpressionDivide*>(expression)
+            || dynamic_cast<const ExpressionMod*>(expression)
+            || dynamic_cast<const ExpressionCompare*>(expression)
+            || dynamic_cast<const ExpressionCond*>(expression)
+            || dynamic_cast<const ExpressionAnd*>(expression)
+            || dynamic_cast<const ExpressionOr*>(expression)
+            || dynamic_cast<const ExpressionNot*>(expression);
+    }
+
+    unsigned ExpressionProgram::emit(OpCode op, unsigned dst, unsigned lhs, unsigned rhs,
+                                     unsigned arg, const Expression* node) {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.dst = dst;
+        instruction.lhs = lhs;
+        instruction.rhs = rhs;
+        instruction.arg = arg;
+        instruction.node = node;
+        _code.push_back(instruction);
+        return _code.size() - 1;
+    }
+
+    bool ExpressionProgram::compileNode(const intrusive_ptr<Expression>& expression,
+                                        unsigned dst) {
+        if (dst >= kMaxRegisters)
+            return false;
+        _numRegisters = std::max(_numRegisters, dst + 1);
+
+        const Expression* node = expression.get();
+
+        if (const ExpressionConstant* constant = dynamic_cast<const ExpressionConstant*>(node)) {
+            Register reg;
+            load(constant->getValue(), &reg);
+            _constants.push_back(reg);
+            emit(CONSTANT, dst, 0, 0, _constants.size() - 1);
+            return true;
+        }
+
+        if (!isCompilable(node)) {
+            emit(EVALUATE, dst, 0, 0, 0, node);
+            return true;
+        }
+
+        // Every compilable operator is an ExpressionNary.
+        const ExpressionVector& operands = static_cast<const ExpressionNary*>(node)->vpOperand;
+
+        const bool isAdd = dynamic_cast<const ExpressionAdd*>(node);
+        if (isAdd || dynamic_cast<const ExpressionMultiply*>(node)) {
+            // Operands are accumulated one at a time so that, like the tree, evaluation stops at
+            // the first null.
+            emit(isAdd ? ADD_BEGIN : MULTIPLY_BEGIN, dst);
+            vector<unsigned> exits;
+            for (size_t i = 0; i < operands.size(); i++) {
+                if (!compileNode(operands[i], dst + 1))
+                    return false;
+                exits.push_back(emit(isAdd ? ADD : MULTIPLY, dst, dst + 1, 0, 0, node));
+            }
+            emit(isAdd ? ADD_END : MULTIPLY_END, dst);
+            for (size_t i = 0; i < exits.size(); i++) {
+                _code[exits[i]].arg = _code.size();
+            }
+            return true;
+        }
+
+        if (dynamic_cast<const ExpressionCond*>(node)) {
+            if (!compileNode(operands[0], dst))
+                return false;
+            const unsigned toElse = emit(JUMP_IF_FALSE, dst, dst);
+            if (!compileNode(operands[1], dst))
+                return false;
+            const unsigned toEnd = emit(JUMP, dst);
+            _code[toElse].arg = _code.size();
+            if (!compileNode(operands[2], dst))
+                return false;
+            _code[toEnd].arg = _code.size();
+            return true;
+        }
+
+        const bool isAnd = dynamic_cast<const ExpressionAnd*>(node);
+        if (isAnd || dynamic_cast<const ExpressionOr*>(node)) {
+            // $and stops at the first false operand and $or at the first true one.
+            vector<unsigned> shortCircuits;
+            for (size_t i = 0; i < operands.size(); i++) {
+                if (!compileNode(operands[i], dst))
+                    return false;
+                shortCircuits.push_back(emit(isAnd ? JUMP_IF_FALSE : JUMP_IF_TRUE, dst, dst));
+            }
+
+            Register result;
+            load(Value(isAnd), &result);
+            _constants.push_back(result);
+            emit(CONSTANT, dst, 0, 0, _constants.size() - 1);
+            const unsigned toEnd = emit(JUMP, dst);
+
+            for (size_t i = 0; i < shortCircuits.size(); i++) {
+                _code[shortCircuits[i]].arg = _code.size();
+            }
+            load(Value(!isAnd), &result);
+            _constants.push_back(result);
+            emit(CONSTANT, dst, 0, 0, _constants.size() - 1);
+            _code[toEnd].arg = _code.size();
+            return true;
+        }
+
+        if (dynamic_cast<const ExpressionNot*>(node)) {
+            if (!compileNode(operands[0], dst))
+                return false;
+            emit(NOT, dst, dst);
+            return true;
+        }
+
+        // The rest are binary operators.
+        if (!compileNode(operands[0], dst) || !compileNode(operands[1], dst + 1))
+            return false;
+
+        if (dynamic_cast<const ExpressionSubtract*>(node)) {
+            emit(SUBTRACT, dst, dst, dst + 1, 0, node);
+        }
+        else if (dynamic_cast<const ExpressionDivide*>(node)) {
+            emit(DIVIDE, dst, dst, dst + 1, 0, node);
+        }
+        else if (dynamic_cast<const ExpressionMod*>(node)) {
+            emit(MOD, dst, dst, dst + 1, 0, node);
+        }
+        else {
+            const ExpressionCompare* compare = static_cast<const ExpressionCompare*>(node);
+            emit(COMPARE, dst, dst, dst + 1, compare->cmpOp, node);
+        }
+        return true;
+    }
+
+    void ExpressionProgram::load(const Value& value, Register* reg) {
+        reg->type = value.getType();
+        switch (reg->type) {
+        case NumberInt: reg->longValue = value.getInt(); break;
+        case NumberLong: reg->longValue = value.getLong(); break;
+        case NumberDouble: reg->doubleValue = value.getDouble(); break;
+        case Bool: reg->longValue = value.getBool(); break;
+        default: reg->boxed = value; break;
+        }
+    }
+
+    Value ExpressionProgram::box(const Register& reg) {
+        switch (reg.type) {
+        case NumberInt: return Value(static_cast<int>(reg.longValue));
+        case NumberLong: return Value(reg.longValue);
+        case NumberDouble: return Value(reg.doubleValue);
+        case Bool: return Value(reg.longValue != 0);
+        default: return reg.boxed;
+        }
+    }
+
+    Value ExpressionProgram::evaluateInternal(Variables* vars) const {
+        Register registers[kMaxRegisters];
+
+        const size_t end = _code.size();
+        size_t pc = 0;
+        while (pc < end) {
+            const Instruction& instruction = _code[pc++];
+            Register& dst = registers[instruction.dst];
+            const Register& lhs = registers[instruction.lhs];
+            const Register& rhs = registers[instruction.rhs];
+
+            switch (instruction.op) {
+            case CONSTANT:
+                dst = _constants[instruction.arg];
+                break;
+
+            case EVALUATE:
+                load(instruction.node->evaluateInternal(vars), &dst);
+                break;
+
+            case ADD_BEGIN:
+            case MULTIPLY_BEGIN:
+                dst.type = NumberInt;
+                dst.longValue = instruction.op == ADD_BEGIN ? 0 : 1;
+                dst.doubleValue = dst.longValue;
+                break;
+
+            case ADD:
+            case MULTIPLY:
+                // This mirrors ExpressionAdd and ExpressionMultiply: the integral and double
+                // results are kept in parallel and the widest operand type picks between them.
+                if (lhs.isNumber()) {
+                    dst.type = Value::getWidestNumeric(dst.type, lhs.type);
+                    if (instruction.op == ADD) {
+                        dst.doubleValue += lhs.asDouble();
+                        if (lhs.type != NumberDouble)
+                            dst.longValue += lhs.longValue;
+                    }
+                    else {
+                        dst.doubleValue *= lhs.asDouble();
+                        if (lhs.type != NumberDouble)
+                            dst.longValue *= lhs.longValue;
+                    }
+                }
+                else if (lhs.type == jstNULL || lhs.type == Undefined || lhs.type == EOO) {
+                    load(Value(BSONNULL), &dst);
+                    pc = instruction.arg;
+                }
+                else {
+                    // Dates and type errors are left to the tree.
+                    load(instruction.node->evaluateInternal(vars), &dst);
+                    pc = instruction.arg;
+                }
+                break;
+
+            case ADD_END:
+            case MULTIPLY_END:
+                // Same as Value::createIntOrLong().
+                if (dst.type == NumberInt && static_cast<int>(dst.longValue) != dst.longValue)
+                    dst.type = NumberLong;
+                break;
+
+            case SUBTRACT:
+                if (lhs.isNumber() && rhs.isNumber()) {
+                    const BSONType type = Value::getWidestNumeric(lhs.type, rhs.type);
+                    if (type == NumberDouble) {
+                        dst.doubleValue = lhs.asDouble() - rhs.asDouble();
+                    }
+                    else {
+                        dst.longValue = lhs.longValue - rhs.longValue;
+                        if (type == NumberInt
+                                && static_cast<int>(dst.longValue) != dst.longValue) {
+                            dst.type = NumberLong;
+                            break;
+                        }
+                    }
+                    dst.type = type;
+                }
+                else {
+                    load(ExpressionSubtract::apply(box(lhs), box(rhs)), &dst);
+                }
+                break;
+
+            case DIVIDE:
+                if (lhs.isNumber() && rhs.isNumber() && rhs.asDouble() != 0) {
+                    dst.doubleValue = lhs.asDouble() / rhs.asDouble();
+                    dst.type = NumberDouble;
+                }
+                else {
+                    load(ExpressionDivide::apply(box(lhs), box(rhs)), &dst);
+                }
+                break;
+
+            case MOD:
+                if ((lhs.type == NumberInt || lhs.type == NumberLong)
+                        && (rhs.type == NumberInt || rhs.type == NumberLong)
+                        && rhs.longValue != 0) {
+                    if (lhs.type == NumberInt && rhs.type == NumberInt) {
+                        dst.longValue = static_cast<int>(lhs.longValue)
+                                      % static_cast<int>(rhs.longValue);
+                        dst.type = NumberInt;
+                    }
+                    else {
+                        dst.longValue = lhs.longValue % rhs.longValue;
+                        dst.type = NumberLong;
+                    }
+                }
+                else {
+                    load(ExpressionMod::apply(box(lhs), box(rhs)), &dst);
+                }
+                break;
+
+            case COMPARE: {
+                int cmp;
+                if (lhs.isNumber() && rhs.isNumber()) {
+                    cmp = (lhs.type == NumberDouble || rhs.type == NumberDouble)
+                        ? compareDoubles(lhs.asDouble(), rhs.asDouble())
+                        : compareLongs(lhs.longValue, rhs.longValue);
+                }
+                else if (lhs.type == Bool && rhs.type == Bool) {
+                    cmp = compareLongs(lhs.longValue, rhs.longValue);
+                }
+                else {
+                    cmp = Value::compare(box(lhs), box(rhs));
+                    cmp = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+                }
+
+                const ExpressionCompare::CmpOp op =
+                    static_cast<ExpressionCompare::CmpOp>(instruction.arg);
+                if (op == ExpressionCompare::CMP) {
+                    dst.type = NumberInt;
+                    dst.longValue = cmp;
+                }
+                else {
+                    dst.type = Bool;
+                    dst.longValue = compareResult(op, cmp);
+                }
+                break;
+            }
+
+            case NOT:
+                dst.longValue = !lhs.asBool();
+                dst.type = Bool;
+                break;
+
+            case JUMP:
+                pc = instruction.arg;
+                break;
+
+            case JUMP_IF_FALSE:
+                if (!lhs.asBool())
+                    pc = instruction.arg;
+                break;
+
+            case JUMP_IF_TRUE:
+                if (lhs.asBool())
+                    pc = instruction.arg;
+                break;
+            }
+        }
+
+        return box(registers[0]);
+    }
+
+    void ExpressionProgram::addDependencies(DepsTracker* deps, vector<string>* path) const {
+        _tree->addDependencies(deps, path);
+    }
+
+    Value ExpressionProgram::serialize(bool explain) const {
+        return _tree->serialize(explain);
+    }
+
+}
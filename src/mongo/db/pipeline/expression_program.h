@@ -0,0 +1,165 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/expression.h"
+
+namespace mongo {
+
+    /**
+     * An Expression tree compiled into a flat, register-based program.
+     *
+     * Evaluating a tree makes a virtual call and builds a ref-counted Value per node.  A program
+     * instead runs a vector of instructions over a small array of registers that hold ints,
+     * longs, doubles and bools unboxed, so a $project full of arithmetic and $cond only boxes
+     * its final result.
+     *
+     * Only $add, $subtract, $multiply, $divide, $mod, the comparisons, $cond, $and, $or, $not and
+     * constants are compiled.  Any other node (field paths included) becomes a leaf that is
+     * evaluated as a tree.  Operands the fast paths don't handle, such as Dates, are handed back
+     * to the original operator so results and errors are always the same as the tree's.
+     *
+     * A program is immutable once built and keeps its registers on the stack, so one program may
+     * be evaluated by several threads at once.
+     */
+    class ExpressionProgram : public Expression {
+    public:
+        /**
+         * Returns a program for 'expression', or 'expression' itself if it isn't worth compiling
+         * (its root is not a supported operator) or is too deep to fit in the registers.
+         *
+         * 'expression' should already be optimized.
+         */
+        static intrusive_ptr<Expression> compile(const intrusive_ptr<Expression>& expression);
+
+        // virtuals from Expression
+        virtual intrusive_ptr<Expression> optimize() { return this; }
+        virtual void addDependencies(DepsTracker* deps, vector<string>* path=NULL) const;
+        virtual Value serialize(bool explain) const;
+        virtual Value evaluateInternal(Variables* vars) const;
+
+        /** The tree this program was compiled from. */
+        const intrusive_ptr<Expression>& getTree() const { return _tree; }
+
+        static const unsigned kMaxRegisters = 32;
+
+    private:
+        enum OpCode {
+            CONSTANT,       // dst = constants[arg]
+            EVALUATE,       // dst = node->evaluate()
+            ADD_BEGIN,      // dst = 0
+            ADD,            // dst += lhs, or finish early at arg
+            ADD_END,        // narrow dst to an int if it fits
+            MULTIPLY_BEGIN, // dst = 1
+            MULTIPLY,       // dst *= lhs, or finish early at arg
+            MULTIPLY_END,   // narrow dst to an int if it fits
+            SUBTRACT,       // dst = lhs - rhs
+            DIVIDE,         // dst = lhs / rhs
+            MOD,            // dst = lhs % rhs
+            COMPARE,        // dst = lhs <arg> rhs, arg is an ExpressionCompare::CmpOp
+            NOT,            // dst = !lhs
+            JUMP,           // go to arg
+            JUMP_IF_FALSE,  // go to arg if lhs is false
+            JUMP_IF_TRUE,   // go to arg if lhs is true
+        };
+
+        struct Instruction {
+            OpCode op;
+            unsigned dst;
+            unsigned lhs;
+            unsigned rhs;
+            unsigned arg;
+
+            // The tree node this instruction came from, for EVALUATE and for falling back to
+            // the tree.  Owned by _tree.
+            const Expression* node;
+        };
+
+        /**
+         * A register.  NumberInt and NumberLong are kept in 'longValue', NumberDouble in
+         * 'doubleValue' and Bool as 0 or 1 in 'longValue'.  Any other type is held boxed in
+         * 'boxed'.
+         */
+        struct Register {
+            Register() : type(EOO), longValue(0), doubleValue(0) {}
+
+            bool isNumber() const {
+                return type == NumberInt || type == NumberLong || type == NumberDouble;
+            }
+
+            double asDouble() const {
+                return type == NumberDouble ? doubleValue : static_cast<double>(longValue);
+            }
+
+            /** Same as Value::coerceToBool(). */
+            bool asBool() const {
+                switch (type) {
+                case NumberInt:
+                case NumberLong:
+                case Bool:
+                    return longValue != 0;
+                case NumberDouble:
+                    return doubleValue;
+                default:
+                    return boxed.coerceToBool();
+                }
+            }
+
+            BSONType type;
+            long long longValue;
+            double doubleValue;
+            Value boxed;
+        };
+
+        explicit ExpressionProgram(const intrusive_ptr<Expression>& tree);
+
+        /**
+         * Emits code leaving the value of 'expression' in register 'dst'.  Registers above 'dst'
+         * are free to use as scratch space.  Returns false if the registers run out.
+         */
+        bool compileNode(const intrusive_ptr<Expression>& expression, unsigned dst);
+
+        unsigned emit(OpCode op, unsigned dst, unsigned lhs=0, unsigned rhs=0, unsigned arg=0,
+                      const Expression* node=NULL);
+
+        static bool isCompilable(const Expression* expression);
+
+        static void load(const Value& value, Register* reg);
+        static Value box(const Register& reg);
+
+        intrusive_ptr<Expression> _tree;
+        vector<Instruction> _code;
+        vector<Register> _constants;
+
+        unsigned _numRegisters;
+    };
+
+}
@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/flat_value_set.h"
+
+namespace mongo {
+
+    namespace {
+        // Keep the table at most 70% full.
+        bool overLoadLimit(size_t numValues, size_t numSlots) {
+            return numValues * 10 > numSlots * 7;
+        }
+
+        const size_t kMinSlots = 16;
+    }
+
+    const size_t FlatValueSet::npos;
+
+    FlatValueSet::FlatValueSet() { }
+
+    // static
+    size_t FlatValueSet::hashOf(const Value& value) {
+        // Value::Hash is built with boost::hash_combine and clusters for small integers.  Linear
+        // probing needs the low bits to be well mixed, so finish with a 64 bit mixer.
+        unsigned long long h = Value::Hash()(value);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    size_t FlatValueSet::findSlot(const Value& value, size_t hash) const {
+        const size_t mask = _slots.size() - 1;
+        size_t i = hash & mask;
+        while (true) {
+            const Slot& slot = _slots[i];
+            if (npos == slot.pos) {
+                return i;
+            }
+            if (slot.hash == hash && _values[slot.pos] == value) {
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    size_t FlatValueSet::find(const Value& value) const {
+        if (_slots.empty()) {
+            return npos;
+        }
+        return _slots[findSlot(value, hashOf(value))].pos;
+    }
+
+    size_t FlatValueSet::insert(const Value& value, bool* inserted) {
+        if (_slots.empty() || overLoadLimit(_values.size() + 1, _slots.size())) {
+            grow();
+        }
+
+        const size_t hash = hashOf(value);
+        Slot& slot = _slots[findSlot(value, hash)];
+        if (npos != slot.pos) {
+            *inserted = false;
+            return slot.pos;
+        }
+
+        slot.hash = hash;
+        slot.pos = _values.size();
+        _values.push_back(value);
+        *inserted = true;
+        return slot.pos;
+    }
+
+    void FlatValueSet::grow() {
+        const size_t newSize = _slots.empty() ? kMinSlots : _slots.size() * 2;
+        std::vector<Slot> oldSlots(newSize);
+        _slots.swap(oldSlots);
+
+        const size_t mask = newSize - 1;
+        for (size_t i = 0; i < oldSlots.size(); i++) {
+            if (npos == oldSlots[i].pos) {
+                continue;
+            }
+
+            // Every Value is distinct, so we only need an empty slot.
+            size_t j = oldSlots[i].hash & mask;
+            while (npos != _slots[j].pos) {
+                j = (j + 1) & mask;
+            }
+            _slots[j] = oldSlots[i];
+        }
+    }
+
+    void FlatValueSet::clear() {
+        std::vector<Value>().swap(_values);
+        std::vector<Slot>().swap(_slots);
+    }
+
+    size_t FlatValueSet::memUsage() const {
+        return sizeof(*this)
+             + _values.capacity() * sizeof(Value)
+             + _slots.capacity() * sizeof(Slot);
+    }
+
+}  // namespace mongo
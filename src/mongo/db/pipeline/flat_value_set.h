@@ -0,0 +1,100 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    /**
+     * A set of Values kept in a single open-addressing hash table.
+     *
+     * The Values themselves are stored densely, in insertion order, and are addressed by their
+     * position.  That lets callers keep per-Value state in a parallel array rather than in a
+     * node per entry, as an unordered_map would.  The table proper is an array of (hash,
+     * position) slots probed linearly.
+     *
+     * Values are compared with Value::operator==, so like Value::Hash this treats numerically
+     * equal numbers of different types as the same Value.
+     */
+    class FlatValueSet {
+    public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+        FlatValueSet();
+
+        /**
+         * Returns the position of 'value', adding it at the end if it isn't already present.
+         * Sets '*inserted' to whether it was added.
+         */
+        size_t insert(const Value& value, bool* inserted);
+
+        /**
+         * Returns the position of 'value', or npos if it isn't present.
+         */
+        size_t find(const Value& value) const;
+
+        const Value& operator[](size_t pos) const { return _values[pos]; }
+
+        /// Every Value in the set, in insertion order.
+        const std::vector<Value>& values() const { return _values; }
+
+        size_t size() const { return _values.size(); }
+        bool empty() const { return _values.empty(); }
+
+        /// Removes everything and releases the memory.
+        void clear();
+
+        /**
+         * Bytes used by the table and the Value array.  This doesn't include memory that the
+         * Values point to; see Value::getApproximateSize().
+         */
+        size_t memUsage() const;
+
+    private:
+        struct Slot {
+            Slot() : hash(0), pos(npos) {}
+            size_t hash;
+            size_t pos; // npos for an empty slot
+        };
+
+        static size_t hashOf(const Value& value);
+
+        // Returns the slot holding 'value' or the empty slot where it belongs.
+        size_t findSlot(const Value& value, size_t hash) const;
+
+        void grow();
+
+        std::vector<Value> _values;
+        std::vector<Slot> _slots; // empty or a power of two in size
+    };
+
+}  // namespace mongo
@@ -0,0 +1,319 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/materialized_view.h"
+
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/db/matcher/matcher.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+    using namespace mongoutils;
+
+    const char MaterializedView::bookkeepingField[] = "_mv";
+
+namespace {
+    const char keyField[] = "k";
+    const char valuesField[] = "v";
+    const char countField[] = "n";
+    const char sumField[] = "sum";
+    const char avgCountField[] = "count";
+
+    intrusive_ptr<Expression> parseOperand(const BSONElement& elem, const VariablesParseState& vps) {
+        if (elem.type() == Object) {
+            Expression::ObjectCtx oCtx(Expression::ObjectCtx::DOCUMENT_OK);
+            return Expression::parseObject(elem.Obj(), &oCtx, vps);
+        }
+        return Expression::parseOperand(elem, vps);
+    }
+
+    /** lhs + sign * rhs, widening as $sum does. */
+    Value addNumbers(const Value& lhs, const Value& rhs, int sign) {
+        if (lhs.getType() != NumberDouble && rhs.getType() != NumberDouble)
+            return Value::createIntOrLong(lhs.coerceToLong() + sign * rhs.coerceToLong());
+        return Value(lhs.coerceToDouble() + sign * rhs.coerceToDouble());
+    }
+
+    void checkWrite(DBClientBase* conn, const string& ns) {
+        const string err = conn->getLastError();
+        uassert(17500, str::stream() << "write to materialized view collection " << ns
+                                     << " failed: " << err,
+                err.empty());
+    }
+}
+
+    MaterializedView::MaterializedView(const NamespaceString& sourceNs,
+                                       const NamespaceString& targetNs,
+                                       const BSONObj& pipeline)
+        : _sourceNs(sourceNs)
+        , _targetNs(targetNs)
+        , _pipeline(pipeline.getOwned())
+        , _numVariables(0) {
+
+        uassert(17489, "a materialized view must be in the same database as its source",
+                sourceNs.db() == targetNs.db());
+        uassert(17490, "a materialized view can't be its own source", sourceNs != targetNs);
+        uassert(17491, str::stream() << "can't use " << targetNs.ns()
+                                     << " for a materialized view",
+                targetNs.isValid() && !targetNs.isSpecial());
+
+        vector<BSONObj> matches;
+        bool haveGroup = false;
+        BSONForEach(stageElem, _pipeline) {
+            uassert(17492, "each pipeline stage must be an object with exactly one field",
+                    stageElem.type() == Object && stageElem.Obj().nFields() == 1);
+            uassert(17493, "$group must be the last stage of a materialized view's pipeline",
+                    !haveGroup);
+
+            const BSONElement stage = stageElem.Obj().firstElement();
+            const StringData stageName = stage.fieldNameStringData();
+            if (stageName == "$match") {
+                uassert(17494, "$match must be an object", stage.type() == Object);
+                matches.push_back(stage.Obj());
+            }
+            else if (stageName == "$group") {
+                uassert(17495, "$group must be an object", stage.type() == Object);
+                haveGroup = true;
+
+                VariablesIdGenerator idGenerator;
+                VariablesParseState vps(&idGenerator);
+                BSONForEach(field, stage.Obj()) {
+                    const string fieldName = field.fieldName();
+                    if (fieldName == "_id") {
+                        _idExpression = parseOperand(field, vps)->optimize();
+                        continue;
+                    }
+
+                    uassert(17496, str::stream() << "a materialized view can't have a field named "
+                                                 << bookkeepingField,
+                            fieldName != bookkeepingField);
+                    uassert(17497, str::stream() << "the group field '" << fieldName
+                                                 << "' must be an object with one accumulator",
+                            field.type() == Object && field.Obj().nFields() == 1);
+
+                    const BSONElement accumulator = field.Obj().firstElement();
+                    const StringData opName = accumulator.fieldNameStringData();
+                    if (opName == "$sum") {
+                        _ops.push_back(SUM);
+                    }
+                    else if (opName == "$avg") {
+                        _ops.push_back(AVG);
+                    }
+                    else {
+                        uasserted(17498, str::stream() << "only $sum and $avg can be maintained"
+                                                       << " incrementally, not " << opName);
+                    }
+
+                    _fieldNames.push_back(fieldName);
+                    _expressions.push_back(parseOperand(accumulator, vps)->optimize());
+                }
+                _numVariables = idGenerator.getIdCount();
+            }
+            else {
+                uasserted(17499, str::stream() << "a materialized view's pipeline may only have"
+                                               << " $match and $group stages, not "
+                                               << stageName);
+            }
+        }
+
+        uassert(17501, "a materialized view's pipeline must end with a $group", haveGroup);
+        uassert(17502, "a group specification must include an _id", _idExpression);
+
+        if (matches.size() == 1) {
+            _matcher.reset(new Matcher(matches[0]));
+        }
+        else if (!matches.empty()) {
+            _matcher.reset(new Matcher(BSON("$and" << matches)));
+        }
+    }
+
+    MaterializedView::~MaterializedView() {}
+
+    NamespaceString MaterializedView::getContributionsNs() const {
+        return NamespaceString(_targetNs.db(), _targetNs.coll().toString() + ".contributions");
+    }
+
+    MaterializedView::Contribution MaterializedView::computeContribution(
+            const BSONObj& doc) const {
+        Contribution contribution;
+        if (doc.isEmpty() || (_matcher && !_matcher->matches(doc)))
+            return contribution;
+
+        Variables vars(_numVariables, Document(doc));
+        contribution.exists = true;
+        contribution.key = _idExpression->evaluate(&vars);
+        if (contribution.key.missing())
+            contribution.key = Value(BSONNULL);
+
+        for (size_t i = 0; i < _expressions.size(); i++) {
+            // Both $sum and $avg ignore non-numeric values.
+            const Value value = _expressions[i]->evaluate(&vars);
+            contribution.values.push_back(value.numeric() ? value : Value(BSONNULL));
+        }
+        return contribution;
+    }
+
+    MaterializedView::Contribution MaterializedView::parseContribution(const BSONObj& stored) {
+        Contribution contribution;
+        if (stored.isEmpty())
+            return contribution;
+
+        contribution.exists = true;
+        contribution.key = Value(stored[keyField]);
+        contribution.values = Value(stored[valuesField]).getArray();
+        return contribution;
+    }
+
+    BSONObj MaterializedView::serializeContribution(const BSONElement& id,
+                                                    const Contribution& contribution) {
+        BSONObjBuilder builder;
+        builder.appendAs(id, "_id");
+        contribution.key.addToBsonObj(&builder, keyField);
+        Value(contribution.values).addToBsonObj(&builder, valuesField);
+        return builder.obj();
+    }
+
+    void MaterializedView::rebuild(DBClientBase* conn) {
+        const string contributionsNs = getContributionsNs().ns();
+        conn->dropCollection(_targetNs.ns());
+        conn->dropCollection(contributionsNs);
+
+        auto_ptr<DBClientCursor> cursor = conn->query(_sourceNs.ns(), Query());
+        uassert(17503, "couldn't read " + _sourceNs.ns(), cursor.get());
+        while (cursor->more()) {
+            const BSONObj doc = cursor->nextSafe();
+            const Contribution contribution = computeContribution(doc);
+            if (!contribution.exists)
+                continue;
+
+            applyToGroup(conn, contribution, 1);
+            conn->insert(contributionsNs, serializeContribution(doc["_id"], contribution));
+            checkWrite(conn, contributionsNs);
+        }
+    }
+
+    void MaterializedView::refresh(DBClientBase* conn, const BSONElement& id) {
+        const BSONObj idQuery = id.wrap("_id");
+        const Contribution oldContribution =
+            parseContribution(conn->findOne(getContributionsNs().ns(), Query(idQuery)));
+        const Contribution newContribution =
+            computeContribution(conn->findOne(_sourceNs.ns(), Query(idQuery)));
+        apply(conn, id, oldContribution, newContribution);
+    }
+
+    void MaterializedView::apply(DBClientBase* conn,
+                                 const BSONElement& id,
+                                 const Contribution& oldContribution,
+                                 const Contribution& newContribution) {
+        if (oldContribution.exists && newContribution.exists
+                && Value::compare(oldContribution.key, newContribution.key) == 0
+                && Value::compare(Value(oldContribution.values),
+                                  Value(newContribution.values)) == 0) {
+            return; // nothing the view depends on changed
+        }
+
+        if (oldContribution.exists)
+            applyToGroup(conn, oldContribution, -1);
+
+        const string contributionsNs = getContributionsNs().ns();
+        const BSONObj idQuery = id.wrap("_id");
+        if (newContribution.exists) {
+            applyToGroup(conn, newContribution, 1);
+            conn->update(contributionsNs, Query(idQuery),
+                         serializeContribution(id, newContribution), /*upsert*/ true);
+            checkWrite(conn, contributionsNs);
+        }
+        else if (oldContribution.exists) {
+            conn->remove(contributionsNs, Query(idQuery), /*justOne*/ true);
+            checkWrite(conn, contributionsNs);
+        }
+    }
+
+    void MaterializedView::applyToGroup(DBClientBase* conn,
+                                        const Contribution& contribution,
+                                        int sign) {
+        const string targetNs = _targetNs.ns();
+        BSONObjBuilder idBuilder;
+        contribution.key.addToBsonObj(&idBuilder, "_id");
+        const BSONObj idQuery = idBuilder.obj();
+
+        const BSONObj group = conn->findOne(targetNs, Query(idQuery));
+        const BSONObj bookkeeping = group[bookkeepingField].isABSONObj()
+                                  ? group[bookkeepingField].Obj()
+                                  : BSONObj();
+
+        const long long count = bookkeeping[countField].numberLong() + sign;
+        if (count <= 0) {
+            conn->remove(targetNs, Query(idQuery), /*justOne*/ true);
+            checkWrite(conn, targetNs);
+            return;
+        }
+
+        BSONObjBuilder out;
+        out.appendElements(idQuery);
+        BSONObjBuilder newBookkeeping;
+        newBookkeeping.append(countField, count);
+        for (size_t i = 0; i < _fieldNames.size(); i++) {
+            const string& name = _fieldNames[i];
+            const Value& value = contribution.values[i];
+
+            if (_ops[i] == SUM) {
+                Value total(group[name]);
+                if (total.missing())
+                    total = Value(0);
+                if (value.numeric())
+                    total = addNumbers(total, value, sign);
+                total.addToBsonObj(&out, name);
+            }
+            else {
+                const BSONObj avgState = bookkeeping[name].isABSONObj()
+                                       ? bookkeeping[name].Obj()
+                                       : BSONObj();
+                double sum = avgState[sumField].numberDouble();
+                long long numValues = avgState[avgCountField].numberLong();
+                if (value.numeric()) {
+                    sum += sign * value.getDouble();
+                    numValues += sign;
+                }
+
+                // Like $avg, this is 0 if there were no numeric values.
+                out.append(name, numValues ? sum / numValues : 0.0);
+                newBookkeeping.append(name, BSON(sumField << sum << avgCountField << numValues));
+            }
+        }
+        out.append(bookkeepingField, newBookkeeping.obj());
+
+        conn->update(targetNs, Query(idQuery), out.obj(), /*upsert*/ true);
+        checkWrite(conn, targetNs);
+    }
+
+}  // namespace mongo
@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    class DBClientBase;
+    class Expression;
+    class Matcher;
+
+    /**
+     * An aggregation whose result is kept in a collection and updated incrementally as the source
+     * collection changes, instead of being recomputed.
+     *
+     * Only pipelines whose result can be updated by adding and subtracting per-document
+     * contributions are supported: zero or more $match stages followed by one $group whose
+     * accumulators are all $sum or $avg (a count is {$sum: 1}).
+     *
+     * Each source document's contribution (its group key and accumulator inputs) is remembered in
+     * getContributionsNs(), keyed by the document's _id.  refresh() recomputes the contribution
+     * of one document from its current state, subtracts the old one from its group and adds the
+     * new one.  Since that only depends on the current state of the document, refreshing a
+     * document again is harmless, so the oplog can be replayed from any earlier point.
+     *
+     * Each target document is {_id: <group key>, <field>: <value>, ..., _mv: <bookkeeping>}.
+     * The _mv subdocument holds the number of documents in the group and the sums and counts
+     * behind each $avg.  A group is removed when its last document is.
+     */
+    class MaterializedView {
+        MONGO_DISALLOW_COPYING(MaterializedView);
+    public:
+        /**
+         * Throws a UserException if 'pipeline' can't be maintained incrementally.
+         */
+        MaterializedView(const NamespaceString& sourceNs,
+                         const NamespaceString& targetNs,
+                         const BSONObj& pipeline);
+        ~MaterializedView();
+
+        const NamespaceString& getSourceNs() const { return _sourceNs; }
+        const NamespaceString& getTargetNs() const { return _targetNs; }
+        const BSONObj& getPipeline() const { return _pipeline; }
+
+        /** Where the per-document contributions are kept. */
+        NamespaceString getContributionsNs() const;
+
+        /**
+         * Replaces the target and the contributions with ones computed from every document
+         * currently in the source.
+         */
+        void rebuild(DBClientBase* conn);
+
+        /**
+         * Brings the target up to date with the current state of the source document whose _id
+         * is 'id'.  The document may have been deleted.
+         */
+        void refresh(DBClientBase* conn, const BSONElement& id);
+
+        static const char bookkeepingField[];
+
+    private:
+        enum AccumulatorOp { SUM, AVG };
+
+        struct Contribution {
+            Contribution() : exists(false) {}
+
+            bool exists; // false if the document doesn't exist or doesn't match
+            Value key;
+            vector<Value> values; // one per accumulator
+        };
+
+        Contribution computeContribution(const BSONObj& doc) const;
+        static Contribution parseContribution(const BSONObj& stored);
+        static BSONObj serializeContribution(const BSONElement& id, const Contribution& c);
+
+        // Applies the document 'id' changing from 'oldContribution' to 'newContribution'.
+        void apply(DBClientBase* conn,
+                   const BSONElement& id,
+                   const Contribution& oldContribution,
+                   const Contribution& newContribution);
+
+        // Adds (sign 1) or subtracts (sign -1) 'contribution' to or from its group.
+        void applyToGroup(DBClientBase* conn, const Contribution& contribution, int sign);
+
+        const NamespaceString _sourceNs;
+        const NamespaceString _targetNs;
+        const BSONObj _pipeline;
+
+        boost::scoped_ptr<Matcher> _matcher; // NULL if there is no $match
+        intrusive_ptr<Expression> _idExpression;
+        vector<string> _fieldNames;
+        vector<AccumulatorOp> _ops;
+        vector<intrusive_ptr<Expression> > _expressions;
+        size_t _numVariables;
+    };
+
+}  // namespace mongo
@@ -210,31 +210,88 @@ namespace mongo {
 
         // The order in which optimizations are applied can have significant impact on the
         // efficiency of the final pipeline. Be Careful!
-        Optimizations::Local::moveMatchBeforeSort(pPipeline.get());
+        Optimizations::Local::moveMatchEarlier(pPipeline.get());
         Optimizations::Local::moveLimitBeforeSkip(pPipeline.get());
         Optimizations::Local::coalesceAdjacent(pPipeline.get());
+        Optimizations::Local::absorbUnwindIntoGroup(pPipeline.get());
         Optimizations::Local::optimizeEachDocumentSource(pPipeline.get());
         Optimizations::Local::duplicateMatchBeforeInitalRedact(pPipeline.get());
 
         return pPipeline;
     }
 
-    void Pipeline::Optimizations::Local::moveMatchBeforeSort(Pipeline* pipeline) {
-        // TODO Keep moving matches across multiple sorts as moveLimitBeforeSkip does below.
-        // TODO Check sort for limit. Not an issue currently due to order optimizations are applied,
-        // but should be fixed.
+namespace {
+    /**
+     * Returns a match that, run in front of 'stage', keeps exactly the documents that 'match'
+     * would keep after it.  Returns NULL if there is no such match.
+     */
+    intrusive_ptr<DocumentSourceMatch> matchBefore(DocumentSourceMatch* match,
+                                                   DocumentSource* stage) {
+        // TODO Check sort for limit. Not an issue currently due to order optimizations are
+        // applied, but should be fixed.
+        if (dynamic_cast<DocumentSourceSort*>(stage))
+            return match;
+
+        set<string> fields;
+        if (!match->getTopLevelFields(&fields))
+            return NULL;
+
+        if (DocumentSourceUnwind* unwind = dynamic_cast<DocumentSourceUnwind*>(stage)) {
+            const string unwound = unwind->getUnwindPath();
+            if (fields.count(unwound.substr(0, unwound.find('.'))))
+                return NULL;
+            return match;
+        }
+
+        if (DocumentSourceProject* project = dynamic_cast<DocumentSourceProject*>(stage)) {
+            const map<string, string> renames = project->getRenamedFields();
+            for (set<string>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+                if (!renames.count(*it))
+                    return NULL;
+            }
+            return match->renameTopLevelFields(renames);
+        }
+
+        if (DocumentSourceGroup* group = dynamic_cast<DocumentSourceGroup*>(stage)) {
+            const string idField = group->getIdFieldPath();
+            if (idField.empty() || fields.size() != 1 || !fields.count("_id"))
+                return NULL;
+
+            // Values of different types can be equal and share a group, which then has the type of
+            // whichever came first.
+            if (match->isTypeSensitive())
+                return NULL;
+
+            // Documents missing the field are grouped under a null _id, so the match must treat a
+            // missing and a null field alike.
+            if (match->matches(BSONObj()) != match->matches(BSON("_id" << BSONNULL)))
+                return NULL;
+
+            map<string, string> renames;
+            renames["_id"] = idField;
+            return match->renameTopLevelFields(renames);
+        }
+
+        return NULL;
+    }
+}
+
+    void Pipeline::Optimizations::Local::moveMatchEarlier(Pipeline* pipeline) {
         SourceContainer& sources = pipeline->sources;
-        for (size_t srcn = sources.size(), srci = 1; srci < srcn; ++srci) {
-            intrusive_ptr<DocumentSource> &pSource = sources[srci];
-            DocumentSourceMatch* match = dynamic_cast<DocumentSourceMatch *>(pSource.get());
-            if (match && !match->isTextQuery()) {
-                intrusive_ptr<DocumentSource> &pPrevious = sources[srci - 1];
-                if (dynamic_cast<DocumentSourceSort *>(pPrevious.get())) {
-                    /* swap this item with the previous */
-                    intrusive_ptr<DocumentSource> pTemp(pPrevious);
-                    pPrevious = pSource;
-                    pSource = pTemp;
-                }
+        for (size_t srci = 1; srci < sources.size(); ++srci) {
+            // Keep moving this match forward until something stops it.
+            for (size_t i = srci; i > 0; --i) {
+                DocumentSourceMatch* match = dynamic_cast<DocumentSourceMatch*>(sources[i].get());
+                if (!match || match->isTextQuery())
+                    break;
+
+                intrusive_ptr<DocumentSourceMatch> moved = matchBefore(match,
+                                                                       sources[i - 1].get());
+                if (!moved)
+                    break;
+
+                sources[i] = sources[i - 1];
+                sources[i - 1] = moved;
             }
         }
     }
@@ -297,6 +354,17 @@ namespace mongo {
         }
     }
 
+    void Pipeline::Optimizations::Local::absorbUnwindIntoGroup(Pipeline* pipeline) {
+        SourceContainer& sources = pipeline->sources;
+        for (size_t i = 0; i + 1 < sources.size(); ++i) {
+            DocumentSourceUnwind* unwind = dynamic_cast<DocumentSourceUnwind*>(sources[i].get());
+            DocumentSourceGroup* group = dynamic_cast<DocumentSourceGroup*>(sources[i + 1].get());
+            if (unwind && group && group->absorbUnwind(FieldPath(unwind->getUnwindPath()))) {
+                sources.erase(sources.begin() + i);
+            }
+        }
+    }
+
     void Pipeline::Optimizations::Local::optimizeEachDocumentSource(Pipeline* pipeline) {
         SourceContainer& sources = pipeline->sources;
         for (SourceContainer::iterator it(sources.begin()); it != sources.end(); ++it) {
@@ -39,10 +39,21 @@
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_runner.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/s/d_logic.h"
 
 namespace mongo {
 
+    // A $sort with a $limit of at most this many documents may be run as a top-K sort by the
+    // query system when no index provides the order.
+    MONGO_EXPORT_SERVER_PARAMETER(internalAggregationQueryTopKMaxLimit, int, 1000);
+
+    // The query system's sort fails once it holds 32MB and can't spill, where $sort has a larger
+    // limit and can use the disk.  So we only hand it a top-K sort when the limit times the
+    // collection's average object size fits in this many bytes, leaving room for the documents
+    // that are kept to be larger than average.
+    MONGO_EXPORT_SERVER_PARAMETER(internalAggregationQueryTopKMaxBytes, int, 8 * 1024 * 1024);
+
 namespace {
     class MongodImplementation : public DocumentSourceNeedsMongod::MongodInterface {
     public:
@@ -171,12 +182,64 @@ namespace {
                 // success: The Runner will handle sorting for us using an index.
                 runner.reset(rawRunner);
                 sortInRunner = true;
+            }
+        }
 
-                sources.pop_front();
-                if (sortStage->getLimitSrc()) {
-                    // need to reinsert coalesced $limit after removing $sort
-                    sources.push_front(sortStage->getLimitSrc());
-                }
+        // No index gives the order, but if the $sort only keeps its first few documents the
+        // query system can do a top-K sort.  That saves converting every matching document into
+        // a Document just to throw most of them away.  If the user allowed the sort to use the
+        // disk, or we have no idea how large the kept documents will be, leave it to $sort.
+        if (sortStage && !sortInRunner && sortStage->getLimitSrc()
+                && sortStage->getLimit() <= internalAggregationQueryTopKMaxLimit
+                && !pExpCtx->extSortAllowed
+                && collection && collection->numRecords() > 0
+                && sortStage->getLimit() * collection->averageObjectSize()
+                       <= internalAggregationQueryTopKMaxBytes) {
+            CanonicalQuery* cq;
+            // A negative limit is a hard limit, so the planner makes a plain top-K sort.
+            Status status =
+                CanonicalQuery::canonicalize(pExpCtx->ns,
+                                             queryObj,
+                                             sortObj,
+                                             projectionForQuery,
+                                             0, // skip
+                                             -sortStage->getLimit(),
+                                             &cq,
+                                             whereCallback);
+            Runner* rawRunner;
+            if (status.isOK()
+                    && getRunner(collection, cq, &rawRunner,
+                                 runnerOptions & ~QueryPlannerParams::NO_BLOCKING_SORT).isOK()) {
+                runner.reset(rawRunner);
+                sortInRunner = true;
+            }
+        }
+
+        if (sortInRunner) {
+            sources.pop_front();
+            if (sortStage->getLimitSrc()) {
+                // need to reinsert coalesced $limit after removing $sort
+                sources.push_front(sortStage->getLimitSrc());
+            }
+        }
+
+        // A leading {$group: {_id: "$field"}} only needs the distinct values of 'field', which an
+        // index on it can produce without looking at every key.  The distinct runner doesn't
+        // filter out orphans, so this is only safe on unsharded collections.  A collection that
+        // doesn't exist is left to the regular runner, which returns nothing.
+        intrusive_ptr<DocumentSourceGroup> groupStage;
+        if (collection && !runner.get() && !sources.empty() && !deps.needTextScore
+                && !shardingState.needCollectionMetadata(fullName)) {
+            groupStage = dynamic_cast<DocumentSourceGroup*>(sources.front().get());
+        }
+        if (groupStage) {
+            const string field = groupStage->getDistinctFieldPath();
+            Runner* rawRunner;
+            if (!field.empty()
+                    && getRunnerDistinct(collection, queryObj, field, &rawRunner,
+                                         /*allowMultikey*/ false,
+                                         /*allowSparse*/ false).isOK()) {
+                runner.reset(rawRunner);
             }
         }
 
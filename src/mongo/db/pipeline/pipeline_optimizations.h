@@ -43,14 +43,21 @@ namespace mongo {
      */
     class Pipeline::Optimizations::Local {
     public:
-        /** 
-         * Moves matches before any adjacent sort phases.
+        /**
+         * Moves each match as early in the pipeline as it can go without changing the result.
+         *
+         * A match (excluding $text) moves in front of:
+         *  - a $sort, since neither stage changes the documents.
+         *  - a $project, if every field it examines is copied or renamed from an input field.
+         *    The match is rewritten to use the input names.
+         *  - an $unwind, if it doesn't examine the unwound field.
+         *  - a $group, if it only examines the _id of a {$group: {_id: "$a"}}.  The match is
+         *    rewritten to examine 'a' instead.
          *
-         * This means we sort fewer items.  Neither sorts, nor matches (excluding $text)
-         * change the documents in the stream, so this transformation shouldn't affect
-         * the result.
+         * This means later stages see fewer documents, and a match that reaches the front of the
+         * pipeline becomes part of the query, where it can use indexes.
          */
-        static void moveMatchBeforeSort(Pipeline* pipeline);
+        static void moveMatchEarlier(Pipeline* pipeline);
 
         /**
          * Moves limits before any adjacent skip phases.
@@ -73,6 +80,14 @@ namespace mongo {
          */
         static void coalesceAdjacent(Pipeline* pipeline);
 
+        /**
+         * Folds each $unwind that is directly followed by a $group into the $group, which then
+         * feeds the array elements to its accumulators without making a document for each.
+         *
+         * NOTE: uses DocumentSourceGroup::absorbUnwind()
+         */
+        static void absorbUnwindIntoGroup(Pipeline* pipeline);
+
         /**
          * Gives each DocumentSource the opportunity to optimize itself.
          *
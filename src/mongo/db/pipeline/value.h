@@ -151,6 +151,7 @@ namespace mongo {
         OpTime getTimestamp() const;
         const char* getRegex() const;
         const char* getRegexFlags() const;
+        BSONBinData getBinData() const; // points into this Value
         string getSymbol() const;
         string getCode() const;
         int getInt() const;
@@ -329,6 +330,12 @@ namespace mongo {
         return _storage.timestampValue;
     }
 
+    inline BSONBinData Value::getBinData() const {
+        verify(getType() == BinData);
+        const StringData data = _storage.getString();
+        return BSONBinData(data.rawData(), data.size(), _storage.binDataType());
+    }
+
     inline const char* Value::getRegex() const {
         verify(getType() == RegEx);
         return _storage.getString().rawData(); // this is known to be NUL terminated
@@ -30,14 +30,20 @@
 
 #include "mongo/db/prefetch.h"
 
+#include <map>
+
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/record.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/commands/server_status_metric.h"
+#include "mongo/util/processinfo.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -55,6 +61,123 @@ namespace mongo {
                                                     "repl.preload.docs",
                                                     &prefetchDocStats );
 
+    // Whether secondaries stop prefetching for a collection whose documents are found to be in
+    // memory already, as sampled with ProcessInfo::blockInMemory().
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchAdaptive, bool, true);
+
+    // Documents of a collection sampled per decision, and the percentage of them that must have
+    // been in memory for prefetch to be skipped until the next decision.
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchAdaptiveSamples, int, 1000);
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchAdaptiveResidentPercent, int, 99);
+
+    /**
+     * Decides, per collection, whether prefetching its ops is worth it, and reports the decisions
+     * and what skipping saved.
+     *
+     * Each update's document is checked for being in memory before it is prefetched.  After
+     * replPrefetchAdaptiveSamples checks, prefetch is skipped for the collection if enough of
+     * them found the document in memory, and done otherwise.  While it is skipped, one op in
+     * kProbeInterval is prefetched anyway, to keep sampling.  Collections without samples, such
+     * as insert-only ones, are always prefetched.
+     */
+    class AdaptivePrefetchPolicy : public ServerStatusMetric {
+    public:
+        AdaptivePrefetchPolicy() : ServerStatusMetric("repl.preload.adaptive"),
+                                   _mutex("AdaptivePrefetchPolicy"),
+                                   _opsPrefetched(0),
+                                   _opsSkipped(0),
+                                   _prefetchMicros(0),
+                                   _docsSampled(0),
+                                   _docsInMemory(0),
+                                   _decisions(0),
+                                   _collectionsSkipped(0) {
+        }
+
+        bool shouldPrefetch(const std::string& ns) {
+            scoped_lock lk(_mutex);
+            CollectionState& state = _collections[ns];
+            if (state.skip && ++state.opsSinceProbe < kProbeInterval) {
+                _opsSkipped++;
+                return false;
+            }
+            state.opsSinceProbe = 0;
+            return true;
+        }
+
+        void recordPrefetch(long long micros) {
+            scoped_lock lk(_mutex);
+            _opsPrefetched++;
+            _prefetchMicros += micros;
+        }
+
+        void recordSample(const std::string& ns, bool inMemory) {
+            scoped_lock lk(_mutex);
+            _docsSampled++;
+            if (inMemory)
+                _docsInMemory++;
+
+            CollectionState& state = _collections[ns];
+            state.sampled++;
+            if (inMemory)
+                state.inMemory++;
+            if (state.sampled < replPrefetchAdaptiveSamples)
+                return;
+
+            const bool skip = state.inMemory * 100 >=
+                              state.sampled * replPrefetchAdaptiveResidentPercent;
+            if (skip != state.skip) {
+                LOG(1) << (skip ? "skipping" : "resuming") << " prefetch for " << ns << ": "
+                       << state.inMemory << " of " << state.sampled
+                       << " sampled documents were in memory" << endl;
+                _decisions++;
+                _collectionsSkipped += skip ? 1 : -1;
+                state.skip = skip;
+            }
+            state.sampled = 0;
+            state.inMemory = 0;
+        }
+
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            scoped_lock lk(_mutex);
+            BSONObjBuilder sub(b.subobjStart(_leafName));
+            sub.append("enabled", replPrefetchAdaptive);
+            sub.append("collectionsSkipped", _collectionsSkipped);
+            sub.append("decisions", _decisions);
+            sub.append("docsSampled", _docsSampled);
+            sub.append("docsInMemory", _docsInMemory);
+            sub.append("opsPrefetched", _opsPrefetched);
+            sub.append("opsSkipped", _opsSkipped);
+            // what the skipped ops would have cost at the average cost of a prefetched one
+            sub.append("estimatedMicrosSaved",
+                       _opsPrefetched ? _opsSkipped * (_prefetchMicros / _opsPrefetched) : 0);
+            sub.done();
+        }
+
+    private:
+        static const int kProbeInterval = 16;
+
+        struct CollectionState {
+            CollectionState() : skip(false), opsSinceProbe(0), sampled(0), inMemory(0) {}
+
+            bool skip;
+            int opsSinceProbe;
+            long long sampled;
+            long long inMemory;
+        };
+
+        mutable mongo::mutex _mutex;
+        std::map<std::string, CollectionState> _collections;
+        long long _opsPrefetched;
+        long long _opsSkipped;
+        long long _prefetchMicros;
+        long long _docsSampled;
+        long long _docsInMemory;
+        long long _decisions;
+        long long _collectionsSkipped;
+    };
+
+    static AdaptivePrefetchPolicy adaptivePrefetchPolicy;
+
     // prefetch for an oplog operation
     void prefetchPagesForReplicatedOp(Database* db, const BSONObj& op) {
         const char *opField;
@@ -79,6 +202,12 @@ namespace mongo {
         if ( !collection )
             return;
 
+        const bool adaptive = replPrefetchAdaptive && ProcessInfo::blockCheckSupported();
+        if (adaptive && !adaptivePrefetchPolicy.shouldPrefetch(ns)) {
+            return;
+        }
+        Timer timer;
+
         LOG(4) << "index prefetch for op " << *opType << endl;
 
         DEV Lock::assertAtLeastReadLocked(ns);
@@ -112,6 +241,10 @@ namespace mongo {
             !collection->isCapped()) {
             prefetchRecordPages(ns, obj);
         }
+
+        if (adaptive) {
+            adaptivePrefetchPolicy.recordPrefetch(timer.micros());
+        }
     }
 
     void prefetchIndexPages(Collection* collection, const BSONObj& obj) {
@@ -176,12 +309,24 @@ namespace mongo {
             TimerHolder timer(&prefetchDocStats);
             BSONObjBuilder builder;
             builder.append(_id);
-            BSONObj result;
             try {
                 // we can probably use Client::Context here instead of ReadContext as we
                 // have locked higher up the call stack already
                 Client::ReadContext ctx( ns );
-                if( Helpers::findById(ctx.ctx().db(), ns, builder.done(), result) ) {
+                Collection* collection = ctx.ctx().db()->getCollection( ns );
+                DiskLoc loc;
+                if ( collection )
+                    loc = Helpers::findById( collection, builder.done() );
+                if( !loc.isNull() ) {
+                    // Only the index has been touched so far.  Note whether the document was in
+                    // memory before touching it.
+                    if (replPrefetchAdaptive && ProcessInfo::blockCheckSupported()) {
+                        const Record* record = collection->getRecordStore()->recordFor( loc );
+                        adaptivePrefetchPolicy.recordSample(ns,
+                                                            ProcessInfo::blockInMemory(
+                                                                record->data()));
+                    }
+                    BSONObj result = collection->docFor( loc );
                     // do we want to use Record::touch() here?  it's pretty similar.
                     volatile char _dummy_char = '\0';
                     // Touch the first word on every page in order to fault it into memory
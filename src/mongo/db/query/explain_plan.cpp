@@ -476,6 +476,9 @@ namespace mongo {
             bob->appendNumber("flaggedInProgress", spec->flaggedInProgress);
             bob->appendNumber("memUsage", spec->memUsage);
             bob->appendNumber("memLimit", spec->memLimit);
+            bob->appendNumber("bloomFilterBits", spec->bloomFilterBits);
+            bob->appendNumber("bloomFilterRejects", spec->bloomFilterRejects);
+            bob->appendNumber("bloomFilterFalsePositives", spec->bloomFilterFalsePositives);
             for (size_t i = 0; i < spec->mapAfterChild.size(); ++i) {
                 bob->appendNumber(string(stream() << "mapAfterChild_" << i), spec->mapAfterChild[i]);
             }
@@ -42,6 +42,7 @@
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_cost_model.h"
 #include "mongo/db/query/planner_analysis.h"
 #include "mongo/db/query/planner_access.h"
 #include "mongo/db/query/qlog.h"
@@ -119,8 +120,9 @@ namespace mongo {
     }
 
     namespace {
-        // The body is below in the "count hack" section but getRunner calls it.
+        // The bodies are below in the "count hack" section but getRunner calls them.
         bool turnIxscanIntoCount(QuerySolution* soln);
+        bool turnFetchIntoCoveredCount(QuerySolution* soln);
     }  // namespace
 
 
@@ -253,6 +255,15 @@ namespace mongo {
                                                         &qs, &backupQs);
 
             if (status.isOK()) {
+                // We don't probe the index bounds again on a cache hit.  The estimate the plan
+                // was cached under is reported by explain, and the CachedPlanStage checks it
+                // against what the plan actually did when it gives the cache feedback.
+                if (NULL != cs->costEstimate.get()) {
+                    qs->costEstimate.reset(new PlanCostEstimate(*cs->costEstimate));
+                }
+
+                collection->infoCache()->getPlanCache()->recordHit(*canonicalQuery);
+
                 // the working set will be shared by the root and backupRoot plans
                 // and owned by the containing single-solution-runner
                 //
@@ -279,7 +290,8 @@ namespace mongo {
                 }
 
                 // add a CachedPlanStage on top of the previous root
-                root = new CachedPlanStage(collection, rawCanonicalQuery, root, backupRoot);
+                root = new CachedPlanStage(collection, rawCanonicalQuery, root, backupRoot,
+                                           cs->costEstimate.get());
                 
                 *out = new SingleSolutionRunner(collection,
                                                 canonicalQuery.release(),
@@ -361,6 +373,15 @@ namespace mongo {
                     return Status::OK();
                 }
             }
+
+            // None of them can use the count stage, but we may still be able to count keys
+            // rather than documents.
+            for (size_t i = 0; i < solutions.size(); ++i) {
+                if (turnFetchIntoCoveredCount(solutions[i])) {
+                    LOG(2) << "Using covered count: " << canonicalQuery->toStringShort()
+                           << ", planSummary: " << getPlanSummary(*solutions[i]);
+                }
+            }
         }
 
         if (1 == solutions.size()) {
@@ -384,6 +405,11 @@ namespace mongo {
         else {
             // Many solutions.  Create a MultiPlanStage to pick the best, update the cache, and so on.
 
+            // Drop the candidates that are clearly worse than another before racing them.  We go
+            // through the MultiPlanStage even if only one candidate is left so that the choice is
+            // cached and we don't pay for the estimates on every run.
+            PlanCostModel::pruneSolutions(collection, &solutions);
+
             // The working set will be shared by all candidate plans and owned by the containing runner
             WorkingSet* sharedWorkingSet = new WorkingSet();
 
@@ -478,6 +504,35 @@ namespace mongo {
             return true;
         }
 
+        /**
+         * Returns 'true' if the provided solution 'soln' reads documents only to count them, that
+         * is if its root is a fetch without a filter over an index scan.  Removes the fetch so
+         * that the count is answered from the index keys alone.  Mutates the tree in 'soln->root'.
+         *
+         * Unlike turnIxscanIntoCount this works for any bounds, such as those of an $in or a
+         * skip-scan.
+         *
+         * Otherwise, returns 'false'.
+         */
+        bool turnFetchIntoCoveredCount(QuerySolution* soln) {
+            QuerySolutionNode* root = soln->root.get();
+
+            if (STAGE_FETCH != root->getType() || NULL != root->filter.get()) {
+                return false;
+            }
+
+            // Any filter on the ixscan is over the index keys, so it's fine to keep.
+            if (STAGE_IXSCAN != root->children[0]->getType()) {
+                return false;
+            }
+
+            QuerySolutionNode* ixscan = root->children[0];
+            root->children.clear();
+            // Deletes the old root.
+            soln->root.reset(ixscan);
+            return true;
+        }
+
         /**
          * Returns true if indices contains an index that can be
          * used with DistinctNode. Sets indexOut to the array index
@@ -608,7 +663,12 @@ namespace mongo {
                                                      &cq,
                                                      whereCallback));
 
-        return getRunner(collection, cq, out, QueryPlannerParams::PRIVATE_IS_COUNT);
+        size_t options = QueryPlannerParams::PRIVATE_IS_COUNT;
+        if (internalQueryPlannerEnableSkipScan) {
+            options |= QueryPlannerParams::SKIP_SCAN;
+        }
+
+        return getRunner(collection, cq, out, options);
     }
 
     //
@@ -650,9 +710,7 @@ namespace mongo {
             dn->direction = isn->direction;
             dn->bounds = isn->bounds;
 
-            // Figure out which field we're skipping to the next value of.  TODO: We currently only
-            // try to distinct-hack when there is an index prefixed by the field we're distinct-ing
-            // over.  Consider removing this code if we stick with that policy.
+            // Figure out which field we're skipping to the next value of.
             dn->fieldNo = 0;
             BSONObjIterator it(isn->indexKeyPattern);
             while (it.more()) {
@@ -674,7 +732,9 @@ namespace mongo {
     Status getRunnerDistinct(Collection* collection,
                              const BSONObj& query,
                              const string& field,
-                             Runner** out) {
+                             Runner** out,
+                             bool allowMultikey,
+                             bool allowSparse) {
         // This should'a been checked by the distinct command.
         verify(collection);
 
@@ -683,7 +743,10 @@ namespace mongo {
         // When can we do a fast distinct hack?
         // 1. There is a plan with just one leaf and that leaf is an ixscan.
         // 2. The ixscan indexes the field we're interested in.
-        // 2a: We are correct if the index contains the field but for now we look for prefix.
+        // 2a: We are correct if the index contains the field.  We prefer indices prefixed by the
+        //     field, and only fall back to the others when there are none.  Distinct-scanning a
+        //     non-leading field skips from one value of the index prefix up to and including the
+        //     field to the next, so it is only a win when that prefix has few distinct values.
         // 3. The query is covered/no fetch.
         //
         // We go through normal planning (with limited parameters) to see if we can produce
@@ -697,6 +760,12 @@ namespace mongo {
             const IndexDescriptor* desc = ii.next();
             // The distinct hack can work if any field is in the index but it's not always clear
             // if it's a win unless it's the first field.
+            if (!allowMultikey && desc->isMultikey()) {
+                continue;
+            }
+            if (!allowSparse && desc->isSparse()) {
+                continue;
+            }
             if (desc->keyPattern().firstElement().fieldName() == field) {
                 plannerParams.indices.push_back(IndexEntry(desc->keyPattern(),
                                                            desc->getAccessMethodName(),
@@ -707,6 +776,28 @@ namespace mongo {
             }
         }
 
+        // Look for a plain btree index that has the field in a later position.  A multikey or
+        // sparse index can't be skip-scanned since it doesn't have a key for every document.
+        if (plannerParams.indices.empty() && internalQueryPlannerEnableSkipScan) {
+            ii = collection->getIndexCatalog()->getIndexIterator(false);
+            while (ii.more()) {
+                const IndexDescriptor* desc = ii.next();
+                if (desc->isMultikey() || desc->isSparse()
+                    || !IndexNames::findPluginName(desc->keyPattern()).empty()
+                    || !desc->keyPattern().hasField(field)) {
+                    continue;
+                }
+                plannerParams.indices.push_back(IndexEntry(desc->keyPattern(),
+                                                           desc->getAccessMethodName(),
+                                                           desc->isMultikey(),
+                                                           desc->isSparse(),
+                                                           desc->indexName(),
+                                                           desc->infoObj()));
+            }
+
+            plannerParams.options |= QueryPlannerParams::SKIP_SCAN;
+        }
+
         const WhereCallbackReal whereCallback(collection->ns().db());
 
         // If there are no suitable indices for the distinct hack bail out now into regular planning
@@ -724,7 +815,7 @@ namespace mongo {
         }
 
         //
-        // If we're here, we have an index prefixed by the field we're distinct-ing over.
+        // If we're here, we have an index containing the field we're distinct-ing over.
         //
 
         // Applying a projection allows the planner to try to give us covered plans that we can turn
@@ -755,6 +846,13 @@ namespace mongo {
             dn->direction = 1;
             IndexBoundsBuilder::allValuesBounds(dn->indexKeyPattern, &dn->bounds);
             dn->fieldNo = 0;
+            BSONObjIterator it(dn->indexKeyPattern);
+            while (it.more()) {
+                if (field == it.next().fieldName()) {
+                    break;
+                }
+                dn->fieldNo++;
+            }
 
             QueryPlannerParams params;
 
@@ -90,11 +90,17 @@ namespace mongo {
      * Distinct is unique in that it doesn't care about getting all the results; it just wants all
      * possible values of a certain field.  As such, we can skip lots of data in certain cases (see
      * body of method for detail).
+     *
+     * If 'allowMultikey' is false, multikey indices are never used, so an array value is returned
+     * whole rather than as its elements.  If 'allowSparse' is false, sparse indices are never
+     * used, so documents missing the field still produce a null value.  $group relies on both.
      */
     Status getRunnerDistinct(Collection* collection,
                              const BSONObj& query,
                              const std::string& field,
-                             Runner** out);
+                             Runner** out,
+                             bool allowMultikey = true,
+                             bool allowSparse = true);
     /*
      * Get a runner for a query executing as part of a count command.
      *
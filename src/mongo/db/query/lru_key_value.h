@@ -170,6 +170,25 @@ namespace mongo {
             return Status::OK();
         }
 
+        /**
+         * Remove the least recently used entry and pass ownership of it to the caller.  Returns
+         * an empty auto_ptr if the kv-store is empty.
+         *
+         * Lets a client bound the store by something other than the number of entries, e.g.
+         * by evicting until the entries it holds fit in a memory budget.
+         */
+        std::auto_ptr<V> removeLeastRecentlyUsed() {
+            if (_kvList.empty()) {
+                return std::auto_ptr<V>();
+            }
+
+            V* evictedEntry = _kvList.back().second;
+            _kvMap.erase(_kvList.back().first);
+            _kvList.pop_back();
+            _currentSize--;
+            return std::auto_ptr<V>(evictedEntry);
+        }
+
         /**
          * Deletes all entries in the kv-store.
          */
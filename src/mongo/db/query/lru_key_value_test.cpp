@@ -126,6 +126,34 @@ namespace {
         }
     }
 
+    /**
+     * Entries come out of removeLeastRecentlyUsed() oldest first.
+     */
+    TEST(LRUKeyValueTest, RemoveLeastRecentlyUsed) {
+        LRUKeyValue<int, int> cache(10);
+        ASSERT(NULL == cache.removeLeastRecentlyUsed().get());
+
+        cache.add(0, new int(0));
+        cache.add(1, new int(1));
+        cache.add(2, new int(2));
+
+        // Promote 0 so that 1 is now the least recently used.
+        assertInKVStore(cache, 0, 0);
+
+        std::auto_ptr<int> evicted = cache.removeLeastRecentlyUsed();
+        ASSERT(NULL != evicted.get());
+        ASSERT_EQUALS(*evicted, 1);
+        ASSERT_EQUALS(cache.size(), 2U);
+        assertNotInKVStore(cache, 1);
+
+        evicted = cache.removeLeastRecentlyUsed();
+        ASSERT_EQUALS(*evicted, 2);
+        evicted = cache.removeLeastRecentlyUsed();
+        ASSERT_EQUALS(*evicted, 0);
+        ASSERT_EQUALS(cache.size(), 0U);
+        ASSERT(NULL == cache.removeLeastRecentlyUsed().get());
+    }
+
     /**
      * Fill up a size 10 kv-store with 10 entries. Call get()
      * on a single entry to promote it to most recently
@@ -28,9 +28,11 @@
 
 #include "mongo/db/query/new_find.h"
 
+#include "mongo/base/counter.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/oplogstart.h"
 #include "mongo/db/exec/working_set_common.h"
@@ -40,7 +42,9 @@
 #include "mongo/db/query/get_runner.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner_params.h"
+#include "mongo/db/query/query_result_cache.h"
 #include "mongo/db/query/single_solution_runner.h"
 #include "mongo/db/query/type_explain.h"
 #include "mongo/db/repl/repl_reads_ok.h"
@@ -108,6 +112,18 @@ namespace {
 
 namespace mongo {
 
+    // Use of the per-collection query result caches, summed over all collections.
+    static Counter64 resultCacheHits;
+    static Counter64 resultCacheMisses;
+    static Counter64 resultCacheInserts;
+    static ServerStatusMetricField<Counter64> displayResultCacheHits("query.resultCache.hits",
+                                                                     &resultCacheHits);
+    static ServerStatusMetricField<Counter64> displayResultCacheMisses("query.resultCache.misses",
+                                                                       &resultCacheMisses);
+    static ServerStatusMetricField<Counter64> displayResultCacheInserts(
+                                                                "query.resultCache.inserts",
+                                                                &resultCacheInserts);
+
     // TODO: Move this and the other command stuff in newRunQuery outta here and up a level.
     static bool runCommands(const char *ns,
                             BSONObj& jsobj,
@@ -139,9 +155,15 @@ namespace mongo {
      * pass - when QueryOption_AwaitData is in use, the caller will make repeated calls 
      *        when this method returns an empty result, incrementing pass on each call.  
      *        Thus, pass == 0 indicates this is the first "attempt" before any 'awaiting'.
+     *
+     * notifier, notifierVersion - set when this method returns an empty result, to the
+     *        collection's CappedInsertNotifier and its version as of the empty read.  The caller
+     *        waits for the version to change before the next pass.
      */
     QueryResult* newGetMore(const char* ns, int ntoreturn, long long cursorid, CurOp& curop,
-                            int pass, bool& exhaust, bool* isCursorAuthorized) {
+                            int pass, bool& exhaust, bool* isCursorAuthorized,
+                            boost::shared_ptr<CappedInsertNotifier>* notifier,
+                            uint64_t* notifierVersion) {
         exhaust = false;
 
         // This is a read lock.
@@ -244,7 +266,10 @@ namespace mongo {
                 && (queryOptions & QueryOption_CursorTailable)
                 && (queryOptions & QueryOption_AwaitData) && (pass < 1000)) {
                 // If the cursor is tailable we don't kill it if it's eof.  We let it try to get
-                // data some # of times first.
+                // data some # of times first.  Nothing can be inserted while we hold the read
+                // lock, so the notifier's version now is the one the runner read up to.
+                *notifier = collection->getCappedInsertNotifier();
+                *notifierVersion = *notifier ? (*notifier)->getVersion() : 0;
                 return 0;
             }
 
@@ -469,6 +494,54 @@ namespace mongo {
         // We use this a lot below.
         const LiteParsedQuery& pq = cq->getParsed();
 
+        // If the collection keeps a result cache, see if we already have the answer.  Sharded
+        // collections are left out since chunk migrations change what we own without us being
+        // told through a write.
+        std::string resultCacheKey;
+        unsigned long long resultCacheGeneration = 0;
+        bool useResultCache = (NULL != collection
+                               && internalQueryResultCacheMaxBytes > 0
+                               && !shardingState.needCollectionMetadata(pq.ns())
+                               && QueryResultCache::shouldCacheQuery(*cq));
+        if (useResultCache) {
+            resultCacheKey = QueryResultCache::makeKey(pq);
+
+            std::string cachedData;
+            int cachedNumResults;
+            if (collection->infoCache()->getResultCache()->get(resultCacheKey,
+                                                               &cachedData,
+                                                               &cachedNumResults,
+                                                               &resultCacheGeneration)) {
+                resultCacheHits.increment();
+                boost::scoped_ptr<CanonicalQuery> cachedCq(cq);
+
+                replVerifyReadsOk(cq->ns(), &pq);
+
+                QLOG() << "Returning " << cachedNumResults
+                       << " results from the query result cache" << endl;
+
+                BufBuilder bb(sizeof(QueryResult) + cachedData.size());
+                bb.skip(sizeof(QueryResult));
+                bb.appendBuf(cachedData.data(), cachedData.size());
+                result.appendData(bb.buf(), bb.len());
+                bb.decouple();
+
+                QueryResult* qr = static_cast<QueryResult*>(result.header());
+                qr->cursorId = 0;
+                qr->setResultFlagsToOk();
+                qr->setOperation(opReply);
+                qr->startingFrom = 0;
+                qr->nReturned = cachedNumResults;
+
+                curop.debug().cursorid = -1;
+                curop.debug().ntoskip = pq.getSkip();
+                curop.debug().nreturned = cachedNumResults;
+                curop.debug().planSummary = "RESULT_CACHE";
+                return "";
+            }
+            resultCacheMisses.increment();
+        }
+
         // We'll now try to get the query runner that will execute this query for us. There
         // are a few cases in which we know upfront which runner we should get and, therefore,
         // we shortcut the selection process here.
@@ -770,6 +843,21 @@ namespace mongo {
         }
         else {
             QLOG() << "Not caching runner but returning " << numResults << " results.\n";
+
+            // We have the whole answer, so remember it unless the runner was killed part way.
+            // The query may have yielded, so look the collection up again.
+            if (useResultCache && Runner::RUNNER_DEAD != state) {
+                Collection* current = ctx.ctx().db()->getCollection(pq.ns());
+                if (NULL != current
+                    && current->infoCache()->getResultCache()->add(
+                                                    resultCacheKey,
+                                                    bb.buf() + sizeof(QueryResult),
+                                                    bb.len() - sizeof(QueryResult),
+                                                    numResults,
+                                                    resultCacheGeneration)) {
+                    resultCacheInserts.increment();
+                }
+            }
         }
 
         // Add the results from the query into the output buffer.
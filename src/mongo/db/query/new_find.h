@@ -30,6 +30,9 @@
 
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
+#include "mongo/db/catalog/capped_insert_notifier.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/dbmessage.h"
@@ -43,7 +46,9 @@ namespace mongo {
      * Called from the getMore entry point in ops/query.cpp.
      */
     QueryResult* newGetMore(const char* ns, int ntoreturn, long long cursorid, CurOp& curop,
-                            int pass, bool& exhaust, bool* isCursorAuthorized);
+                            int pass, bool& exhaust, bool* isCursorAuthorized,
+                            boost::shared_ptr<CappedInsertNotifier>* notifier,
+                            uint64_t* notifierVersion);
 
     /**
      * Run the query 'q' and place the result in 'result'.
@@ -113,6 +113,9 @@ namespace mongo {
             verify(entry.plannerData[i]);
             plannerData[i] = entry.plannerData[i]->clone();
         }
+        if (NULL != entry.costEstimate.get()) {
+            costEstimate.reset(new PlanCostEstimate(*entry.costEstimate));
+        }
     }
 
     CachedSolution::~CachedSolution() {
@@ -130,7 +133,11 @@ namespace mongo {
     PlanCacheEntry::PlanCacheEntry(const std::vector<QuerySolution*>& solutions,
                                    PlanRankingDecision* why)
         : plannerData(solutions.size()),
-          decision(why) {
+          decision(why),
+          numHits(0),
+          numReplans(0),
+          numPlanned(0),
+          replanPending(false) {
         invariant(why);
 
         // The caller of this constructor is responsible for ensuring
@@ -178,6 +185,14 @@ namespace mongo {
         }
         entry->averageScore = averageScore;
         entry->stddevScore = stddevScore;
+
+        if (NULL != costEstimate.get()) {
+            entry->costEstimate.reset(new PlanCostEstimate(*costEstimate));
+        }
+        entry->numHits = numHits;
+        entry->numReplans = numReplans;
+        entry->numPlanned = numPlanned;
+        entry->replanPending = replanPending;
         return entry;
     }
 
@@ -324,6 +339,10 @@ namespace mongo {
         entry->sort = pq.getSort().getOwned();
         entry->projection = pq.getProj().getOwned();
 
+        if (NULL != solns[0]->costEstimate.get()) {
+            entry->costEstimate.reset(new PlanCostEstimate(*solns[0]->costEstimate));
+        }
+
         // If the winning solution uses a blocking stage, then try and
         // find a fallback solution that has no blocking stage.
         if (solns[0]->hasBlockingStage) {
@@ -336,6 +355,16 @@ namespace mongo {
         }
 
         boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+
+        // Keep the usage counters of the entry we're replacing, if any.
+        PlanCacheEntry* oldEntry;
+        if (_cache.get(query.getPlanCacheKey(), &oldEntry).isOK()) {
+            entry->numHits = oldEntry->numHits;
+            entry->numReplans = oldEntry->numReplans;
+            entry->numPlanned = oldEntry->numPlanned;
+        }
+        ++entry->numPlanned;
+
         std::auto_ptr<PlanCacheEntry> evictedEntry = _cache.add(query.getPlanCacheKey(), entry);
 
         if (NULL != evictedEntry.get()) {
@@ -359,11 +388,42 @@ namespace mongo {
         }
         invariant(entry);
 
+        if (entry->replanPending) {
+            return Status(ErrorCodes::BadValue, "plan cache entry is waiting to be replanned");
+        }
+
         *crOut = new CachedSolution(key, *entry);
 
         return Status::OK();
     }
 
+    Status PlanCache::recordHit(const CanonicalQuery& query) {
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        PlanCacheEntry* entry;
+        Status cacheStatus = _cache.get(query.getPlanCacheKey(), &entry);
+        if (!cacheStatus.isOK()) {
+            return cacheStatus;
+        }
+        invariant(entry);
+
+        ++entry->numHits;
+        return Status::OK();
+    }
+
+    Status PlanCache::recordReplan(const CanonicalQuery& query) {
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        PlanCacheEntry* entry;
+        Status cacheStatus = _cache.get(query.getPlanCacheKey(), &entry);
+        if (!cacheStatus.isOK()) {
+            return cacheStatus;
+        }
+        invariant(entry);
+
+        ++entry->numReplans;
+        entry->replanPending = true;
+        return Status::OK();
+    }
+
     // TODO: Figure out what the right policy is here for determining if the cached solution is bad.
     // This is a solution but may not be the right one, if there even is a right one...
     static bool hasCachedPlanPerformanceDegraded(PlanCacheEntry* entry,
@@ -41,6 +41,7 @@
 
 namespace mongo {
 
+    struct PlanCostEstimate;
     struct PlanRankingDecision;
     struct QuerySolution;
     struct QuerySolutionNode;
@@ -195,6 +196,10 @@ namespace mongo {
         BSONObj query;
         BSONObj sort;
         BSONObj projection;
+
+        // The cost estimate of the winning plan for the parameters it was chosen under, or NULL
+        // if it couldn't be estimated.  Owned here.
+        boost::scoped_ptr<PlanCostEstimate> costEstimate;
     };
 
     /**
@@ -263,6 +268,30 @@ namespace mongo {
         // The standard deviation of the scores from stored as feedback.
         boost::optional<double> stddevScore;
 
+        // The cost estimate of the winning plan for the query that put this entry in the cache,
+        // if the cost model estimated it.  The entry is dropped when a run of the cached plan does
+        // clearly more or less work than this; see PlanCostModel::similarSelectivity().
+        boost::scoped_ptr<PlanCostEstimate> costEstimate;
+
+        //
+        // Usage counters.  These describe the query shape rather than this particular entry, so
+        // they carry over when the entry is replaced by a new plan for the same shape.
+        //
+
+        // How many queries ran with a plan from the cache?
+        long long numHits;
+
+        // How many times did a run of the cached plan do too different an amount of work from
+        // the estimate the entry was chosen under?
+        long long numReplans;
+
+        // How many times has the shape been planned from scratch and the result added?
+        long long numPlanned;
+
+        // Set by PlanCache::recordReplan().  get() doesn't hand out the entry again, so the next
+        // query of this shape is planned from scratch and its plan replaces the entry.
+        bool replanPending;
+
         // In order to justify eviction, the deviation from the mean must exceed a
         // minimum threshold.
         static const double kMinDeviation;
@@ -320,6 +349,15 @@ namespace mongo {
          */
         Status get(const CanonicalQuery& query, CachedSolution** crOut) const;
 
+        /**
+         * Records that 'query' ran with the plan returned by get(), or that the cached plan did
+         * too different an amount of work for it.  In the latter case the entry stays in the cache
+         * to keep its counters, but get() won't return it until add() replaces it.  Returns an
+         * error Status if the entry isn't in the cache anymore.
+         */
+        Status recordHit(const CanonicalQuery& query);
+        Status recordReplan(const CanonicalQuery& query);
+
         /**
          * When the CachedPlanRunner runs a plan out of the cache, we want to record data about the
          * plan's performance.  The CachedPlanRunner calls feedback(...) at the end of query
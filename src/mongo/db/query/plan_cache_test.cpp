@@ -377,6 +377,85 @@ namespace {
         ASSERT_EQUALS(planCache.size(), 1U);
     }
 
+    TEST(PlanCacheTest, UsageCountersSurviveReplacement) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+
+        // No entry to count against yet.
+        ASSERT_NOT_OK(planCache.recordHit(*cq));
+        ASSERT_NOT_OK(planCache.recordReplan(*cq));
+
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+        ASSERT_OK(planCache.recordHit(*cq));
+        ASSERT_OK(planCache.recordReplan(*cq));
+
+        // Replanning the same shape replaces the entry but keeps the counters.
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+        ASSERT_EQUALS(planCache.size(), 1U);
+
+        PlanCacheEntry* rawEntry;
+        ASSERT_OK(planCache.getEntry(*cq, &rawEntry));
+        boost::scoped_ptr<PlanCacheEntry> entry(rawEntry);
+        ASSERT_EQUALS(entry->numHits, 1LL);
+        ASSERT_EQUALS(entry->numReplans, 1LL);
+        ASSERT_EQUALS(entry->numPlanned, 2LL);
+        ASSERT(NULL == entry->costEstimate.get());
+    }
+
+    TEST(PlanCacheTest, ReplanHidesEntryUntilReplaced) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+        ASSERT_OK(planCache.recordReplan(*cq));
+
+        // The entry is still there for its counters, but queries don't get its plan.
+        CachedSolution* rawCS;
+        ASSERT_NOT_OK(planCache.get(*cq, &rawCS));
+        ASSERT_EQUALS(planCache.size(), 1U);
+
+        // Planning the shape again puts a usable entry back.
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+        ASSERT_OK(planCache.get(*cq, &rawCS));
+        boost::scoped_ptr<CachedSolution> cs(rawCS);
+
+        PlanCacheEntry* rawEntry;
+        ASSERT_OK(planCache.getEntry(*cq, &rawEntry));
+        boost::scoped_ptr<PlanCacheEntry> entry(rawEntry);
+        ASSERT_EQUALS(entry->numReplans, 1LL);
+        ASSERT_FALSE(entry->replanPending);
+    }
+
+    TEST(PlanCacheTest, CachedSolutionCarriesCostEstimate) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        qs.costEstimate.reset(new PlanCostEstimate());
+        qs.costEstimate->works = 42;
+        qs.costEstimate->exact = false;
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        ASSERT_OK(planCache.add(*cq, solns, createDecision(1U)));
+
+        CachedSolution* rawCS;
+        ASSERT_OK(planCache.get(*cq, &rawCS));
+        boost::scoped_ptr<CachedSolution> cs(rawCS);
+        ASSERT(NULL != cs->costEstimate.get());
+        ASSERT_EQUALS(cs->costEstimate->works, 42.0);
+        ASSERT_FALSE(cs->costEstimate->exact);
+    }
+
     TEST(PlanCacheTest, NotifyOfWriteOp) {
         PlanCache planCache;
         auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
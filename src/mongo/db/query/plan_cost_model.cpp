@@ -0,0 +1,349 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/query/plan_cost_model.h"
+
+#include <algorithm>
+#include <map>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/query/explain_plan.h"
+#include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+namespace {
+
+    /**
+     * The estimate for one subtree of a solution.
+     */
+    struct NodeEstimate {
+        NodeEstimate() : works(0), out(0), exact(true) { }
+
+        // Work done by this subtree, including its children.
+        double works;
+
+        // How many results does the subtree produce?
+        double out;
+
+        bool exact;
+    };
+
+    typedef std::map<std::string, long long> IndexKeyCounts;
+
+    /**
+     * Counts the keys in the bounds of 'ixn', up to 'maxKeys'.  Returns false if the index isn't
+     * there or the scan fails.
+     */
+    bool probeIndexScan(const Collection* collection,
+                        const IndexScanNode* ixn,
+                        size_t maxKeys,
+                        IndexKeyCounts* indexKeys,
+                        NodeEstimate* out) {
+        IndexScanParams params;
+        params.descriptor =
+            collection->getIndexCatalog()->findIndexByKeyPattern(ixn->indexKeyPattern);
+        if (NULL == params.descriptor) {
+            return false;
+        }
+
+        params.bounds = ixn->bounds;
+        params.direction = ixn->direction;
+        params.doNotDedup = true;
+        params.maxScan = maxKeys;
+
+        WorkingSet ws;
+        IndexScan scan(params, &ws, NULL);
+
+        size_t advanced = 0;
+        while (!scan.isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = scan.work(&id);
+            if (PlanStage::ADVANCED == state) {
+                ++advanced;
+                ws.free(id);
+            }
+            else if (PlanStage::FAILURE == state || PlanStage::DEAD == state) {
+                return false;
+            }
+        }
+
+        scoped_ptr<PlanStageStats> stats(scan.getStats());
+        const IndexScanStats* spec = static_cast<const IndexScanStats*>(stats->specific.get());
+        size_t keysExamined = spec->keysExamined;
+
+        out->works = keysExamined;
+        out->out = advanced;
+        out->exact = keysExamined < maxKeys;
+        (*indexKeys)[params.descriptor->indexName()] += keysExamined;
+        return true;
+    }
+
+    bool estimateNode(const Collection* collection,
+                      const QuerySolutionNode* node,
+                      size_t maxKeys,
+                      IndexKeyCounts* indexKeys,
+                      NodeEstimate* out) {
+        StageType type = node->getType();
+
+        if (STAGE_COLLSCAN == type) {
+            double numRecords = collection->numRecords();
+            out->works = numRecords;
+            out->out = numRecords;
+            out->exact = true;
+            return true;
+        }
+        else if (STAGE_IXSCAN == type) {
+            return probeIndexScan(collection,
+                                  static_cast<const IndexScanNode*>(node),
+                                  maxKeys,
+                                  indexKeys,
+                                  out);
+        }
+
+        std::vector<NodeEstimate> children(node->children.size());
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            if (!estimateNode(collection, node->children[i], maxKeys, indexKeys, &children[i])) {
+                return false;
+            }
+        }
+
+        out->works = 0;
+        out->exact = true;
+        for (size_t i = 0; i < children.size(); ++i) {
+            out->works += children[i].works;
+            out->exact = out->exact && children[i].exact;
+        }
+
+        if (STAGE_FETCH == type) {
+            invariant(1 == children.size());
+            out->works += children[0].out;
+            out->out = children[0].out;
+        }
+        else if (STAGE_SORT == type) {
+            invariant(1 == children.size());
+            out->works += children[0].out;
+            out->out = children[0].out;
+        }
+        else if (STAGE_AND_HASH == type || STAGE_AND_SORTED == type) {
+            invariant(!children.empty());
+            out->out = children[0].out;
+            for (size_t i = 1; i < children.size(); ++i) {
+                out->out = std::min(out->out, children[i].out);
+            }
+        }
+        else if (STAGE_OR == type || STAGE_SORT_MERGE == type) {
+            out->out = 0;
+            for (size_t i = 0; i < children.size(); ++i) {
+                out->out += children[i].out;
+            }
+        }
+        else if (STAGE_PROJECTION == type
+                 || STAGE_LIMIT == type
+                 || STAGE_SKIP == type
+                 || STAGE_SHARDING_FILTER == type
+                 || STAGE_KEEP_MUTATIONS == type) {
+            // These don't change how much is read below them.  Limits could cut the work short
+            // but we can't tell by how much, so we estimate pessimistically.
+            invariant(1 == children.size());
+            out->out = children[0].out;
+        }
+        else {
+            // Geo, text, count, distinct...  We don't know what these cost.
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace
+
+    // static
+    bool PlanCostModel::estimate(const Collection* collection, QuerySolution* soln) {
+        soln->costEstimate.reset();
+
+        if (NULL == collection || NULL == soln->root.get()) {
+            return false;
+        }
+
+        size_t maxKeys = std::max(1, internalQueryCostModelMaxKeysPerProbe);
+        IndexKeyCounts indexKeys;
+        NodeEstimate rootEstimate;
+        if (!estimateNode(collection, soln->root.get(), maxKeys, &indexKeys, &rootEstimate)) {
+            return false;
+        }
+
+        soln->costEstimate.reset(new PlanCostEstimate());
+        soln->costEstimate->works = rootEstimate.works;
+        soln->costEstimate->exact = rootEstimate.exact;
+
+        BSONObjBuilder bob;
+        for (IndexKeyCounts::const_iterator it = indexKeys.begin(); it != indexKeys.end(); ++it) {
+            bob.appendNumber(it->first, it->second);
+        }
+        soln->costEstimate->indexKeys = bob.obj();
+
+        return true;
+    }
+
+    // static
+    bool PlanCostModel::dominates(const QuerySolution& winner, const QuerySolution& loser) {
+        const PlanCostEstimate* w = winner.costEstimate.get();
+        const PlanCostEstimate* l = loser.costEstimate.get();
+        if (NULL == w || NULL == l) {
+            return false;
+        }
+
+        if (!w->exact) {
+            return false;
+        }
+
+        if (winner.hasBlockingStage && !loser.hasBlockingStage) {
+            return false;
+        }
+
+        if (l->works < static_cast<double>(internalQueryCostModelMaxKeysPerProbe)) {
+            return false;
+        }
+
+        // A ratio of 1 or less could let two candidates dominate each other.
+        double ratio = internalQueryCostModelPruneRatio;
+        if (ratio <= 1.0) {
+            return false;
+        }
+
+        return l->works >= ratio * w->works;
+    }
+
+    // static
+    bool PlanCostModel::cheaperThan(const QuerySolution& lhs, const QuerySolution& rhs) {
+        if (NULL == lhs.costEstimate.get()) {
+            return false;
+        }
+        if (NULL == rhs.costEstimate.get()) {
+            return true;
+        }
+        return lhs.costEstimate->works < rhs.costEstimate->works;
+    }
+
+    // static
+    bool PlanCostModel::similarSelectivity(const PlanCostEstimate& cached,
+                                           const PlanCostEstimate& current) {
+        double ratio = internalQueryCacheReplanSelectivityRatio;
+        if (ratio <= 1.0) {
+            return true;
+        }
+
+        if (!cached.exact && !current.exact) {
+            return true;
+        }
+
+        // Add one to each side so that a handful of works either way doesn't count as a
+        // difference in selectivity.
+        double lo = std::min(cached.works, current.works) + 1;
+        double hi = std::max(cached.works, current.works) + 1;
+        if (hi < ratio * lo) {
+            return true;
+        }
+
+        // An inexact estimate is only a lower bound.  If it's the smaller of the two we don't
+        // actually know that they differ.
+        bool lowerIsInexact = (cached.works <= current.works) ? !cached.exact : !current.exact;
+        return lowerIsInexact;
+    }
+
+    // static
+    size_t PlanCostModel::pruneSolutions(const Collection* collection,
+                                         std::vector<QuerySolution*>* solutions) {
+        if (!internalQueryPlannerEnableCostModel || NULL == collection) {
+            return 0;
+        }
+
+        // Tests that force intersection plans want to see them win the race.
+        if (internalQueryForceIntersectionPlans) {
+            return 0;
+        }
+
+        if (internalQueryCostModelMaxKeysPerProbe <= 0 || solutions->size() < 2) {
+            return 0;
+        }
+
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            QuerySolution* soln = (*solutions)[i];
+            if (estimate(collection, soln)) {
+                QLOG() << "Cost estimate for candidate " << i << ": "
+                       << soln->costEstimate->toBSON().toString() << endl;
+            }
+        }
+
+        // The cheapest exactly-estimated candidate can't be dominated, so at least one candidate
+        // always survives.
+        std::vector<QuerySolution*> survivors;
+        std::vector<QuerySolution*> losers;
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            QuerySolution* candidate = (*solutions)[i];
+            bool dominated = false;
+            for (size_t j = 0; j < solutions->size(); ++j) {
+                if (i != j && dominates(*(*solutions)[j], *candidate)) {
+                    dominated = true;
+                    break;
+                }
+            }
+
+            if (dominated) {
+                LOG(2) << "Pruning query plan before trial run: " << getPlanSummary(*candidate)
+                       << " costEstimate: " << candidate->costEstimate->toBSON();
+                losers.push_back(candidate);
+            }
+            else {
+                survivors.push_back(candidate);
+            }
+        }
+
+        invariant(!survivors.empty());
+
+        for (size_t i = 0; i < losers.size(); ++i) {
+            delete losers[i];
+        }
+
+        for (size_t i = 0; i < survivors.size(); ++i) {
+            if (NULL != survivors[i]->costEstimate.get()) {
+                survivors[i]->costEstimate->candidatesPruned = losers.size();
+            }
+        }
+
+        solutions->swap(survivors);
+        return losers.size();
+    }
+
+}  // namespace mongo
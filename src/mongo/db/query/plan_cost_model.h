@@ -0,0 +1,97 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/query/query_solution.h"
+
+namespace mongo {
+
+    class Collection;
+
+    /**
+     * Estimates how much work a candidate solution will do before any candidate is run, and uses
+     * the estimates to drop candidates that are clearly worse than another one.
+     *
+     * The only statistics we use are sampled on demand: each index scan in a solution counts the
+     * keys in its bounds, stopping at internalQueryCostModelMaxKeysPerProbe.  Small scans are
+     * therefore estimated exactly, and large ones are known to be at least that large.  Because
+     * we look at the actual bounds we don't get fooled by skewed values the way a per-index
+     * histogram would.
+     */
+    class PlanCostModel {
+    public:
+        /**
+         * Estimates the cost of each solution in 'solutions', filling out its 'costEstimate' when
+         * possible, and deletes the candidates that another candidate dominates (see below).
+         * Never removes every candidate.
+         *
+         * Returns the number of candidates removed.
+         */
+        static size_t pruneSolutions(const Collection* collection,
+                                     std::vector<QuerySolution*>* solutions);
+
+        /**
+         * Fills out 'soln->costEstimate'.  Returns false, leaving it NULL, if 'soln' has a stage
+         * we don't know how to estimate or an index scan couldn't be probed.
+         */
+        static bool estimate(const Collection* collection, QuerySolution* soln);
+
+        /**
+         * Returns true if we're confident enough that 'winner' does less work than 'loser' to
+         * not bother running 'loser' at all.  This is the case when the estimate for 'winner' is
+         * exact, 'loser' is expected to do at least internalQueryCostModelMaxKeysPerProbe works,
+         * and 'loser' does at least internalQueryCostModelPruneRatio times as much work as
+         * 'winner'.  A non-blocking 'loser' is never dominated by a blocking 'winner', since under
+         * a limit the non-blocking plan can stop early.
+         *
+         * Exposed for testing.
+         */
+        static bool dominates(const QuerySolution& winner, const QuerySolution& loser);
+
+        /**
+         * Orders two estimated solutions for tie-breaking.  Returns true if 'lhs' is expected to
+         * do strictly less work than 'rhs'.  An unestimated solution is considered the most
+         * expensive.
+         */
+        static bool cheaperThan(const QuerySolution& lhs, const QuerySolution& rhs);
+
+        /**
+         * Returns true if a plan estimated at 'cached' when it was put in the plan cache is still
+         * a fair choice for a query where it did the work in 'current', that is if the two are
+         * within internalQueryCacheReplanSelectivityRatio of each other.  Two inexact figures
+         * (an estimate that ran into the probe limit, or a run that stopped before EOF) are
+         * treated as the same, since we only know that each is large.
+         */
+        static bool similarSelectivity(const PlanCostEstimate& cached,
+                                       const PlanCostEstimate& current);
+    };
+
+}  // namespace mongo
@@ -0,0 +1,219 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/query/plan_cost_model.h
+ */
+
+#include "mongo/db/query/plan_cost_model.h"
+
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    /**
+     * Makes a solution with an estimate of 'works'.  The solution doesn't have a tree; the
+     * functions under test only look at the estimate.
+     */
+    QuerySolution* makeSolution(double works, bool exact, bool blocking) {
+        QuerySolution* soln = new QuerySolution();
+        soln->hasBlockingStage = blocking;
+        soln->costEstimate.reset(new PlanCostEstimate());
+        soln->costEstimate->works = works;
+        soln->costEstimate->exact = exact;
+        return soln;
+    }
+
+    /**
+     * Sets the cost model knobs for the duration of a test.
+     */
+    class CostModelKnobs {
+    public:
+        CostModelKnobs(int maxKeys, double ratio)
+            : _oldMaxKeys(internalQueryCostModelMaxKeysPerProbe),
+              _oldRatio(internalQueryCostModelPruneRatio) {
+            internalQueryCostModelMaxKeysPerProbe = maxKeys;
+            internalQueryCostModelPruneRatio = ratio;
+        }
+
+        ~CostModelKnobs() {
+            internalQueryCostModelMaxKeysPerProbe = _oldMaxKeys;
+            internalQueryCostModelPruneRatio = _oldRatio;
+        }
+
+    private:
+        int _oldMaxKeys;
+        double _oldRatio;
+    };
+
+    TEST(PlanCostModelTest, DominatesClearlyCheaper) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> cheap(makeSolution(50, true, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(2000, false, false));
+
+        ASSERT_TRUE(PlanCostModel::dominates(*cheap, *expensive));
+        ASSERT_FALSE(PlanCostModel::dominates(*expensive, *cheap));
+    }
+
+    TEST(PlanCostModelTest, InexactWinnerDoesNotDominate) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> cheap(makeSolution(50, false, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(2000, false, false));
+
+        ASSERT_FALSE(PlanCostModel::dominates(*cheap, *expensive));
+    }
+
+    TEST(PlanCostModelTest, SmallLoserIsNotPruned) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> cheap(makeSolution(1, true, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(500, true, false));
+
+        // 'expensive' is 500x worse but so small that racing it costs nothing.
+        ASSERT_FALSE(PlanCostModel::dominates(*cheap, *expensive));
+    }
+
+    TEST(PlanCostModelTest, RatioNotMet) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> cheap(makeSolution(500, true, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(4000, true, false));
+
+        ASSERT_FALSE(PlanCostModel::dominates(*cheap, *expensive));
+    }
+
+    TEST(PlanCostModelTest, BlockingWinnerDoesNotDominateNonBlocking) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> blocking(makeSolution(50, true, true));
+        scoped_ptr<QuerySolution> streaming(makeSolution(2000, false, false));
+        scoped_ptr<QuerySolution> blockingLoser(makeSolution(2000, false, true));
+
+        ASSERT_FALSE(PlanCostModel::dominates(*blocking, *streaming));
+        ASSERT_TRUE(PlanCostModel::dominates(*blocking, *blockingLoser));
+    }
+
+    TEST(PlanCostModelTest, BadRatioDisablesPruning) {
+        CostModelKnobs knobs(1000, 0.5);
+        scoped_ptr<QuerySolution> cheap(makeSolution(50, true, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(2000, true, false));
+
+        ASSERT_FALSE(PlanCostModel::dominates(*cheap, *expensive));
+        ASSERT_FALSE(PlanCostModel::dominates(*expensive, *cheap));
+    }
+
+    TEST(PlanCostModelTest, UnestimatedNeverDominates) {
+        CostModelKnobs knobs(1000, 10.0);
+        scoped_ptr<QuerySolution> unknown(new QuerySolution());
+        scoped_ptr<QuerySolution> expensive(makeSolution(2000, true, false));
+        scoped_ptr<QuerySolution> cheap(makeSolution(50, true, false));
+
+        ASSERT_FALSE(PlanCostModel::dominates(*unknown, *expensive));
+        ASSERT_FALSE(PlanCostModel::dominates(*cheap, *unknown));
+    }
+
+    TEST(PlanCostModelTest, CheaperThan) {
+        scoped_ptr<QuerySolution> unknown(new QuerySolution());
+        scoped_ptr<QuerySolution> cheap(makeSolution(50, true, false));
+        scoped_ptr<QuerySolution> expensive(makeSolution(2000, false, false));
+
+        ASSERT_TRUE(PlanCostModel::cheaperThan(*cheap, *expensive));
+        ASSERT_FALSE(PlanCostModel::cheaperThan(*expensive, *cheap));
+        ASSERT_FALSE(PlanCostModel::cheaperThan(*cheap, *cheap));
+
+        // Unestimated solutions sort last.
+        ASSERT_TRUE(PlanCostModel::cheaperThan(*expensive, *unknown));
+        ASSERT_FALSE(PlanCostModel::cheaperThan(*unknown, *expensive));
+        ASSERT_FALSE(PlanCostModel::cheaperThan(*unknown, *unknown));
+    }
+
+    /**
+     * Sets internalQueryCacheReplanSelectivityRatio for the duration of a test.
+     */
+    class ReplanRatioKnob {
+    public:
+        ReplanRatioKnob(double ratio) : _oldRatio(internalQueryCacheReplanSelectivityRatio) {
+            internalQueryCacheReplanSelectivityRatio = ratio;
+        }
+
+        ~ReplanRatioKnob() {
+            internalQueryCacheReplanSelectivityRatio = _oldRatio;
+        }
+
+    private:
+        double _oldRatio;
+    };
+
+    PlanCostEstimate makeEstimate(double works, bool exact) {
+        PlanCostEstimate estimate;
+        estimate.works = works;
+        estimate.exact = exact;
+        return estimate;
+    }
+
+    TEST(PlanCostModelTest, SimilarSelectivity) {
+        ReplanRatioKnob knob(10.0);
+
+        ASSERT_TRUE(PlanCostModel::similarSelectivity(makeEstimate(100, true),
+                                                      makeEstimate(300, true)));
+        ASSERT_FALSE(PlanCostModel::similarSelectivity(makeEstimate(10, true),
+                                                       makeEstimate(500, true)));
+        ASSERT_FALSE(PlanCostModel::similarSelectivity(makeEstimate(500, true),
+                                                       makeEstimate(10, true)));
+
+        // Tiny estimates aren't told apart.
+        ASSERT_TRUE(PlanCostModel::similarSelectivity(makeEstimate(0, true),
+                                                      makeEstimate(5, true)));
+    }
+
+    TEST(PlanCostModelTest, SimilarSelectivityInexact) {
+        ReplanRatioKnob knob(10.0);
+
+        // Both hit the probe limit: we can't tell them apart.
+        ASSERT_TRUE(PlanCostModel::similarSelectivity(makeEstimate(1000, false),
+                                                      makeEstimate(1000, false)));
+
+        // A small exact estimate against a large lower bound is a real difference.
+        ASSERT_FALSE(PlanCostModel::similarSelectivity(makeEstimate(1000, false),
+                                                       makeEstimate(10, true)));
+        ASSERT_FALSE(PlanCostModel::similarSelectivity(makeEstimate(10, true),
+                                                       makeEstimate(1000, false)));
+
+        // But a small lower bound might really be large.
+        ASSERT_TRUE(PlanCostModel::similarSelectivity(makeEstimate(10, false),
+                                                      makeEstimate(1000, true)));
+    }
+
+    TEST(PlanCostModelTest, SimilarSelectivityDisabled) {
+        ReplanRatioKnob knob(1.0);
+
+        ASSERT_TRUE(PlanCostModel::similarSelectivity(makeEstimate(10, true),
+                                                      makeEstimate(5000, true)));
+    }
+
+}  // namespace
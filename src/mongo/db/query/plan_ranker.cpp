@@ -35,6 +35,7 @@
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/query/explain_plan.h"
+#include "mongo/db/query/plan_cost_model.h"
 #include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
@@ -43,15 +44,31 @@
 
 namespace {
 
+    using mongo::CandidatePlan;
+    using mongo::PlanCostModel;
+
     /**
      * Comparator for (scores, candidateIndex) in pickBestPlan().
      */
-    bool scoreComparator(const std::pair<double, size_t>& lhs,
-                         const std::pair<double, size_t>& rhs) {
-        // Just compare score in lhs.first and rhs.first;
-        // Ignore candidate array index in lhs.second and rhs.second.
-        return lhs.first > rhs.first;
-    }
+    class ScoreComparator {
+    public:
+        explicit ScoreComparator(const std::vector<CandidatePlan>& candidates)
+            : _candidates(candidates) { }
+
+        bool operator()(const std::pair<double, size_t>& lhs,
+                        const std::pair<double, size_t>& rhs) const {
+            if (lhs.first != rhs.first) {
+                return lhs.first > rhs.first;
+            }
+
+            // Break ties with the cost model's estimate, if there is one.
+            return PlanCostModel::cheaperThan(*_candidates[lhs.second].solution,
+                                              *_candidates[rhs.second].solution);
+        }
+
+    private:
+        const std::vector<CandidatePlan>& _candidates;
+    };
 
 } // namespace
 
@@ -105,7 +122,7 @@ namespace mongo {
 
         // Sort (scores, candidateIndex). Get best child and populate candidate ordering.
         std::stable_sort(scoresAndCandidateindices.begin(), scoresAndCandidateindices.end(),
-                         scoreComparator);
+                         ScoreComparator(candidates));
 
         // Update results in 'why'
         // Stats and scores in 'why' are sorted in descending order by score.
@@ -37,6 +37,7 @@
 #include "mongo/db/query/indexability.h"
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/index_tag.h"
+#include "mongo/db/query/planner_ixselect.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_common.h"
@@ -1176,6 +1177,98 @@ namespace mongo {
         return NULL;
     }
 
+    // static
+    QuerySolutionNode* QueryPlannerAccess::makeSkipScan(const IndexEntry& index,
+                                                        const CanonicalQuery& query,
+                                                        const QueryPlannerParams& params) {
+        if (INDEX_BTREE != index.type || index.multikey || index.sparse) {
+            return NULL;
+        }
+
+        size_t numFields = index.keyPattern.nFields();
+        if (numFields < 2) {
+            return NULL;
+        }
+
+        vector<MatchExpression*> preds;
+        MatchExpression* root = query.root();
+        if (MatchExpression::AND == root->matchType()) {
+            for (size_t i = 0; i < root->numChildren(); ++i) {
+                preds.push_back(root->getChild(i));
+            }
+        }
+        else {
+            preds.push_back(root);
+        }
+
+        if (preds.empty()) {
+            return NULL;
+        }
+
+        auto_ptr<IndexScanNode> isn(new IndexScanNode());
+        isn->indexKeyPattern = index.keyPattern;
+        isn->indexIsMultiKey = false;
+        isn->maxScan = query.getParsed().getMaxScan();
+        isn->addKeyMetadata = query.getParsed().returnKey();
+        isn->bounds.fields.resize(numFields);
+
+        for (size_t i = 0; i < preds.size(); ++i) {
+            MatchExpression* pred = preds[i];
+            if (!pred->isLeaf()) {
+                return NULL;
+            }
+
+            // Find the predicate's field in the key pattern.  It mustn't be the first field;
+            // if it were, the enumerator would have used the index normally.
+            BSONObjIterator it(index.keyPattern);
+            BSONElement elt;
+            size_t pos = 0;
+            bool found = false;
+            while (it.more()) {
+                elt = it.next();
+                if (pred->path() == elt.fieldName()) {
+                    found = true;
+                    break;
+                }
+                ++pos;
+            }
+
+            if (!found || 0 == pos) {
+                return NULL;
+            }
+
+            if (!QueryPlannerIXSelect::compatible(elt, index, pred)) {
+                return NULL;
+            }
+
+            OrderedIntervalList* oil = &isn->bounds.fields[pos];
+            IndexBoundsBuilder::BoundsTightness tightness;
+            if (oil->name.empty()) {
+                IndexBoundsBuilder::translate(pred, elt, index, oil, &tightness);
+            }
+            else {
+                IndexBoundsBuilder::translateAndIntersect(pred, elt, index, oil, &tightness);
+            }
+
+            // Without a filter we can only use predicates the bounds answer exactly.
+            if (IndexBoundsBuilder::EXACT != tightness) {
+                return NULL;
+            }
+        }
+
+        // The fields nothing constrains, including the first, take every value.
+        BSONObjIterator it(index.keyPattern);
+        for (size_t pos = 0; pos < numFields; ++pos) {
+            BSONElement elt = it.next();
+            if (isn->bounds.fields[pos].name.empty()) {
+                IndexBoundsBuilder::allValuesForField(elt, &isn->bounds.fields[pos]);
+            }
+        }
+
+        IndexBoundsBuilder::alignBounds(&isn->bounds, index.keyPattern);
+        return isn.release();
+    }
+
     QuerySolutionNode* QueryPlannerAccess::scanWholeIndex(const IndexEntry& index,
                                                           const CanonicalQuery& query,
                                                           const QueryPlannerParams& params,
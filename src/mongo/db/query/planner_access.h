@@ -118,6 +118,23 @@ namespace mongo {
                                                 const BSONObj& startKey,
                                                 const BSONObj& endKey);
 
+        /**
+         * Return a skip-scan over 'index', or NULL if we can't make one.
+         *
+         * A skip-scan answers a query that constrains some fields of a compound index but not
+         * the first one.  The unconstrained fields get all-values bounds, and the bounds checker
+         * then seeks from each distinct value of the prefix straight to the keys that can match,
+         * rather than the scan reading every key.
+         *
+         * Only the simple case is handled: 'index' is a btree index that is neither multikey nor
+         * sparse, and the query is one predicate or an AND of predicates, each over a field of
+         * the index other than the first, that translate exactly into bounds.  The scan needs no
+         * filter.
+         */
+        static QuerySolutionNode* makeSkipScan(const IndexEntry& index,
+                                               const CanonicalQuery& query,
+                                               const QueryPlannerParams& params);
+
         //
         // Indexed Data Access methods.
         //
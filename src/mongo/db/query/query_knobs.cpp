@@ -40,6 +40,10 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheSize, int, 5000);
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheReplanSelectivityRatio, double, 10.0);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryResultCacheMaxBytes, int, 0);
+
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheFeedbacksStored, int, 20);
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheStdDeviations, double, 2.0);
@@ -56,6 +60,14 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableIndexIntersection, bool, true);
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableSkipScan, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableCostModel, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCostModelMaxKeysPerProbe, int, 1000);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCostModelPruneRatio, double, 10.0);
+
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlanOrChildrenIndependently, bool, true);
 
 }  // namespace mongo
@@ -51,6 +51,24 @@ namespace mongo {
     // Do we have ixisect on at all?
     extern bool internalQueryPlannerEnableIndexIntersection;
 
+    // May count and distinct skip-scan an index whose leading fields the query doesn't constrain?
+    extern bool internalQueryPlannerEnableSkipScan;
+
+    //
+    // cost-based pruning before the trial run
+    //
+
+    // Do we estimate candidate plans from their index bounds and drop the clear losers before
+    // working them?
+    extern bool internalQueryPlannerEnableCostModel;
+
+    // How many keys will we count in an index scan's bounds when estimating a plan?
+    extern int internalQueryCostModelMaxKeysPerProbe;
+
+    // How many times more work than the best exactly-estimated candidate must a candidate be
+    // expected to do before we drop it?
+    extern double internalQueryCostModelPruneRatio;
+
     //
     // plan cache
     //
@@ -58,6 +76,18 @@ namespace mongo {
     // How many entries in the cache?
     extern int internalQueryCacheSize;
 
+    // A cached plan stays cached only while the work it does for a query is within this factor of
+    // the estimate it was chosen under.  Otherwise the entry is dropped and the next query of the
+    // shape is planned from scratch.  A value of 1 or less turns the check off.
+    extern double internalQueryCacheReplanSelectivityRatio;
+
+    //
+    // query result cache
+    //
+
+    // How much memory may each collection's query result cache use?  0 turns the cache off.
+    extern int internalQueryResultCacheMaxBytes;
+
     // How many feedback entries do we collect before possibly evicting from the cache based on bad
     // performance?
     extern int internalQueryCacheFeedbacksStored;
@@ -92,7 +92,10 @@ namespace mongo {
             ss << "INDEX_INTERSECTION ";
         }
         if (options & QueryPlannerParams::KEEP_MUTATIONS) {
-            ss << "KEEP_MUTATIONS";
+            ss << "KEEP_MUTATIONS ";
+        }
+        if (options & QueryPlannerParams::SKIP_SCAN) {
+            ss << "SKIP_SCAN ";
         }
 
         return ss;
@@ -883,6 +886,31 @@ namespace mongo {
             }
         }
 
+        // No index has a prefix the query can use, but an index with a constrained field
+        // further in may still be cheaper to read than the collection: the scan jumps from one
+        // value of the unconstrained prefix to the next.  These plans can't be cached, and they
+        // can be slow if the prefix has many distinct values, so we only make them on request
+        // and still race them against a collection scan.
+        bool addedSkipScan = false;
+        if (0 == out->size() && hintIndex.isEmpty()
+            && (params.options & QueryPlannerParams::SKIP_SCAN)) {
+            for (size_t i = 0; i < params.indices.size(); ++i) {
+                QuerySolutionNode* skipScan =
+                    QueryPlannerAccess::makeSkipScan(params.indices[i], query, params);
+                if (NULL == skipScan) {
+                    continue;
+                }
+
+                QuerySolution* soln = QueryPlannerAnalysis::analyzeDataAccess(query, params,
+                                                                              skipScan);
+                if (NULL != soln) {
+                    QLOG() << "Planner: adding skip-scan solution:" << endl << soln->toString();
+                    out->push_back(soln);
+                    addedSkipScan = true;
+                }
+            }
+        }
+
         // geoNear and text queries *require* an index.
         // Also, if a hint is specified it indicates that we MUST use it.
         bool possibleToCollscan = !QueryPlannerCommon::hasNode(query.root(), MatchExpression::GEO_NEAR)
@@ -893,7 +921,7 @@ namespace mongo {
         bool collscanRequested = (params.options & QueryPlannerParams::INCLUDE_COLLSCAN);
 
         // No indexed plans?  We must provide a collscan if possible or else we can't run the query.
-        bool collscanNeeded = (0 == out->size() && canTableScan);
+        bool collscanNeeded = ((0 == out->size() || addedSkipScan) && canTableScan);
 
         if (possibleToCollscan && (collscanRequested || collscanNeeded)) {
             QuerySolution* collscan = buildCollscanSoln(query, false, params);
@@ -81,7 +81,13 @@ namespace mongo {
             // Set this if you want to handle batchSize properly with sort(). If limits on SORT
             // stages are always actually limits, then this should be left off. If they are
             // sometimes to be interpreted as batchSize, then this should be turned on.
-            SPLIT_LIMITED_SORT = 1 << 7
+            SPLIT_LIMITED_SORT = 1 << 7,
+
+            // Set this if the caller can make good use of a skip-scan: an index scan over an index
+            // whose leading field the query doesn't constrain.  The planner only outputs skip-scans
+            // when no other index applies.  Count and distinct set this since they can answer the
+            // query from the index keys alone.
+            SKIP_SCAN = 1 << 8
         };
 
         // See Options enum above.
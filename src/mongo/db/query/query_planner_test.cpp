@@ -3704,6 +3704,83 @@ namespace {
                                 "{filter: null, pattern: {a: 1}}}}}]}}}}");
     }
 
+    TEST_F(QueryPlannerTest, SkipScanNonLeadingEquality) {
+        params.options = QueryPlannerParams::SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{b: 5}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {filter: null, "
+                                "pattern: {a: 1, b: 1}, bounds: "
+                                "{a: [['MinKey','MaxKey',true,true]], b: [[5,5,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanSeveralLaterFields) {
+        params.options = QueryPlannerParams::SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1 << "c" << 1));
+        runQuery(fromjson("{b: 5, c: {$gt: 3}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {filter: null, "
+                                "pattern: {a: 1, b: 1, c: 1}, bounds: "
+                                "{a: [['MinKey','MaxKey',true,true]], b: [[5,5,true,true]], "
+                                "c: [[3,Infinity,false,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanCovered) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuerySortProj(fromjson("{b: {$in: [1, 4]}}"), BSONObj(), fromjson("{_id: 0, b: 1}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {ixscan: {filter: null, "
+                                "pattern: {a: 1, b: 1}, bounds: "
+                                "{a: [['MinKey','MaxKey',true,true]], "
+                                "b: [[1,1,true,true], [4,4,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanRequiresOption) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{b: 5}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNotUsedWithLeadingField) {
+        params.options = QueryPlannerParams::SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{a: 1, b: 5}"));
+
+        // The regular index plan is all we need, so there's no collection scan either.
+        assertNumSolutions(1U);
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: {pattern: {a: 1, b: 1}, "
+                                "bounds: {a: [[1,1,true,true]], b: [[5,5,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNotMultikeyOrSparse) {
+        params.options = QueryPlannerParams::SKIP_SCAN;
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        // false means not multikey, true means sparse
+        addIndex(BSON("c" << 1 << "b" << 1), false, true);
+        runQuery(fromjson("{b: 5}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanNotInexactBounds) {
+        params.options = QueryPlannerParams::SKIP_SCAN;
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{b: /^foo/}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
     //
     // Index Intersection.
     //
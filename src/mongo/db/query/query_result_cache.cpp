@@ -0,0 +1,222 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/db/query/query_result_cache.h"
+
+#include "boost/thread/locks.hpp"
+#include "mongo/client/dbclientinterface.h"   // For QueryOption_foobar
+#include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/query/query_planner_common.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+namespace {
+
+    // Generations are unique across all the caches in the process, so that results computed
+    // against a collection that is dropped and re-created while the query yields are never
+    // mistaken for results from the new collection.
+    AtomicUInt64 nextGeneration;
+
+    // Rough bookkeeping cost of an entry beyond its key and data.
+    const size_t kEntryOverhead = 64;
+
+} // namespace
+
+    BSONObj QueryResultCacheStats::toBSON() const {
+        BSONObjBuilder bob;
+        bob.appendNumber("hits", hits);
+        bob.appendNumber("misses", misses);
+        bob.appendNumber("inserts", inserts);
+        bob.appendNumber("invalidations", invalidations);
+        bob.appendNumber("evictions", evictions);
+        bob.appendNumber("entries", numEntries);
+        bob.appendNumber("bytes", numBytes);
+        return bob.obj();
+    }
+
+    // static
+    bool QueryResultCache::shouldCacheQuery(const CanonicalQuery& query) {
+        const LiteParsedQuery& lpq = query.getParsed();
+
+        // The explain output, not the results, is what's returned.
+        if (lpq.isExplain()) {
+            return false;
+        }
+
+        // These expect to keep reading as the collection changes.
+        if (lpq.hasOption(QueryOption_CursorTailable)
+            || lpq.hasOption(QueryOption_OplogReplay)
+            || lpq.hasOption(QueryOption_Exhaust)) {
+            return false;
+        }
+
+        // $where can run arbitrary JS, which needn't return the same thing twice.
+        if (QueryPlannerCommon::hasNode(query.root(), MatchExpression::WHERE)) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // static
+    std::string QueryResultCache::makeKey(const LiteParsedQuery& query) {
+        BSONObjBuilder bob;
+        bob.append("q", query.getFilter());
+        bob.append("p", query.getProj());
+        bob.append("s", query.getSort());
+        bob.append("h", query.getHint());
+        bob.append("min", query.getMin());
+        bob.append("max", query.getMax());
+        bob.append("skip", query.getSkip());
+        bob.append("n", query.getNumToReturn());
+        bob.appendBool("more", query.wantMore());
+        bob.append("opts", query.getOptions());
+        bob.append("maxScan", query.getMaxScan());
+        bob.appendBool("snapshot", query.isSnapshot());
+        bob.appendBool("returnKey", query.returnKey());
+        bob.appendBool("showDiskLoc", query.showDiskLoc());
+        BSONObj obj = bob.done();
+        return std::string(obj.objdata(), obj.objsize());
+    }
+
+    QueryResultCache::QueryResultCache(const std::string& ns)
+        : _cache(internalQueryCacheSize),
+          _generation(nextGeneration.addAndFetch(1)),
+          _numBytes(0),
+          _ns(ns) { }
+
+    QueryResultCache::~QueryResultCache() { }
+
+    bool QueryResultCache::get(const std::string& key,
+                               std::string* dataOut,
+                               int* numResultsOut,
+                               unsigned long long* generationOut) {
+        boost::lock_guard<boost::mutex> cacheLock(_mutex);
+        *generationOut = _generation;
+
+        Entry* entry;
+        if (!_cache.get(key, &entry).isOK()) {
+            ++_stats.misses;
+            return false;
+        }
+
+        ++_stats.hits;
+        *dataOut = entry->data;
+        *numResultsOut = entry->numResults;
+        return true;
+    }
+
+    bool QueryResultCache::add(const std::string& key,
+                               const char* data,
+                               size_t len,
+                               int numResults,
+                               unsigned long long generation) {
+        if (internalQueryResultCacheMaxBytes <= 0) {
+            return false;
+        }
+        size_t maxBytes = static_cast<size_t>(internalQueryResultCacheMaxBytes);
+
+        size_t size = len + key.size() + kEntryOverhead;
+        if (size > maxBytes / 2) {
+            // Don't let one big result push out everything else.
+            return false;
+        }
+
+        boost::lock_guard<boost::mutex> cacheLock(_mutex);
+        if (generation != _generation) {
+            return false;
+        }
+
+        std::auto_ptr<Entry> entry(new Entry());
+        entry->data.assign(data, len);
+        entry->numResults = numResults;
+        entry->size = size;
+
+        // We may be replacing an entry for the same key.
+        Entry* oldEntry;
+        if (_cache.get(key, &oldEntry).isOK()) {
+            _numBytes -= oldEntry->size;
+            _cache.remove(key);
+        }
+
+        _evictTo(maxBytes - size);
+
+        std::auto_ptr<Entry> evicted = _cache.add(key, entry.release());
+        if (NULL != evicted.get()) {
+            _numBytes -= evicted->size;
+            ++_stats.evictions;
+        }
+        _numBytes += size;
+        ++_stats.inserts;
+        return true;
+    }
+
+    void QueryResultCache::invalidate() {
+        boost::lock_guard<boost::mutex> cacheLock(_mutex);
+        _generation = nextGeneration.addAndFetch(1);
+        if (0 == _cache.size()) {
+            return;
+        }
+
+        QLOG() << _ns << ": clearing query result cache on write" << endl;
+        _cache.clear();
+        _numBytes = 0;
+        ++_stats.invalidations;
+    }
+
+    void QueryResultCache::clear() {
+        boost::lock_guard<boost::mutex> cacheLock(_mutex);
+        _generation = nextGeneration.addAndFetch(1);
+        _cache.clear();
+        _numBytes = 0;
+    }
+
+    QueryResultCacheStats QueryResultCache::getStats() const {
+        boost::lock_guard<boost::mutex> cacheLock(_mutex);
+        QueryResultCacheStats stats = _stats;
+        stats.numEntries = _cache.size();
+        stats.numBytes = _numBytes;
+        return stats;
+    }
+
+    void QueryResultCache::_evictTo(size_t maxBytes) {
+        while (_numBytes > maxBytes) {
+            std::auto_ptr<Entry> evicted = _cache.removeLeastRecentlyUsed();
+            if (NULL == evicted.get()) {
+                break;
+            }
+            _numBytes -= evicted->size;
+            ++_stats.evictions;
+        }
+    }
+
+}  // namespace mongo
@@ -0,0 +1,161 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/lru_key_value.h"
+
+namespace mongo {
+
+    /**
+     * Counters describing how a QueryResultCache has been used.
+     */
+    struct QueryResultCacheStats {
+        QueryResultCacheStats() : hits(0), misses(0), inserts(0), invalidations(0),
+                                  evictions(0), numEntries(0), numBytes(0) { }
+
+        BSONObj toBSON() const;
+
+        long long hits;
+        long long misses;
+        long long inserts;
+
+        // Number of writes that emptied a non-empty cache.
+        long long invalidations;
+
+        // Entries dropped to stay under the memory limit.
+        long long evictions;
+
+        long long numEntries;
+        long long numBytes;
+    };
+
+    /**
+     * Caches the first batch of results of finds against a collection, so that a read-mostly
+     * collection can answer a repeated query without running it.
+     *
+     * Entries are keyed by everything in the query that affects its results (see makeKey()), and
+     * the whole cache is thrown away whenever the collection is written to.  The cache is
+     * bounded by internalQueryResultCacheMaxBytes, and evicts the least recently used entries
+     * to stay under it.
+     *
+     * Since a query can yield, a write may happen between looking an entry up and adding the
+     * results of running the query.  Every write therefore moves the cache to a new generation,
+     * and add() refuses results computed in an older generation than the current one.
+     *
+     * Thread safe.
+     */
+    class QueryResultCache {
+        MONGO_DISALLOW_COPYING(QueryResultCache);
+    public:
+        /**
+         * Can the results of 'query' be cached at all?  We only cache queries whose results
+         * depend on nothing but the contents of the collection, and that are answered in a
+         * single batch.
+         */
+        static bool shouldCacheQuery(const CanonicalQuery& query);
+
+        /**
+         * Returns the cache key for 'query': its filter, projection, sort, skip, limit and
+         * every other option that can change what is returned.
+         */
+        static std::string makeKey(const LiteParsedQuery& query);
+
+        QueryResultCache(const std::string& ns);
+
+        ~QueryResultCache();
+
+        /**
+         * Looks up 'key'.  On a hit, copies the cached result documents, one BSONObj after
+         * another, into 'dataOut', sets 'numResultsOut' and returns true.
+         *
+         * Always sets 'generationOut' to the current generation.  Pass it to add() when caching
+         * the results of running the query after a miss.
+         */
+        bool get(const std::string& key,
+                 std::string* dataOut,
+                 int* numResultsOut,
+                 unsigned long long* generationOut);
+
+        /**
+         * Caches 'numResults' documents, stored back to back in the 'len' bytes at 'data', as
+         * the results of the query with key 'key'.  Does nothing and returns false if the
+         * collection was written to since 'generation', or if the results are too big.
+         */
+        bool add(const std::string& key,
+                 const char* data,
+                 size_t len,
+                 int numResults,
+                 unsigned long long generation);
+
+        /**
+         * The collection is being written to.  Drops every entry and starts a new generation.
+         */
+        void invalidate();
+
+        /**
+         * Drops every entry.
+         */
+        void clear();
+
+        QueryResultCacheStats getStats() const;
+
+    private:
+        struct Entry {
+            std::string data;
+            int numResults;
+
+            // What we count against the memory limit: the results, the key and some overhead.
+            size_t size;
+        };
+
+        // Evicts entries until the cache takes at most 'maxBytes'.  Must hold _mutex.
+        void _evictTo(size_t maxBytes);
+
+        // Guards everything below.
+        mutable boost::mutex _mutex;
+
+        LRUKeyValue<std::string, Entry> _cache;
+
+        unsigned long long _generation;
+
+        size_t _numBytes;
+
+        QueryResultCacheStats _stats;
+
+        // For logging.
+        std::string _ns;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,213 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+/**
+ * This file contains tests for mongo/db/query/query_result_cache.h
+ */
+
+#include "mongo/db/query/query_result_cache.h"
+
+#include <memory>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    using std::auto_ptr;
+
+    static const char* ns = "somebogusns";
+
+    CanonicalQuery* canonicalize(const char* queryStr, const char* sortStr, const char* projStr,
+                                 long long skip, long long limit, bool explain) {
+        CanonicalQuery* cq;
+        Status result = CanonicalQuery::canonicalize(ns, fromjson(queryStr), fromjson(sortStr),
+                                                     fromjson(projStr), skip, limit, BSONObj(),
+                                                     BSONObj(), BSONObj(), false, explain, &cq);
+        ASSERT_OK(result);
+        return cq;
+    }
+
+    CanonicalQuery* canonicalize(const char* queryStr) {
+        return canonicalize(queryStr, "{}", "{}", 0, 0, false);
+    }
+
+    /**
+     * Sets internalQueryResultCacheMaxBytes for the duration of a test.
+     */
+    class MaxBytesKnob {
+    public:
+        MaxBytesKnob(int maxBytes) : _oldMaxBytes(internalQueryResultCacheMaxBytes) {
+            internalQueryResultCacheMaxBytes = maxBytes;
+        }
+
+        ~MaxBytesKnob() {
+            internalQueryResultCacheMaxBytes = _oldMaxBytes;
+        }
+
+    private:
+        int _oldMaxBytes;
+    };
+
+    /**
+     * Adds 'obj' as the single result of 'key'.
+     */
+    bool addResult(QueryResultCache* cache, const std::string& key, const BSONObj& obj) {
+        std::string ignoredData;
+        int ignoredNumResults;
+        unsigned long long generation;
+        cache->get(key, &ignoredData, &ignoredNumResults, &generation);
+        return cache->add(key, obj.objdata(), obj.objsize(), 1, generation);
+    }
+
+    TEST(QueryResultCacheTest, ShouldCacheQuery) {
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        ASSERT_TRUE(QueryResultCache::shouldCacheQuery(*cq));
+
+        auto_ptr<CanonicalQuery> explain(canonicalize("{a: 1}", "{}", "{}", 0, 0, true));
+        ASSERT_FALSE(QueryResultCache::shouldCacheQuery(*explain));
+    }
+
+    TEST(QueryResultCacheTest, KeyDependsOnEverythingThatChangesResults) {
+        auto_ptr<CanonicalQuery> base(canonicalize("{a: 1}"));
+        auto_ptr<CanonicalQuery> otherValue(canonicalize("{a: 2}"));
+        auto_ptr<CanonicalQuery> sort(canonicalize("{a: 1}", "{b: 1}", "{}", 0, 0, false));
+        auto_ptr<CanonicalQuery> proj(canonicalize("{a: 1}", "{}", "{_id: 0}", 0, 0, false));
+        auto_ptr<CanonicalQuery> skip(canonicalize("{a: 1}", "{}", "{}", 5, 0, false));
+        auto_ptr<CanonicalQuery> limit(canonicalize("{a: 1}", "{}", "{}", 0, 5, false));
+        auto_ptr<CanonicalQuery> same(canonicalize("{a: 1}"));
+
+        std::string key = QueryResultCache::makeKey(base->getParsed());
+        ASSERT_EQUALS(key, QueryResultCache::makeKey(same->getParsed()));
+        ASSERT_NOT_EQUALS(key, QueryResultCache::makeKey(otherValue->getParsed()));
+        ASSERT_NOT_EQUALS(key, QueryResultCache::makeKey(sort->getParsed()));
+        ASSERT_NOT_EQUALS(key, QueryResultCache::makeKey(proj->getParsed()));
+        ASSERT_NOT_EQUALS(key, QueryResultCache::makeKey(skip->getParsed()));
+        ASSERT_NOT_EQUALS(key, QueryResultCache::makeKey(limit->getParsed()));
+    }
+
+    TEST(QueryResultCacheTest, AddGet) {
+        MaxBytesKnob knob(1024 * 1024);
+        QueryResultCache cache(ns);
+        BSONObj doc = BSON("_id" << 1 << "a" << 1);
+
+        std::string data;
+        int numResults;
+        unsigned long long generation;
+        ASSERT_FALSE(cache.get("k", &data, &numResults, &generation));
+        ASSERT_TRUE(cache.add("k", doc.objdata(), doc.objsize(), 1, generation));
+
+        ASSERT_TRUE(cache.get("k", &data, &numResults, &generation));
+        ASSERT_EQUALS(numResults, 1);
+        ASSERT_EQUALS(BSONObj(data.data()), doc);
+
+        QueryResultCacheStats stats = cache.getStats();
+        ASSERT_EQUALS(stats.hits, 1);
+        ASSERT_EQUALS(stats.misses, 1);
+        ASSERT_EQUALS(stats.inserts, 1);
+        ASSERT_EQUALS(stats.numEntries, 1);
+    }
+
+    TEST(QueryResultCacheTest, DisabledByDefault) {
+        MaxBytesKnob knob(0);
+        QueryResultCache cache(ns);
+        ASSERT_FALSE(addResult(&cache, "k", BSON("a" << 1)));
+        ASSERT_EQUALS(cache.getStats().numEntries, 0);
+    }
+
+    TEST(QueryResultCacheTest, WriteInvalidates) {
+        MaxBytesKnob knob(1024 * 1024);
+        QueryResultCache cache(ns);
+        ASSERT_TRUE(addResult(&cache, "k", BSON("a" << 1)));
+
+        cache.invalidate();
+
+        std::string data;
+        int numResults;
+        unsigned long long generation;
+        ASSERT_FALSE(cache.get("k", &data, &numResults, &generation));
+        ASSERT_EQUALS(cache.getStats().invalidations, 1);
+
+        // Invalidating an empty cache isn't counted.
+        cache.invalidate();
+        ASSERT_EQUALS(cache.getStats().invalidations, 1);
+    }
+
+    TEST(QueryResultCacheTest, WriteDuringQueryPreventsAdd) {
+        MaxBytesKnob knob(1024 * 1024);
+        QueryResultCache cache(ns);
+        BSONObj doc = BSON("a" << 1);
+
+        std::string data;
+        int numResults;
+        unsigned long long generation;
+        ASSERT_FALSE(cache.get("k", &data, &numResults, &generation));
+
+        // The query yields and someone writes to the collection.
+        cache.invalidate();
+
+        ASSERT_FALSE(cache.add("k", doc.objdata(), doc.objsize(), 1, generation));
+        ASSERT_FALSE(cache.get("k", &data, &numResults, &generation));
+    }
+
+    TEST(QueryResultCacheTest, EvictsToStayUnderMemoryLimit) {
+        MaxBytesKnob knob(4096);
+        QueryResultCache cache(ns);
+        BSONObj doc = BSON("s" << std::string(1000, 'x'));
+
+        ASSERT_TRUE(addResult(&cache, "a", doc));
+        ASSERT_TRUE(addResult(&cache, "b", doc));
+        ASSERT_TRUE(addResult(&cache, "c", doc));
+
+        // Touch "a" so that "b" is the least recently used.
+        std::string data;
+        int numResults;
+        unsigned long long generation;
+        ASSERT_TRUE(cache.get("a", &data, &numResults, &generation));
+
+        ASSERT_TRUE(addResult(&cache, "d", doc));
+
+        QueryResultCacheStats stats = cache.getStats();
+        ASSERT_LESS_THAN_OR_EQUALS(stats.numBytes, 4096);
+        ASSERT_EQUALS(stats.evictions, 1);
+        ASSERT_TRUE(cache.get("a", &data, &numResults, &generation));
+        ASSERT_FALSE(cache.get("b", &data, &numResults, &generation));
+    }
+
+    TEST(QueryResultCacheTest, HugeResultIsNotCached) {
+        MaxBytesKnob knob(4096);
+        QueryResultCache cache(ns);
+        ASSERT_FALSE(addResult(&cache, "k", BSON("s" << std::string(3000, 'x'))));
+    }
+
+}  // namespace
@@ -31,6 +31,15 @@
 
 namespace mongo {
 
+    BSONObj PlanCostEstimate::toBSON() const {
+        BSONObjBuilder bob;
+        bob.append("works", works);
+        bob.append("exact", exact);
+        bob.append("indexKeys", indexKeys);
+        bob.appendNumber("candidatesPruned", static_cast<long long>(candidatesPruned));
+        return bob.obj();
+    }
+
     string QuerySolutionNode::toString() const {
         mongoutils::str::stream ss;
         appendToString(&ss, 0);
@@ -165,6 +165,28 @@ namespace mongo {
         MONGO_DISALLOW_COPYING(QuerySolutionNode);
     };
 
+    /**
+     * What PlanCostModel predicted about a solution before any of the candidates were run.
+     */
+    struct PlanCostEstimate {
+        PlanCostEstimate() : works(0), exact(true), candidatesPruned(0) { }
+
+        BSONObj toBSON() const;
+
+        // Index keys examined plus documents fetched, scanned, or sorted.
+        double works;
+
+        // False if some index scan had more keys in its bounds than we were willing to count.  In
+        // that case 'works' is a lower bound.
+        bool exact;
+
+        // How many keys were counted in each index's bounds: {<index name>: <count>, ...}.
+        BSONObj indexKeys;
+
+        // How many other candidates were thrown out in favor of this one before the trial run?
+        size_t candidatesPruned;
+    };
+
     /**
      * A QuerySolution must be entirely self-contained and own everything inside of it.
      *
@@ -198,6 +220,9 @@ namespace mongo {
         // Owned here. Used by the plan cache.
         boost::scoped_ptr<SolutionCacheData> cacheData;
 
+        // Owned here.  NULL unless PlanCostModel was able to estimate this solution.
+        boost::scoped_ptr<PlanCostEstimate> costEstimate;
+
         /**
          * Output a human-readable string representing the plan.
          */
@@ -113,6 +113,10 @@ namespace mongo {
             // is enabled in the query flags.
             if (_solution) {
                 (*explain)->setIndexFilterApplied(_solution->indexFilterApplied);
+
+                if (NULL != _solution->costEstimate.get()) {
+                    (*explain)->setCostEstimate(_solution->costEstimate->toBSON());
+                }
             }
         }
         else if (NULL != planInfo) {
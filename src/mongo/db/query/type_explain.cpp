@@ -56,6 +56,7 @@ namespace mongo {
     const BSONField<TypeExplain*> TypeExplain::oldPlan("oldPlan");
     const BSONField<bool> TypeExplain::indexFilterApplied("filterSet");
     const BSONField<std::string> TypeExplain::server("server");
+    const BSONField<BSONObj> TypeExplain::costEstimate("costEstimate");
 
     TypeExplain::TypeExplain() {
         clear();
@@ -164,6 +165,8 @@ namespace mongo {
 
         if (_isIndexFilterAppliedSet) builder.append(indexFilterApplied(), _indexFilterApplied);
 
+        if (_isCostEstimateSet) builder.append(costEstimate(), _costEstimate);
+
         // Add this at the end as it can be huge
         if (!stats.isEmpty()) {
             builder.append("stats", stats);
@@ -254,6 +257,10 @@ namespace mongo {
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isServerSet = fieldState == FieldParser::FIELD_SET;
 
+        fieldState = FieldParser::extract(source, costEstimate, &_costEstimate, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isCostEstimateSet = fieldState == FieldParser::FIELD_SET;
+
         return true;
     }
 
@@ -312,6 +319,9 @@ namespace mongo {
         _server.clear();
         _isServerSet = false;
 
+        _costEstimate = BSONObj();
+        _isCostEstimateSet = false;
+
     }
 
     void TypeExplain::cloneTo(TypeExplain* other) const {
@@ -393,6 +403,9 @@ namespace mongo {
 
         other->_server = _server;
         other->_isServerSet = _isServerSet;
+
+        other->_costEstimate = _costEstimate;
+        other->_isCostEstimateSet = _isCostEstimateSet;
     }
 
     std::string TypeExplain::toString() const {
@@ -802,4 +815,22 @@ namespace mongo {
         return _server;
     }
 
+    void TypeExplain::setCostEstimate(const BSONObj& costEstimate) {
+        _costEstimate = costEstimate.getOwned();
+        _isCostEstimateSet = true;
+    }
+
+    void TypeExplain::unsetCostEstimate() {
+         _isCostEstimateSet = false;
+     }
+
+    bool TypeExplain::isCostEstimateSet() const {
+         return _isCostEstimateSet;
+    }
+
+    const BSONObj& TypeExplain::getCostEstimate() const {
+        verify(_isCostEstimateSet);
+        return _costEstimate;
+    }
+
 } // namespace mongo
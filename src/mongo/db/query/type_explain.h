@@ -80,6 +80,7 @@ namespace mongo {
         static const BSONField<TypeExplain*> oldPlan;
         static const BSONField<bool> indexFilterApplied;
         static const BSONField<std::string> server;
+        static const BSONField<BSONObj> costEstimate;
 
         //
         // construction / destruction
@@ -206,6 +207,11 @@ namespace mongo {
         bool isServerSet() const;
         const std::string& getServer() const;
 
+        void setCostEstimate(const BSONObj& costEstimate);
+        void unsetCostEstimate();
+        bool isCostEstimateSet() const;
+        const BSONObj& getCostEstimate() const;
+
         // Opaque stats object
         BSONObj stats;
 
@@ -284,6 +290,10 @@ namespace mongo {
         // (O)  server's host:port against which the query ran
         std::string _server;
         bool _isServerSet;
+
+        // (O)  what the cost model predicted for this plan before it was run
+        BSONObj _costEstimate;
+        bool _isCostEstimateSet;
     };
 
 } // namespace mongo
@@ -90,6 +90,7 @@ namespace replset {
                                        _lastH(0),
                                        _pause(true),
                                        _appliedBuffer(true),
+                                       _consumedNotApplied(0),
                                        _assumingPrimary(false),
                                        _currentSyncTarget(NULL) {
     }
@@ -113,7 +114,7 @@ namespace replset {
             boost::unique_lock<boost::mutex> lock(s_instance->_mutex);
 
             // If all ops in the buffer have been applied, unblock waitForRepl (if it's waiting)
-            if (s_instance->_buffer.empty()) {
+            if (s_instance->_buffer.empty() && s_instance->_consumedNotApplied == 0) {
                 s_instance->_appliedBuffer = true;
                 s_instance->_condvar.notify_all();
             }
@@ -334,6 +335,12 @@ namespace replset {
     }
 
     void BackgroundSync::consume() {
+        {
+            // counted before it leaves the buffer, so that notify() sees it in one or the other
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _consumedNotApplied++;
+        }
+
         // this is just to get the op off the queue, it's been peeked at
         // and queued for application already
         BSONObj op = _buffer.blockingPop();
@@ -341,6 +348,12 @@ namespace replset {
         bufferSizeGauge.decrement(getSize(op));
     }
 
+    void BackgroundSync::markApplied(size_t numOps) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        // start() may have written these off already, see there
+        _consumedNotApplied = std::max(_consumedNotApplied - static_cast<long long>(numOps), 0LL);
+    }
+
     bool BackgroundSync::isStale(OplogReader& r, BSONObj& remoteOldestOp) {
         remoteOldestOp = r.findOne(rsoplog, Query());
         OpTime remoteTs = remoteOldestOp["ts"]._opTime();
@@ -487,6 +500,16 @@ namespace replset {
         boost::unique_lock<boost::mutex> lock(_mutex);
         _pause = false;
 
+        // Syncing stopped for a rollback or to step up, both of which wait for every op handed
+        // to the sync thread to be applied, so a count left over now was leaked and would block
+        // getOplogReader() for good.
+        if (_consumedNotApplied != 0) {
+            warning() << "replSet bgsync restarting with " << _consumedNotApplied
+                      << " ops consumed but not applied, resetting" << rsLog;
+            _consumedNotApplied = 0;
+        }
+        _appliedBuffer = true;
+
         // reset _last fields with current data
         _lastOpTimeFetched = theReplSet->lastOpTimeWritten;
         _lastH = theReplSet->lastH;
@@ -50,9 +50,13 @@ namespace replset {
         virtual bool peek(BSONObj* op) = 0;
 
         // Deletes objects in the queue;
-        // called by sync thread after it has applied an op
+        // called by sync thread once it has taken an op for a batch
         virtual void consume() = 0;
 
+        // Called by sync thread once 'numOps' consumed ops have been applied, or dropped.  Until
+        // then they count as part of the buffer that hasn't been applied.
+        virtual void markApplied(size_t numOps) = 0;
+
         // Returns the member we're currently syncing from (or NULL)
         virtual const Member* getSyncTarget() = 0;
 
@@ -86,6 +90,8 @@ namespace replset {
         // if produce thread should be running
         bool _pause;
         bool _appliedBuffer;
+        // ops consumed by the sync thread that it hasn't applied yet
+        long long _consumedNotApplied;
         bool _assumingPrimary;
         boost::condition _condvar;
 
@@ -129,6 +135,7 @@ namespace replset {
 
         virtual bool peek(BSONObj* op);
         virtual void consume();
+        virtual void markApplied(size_t numOps);
         virtual const Member* getSyncTarget();
         virtual void waitForMore();
 
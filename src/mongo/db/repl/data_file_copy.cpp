@@ -0,0 +1,539 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/data_file_copy.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <set>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/d_concurrency.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/oplogreader.h"
+#include "mongo/db/repl/replset_commands.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/file.h"
+#include "mongo/util/md5.hpp"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace replset {
+
+    using namespace mongoutils;
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER( initialSyncFromDataFiles, bool, false );
+    MONGO_EXPORT_SERVER_PARAMETER( initialSyncDataFileChunkBytes, int, 4 * 1024 * 1024 );
+
+namespace {
+
+    // Replies carry at most this much data, whatever is asked for.
+    const int kMaxChunkBytes = 8 * 1024 * 1024;
+
+    // How many times, a second apart, we try to fsync-unlock the source before giving up on it.
+    const int kUnlockAttempts = 30;
+
+    // The progress of the current, or last, data file copy.  Guarded by progressMutex.
+    mongo::mutex progressMutex( "initialSyncFileCopyProgress" );
+    std::string progressSource;
+    unsigned long long progressStart = 0;
+    unsigned long long progressEnd = 0;
+    int progressFiles = 0;
+    int progressFilesDone = 0;
+    long long progressBytes = 0;
+    long long progressBytesCopied = 0;
+    std::string progressCurrentFile;
+
+    long long bytesPerSec( long long bytes, unsigned long long millis ) {
+        return millis ? static_cast<long long>( bytes * 1000 / millis ) : 0;
+    }
+
+    std::string describe( const std::string& db, int fileNo ) {
+        if ( fileNo < 0 )
+            return db + ".ns";
+        return str::stream() << db << '.' << fileNo;
+    }
+
+} // namespace
+
+    boost::filesystem::path dataFilePath( const std::string& db, int fileNo ) {
+        boost::filesystem::path path( storageGlobalParams.dbpath );
+        if ( storageGlobalParams.directoryperdb )
+            path /= db;
+        path /= describe( db, fileNo );
+        return path;
+    }
+
+    /**
+     * Lists the data files of every database but local, with their sizes, for DataFileCopier.
+     * Only answers while this server is fsync-locked, so that the sizes hold.
+     */
+    class CmdReplSetListDataFiles : public ReplSetCommand {
+    public:
+        CmdReplSetListDataFiles() : ReplSetCommand("replSetListDataFiles") { }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::internal);
+            out->push_back(Privilege(ResourcePattern::forClusterResource(), actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            if( !check(errmsg, result) )
+                return false;
+            if( !lockedForWriting() ) {
+                errmsg = "data files are only listed while fsync-locked";
+                return false;
+            }
+
+            vector<string> dbs;
+            getDatabaseNames(dbs);
+
+            BSONArrayBuilder files(result.subarrayStart("files"));
+            for( vector<string>::const_iterator i = dbs.begin(); i != dbs.end(); ++i ) {
+                if( *i == "local" )
+                    continue;
+                for( int fileNo = -1; fileNo < DiskLoc::MaxFiles; fileNo++ ) {
+                    boost::filesystem::path path = dataFilePath(*i, fileNo);
+                    if( !boost::filesystem::exists(path) ) {
+                        if( fileNo < 0 )
+                            continue;
+                        break;
+                    }
+                    files.append(BSON("db" << *i
+                                      << "fileNo" << fileNo
+                                      << "size" << static_cast<long long>(
+                                          boost::filesystem::file_size(path))));
+                }
+            }
+            files.done();
+            return true;
+        }
+    } cmdReplSetListDataFiles;
+
+    /**
+     * Reads part of a data file, for DataFileCopier:
+     *
+     *   { replSetReadDataFile: 1, db: <db>, fileNo: <n, or -1 for the .ns file>,
+     *     offset: <bytes>, length: <bytes> }
+     *
+     * answers with the bytes as 'data' and their md5 as 'md5'.  The reply is short at the end of
+     * the file.  Only answers while this server is fsync-locked.
+     */
+    class CmdReplSetReadDataFile : public ReplSetCommand {
+    public:
+        CmdReplSetReadDataFile() : ReplSetCommand("replSetReadDataFile") { }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::internal);
+            out->push_back(Privilege(ResourcePattern::forClusterResource(), actions));
+        }
+        virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            if( !check(errmsg, result) )
+                return false;
+            if( !lockedForWriting() ) {
+                errmsg = "data files are only read while fsync-locked";
+                return false;
+            }
+
+            const string db = cmdObj["db"].str();
+            const int fileNo = cmdObj["fileNo"].numberInt();
+            const long long offset = cmdObj["offset"].numberLong();
+            const int length = std::min(cmdObj["length"].numberInt(), kMaxChunkBytes);
+            if( !NamespaceString::validDBName(db) || db == "local" ||
+                fileNo < -1 || fileNo >= DiskLoc::MaxFiles || offset < 0 || length <= 0 ) {
+                errmsg = str::stream() << "bad data file read: " << cmdObj;
+                return false;
+            }
+
+            boost::filesystem::path path = dataFilePath(db, fileNo);
+            if( !boost::filesystem::exists(path) ) {
+                errmsg = str::stream() << "no data file " << describe(db, fileNo);
+                return false;
+            }
+            const long long size = boost::filesystem::file_size(path);
+            const int toRead = static_cast<int>(std::max(0LL, std::min<long long>(length,
+                                                                                   size - offset)));
+
+            std::vector<char> buf(toRead + 1);
+            if( toRead > 0 ) {
+                File f;
+                f.open(path.string().c_str(), true);
+                if( !f.bad() )
+                    f.read(offset, &buf[0], toRead);
+                if( f.bad() ) {
+                    errmsg = str::stream() << "couldn't read data file " << describe(db, fileNo);
+                    return false;
+                }
+            }
+
+            md5digest digest;
+            md5(&buf[0], toRead, digest);
+            result.appendBinData("data", toRead, BinDataGeneral, &buf[0]);
+            result.append("md5", digestToString(digest));
+            return true;
+        }
+    } cmdReplSetReadDataFile;
+
+    DataFileCopier::DataFileCopier( const std::string& sourceHost )
+        : _sourceHost( sourceHost ),
+          _tempDir( boost::filesystem::path( storageGlobalParams.dbpath ) / "_tmp" /
+                    "initialSyncDataFiles" ),
+          _sourceLocked( false ) {
+    }
+
+    DataFileCopier::~DataFileCopier() {
+        if ( _sourceLocked )
+            unlockSource();
+    }
+
+    bool DataFileCopier::copyDataFiles( BSONObj* lastOp, std::string* errmsg ) {
+        {
+            scoped_lock lk( progressMutex );
+            progressSource = _sourceHost;
+            progressStart = curTimeMillis64();
+            progressEnd = 0;
+            progressFiles = 0;
+            progressFilesDone = 0;
+            progressBytes = 0;
+            progressBytesCopied = 0;
+            progressCurrentFile.clear();
+        }
+
+        bool ok = true;
+        try {
+            // Left over if we were killed during an earlier copy.
+            boost::filesystem::remove_all( _tempDir );
+            boost::filesystem::create_directories( _tempDir );
+
+            _conn.reset( new DBClientConnection( false, 0, 0 ) );
+            string err;
+            uassert( 17520,
+                     str::stream() << "initial sync couldn't connect to " << _sourceHost << ": "
+                                   << err,
+                     _conn->connect( _sourceHost.c_str(), err ) );
+            uassert( 17521,
+                     str::stream() << "initial sync couldn't authenticate to " << _sourceHost,
+                     !getGlobalAuthorizationManager()->isAuthEnabled() ||
+                     replAuthenticate( _conn.get() ) );
+
+            lockSource();
+
+            // Nothing is written while the source is locked, so its data files match its oplog.
+            *lastOp = _conn->findOne( rsoplog, Query().sort( reverseNaturalObj ), NULL,
+                                      QueryOption_SlaveOk ).getOwned();
+            uassert( 17522,
+                     str::stream() << "initial sync couldn't read the oplog of " << _sourceHost,
+                     !lastOp->isEmpty() );
+
+            std::vector<DataFile> files;
+            listFiles( &files );
+            {
+                scoped_lock lk( progressMutex );
+                progressFiles = files.size();
+                for ( size_t i = 0; i < files.size(); i++ )
+                    progressBytes += files[i].size;
+            }
+
+            for ( size_t i = 0; i < files.size(); i++ ) {
+                copyFile( files[i] );
+            }
+
+            unlockSource();
+            installFiles( files );
+            boost::filesystem::remove_all( _tempDir );
+        }
+        catch ( const DBException& e ) {
+            *errmsg = e.toString();
+            ok = false;
+            removeWrittenFiles();
+        }
+        catch ( const boost::filesystem::filesystem_error& e ) {
+            *errmsg = e.what();
+            ok = false;
+            removeWrittenFiles();
+        }
+
+        unsigned long long millis;
+        long long bytes;
+        {
+            scoped_lock lk( progressMutex );
+            progressEnd = curTimeMillis64();
+            progressCurrentFile.clear();
+            millis = progressEnd - progressStart;
+            bytes = progressBytesCopied;
+        }
+        log() << "replSet initial sync copied " << bytes << " bytes of data files from "
+              << _sourceHost << " in " << millis << "ms ("
+              << bytesPerSec( bytes, millis ) << " bytes/sec)" << rsLog;
+        return ok;
+    }
+
+    void DataFileCopier::lockSource() {
+        BSONObj info;
+        uassert( 17523,
+                 str::stream() << "initial sync couldn't fsync-lock " << _sourceHost << ": "
+                               << info,
+                 _conn->runCommand( "admin", BSON( "fsync" << 1 << "lock" << true ), info ) );
+        _sourceLocked = true;
+        log() << "replSet initial sync fsync-locked " << _sourceHost << " to copy its data files"
+              << rsLog;
+    }
+
+    void DataFileCopier::unlockSource() {
+        _sourceLocked = false;
+
+        // The copy's connection failing may be why we are unlocking, and a source left locked
+        // takes no writes until someone unlocks it by hand, so each attempt uses a connection
+        // of its own.
+        for ( int attempt = 1; attempt <= kUnlockAttempts; attempt++ ) {
+            try {
+                DBClientConnection conn( false, 0, 0 );
+                string err;
+                uassert( 17532,
+                         str::stream() << "couldn't connect: " << err,
+                         conn.connect( _sourceHost.c_str(), err ) );
+                uassert( 17533,
+                         "couldn't authenticate",
+                         !getGlobalAuthorizationManager()->isAuthEnabled() ||
+                         replAuthenticate( &conn ) );
+
+                BSONObj info = conn.findOne( "admin.$cmd.sys.unlock", BSONObj() );
+                if ( info["ok"].trueValue() ) {
+                    log() << "replSet initial sync fsync-unlocked " << _sourceHost << rsLog;
+                    return;
+                }
+                if ( info["errmsg"].str() == "not locked" ) {
+                    warning() << "initial sync found " << _sourceHost << " already unlocked"
+                              << rsLog;
+                    return;
+                }
+                warning() << "initial sync couldn't fsync-unlock " << _sourceHost << ": "
+                          << info << rsLog;
+            }
+            catch ( const DBException& e ) {
+                warning() << "initial sync couldn't fsync-unlock " << _sourceHost << ": "
+                          << e.toString() << rsLog;
+            }
+            if ( attempt < kUnlockAttempts )
+                sleepsecs( 1 );
+        }
+
+        error() << "replSet initial sync gave up on fsync-unlocking " << _sourceHost << " after "
+                << kUnlockAttempts << " attempts; it must be unlocked by hand with "
+                << "db.fsyncUnlock()" << rsLog;
+    }
+
+    void DataFileCopier::listFiles( std::vector<DataFile>* files ) {
+        BSONObj info;
+        uassert( 17524,
+                 str::stream() << "initial sync couldn't list the data files of " << _sourceHost
+                               << ": " << info,
+                 _conn->runCommand( "admin", BSON( "replSetListDataFiles" << 1 ), info ) );
+
+        BSONObjIterator i( info["files"].Obj() );
+        while ( i.more() ) {
+            BSONObj f = i.next().Obj();
+            DataFile file;
+            file.db = f["db"].String();
+            file.fileNo = f["fileNo"].numberInt();
+            file.size = f["size"].numberLong();
+            files->push_back( file );
+        }
+    }
+
+    void DataFileCopier::copyFile( const DataFile& file ) {
+        const std::string name = describe( file.db, file.fileNo );
+        {
+            scoped_lock lk( progressMutex );
+            progressCurrentFile = name;
+        }
+
+        const boost::filesystem::path dest = dataFilePath( file.db, file.fileNo );
+        uassert( 17525,
+                 str::stream() << "initial sync found data file " << dest.string()
+                               << " already there",
+                 !boost::filesystem::exists( dest ) );
+
+        const boost::filesystem::path path = _tempDir / name;
+        File out;
+        out.open( path.string().c_str() );
+        uassert( 17526,
+                 str::stream() << "initial sync couldn't create " << path.string(),
+                 !out.bad() );
+
+        const int chunkBytes = std::max( 1, std::min( initialSyncDataFileChunkBytes,
+                                                      kMaxChunkBytes ) );
+        long long offset = 0;
+        while ( offset < file.size ) {
+            const int length = static_cast<int>( std::min<long long>( chunkBytes,
+                                                                      file.size - offset ) );
+            BSONObj info;
+            uassert( 17527,
+                     str::stream() << "initial sync couldn't read " << name << " from "
+                                   << _sourceHost << ": " << info,
+                     _conn->runCommand( "admin",
+                                        BSON( "replSetReadDataFile" << 1
+                                              << "db" << file.db
+                                              << "fileNo" << file.fileNo
+                                              << "offset" << offset
+                                              << "length" << length ),
+                                        info ) );
+
+            int len = 0;
+            const char* data = info["data"].binData( len );
+            uassert( 17528,
+                     str::stream() << "initial sync got " << len << " bytes of " << name
+                                   << " at offset " << offset << ", expected " << length,
+                     len == length );
+
+            md5digest digest;
+            md5( data, len, digest );
+            uassert( 17529,
+                     str::stream() << "initial sync got a bad checksum for " << name
+                                   << " at offset " << offset,
+                     digestToString( digest ) == info["md5"].str() );
+
+            out.write( offset, data, len );
+            uassert( 17530,
+                     str::stream() << "initial sync couldn't write " << path.string(),
+                     !out.bad() );
+
+            offset += len;
+            scoped_lock lk( progressMutex );
+            progressBytesCopied += len;
+        }
+
+        out.fsync();
+
+        scoped_lock lk( progressMutex );
+        progressFilesDone++;
+    }
+
+    void DataFileCopier::installFiles( const std::vector<DataFile>& files ) {
+        // listDatabases and the like open every database they find in the dbpath, so the files
+        // only appear there once they are all complete, and not while anyone could look.
+        Lock::GlobalWrite lk;
+
+        std::set<std::string> dbs;
+        for ( size_t i = 0; i < files.size(); i++ )
+            dbs.insert( files[i].db );
+
+        // Someone may have used one of these databases while it didn't exist here, leaving an
+        // empty one open.  Close it, so that the next use opens the files.
+        for ( std::set<std::string>::const_iterator i = dbs.begin(); i != dbs.end(); ++i ) {
+            if ( dbHolder().__isLoaded( *i, storageGlobalParams.dbpath ) ) {
+                Client::Context ctx( *i );
+                Database::closeDatabase( *i, storageGlobalParams.dbpath );
+            }
+        }
+
+        // If a move fails, the ones already made are undone before the lock is released, so no
+        // one sees part of a database.
+        std::vector<boost::filesystem::path> installed;
+        try {
+            for ( size_t i = 0; i < files.size(); i++ ) {
+                const boost::filesystem::path path = dataFilePath( files[i].db, files[i].fileNo );
+                uassert( 17531,
+                         str::stream() << "initial sync found data file " << path.string()
+                                       << " already there",
+                         !boost::filesystem::exists( path ) );
+                if ( storageGlobalParams.directoryperdb )
+                    boost::filesystem::create_directories( path.parent_path() );
+
+                boost::filesystem::rename( _tempDir / describe( files[i].db, files[i].fileNo ),
+                                           path );
+                installed.push_back( path );
+            }
+        }
+        catch ( ... ) {
+            for ( size_t i = 0; i < installed.size(); i++ ) {
+                try {
+                    boost::filesystem::remove( installed[i] );
+                }
+                catch ( const boost::filesystem::filesystem_error& e ) {
+                    warning() << "initial sync couldn't remove " << installed[i].string()
+                              << ": " << e.what() << rsLog;
+                }
+            }
+            throw;
+        }
+
+        log() << "replSet initial sync moved " << files.size() << " data files into "
+              << storageGlobalParams.dbpath << rsLog;
+    }
+
+    void DataFileCopier::removeWrittenFiles() {
+        try {
+            boost::filesystem::remove_all( _tempDir );
+        }
+        catch ( const boost::filesystem::filesystem_error& e ) {
+            warning() << "initial sync couldn't remove " << _tempDir.string() << ": "
+                      << e.what() << rsLog;
+        }
+    }
+
+    void DataFileCopier::appendProgress( BSONObjBuilder* b ) {
+        scoped_lock lk( progressMutex );
+        if ( !progressStart )
+            return;
+
+        const unsigned long long end = progressEnd ? progressEnd : curTimeMillis64();
+        const unsigned long long elapsed = end - progressStart;
+        BSONObjBuilder s( b->subobjStart( "initialSyncFileCopyStatus" ) );
+        s.append( "source", progressSource );
+        s.append( "inProgress", progressEnd == 0 );
+        s.append( "elapsedMillis", static_cast<long long>( elapsed ) );
+        s.append( "files", progressFiles );
+        s.append( "filesDone", progressFilesDone );
+        s.append( "bytes", progressBytes );
+        s.append( "bytesCopied", progressBytesCopied );
+        s.append( "bytesPerSec", bytesPerSec( progressBytesCopied, elapsed ) );
+        if ( !progressCurrentFile.empty() )
+            s.append( "currentFile", progressCurrentFile );
+        s.done();
+    }
+
+} // namespace replset
+} // namespace mongo
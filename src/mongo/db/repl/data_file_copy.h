@@ -0,0 +1,122 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+namespace replset {
+
+    // Seed initial sync by copying the sync source's data files instead of cloning its
+    // collections.  Only a secondary sync source is copied from.
+    extern bool initialSyncFromDataFiles;
+
+    // Most bytes of a data file sent in one replSetReadDataFile reply.
+    extern int initialSyncDataFileChunkBytes;
+
+    /**
+     * The path of data file 'fileNo' of 'db' under this server's dbpath.  fileNo -1 is the
+     * namespace file.
+     */
+    boost::filesystem::path dataFilePath(const std::string& db, int fileNo);
+
+    /**
+     * Copies the data files of every database but local from a secondary sync source, for initial
+     * sync.
+     *
+     * The source is fsync-locked for the whole copy, so the files are a consistent snapshot as of
+     * the last entry of its oplog, which the copy reports.  The files are written to a temporary
+     * directory under the dbpath and only moved into place, under the global write lock, once
+     * they are all there, so no one can open a database that is still being copied.  Applying the source's oplog from that
+     * entry on then brings the copy up to date, just as after a clone.  Each chunk of a file is
+     * sent with its md5, which is checked before the chunk is written.  Indexes come with the
+     * files, so there's no index pass.
+     *
+     * Progress is reported by appendProgress(), for replSetGetStatus.
+     */
+    class DataFileCopier {
+        MONGO_DISALLOW_COPYING(DataFileCopier);
+    public:
+        explicit DataFileCopier(const std::string& sourceHost);
+
+        /**
+         * Unlocks the source if a copy failed with it locked.
+         */
+        ~DataFileCopier();
+
+        /**
+         * Copies the files.  The databases copied must not exist here.  Sets 'lastOp' to the
+         * source's last oplog entry as of the copy.  Returns false and sets 'errmsg' if that
+         * fails, having removed the files it wrote.
+         */
+        bool copyDataFiles(BSONObj* lastOp, std::string* errmsg);
+
+        /**
+         * Appends the progress of the current, or else the last, data file copy as
+         * 'initialSyncFileCopyStatus'.  Appends nothing if there hasn't been one.
+         */
+        static void appendProgress(BSONObjBuilder* b);
+
+    private:
+        struct DataFile {
+            std::string db;
+            int fileNo;
+            long long size;
+        };
+
+        void lockSource();
+        // Doesn't throw.  Retries over new connections, since the source must not stay locked.
+        void unlockSource();
+
+        void listFiles(std::vector<DataFile>* files);
+
+        // Copies 'file' into the temporary directory.
+        void copyFile(const DataFile& file);
+
+        // Moves the copied files into the dbpath.  If that fails, removes the ones it moved.
+        void installFiles(const std::vector<DataFile>& files);
+
+        // Removes the temporary directory and the files copied into it.
+        void removeWrittenFiles();
+
+        const std::string _sourceHost;
+        const boost::filesystem::path _tempDir;
+        boost::scoped_ptr<DBClientConnection> _conn;
+        bool _sourceLocked;
+    };
+
+} // namespace replset
+} // namespace mongo
@@ -35,6 +35,8 @@
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/connections.h"
+#include "mongo/db/repl/data_file_copy.h"
+#include "mongo/db/repl/initial_sync_cloner.h"
 #include "mongo/db/repl/member.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
@@ -465,6 +467,8 @@ namespace mongo {
             b.append("syncingTo", syncTarget->fullName());
         }
         b.append("members", v);
+        replset::InitialSyncCloner::appendProgress(&b);
+        replset::DataFileCopier::appendProgress(&b);
         if( replSetBlind )
             b.append("blind",true); // to avoid confusion if set...normally never set except for testing.
     }
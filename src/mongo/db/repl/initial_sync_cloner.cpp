@@ -0,0 +1,557 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/initial_sync_cloner.h"
+
+#include <boost/bind.hpp>
+#include <map>
+
+#include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/cloner.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/repl/oplogreader.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/mmap_v1/dur_transaction.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace replset {
+
+    using namespace mongoutils;
+
+    MONGO_EXPORT_SERVER_PARAMETER( initialSyncCloneThreads, int, 4 );
+    MONGO_EXPORT_SERVER_PARAMETER( initialSyncSplitCollectionBytes, long long,
+                                   1024LL * 1024 * 1024 );
+
+namespace {
+
+    // Bounds the size of the progress report for sources with very many collections.
+    const size_t kMaxCollectionsReported = 1000;
+
+    struct CollectionProgress {
+        CollectionProgress() : state( "pending" ), documents( 0 ), bytes( 0 ), parts( 1 ),
+                               start( 0 ), end( 0 ) {}
+
+        std::string state; // "pending", "cloning", "indexing" or "done"
+        long long documents;
+        long long bytes;
+        int parts;
+        unsigned long long start;
+        unsigned long long end;
+    };
+
+    // The progress of the current, or last, initial sync copy.  Guarded by progressMutex.
+    mongo::mutex progressMutex( "initialSyncProgress" );
+    std::string progressSource;
+    int progressThreads = 0;
+    unsigned long long progressStart = 0;
+    unsigned long long progressEnd = 0;
+    std::map<std::string, CollectionProgress> progressByNs;
+
+    void setState( const std::string& ns, const char* state ) {
+        scoped_lock lk( progressMutex );
+        CollectionProgress& p = progressByNs[ns];
+        if ( p.state == "pending" )
+            p.start = curTimeMillis64();
+        p.state = state;
+        if ( p.state == "done" )
+            p.end = curTimeMillis64();
+    }
+
+    void addCopied( const std::string& ns, long long documents, long long bytes ) {
+        scoped_lock lk( progressMutex );
+        CollectionProgress& p = progressByNs[ns];
+        p.documents += documents;
+        p.bytes += bytes;
+    }
+
+    long long bytesPerSec( long long bytes, unsigned long long millis ) {
+        return millis ? static_cast<long long>( bytes * 1000 / millis ) : 0;
+    }
+
+} // namespace
+
+    InitialSyncCloner::InitialSyncCloner( const std::string& sourceHost, int numThreads )
+        : _sourceHost( sourceHost ),
+          _numThreads( std::max( numThreads, 1 ) ),
+          _mutex( "InitialSyncCloner" ),
+          _active( 0 ),
+          _shuttingDown( false ) {
+    }
+
+    InitialSyncCloner::~InitialSyncCloner() {
+        {
+            scoped_lock lk( _mutex );
+            _shuttingDown = true;
+            _tasks.clear();
+            _workAvailable.notify_all();
+        }
+        for ( size_t i = 0; i < _workers.size(); i++ ) {
+            _workers[i]->join();
+        }
+    }
+
+    DBClientConnection* InitialSyncCloner::connect() const {
+        std::auto_ptr<DBClientConnection> conn( new DBClientConnection( false, 0, 0 ) );
+        string errmsg;
+        uassert( 17511,
+                 str::stream() << "initial sync couldn't connect to " << _sourceHost << ": "
+                               << errmsg,
+                 conn->connect( _sourceHost.c_str(), errmsg ) );
+        uassert( 17512,
+                 str::stream() << "initial sync couldn't authenticate to " << _sourceHost,
+                 !getGlobalAuthorizationManager()->isAuthEnabled() ||
+                 replAuthenticate( conn.get() ) );
+        return conn.release();
+    }
+
+    bool InitialSyncCloner::cloneDatabases( const std::list<std::string>& dbs,
+                                            std::string* errmsg ) {
+        {
+            scoped_lock lk( progressMutex );
+            progressSource = _sourceHost;
+            progressThreads = _numThreads;
+            progressStart = curTimeMillis64();
+            progressEnd = 0;
+            progressByNs.clear();
+        }
+
+        bool ok = true;
+        try {
+            _conn.reset( connect() );
+            for ( int i = 0; i < _numThreads; i++ ) {
+                _workers.push_back( boost::shared_ptr<boost::thread>(
+                    new boost::thread( boost::bind( &InitialSyncCloner::workerLoop, this, i ) ) ) );
+            }
+
+            for ( std::list<std::string>::const_iterator i = dbs.begin(); i != dbs.end(); ++i ) {
+                if ( *i == "local" )
+                    continue;
+                cloneDatabase( *i );
+            }
+            waitForIdle();
+            checkWorkers();
+        }
+        catch ( const DBException& e ) {
+            *errmsg = e.toString();
+            ok = false;
+        }
+        catch ( const std::exception& e ) {
+            *errmsg = e.what();
+            ok = false;
+        }
+
+        {
+            scoped_lock lk( progressMutex );
+            progressEnd = curTimeMillis64();
+        }
+        return ok;
+    }
+
+    void InitialSyncCloner::cloneDatabase( const std::string& db ) {
+        sethbmsg( str::stream() << "initial sync cloning db: " << db, 0 );
+
+        CloneOptions opts;
+        opts.fromDB = db;
+        opts.slaveOk = true;
+
+        list<BSONObj> toClone;
+        string errmsg;
+        uassert( 17513,
+                 str::stream() << "initial sync couldn't list the collections of " << db << ": "
+                               << errmsg,
+                 Cloner::listCollectionsToClone( _conn.get(), opts, &toClone, NULL, errmsg ) );
+
+        std::vector<std::string> large;
+        for ( list<BSONObj>::const_iterator i = toClone.begin(); i != toClone.end(); ++i ) {
+            const string ns = (*i)["name"].String();
+            const BSONObj options = i->getObjectField( "options" );
+
+            {
+                Client::WriteContext ctx( ns );
+                DurTransaction txn;
+                // The _id index is built in bulk once the data is in, see buildIndexes().
+                uassertStatusOK( userCreateNS( &txn, ctx.ctx().db(), ns, options, false, false ) );
+            }
+            {
+                scoped_lock lk( progressMutex );
+                progressByNs[ns] = CollectionProgress();
+            }
+
+            BSONObj stats;
+            long long size = 0;
+            if ( _conn->runCommand( db, BSON( "collStats" << nsToCollectionSubstring( ns ) ),
+                                    stats, QueryOption_SlaveOk ) ) {
+                size = stats["size"].safeNumberLong();
+            }
+
+            if ( _numThreads > 1 &&
+                 size > initialSyncSplitCollectionBytes &&
+                 !options["capped"].trueValue() ) {
+                large.push_back( ns );
+            }
+            else {
+                Task task;
+                task.ns = ns;
+                schedule( task );
+            }
+        }
+
+        // The small collections are already being copied, a whole one per worker.  The large
+        // ones are split between all of the workers, one after the other, so that no
+        // parallelCollectionScan cursor sits unread long enough to time out.
+        for ( size_t i = 0; i < large.size(); i++ ) {
+            waitForIdle();
+            checkWorkers();
+            cloneLargeCollection( large[i] );
+        }
+    }
+
+    void InitialSyncCloner::cloneLargeCollection( const std::string& ns ) {
+        const string db = nsToDatabase( ns );
+
+        BSONObj res;
+        BSONObj cmd = BSON( "parallelCollectionScan" << nsToCollectionSubstring( ns )
+                            << "numCursors" << _numThreads );
+        if ( !_conn->runCommand( db, cmd, res, QueryOption_SlaveOk ) ) {
+            // Sources that are too old for parallelCollectionScan can still be read whole.
+            LOG(1) << "initial sync can't split up " << ns << ": " << res << endl;
+            Task task;
+            task.ns = ns;
+            schedule( task );
+            waitForIdle();
+            checkWorkers();
+            return;
+        }
+
+        std::vector<BSONElement> cursors = res["cursors"].Array();
+        {
+            scoped_lock lk( progressMutex );
+            progressByNs[ns].parts = cursors.size();
+        }
+        setState( ns, "cloning" );
+
+        // The first batches come back with the command, the rest is read by the workers.
+        for ( size_t i = 0; i < cursors.size(); i++ ) {
+            BSONObj cursor = cursors[i].Obj()["cursor"].Obj();
+            std::vector<BSONObj> batch;
+            BSONObjIterator it( cursor["firstBatch"].Obj() );
+            while ( it.more() ) {
+                batch.push_back( it.next().Obj().getOwned() );
+            }
+            insertBatch( ns, batch );
+
+            Task task;
+            task.ns = ns;
+            task.cursorId = cursor["id"].numberLong();
+            if ( task.cursorId != 0 )
+                schedule( task );
+        }
+        waitForIdle();
+        checkWorkers();
+
+        setState( ns, "indexing" );
+        buildIndexes( _conn.get(), ns );
+        setState( ns, "done" );
+    }
+
+    void InitialSyncCloner::copy( DBClientBase* conn, const Task& task ) {
+        auto_ptr<DBClientCursor> cursor;
+        if ( task.cursorId ) {
+            cursor.reset( new DBClientCursor( conn, task.ns, task.cursorId, 0,
+                                              QueryOption_SlaveOk ) );
+        }
+        else {
+            setState( task.ns, "cloning" );
+            cursor = conn->query( task.ns, Query(), 0, 0, 0,
+                                  QueryOption_SlaveOk | QueryOption_NoCursorTimeout );
+            int32_t errCode;
+            string errmsg;
+            uassert( 17514,
+                     str::stream() << "initial sync couldn't read " << task.ns << ": " << errmsg,
+                     Cloner::validateQueryResults( cursor, &errCode, errmsg ) );
+        }
+
+        std::vector<BSONObj> batch;
+        while ( cursor->more() ) {
+            batch.clear();
+            while ( cursor->moreInCurrentBatch() ) {
+                batch.push_back( cursor->nextSafe().getOwned() );
+            }
+            insertBatch( task.ns, batch );
+        }
+
+        if ( task.cursorId == 0 ) {
+            setState( task.ns, "indexing" );
+            buildIndexes( conn, task.ns );
+            setState( task.ns, "done" );
+        }
+    }
+
+    void InitialSyncCloner::insertBatch( const std::string& ns,
+                                         const std::vector<BSONObj>& batch ) {
+        if ( batch.empty() )
+            return;
+
+        long long bytes = 0;
+        long long documents = 0;
+        {
+            Client::WriteContext ctx( ns );
+            DurTransaction txn;
+            Collection* collection = ctx.ctx().db()->getCollection( ns );
+            uassert( 17515, str::stream() << "collection dropped during initial sync [" << ns << "]",
+                     collection );
+
+            for ( size_t i = 0; i < batch.size(); i++ ) {
+                const BSONObj& obj = batch[i];
+
+                /* assure object is valid.  note this will slow us down a little. */
+                const Status status = validateBSON( obj.objdata(), obj.objsize() );
+                if ( !status.isOK() ) {
+                    warning() << "initial sync: skipping corrupt object from " << ns
+                              << ": " << status.reason() << endl;
+                    continue;
+                }
+
+                StatusWith<DiskLoc> loc = collection->insertDocument( &txn, obj, true );
+                if ( !loc.isOK() ) {
+                    error() << "error: exception cloning object in " << ns
+                            << ' ' << loc.toString() << " obj:" << obj << endl;
+                }
+                uassertStatusOK( loc.getStatus() );
+                txn.commitIfNeeded();
+
+                bytes += obj.objsize();
+                documents++;
+            }
+        }
+        addCopied( ns, documents, bytes );
+    }
+
+    void InitialSyncCloner::buildIndexes( DBClientBase* conn, const std::string& ns ) {
+        // Read the specs before locking, while nothing has to wait for the network.
+        std::vector<BSONObj> specs;
+        auto_ptr<DBClientCursor> cursor =
+            conn->query( nsToDatabase( ns ) + ".system.indexes", BSON( "ns" << ns ), 0, 0, 0,
+                         QueryOption_SlaveOk );
+        while ( cursor.get() && cursor->more() ) {
+            BSONObj spec = cursor->nextSafe();
+            BSONObj key = spec.getObjectField( "key" );
+            if ( spec["unique"].trueValue() ||
+                 IndexNames::findPluginName( key ) != IndexNames::BTREE ||
+                 ( key.nFields() == 1 && str::equals( key.firstElementFieldName(), "_id" ) ) ) {
+                continue;
+            }
+
+            // Like the Cloner, drop "v" so that v:0 indexes are upgraded to v:1.
+            specs.push_back( spec.removeField( "v" ).getOwned() );
+        }
+
+        Client::WriteContext ctx( ns );
+        DurTransaction txn;
+        Collection* collection = ctx.ctx().db()->getCollection( ns );
+        if ( !collection )
+            return;
+
+        if ( !collection->getIndexCatalog()->haveIdIndex() ) {
+            /* we need dropDups to be true as we didn't do a true snapshot and this is before
+               applying oplog operations that occur during the initial sync.  It is asked for in
+               the spec rather than through inDBRepair, which is global and read by the other
+               workers' index builds.  Capped collections can't drop documents.
+               */
+            BSONObjBuilder b;
+            b.append( "name", "_id_" );
+            b.append( "ns", ns );
+            b.append( "key", BSON( "_id" << 1 ) );
+            if ( !collection->isCapped() )
+                b.appendBool( "dropDups", true );
+            Status status = collection->getIndexCatalog()->createIndex( &txn, b.obj(), false );
+            if ( !status.isOK() && status.code() != ErrorCodes::IndexAlreadyExists ) {
+                uassertStatusOK( status );
+            }
+        }
+
+        // Unique and special indexes wait for the index pass that follows the first oplog
+        // application; it skips over the ones built here.
+        for ( size_t i = 0; i < specs.size(); i++ ) {
+            Status status = collection->getIndexCatalog()->createIndex( &txn, specs[i], false );
+            if ( status.code() == ErrorCodes::IndexAlreadyExists ) {
+                // no-op
+            }
+            else if ( !status.isOK() ) {
+                error() << "error creating index during initial sync, spec: " << specs[i]
+                        << " error: " << status.toString() << endl;
+                uassertStatusOK( status );
+            }
+            txn.commitIfNeeded();
+        }
+    }
+
+    void InitialSyncCloner::schedule( const Task& task ) {
+        scoped_lock lk( _mutex );
+        _tasks.push_back( task );
+        _workAvailable.notify_one();
+    }
+
+    void InitialSyncCloner::waitForIdle() {
+        scoped_lock lk( _mutex );
+        while ( !_tasks.empty() || _active > 0 ) {
+            _idle.wait( lk.boost() );
+        }
+    }
+
+    void InitialSyncCloner::checkWorkers() {
+        scoped_lock lk( _mutex );
+        uassert( 17516, _error, _error.empty() );
+    }
+
+    void InitialSyncCloner::workerLoop( int id ) {
+        const string threadName = str::stream() << "initialSyncClone" << id;
+        Client::initThread( threadName.c_str() );
+        replLocalAuth();
+
+        boost::scoped_ptr<DBClientConnection> conn;
+        while ( true ) {
+            Task task;
+            {
+                scoped_lock lk( _mutex );
+                while ( _tasks.empty() && !_shuttingDown ) {
+                    _workAvailable.wait( lk.boost() );
+                }
+                if ( _shuttingDown )
+                    break;
+                task = _tasks.front();
+                _tasks.pop_front();
+                _active++;
+            }
+
+            string error;
+            try {
+                {
+                    // Once one task has failed the sync is going to be retried, so don't
+                    // bother with the rest.
+                    scoped_lock lk( _mutex );
+                    if ( !_error.empty() )
+                        task.ns.clear();
+                }
+                if ( !task.ns.empty() ) {
+                    if ( !conn )
+                        conn.reset( connect() );
+                    copy( conn.get(), task );
+                }
+            }
+            catch ( const DBException& e ) {
+                error = str::stream() << "error cloning " << task.ns << ": " << e.toString();
+            }
+            catch ( const std::exception& e ) {
+                error = str::stream() << "error cloning " << task.ns << ": " << e.what();
+            }
+
+            scoped_lock lk( _mutex );
+            if ( !error.empty() ) {
+                log() << "initial sync: " << error << rsLog;
+                if ( _error.empty() )
+                    _error = error;
+                // The connection may be in the middle of a reply.
+                conn.reset();
+            }
+            _active--;
+            if ( _tasks.empty() && _active == 0 )
+                _idle.notify_all();
+        }
+
+        cc().shutdown();
+    }
+
+    void InitialSyncCloner::appendProgress( BSONObjBuilder* b ) {
+        scoped_lock lk( progressMutex );
+        if ( !progressStart )
+            return;
+
+        const unsigned long long end = progressEnd ? progressEnd : curTimeMillis64();
+        long long documents = 0;
+        long long bytes = 0;
+        int pending = 0;
+        int done = 0;
+
+        BSONArrayBuilder collections;
+        size_t reported = 0;
+        for ( std::map<std::string, CollectionProgress>::const_iterator it = progressByNs.begin();
+              it != progressByNs.end();
+              ++it ) {
+            const CollectionProgress& p = it->second;
+            documents += p.documents;
+            bytes += p.bytes;
+            if ( p.state == "pending" ) {
+                pending++;
+                continue;
+            }
+            if ( p.state == "done" )
+                done++;
+            if ( reported++ >= kMaxCollectionsReported )
+                continue;
+
+            const unsigned long long elapsed = ( p.end ? p.end : end ) - p.start;
+            BSONObjBuilder c( collections.subobjStart() );
+            c.append( "ns", it->first );
+            c.append( "state", p.state );
+            c.append( "documents", p.documents );
+            c.append( "bytes", p.bytes );
+            c.append( "parts", p.parts );
+            c.append( "elapsedMillis", static_cast<long long>( elapsed ) );
+            c.append( "bytesPerSec", bytesPerSec( p.bytes, elapsed ) );
+            c.done();
+        }
+
+        const unsigned long long elapsed = end - progressStart;
+        BSONObjBuilder s( b->subobjStart( "initialSyncStatus" ) );
+        s.append( "source", progressSource );
+        s.append( "threads", progressThreads );
+        s.append( "inProgress", progressEnd == 0 );
+        s.append( "elapsedMillis", static_cast<long long>( elapsed ) );
+        s.append( "documentsCopied", documents );
+        s.append( "bytesCopied", bytes );
+        s.append( "bytesPerSec", bytesPerSec( bytes, elapsed ) );
+        s.append( "collectionsPending", pending );
+        s.append( "collectionsDone", done );
+        s.append( "collections", collections.arr() );
+        s.done();
+    }
+
+} // namespace replset
+} // namespace mongo
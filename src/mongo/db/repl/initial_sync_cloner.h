@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+namespace replset {
+
+    // Number of connections, and threads, that initial sync copies data with.
+    extern int initialSyncCloneThreads;
+
+    // Collections of more than this many bytes are copied by all of the threads together.
+    extern long long initialSyncSplitCollectionBytes;
+
+    /**
+     * Copies the data of every database but local from the sync source for initial sync, over
+     * several connections at once.
+     *
+     * Collections are copied concurrently, one per worker thread.  A collection of more than
+     * initialSyncSplitCollectionBytes is instead copied by all of the workers together, each
+     * draining one cursor of a parallelCollectionScan of it.  As soon as a collection's data is in,
+     * its _id index and its non-unique btree indexes are built in bulk.  Unique and special
+     * indexes can fail on the not yet consistent copy, so those are left to the index pass that
+     * follows the first oplog application, as before.
+     *
+     * Progress is reported by appendProgress(), for replSetGetStatus.
+     */
+    class InitialSyncCloner {
+        MONGO_DISALLOW_COPYING(InitialSyncCloner);
+    public:
+        InitialSyncCloner(const std::string& sourceHost, int numThreads);
+        ~InitialSyncCloner();
+
+        /**
+         * Copies the collections of 'dbs', which must already be empty here, and their indexes as
+         * described above.  Returns false and sets 'errmsg' if that fails.
+         */
+        bool cloneDatabases(const std::list<std::string>& dbs, std::string* errmsg);
+
+        /**
+         * Appends the progress of the current, or else the last, initial sync copy as
+         * 'initialSyncStatus'.  Appends nothing if there hasn't been one.
+         */
+        static void appendProgress(BSONObjBuilder* b);
+
+    private:
+        /** A collection, or one parallelCollectionScan cursor of one, to copy. */
+        struct Task {
+            Task() : cursorId(0) {}
+
+            std::string ns;
+            long long cursorId; // 0 to read the whole collection
+        };
+
+        // Opens and authenticates a connection to the sync source.  Throws on failure.
+        DBClientConnection* connect() const;
+
+        // Creates the collections of 'db' and queues or splits up their copying.
+        void cloneDatabase(const std::string& db);
+
+        // Copies a collection of more than initialSyncSplitCollectionBytes with every worker.
+        void cloneLargeCollection(const std::string& ns);
+
+        void copy(DBClientBase* conn, const Task& task);
+        void insertBatch(const std::string& ns, const std::vector<BSONObj>& batch);
+        void buildIndexes(DBClientBase* conn, const std::string& ns);
+
+        void schedule(const Task& task);
+        void waitForIdle();
+        void workerLoop(int id);
+
+        // Throws the first error that a worker ran into, if any.
+        void checkWorkers();
+
+        const std::string _sourceHost;
+        const int _numThreads;
+
+        // For the work that isn't done by the workers.
+        boost::scoped_ptr<DBClientConnection> _conn;
+
+        // Guards the members that follow it.
+        mongo::mutex _mutex;
+        boost::condition _workAvailable;
+        boost::condition _idle;
+        std::deque<Task> _tasks;
+        int _active; // tasks being run
+        bool _shuttingDown;
+        std::string _error; // the first error a worker ran into
+
+        std::vector<boost::shared_ptr<boost::thread> > _workers;
+    };
+
+} // namespace replset
+} // namespace mongo
@@ -52,6 +52,7 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/repl_settings.h"
+#include "mongo/db/repl/rollback_undo_log.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/write_concern.h"
 #include "mongo/db/stats/counters.h"
@@ -198,6 +199,38 @@ namespace mongo {
         BSONObj _oField;
     };
 
+    static void _openOplogRS(TransactionExperiment* txn) {
+        if ( localOplogRSCollection == 0 ) {
+            Client::Context ctx(rsoplog, storageGlobalParams.dbpath);
+            localDB = ctx.db();
+            verify( localDB );
+            localOplogRSCollection = localDB->getCollection( txn, rsoplog );
+            massert(13347, "local.oplog.rs missing. did you drop it? if so restart server", localOplogRSCollection);
+        }
+    }
+
+    static void _setLastOpWrittenRS(Client::Context& ctx, const OpTime& ts, long long hashNew) {
+        /* todo: now() has code to handle clock skew.  but if the skew server to server is large it will get unhappy.
+           this code (or code in now() maybe) should be improved.
+        */
+        if( theReplSet ) {
+            if( !(theReplSet->lastOpTimeWritten<ts) ) {
+                log() << "replication oplog stream went back in time. previous timestamp: "
+                      << theReplSet->lastOpTimeWritten << " newest timestamp: " << ts
+                      << ". attempting to sync directly from primary." << endl;
+                std::string errmsg;
+                BSONObjBuilder result;
+                if (!theReplSet->forceSyncFrom(theReplSet->box.getPrimary()->fullName(),
+                                               errmsg, result)) {
+                    log() << "Can't sync from primary: " << errmsg << endl;
+                }
+            }
+            theReplSet->lastOpTimeWritten = ts;
+            theReplSet->lastH = hashNew;
+            ctx.getClient()->setLastOp( ts );
+        }
+    }
+
     /* we write to local.oplog.rs:
          { ts : ..., h: ..., v: ..., op: ..., etc }
        ts: an OpTime timestamp
@@ -278,38 +311,76 @@ namespace mongo {
 
         DEV verify( logNS == 0 ); // check this was never a master/slave master
 
-        if ( localOplogRSCollection == 0 ) {
-            Client::Context ctx(rsoplog, storageGlobalParams.dbpath);
-            localDB = ctx.db();
-            verify( localDB );
-            localOplogRSCollection = localDB->getCollection( txn, rsoplog );
-            massert(13347, "local.oplog.rs missing. did you drop it? if so restart server", localOplogRSCollection);
-        }
+        _openOplogRS( txn );
 
         Client::Context ctx(rsoplog, localDB);
         OplogDocWriter writer( partial, obj );
         checkOplogInsert( localOplogRSCollection->insertDocument( txn, &writer, false ) );
 
-        /* todo: now() has code to handle clock skew.  but if the skew server to server is large it will get unhappy.
-           this code (or code in now() maybe) should be improved.
-        */
-        if( theReplSet ) {
-            if( !(theReplSet->lastOpTimeWritten<ts) ) {
-                log() << "replication oplog stream went back in time. previous timestamp: "
-                      << theReplSet->lastOpTimeWritten << " newest timestamp: " << ts
-                      << ". attempting to sync directly from primary." << endl;
-                std::string errmsg;
-                BSONObjBuilder result;
-                if (!theReplSet->forceSyncFrom(theReplSet->box.getPrimary()->fullName(),
-                                               errmsg, result)) {
-                    log() << "Can't sync from primary: " << errmsg << endl;
-                }
-            }
-            theReplSet->lastOpTimeWritten = ts;
-            theReplSet->lastH = hashNew;
-            ctx.getClient()->setLastOp( ts );
+        _setLastOpWrittenRS( ctx, ts, hashNew );
+    }
+
+    /* like _logOpRS for a run of ops of the same type and namespace, with no o2 or b fields.
+       the entries get consecutive optimes and are written with one reservation in the oplog,
+       so newOpMutex and the capped allocator are taken once per run rather than once per op.
+    */
+    static void _logOpsRS(TransactionExperiment* txn,
+                          const char *opstr,
+                          const char *ns,
+                          const std::vector<BSONObj>& objs,
+                          bool fromMigrate ) {
+        Lock::DBWrite lk1("local");
+
+        if ( strncmp(ns, "local.", 6) == 0 ) {
+            if ( strncmp(ns, "local.slaves", 12) == 0 )
+                resetSlaveCache();
+            return;
+        }
+
+        mutex::scoped_lock lk2(newOpMutex);
+
+        verify( theReplSet );
+        if (!theReplSet->box.getState().primary()) {
+            log() << "replSet error : logOps() but not primary";
+            fassertFailed(17536);
+        }
+
+        std::vector<OplogDocWriter> writers;
+        writers.reserve( objs.size() );
+
+        OpTime ts;
+        long long hashNew = theReplSet->lastH;
+        for ( size_t i = 0; i < objs.size(); i++ ) {
+            ts = getNextGlobalOptime();
+            hashNew = (hashNew * 131 + ts.asLL()) * 17 + theReplSet->selfId();
+
+            BSONObjBuilder b;
+            b.appendTimestamp("ts", ts.asDate());
+            b.append("h", hashNew);
+            b.append("v", OPLOG_VERSION);
+            b.append("op", opstr);
+            b.append("ns", ns);
+            if (fromMigrate)
+                b.appendBool("fromMigrate", true);
+            writers.push_back( OplogDocWriter( b.obj(), objs[i] ) );
         }
+        newOptimeNotifier.notify_all();
+
+        std::vector<const DocWriter*> docs;
+        docs.reserve( writers.size() );
+        for ( size_t i = 0; i < writers.size(); i++ )
+            docs.push_back( &writers[i] );
+
+        _openOplogRS( txn );
+
+        Client::Context ctx(rsoplog, localDB);
+        std::vector<DiskLoc> locs;
+        Status status = localOplogRSCollection->insertDocuments( txn, docs, false, &locs );
+        massert( 17519,
+                 str::stream() << "write to oplog failed: " << status.toString(),
+                 status.isOK() );
 
+        _setLastOpWrittenRS( ctx, ts, hashNew );
     }
 
     static void _logOpOld(TransactionExperiment* txn,
@@ -416,9 +487,16 @@ namespace mongo {
                const BSONObj& obj,
                BSONObj* patt,
                bool* b,
-               bool fromMigrate) {
+               bool fromMigrate,
+               const BSONObj* preImage) {
         if ( replSettings.master ) {
             _logOp(txn, opstr, ns, 0, obj, patt, b, fromMigrate);
+
+            // the client's last op is the entry just written
+            if ( preImage && _logOp == _logOpRS && strncmp(ns, "local.", 6) != 0 &&
+                 replset::RollbackUndoLog::enabled() ) {
+                replset::RollbackUndoLog::logPreImage(txn, cc().getLastOp(), ns, *preImage);
+            }
         }
 
         logOpForSharding(opstr, ns, obj, patt, fromMigrate);
@@ -431,6 +509,35 @@ namespace mongo {
 
     }
 
+    void logOps(TransactionExperiment* txn,
+                const char* opstr,
+                const char* ns,
+                const std::vector<BSONObj>& objs,
+                bool fromMigrate) {
+        if ( objs.empty() )
+            return;
+
+        if ( replSettings.master ) {
+            if ( _logOp == _logOpRS ) {
+                _logOpsRS(txn, opstr, ns, objs, fromMigrate);
+            }
+            else {
+                for ( size_t i = 0; i < objs.size(); i++ )
+                    _logOp(txn, opstr, ns, 0, objs[i], 0, 0, fromMigrate);
+            }
+        }
+
+        for ( size_t i = 0; i < objs.size(); i++ ) {
+            logOpForSharding(opstr, ns, objs[i], 0, fromMigrate);
+            getGlobalAuthorizationManager()->logOp(opstr, ns, objs[i], 0, 0);
+        }
+        logOpForDbHash(ns);
+
+        if ( strstr( ns, ".system.js" ) ) {
+            Scope::storedFuncMod(); // this is terrible
+        }
+    }
+
     void createOplog() {
         Lock::GlobalWrite lk;
 
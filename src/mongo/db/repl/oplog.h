@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 namespace mongo {
 
     class BSONObj;
@@ -66,6 +68,9 @@ namespace mongo {
        the object itself. In that case, we provide also 'fullObj' which is the
        image of the object _after_ the mutation logged here was applied.
 
+       For 'u' and 'd' records, 'preImage' may give the document as it was before the op, for
+       the rollback undo log (see rollback_undo_log.h).
+
        See _logOp() in oplog.cpp for more details.
     */
     void logOp( TransactionExperiment* txn,
@@ -74,7 +79,25 @@ namespace mongo {
                 const BSONObj& obj,
                 BSONObj *patt = NULL,
                 bool *b = NULL,
-                bool fromMigrate = false);
+                bool fromMigrate = false,
+                const BSONObj* preImage = NULL);
+
+    /**
+     * Logs 'objs' in order, as if logOp had been called for each.  On a replica set primary
+     * the entries are written to the oplog together, with consecutive optimes.  For ops that
+     * have no pattern or 'b' flag, i.e. inserts.
+     *
+     * Callers that defer logging must log before the write lock is released or the journal
+     * is committed, and keep each run within the bounds below.
+     */
+    void logOps( TransactionExperiment* txn,
+                 const char *opstr,
+                 const char *ns,
+                 const std::vector<BSONObj>& objs,
+                 bool fromMigrate = false );
+
+    const size_t logOpsMaxRunDocs = 256;
+    const int logOpsMaxRunBytes = 1024 * 1024;
 
     // Log an empty no-op operation to the local oplog
     void logKeepalive();
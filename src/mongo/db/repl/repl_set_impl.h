@@ -274,6 +274,8 @@ namespace mongo {
     private:
         bool _syncDoInitialSync_clone(Cloner &cloner, const char *master,
                                       const list<string>& dbs, bool dataPass);
+        bool _syncDoInitialSync_cloneData(const char *master, const list<string>& dbs);
+        bool _syncDoInitialSync_copyDataFiles(const char *master, BSONObj* lastOp);
         bool _syncDoInitialSync_applyToHead( replset::SyncTail& syncer, OplogReader* r ,
                                              const Member* source, const BSONObj& lastOp,
                                              BSONObj& minValidOut);
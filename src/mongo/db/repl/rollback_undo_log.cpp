@@ -0,0 +1,115 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/rollback_undo_log.h"
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/client.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+namespace replset {
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(rollbackUndoLogSizeMB, int, 0);
+
+    const char RollbackUndoLog::ns[] = "local.replset.undo";
+
+    namespace {
+
+        BSONObj idFor(const OpTime& ts) {
+            BSONObjBuilder b;
+            b.appendTimestamp("_id", ts.asDate());
+            return b.obj();
+        }
+
+    } // namespace
+
+    bool RollbackUndoLog::enabled() {
+        return rollbackUndoLogSizeMB > 0 && theReplSet;
+    }
+
+    void RollbackUndoLog::logPreImage(TransactionExperiment* txn,
+                                      const OpTime& ts,
+                                      const char* docNS,
+                                      const BSONObj& preImage) {
+        // leave room for the entry around the document.  rollback refetches whatever is missing.
+        if (preImage.objsize() > BSONObjMaxUserSize - 1024)
+            return;
+
+        Lock::DBWrite lk(ns);
+        Client::Context ctx(ns, storageGlobalParams.dbpath);
+
+        Collection* collection = ctx.db()->getCollection(txn, ns);
+        if (!collection) {
+            CollectionOptions options;
+            options.capped = true;
+            options.cappedSize = rollbackUndoLogSizeMB * 1024LL * 1024LL;
+            options.autoIndexId = CollectionOptions::YES;
+
+            log() << "replSet creating rollback undo log of size " << rollbackUndoLogSizeMB
+                  << "MB" << rsLog;
+            collection = ctx.db()->createCollection(txn, ns, options);
+            invariant(collection);
+        }
+
+        BSONObjBuilder b;
+        b.appendTimestamp("_id", ts.asDate());
+        b.append("ns", docNS);
+        b.append("o", preImage);
+
+        StatusWith<DiskLoc> loc = collection->insertDocument(txn, b.obj(), false);
+        if (!loc.isOK()) {
+            // only costs rollback its shortcut for this op
+            warning() << "replSet could not record pre-image for rollback: "
+                      << loc.getStatus().toString() << rsLog;
+        }
+    }
+
+    bool RollbackUndoLog::findPreImage(const OpTime& ts, BSONObj* preImage) {
+        Client::Context ctx(ns, storageGlobalParams.dbpath);
+        Collection* collection = ctx.db()->getCollection(ns);
+        if (!collection)
+            return false;
+
+        DiskLoc loc = Helpers::findById(collection, idFor(ts));
+        if (loc.isNull())
+            return false;
+
+        *preImage = collection->docFor(loc).getObjectField("o").getOwned();
+        return true;
+    }
+
+} // namespace replset
+} // namespace mongo
@@ -0,0 +1,80 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class OpTime;
+    class TransactionExperiment;
+
+namespace replset {
+
+    // Size of the rollback undo log in megabytes.  0, the default, turns the undo log off.
+    extern int rollbackUndoLogSizeMB;
+
+    /**
+     * A bounded log of the pre-images of the documents this member updated or deleted while
+     * primary, kept in the capped collection local.replset.undo and keyed by the optime of the
+     * oplog entry that changed each one.
+     *
+     * Rollback uses it to put the documents it must undo back the way they were at the common
+     * point, instead of fetching their current versions from the sync source one at a time.  Old
+     * pre-images age out of the capped collection, so when one that rollback needs is gone it
+     * refetches as before.
+     */
+    class RollbackUndoLog {
+    public:
+        static const char ns[];
+
+        /**
+         * True if pre-images should be recorded: the undo log is configured and this is a
+         * replica set member.
+         */
+        static bool enabled();
+
+        /**
+         * Records 'preImage', the document in 'docNS' as it was before the op logged at 'ts'.
+         * Called from logOp, with the write lock on 'docNS' held.
+         */
+        static void logPreImage(TransactionExperiment* txn,
+                                const OpTime& ts,
+                                const char* docNS,
+                                const BSONObj& preImage);
+
+        /**
+         * Finds the pre-image recorded for the op at 'ts'.  Returns false if there is none.
+         * Needs a lock on the local database.
+         */
+        static bool findPreImage(const OpTime& ts, BSONObj* preImage);
+    };
+
+} // namespace replset
+} // namespace mongo
@@ -36,12 +36,14 @@
 #include "mongo/db/cloner.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/data_file_copy.h"
 #include "mongo/db/repl/member.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/bson/optime.h"
 #include "mongo/db/repl/repl_settings.h"  // replSettings
 #include "mongo/db/repl/initial_sync.h"
+#include "mongo/db/repl/initial_sync_cloner.h"
 #include "mongo/db/storage/mmap_v1/dur_transaction.h"
 #include "mongo/db/structure/catalog/namespace_details.h"
 #include "mongo/util/mongoutils/str.h"
@@ -125,6 +127,38 @@ namespace mongo {
         return true;
     }
 
+    /**
+     * Copies the data of 'dbs' with an InitialSyncCloner, several collections at a time.  The
+     * indexes that it leaves are built by _syncDoInitialSync_clone's index pass.
+     */
+    bool ReplSetImpl::_syncDoInitialSync_cloneData(const char *master, const list<string>& dbs) {
+        string err;
+        replset::InitialSyncCloner cloner(master, replset::initialSyncCloneThreads);
+        if (!cloner.cloneDatabases(dbs, &err)) {
+            sethbmsg(str::stream() << "initial sync: error while cloning.  "
+                                   << (err.empty() ? "" : err + ".  ")
+                                   << "sleeping 5 minutes", 0);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Copies the data files of the sync source with a DataFileCopier.  Sets 'lastOp' to the
+     * source's oplog entry that the files are a snapshot as of.
+     */
+    bool ReplSetImpl::_syncDoInitialSync_copyDataFiles(const char *master, BSONObj* lastOp) {
+        string err;
+        replset::DataFileCopier copier(master);
+        if (!copier.copyDataFiles(lastOp, &err)) {
+            sethbmsg(str::stream() << "initial sync: error while copying data files.  "
+                                   << (err.empty() ? "" : err + ".  ")
+                                   << "sleeping 5 minutes", 0);
+            return false;
+        }
+        return true;
+    }
+
     void _logOpObjRS(const BSONObj& op);
 
     static void emptyOplog() {
@@ -354,6 +388,10 @@ namespace mongo {
      * three times: step 4, 6, and 8.  4 may involve refetching, 6 should not.  By the end of 6,
      * this member should have consistent data.  8 is "cosmetic," it is only to get this member
      * closer to the latest op time before it can transition to secondary state.
+     *
+     * With initialSyncFromDataFiles and a secondary sync target, steps 2 through 7 are replaced by
+     * copying the target's data files while it is fsync-locked, then applying ops from the point
+     * the copy was taken as of to the target's latest op time.
      */
     void ReplSetImpl::_syncDoInitialSync() {
         replset::InitialSync init(replset::BackgroundSync::get());
@@ -405,13 +443,39 @@ namespace mongo {
 
             sethbmsg("initial sync drop all databases", 0);
             dropAllDatabasesExceptLocal();
+        }
+
+        if (replset::initialSyncFromDataFiles && source->state().secondary()) {
+            // The copy is a consistent snapshot as of lastOp, indexes and all, so one pass over
+            // the oplog from there makes the data consistent.
+            sethbmsg("initial sync copy data files", 0);
+            if (!_syncDoInitialSync_copyDataFiles(sourceHostname.c_str(), &lastOp)) {
+                veto(source->fullName(), 600);
+                sleepsecs(300);
+                return;
+            }
+
+            sethbmsg("initial sync data files copied, starting syncup",0);
+
+            log() << "oplog sync after data file copy" << endl;
+            if (!_syncDoInitialSync_applyToHead(init, &r, source, lastOp, minValid)) {
+                return;
+            }
+
+            lastOp = minValid;
+        }
+        else {
+            if (replset::initialSyncFromDataFiles) {
+                log() << "replSet initial sync source " << sourceHostname << " is not a secondary, "
+                      << "cloning instead of copying data files" << rsLog;
+            }
 
             sethbmsg("initial sync clone all databases", 0);
 
             list<string> dbs = r.conn()->getDatabaseNames();
 
             Cloner cloner;
-            if (!_syncDoInitialSync_clone(cloner, sourceHostname.c_str(), dbs, true)) {
+            if (!_syncDoInitialSync_cloneData(sourceHostname.c_str(), dbs)) {
                 veto(source->fullName(), 600);
                 sleepsecs(300);
                 return;
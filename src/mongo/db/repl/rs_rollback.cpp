@@ -29,10 +29,12 @@
 
 #include "mongo/pch.h"
 
+#include "mongo/base/counter.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/client.h"
 #include "mongo/db/cloner.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_request.h"
@@ -40,6 +42,7 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/rollback_undo_log.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/storage/mmap_v1/dur_transaction.h"
 #include "mongo/db/structure/catalog/namespace_details.h"
@@ -86,6 +89,14 @@ namespace mongo {
 
     void incRBID();
 
+    // Documents rolled back from the local undo log, and refetched from the sync source.
+    static Counter64 undoLogDocs;
+    static ServerStatusMetricField<Counter64> displayUndoLogDocs("repl.rollback.undoLogDocs",
+                                                                &undoLogDocs);
+    static Counter64 refetchedDocs;
+    static ServerStatusMetricField<Counter64> displayRefetchedDocs("repl.rollback.refetchedDocs",
+                                                                  &refetchedDocs);
+
     class rsfatal : public std::exception {
     public:
         rsfatal(std::string m = "replica set fatal exception") : msg(m) {}
@@ -111,6 +122,10 @@ namespace mongo {
            need to refetch it once. */
         set<DocID> toRefetch;
 
+        /* for each of toRefetch, the type and optime of our oldest op on it after the common point.
+           the pre-image of that op, if the undo log kept it, is the document as of the common point. */
+        map<DocID, pair<char,OpTime> > oldestOp;
+
         /* collections to drop */
         set<string> toDrop;
 
@@ -222,6 +237,9 @@ namespace mongo {
         }
 
         h.toRefetch.insert(d);
+
+        // we scan our oplog backwards, so the last op seen on a document is its oldest
+        h.oldestOp[d] = make_pair(*op, ourObj["ts"]._opTime());
     }
 
     int getRBID(DBClientConnection*);
@@ -335,6 +353,34 @@ namespace mongo {
         bson::bo goodVersionOfObject;
     };
 
+    /* fills in goodVersions from the rollback undo log instead of the sync source: each document
+       goes back to the pre-image of our oldest op on it, or is deleted if that op inserted it.
+       returns false, with goodVersions left empty, if the undo log is off or lacks any pre-image
+       we need -- e.g. it has wrapped past the common point -- so the caller refetches them all.
+    */
+    static bool undoLogVersions(const HowToFixUp& h, list< pair<DocID,bo> >& goodVersions) {
+        if( !replset::RollbackUndoLog::enabled() )
+            return false;
+
+        for( set<DocID>::const_iterator i = h.toRefetch.begin(); i != h.toRefetch.end(); i++ ) {
+            map<DocID, pair<char,OpTime> >::const_iterator oldest = h.oldestOp.find(*i);
+            verify( oldest != h.oldestOp.end() );
+
+            // an empty version means the document didn't exist at the common point
+            bo good;
+            if( oldest->second.first != 'i' &&
+                !replset::RollbackUndoLog::findPreImage(oldest->second.second, &good) ) {
+                log() << "replSet rollback undo log has no pre-image for ns:" << i->ns
+                      << " op:" << oldest->second.second.toStringPretty()
+                      << ", refetching from the sync source instead" << rsLog;
+                goodVersions.clear();
+                return false;
+            }
+            goodVersions.push_back(pair<DocID,bo>(*i, good));
+        }
+        return true;
+    }
+
     void ReplSetImpl::syncFixUp(HowToFixUp& h, OplogReader& r) {
         DBClientConnection *them = r.conn();
         DurTransaction txn;
@@ -347,11 +393,18 @@ namespace mongo {
 
         bo newMinValid;
 
-        /* fetch all the goodVersions of each document from current primary */
+        /* take the version of each document as of the common point from the undo log if we can */
+        const bool fromUndoLog = undoLogVersions(h, goodVersions);
+        if( fromUndoLog ) {
+            log() << "replSet rollback using undo log for " << goodVersions.size() << " documents" << rsLog;
+            undoLogDocs.increment(goodVersions.size());
+        }
+
+        /* otherwise fetch all the goodVersions of each document from current primary */
         DocID d;
         unsigned long long n = 0;
         try {
-            for( set<DocID>::iterator i = h.toRefetch.begin(); i != h.toRefetch.end(); i++ ) {
+            for( set<DocID>::iterator i = h.toRefetch.begin(); !fromUndoLog && i != h.toRefetch.end(); i++ ) {
                 d = *i;
 
                 verify( !d._id.eoo() );
@@ -367,6 +420,7 @@ namespace mongo {
                     goodVersions.push_back(pair<DocID,bo>(d,good));
                 }
             }
+            refetchedDocs.increment(n);
             newMinValid = r.getLastOp(rsoplog);
             if( newMinValid.isEmpty() ) {
                 sethbmsg("rollback error newMinValid empty?");
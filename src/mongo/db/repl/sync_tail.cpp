@@ -35,10 +35,17 @@
 #include "mongo/base/counter.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/curop.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/prefetch.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/storage/mmap_v1/dur_transaction.h"
 #include "mongo/util/fail_point_service.h"
@@ -59,6 +66,230 @@ namespace replset {
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
                                                     "repl.apply.batches",
                                                     &applyBatchStats );
+
+    // Whether secondaries spread the writes to one collection over several writer threads.
+    MONGO_EXPORT_SERVER_PARAMETER(replApplyPartitionByDocument, bool, true);
+
+    /**
+     * How the batches were split between the writer threads: the ops spread out by document
+     * and by namespace, the commands and index builds applied as barriers, the ops each writer
+     * got in the last batch and in all, and how far behind its newest op the last batch was
+     * applied.
+     */
+    class ApplyPartitionMetrics : public ServerStatusMetric {
+    public:
+        ApplyPartitionMetrics() : ServerStatusMetric("repl.apply.partition"),
+                                  _mutex("ApplyPartitionMetrics"),
+                                  _byDocument(0),
+                                  _byNamespace(0),
+                                  _barriers(0),
+                                  _lagSecs(0) {
+        }
+
+        void recordBarrier() {
+            scoped_lock lk(_mutex);
+            _barriers++;
+        }
+
+        void recordWriterVectors(const std::vector< std::vector<BSONObj> >& writerVectors,
+                                 long long byDocument,
+                                 bool firstInBatch) {
+            scoped_lock lk(_mutex);
+            if (_totalOps.size() != writerVectors.size()) {
+                _totalOps.assign(writerVectors.size(), 0);
+            }
+            if (firstInBatch || _lastBatchOps.size() != writerVectors.size()) {
+                _lastBatchOps.assign(writerVectors.size(), 0);
+            }
+
+            long long total = 0;
+            for (size_t i = 0; i < writerVectors.size(); i++) {
+                _lastBatchOps[i] += writerVectors[i].size();
+                _totalOps[i] += writerVectors[i].size();
+                total += writerVectors[i].size();
+            }
+            _byDocument += byDocument;
+            _byNamespace += total - byDocument;
+        }
+
+        void recordApplied(const BSONObj& lastOp) {
+            const long long lag = static_cast<long long>(time(0)) -
+                                  lastOp["ts"]._opTime().getSecs();
+            scoped_lock lk(_mutex);
+            _lagSecs = std::max(lag, 0LL);
+        }
+
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            scoped_lock lk(_mutex);
+            BSONObjBuilder sub(b.subobjStart(_leafName));
+            sub.append("byDocument", _byDocument);
+            sub.append("byNamespace", _byNamespace);
+            sub.append("barriers", _barriers);
+            sub.append("lastBatchWriterOps", _lastBatchOps);
+            sub.append("writerOps", _totalOps);
+            sub.append("lagSecs", _lagSecs);
+            sub.done();
+        }
+
+    private:
+        mutable mongo::mutex _mutex;
+        long long _byDocument;
+        long long _byNamespace;
+        long long _barriers;
+        long long _lagSecs;
+        std::vector<long long> _lastBatchOps;
+        std::vector<long long> _totalOps;
+    };
+
+    static ApplyPartitionMetrics applyPartitionMetrics;
+
+    // How long oplogApplication() aims for a batch to take to apply, and the most ops it lets a
+    // batch have.
+    MONGO_EXPORT_SERVER_PARAMETER(replApplyBatchTargetMillis, int, 250);
+    MONGO_EXPORT_SERVER_PARAMETER(replApplyBatchMaxOperations, int, 50000);
+
+    /**
+     * The current batch limits of oplogApplication(), how long its last batch took to apply,
+     * and how often the next batch was, or wasn't yet, ready when it was done with one.
+     */
+    class ApplyPipelineMetrics : public ServerStatusMetric {
+    public:
+        ApplyPipelineMetrics() : ServerStatusMetric("repl.apply.pipeline"),
+                                 _mutex("ApplyPipelineMetrics"),
+                                 _batchLimitOps(0),
+                                 _batchLimitBytes(0),
+                                 _lastBatchMillis(0),
+                                 _batchesReady(0),
+                                 _batchesWaitedFor(0) {
+        }
+
+        void recordBatchWaiting(bool ready) {
+            scoped_lock lk(_mutex);
+            if (ready) {
+                _batchesReady++;
+            }
+            else {
+                _batchesWaitedFor++;
+            }
+        }
+
+        void recordBatch(int applyMillis, unsigned int limitOps, unsigned int limitBytes) {
+            scoped_lock lk(_mutex);
+            _lastBatchMillis = applyMillis;
+            _batchLimitOps = limitOps;
+            _batchLimitBytes = limitBytes;
+        }
+
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            scoped_lock lk(_mutex);
+            BSONObjBuilder sub(b.subobjStart(_leafName));
+            sub.append("batchLimitOps", _batchLimitOps);
+            sub.append("batchLimitBytes", _batchLimitBytes);
+            sub.append("lastBatchMillis", _lastBatchMillis);
+            sub.append("batchesReady", _batchesReady);
+            sub.append("batchesWaitedFor", _batchesWaitedFor);
+            sub.done();
+        }
+
+    private:
+        mutable mongo::mutex _mutex;
+        long long _batchLimitOps;
+        long long _batchLimitBytes;
+        long long _lastBatchMillis;
+        long long _batchesReady;
+        long long _batchesWaitedFor;
+    };
+
+    static ApplyPipelineMetrics applyPipelineMetrics;
+
+namespace {
+
+    /**
+     * BackgroundSync counts the ops taken off its queue until they are marked applied, and waits
+     * for that count to drop to zero before choosing a sync source or letting this member step
+     * up.  This marks a batch's ops applied if the batch is dropped before applyOpsToOplog(),
+     * which does it from then on, has been handed the batch.
+     */
+    class UnappliedBatchGuard {
+        MONGO_DISALLOW_COPYING(UnappliedBatchGuard);
+    public:
+        UnappliedBatchGuard(BackgroundSyncInterface* networkQueue, const std::deque<BSONObj>& ops)
+            : _networkQueue(networkQueue), _ops(ops), _dismissed(false) {}
+
+        ~UnappliedBatchGuard() {
+            if (!_dismissed && !_ops.empty()) {
+                _networkQueue->markApplied(_ops.size());
+            }
+        }
+
+        // Called just before applyOpsToOplog() takes over the batch.
+        void dismiss() { _dismissed = true; }
+
+    private:
+        BackgroundSyncInterface* const _networkQueue;
+        const std::deque<BSONObj>& _ops;
+        bool _dismissed;
+    };
+
+    // Commands and index builds work on whole collections or databases, so every op before one
+    // must be applied before it, and every op after it must wait for it.
+    bool isBarrier(const BSONObj& op) {
+        const char* ns = op["ns"].valuestrsafe();
+        return op["op"].valuestrsafe()[0] == 'c' ||
+               (*ns != '\0' && nsToCollectionSubstring(ns) == "system.indexes");
+    }
+
+    // Returns the _id of the one document that 'op' writes, or EOO if it isn't an insert, update
+    // or delete of a document by _id.
+    BSONElement documentIdForOp(const BSONObj& op) {
+        switch (op["op"].valuestrsafe()[0]) {
+        case 'i':
+        case 'd':
+            return op.getObjectField("o")["_id"];
+        case 'u':
+            return op.getObjectField("o2")["_id"];
+        default:
+            return BSONElement();
+        }
+    }
+
+    // A collection's writes can be applied in any order between documents, as long as each
+    // document's are applied in order, unless it is capped (the inserts must keep their order)
+    // or it has a unique index other than _id's (writes to two documents may then depend on each
+    // other, e.g. a delete that frees up a value for a later insert).
+    bool canPartitionByDocument(const std::string& ns) {
+        if (nsToCollectionSubstring(ns).startsWith("system.")) {
+            return false;
+        }
+
+        Lock::DBRead lk(ns);
+        Database* db = dbHolder().get(ns, storageGlobalParams.dbpath);
+        if (!db) {
+            // Created by this batch.  An implicitly created collection only has the _id index,
+            // and anything else would take a command, which is a barrier.
+            return true;
+        }
+        Collection* collection = db->getCollection(ns);
+        if (!collection) {
+            return true;
+        }
+        if (collection->isCapped()) {
+            return false;
+        }
+
+        IndexCatalog::IndexIterator ii =
+            collection->getIndexCatalog()->getIndexIterator(true);
+        while (ii.more()) {
+            const IndexDescriptor* desc = ii.next();
+            if (desc->unique() && !desc->isIdIndex()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
     void initializePrefetchThread() {
         if (!ClientBasic::getCurrent()) {
             Client::initThread("repl prefetch worker");
@@ -67,7 +298,9 @@ namespace replset {
     }
 
     SyncTail::SyncTail(BackgroundSyncInterface *q) :
-        Sync(""), oplogVersion(0), _networkQueue(q)
+        Sync(""), oplogVersion(0), _networkQueue(q),
+        _batchLimitOps(replBatchLimitOperations),
+        _batchLimitBytes(replBatchLimitBytes)
     {}
 
     SyncTail::~SyncTail() {}
@@ -170,9 +403,37 @@ namespace replset {
 
         // Use a ThreadPool to prefetch all the operations in a batch.
         prefetchOps(ops);
-        
-        std::vector< std::vector<BSONObj> > writerVectors(theReplSet->replWriterThreadCount);
-        fillWriterVectors(ops, &writerVectors);
+
+        applyBatch(ops, applyFunc);
+    }
+
+    void SyncTail::applyBatch( std::deque<BSONObj>& ops, MultiSyncApplyFunc applyFunc ) {
+        // Split the batch around its barriers, which are applied by themselves.
+        // tryPopAndWaitForMore already ends a batch at each one, so there is normally just the
+        // one segment.
+        std::vector< std::deque<BSONObj> > segments(1);
+        for (std::deque<BSONObj>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+            if (isBarrier(*it)) {
+                if (!segments.back().empty()) {
+                    segments.push_back(std::deque<BSONObj>());
+                }
+                segments.back().push_back(*it);
+                segments.push_back(std::deque<BSONObj>());
+                applyPartitionMetrics.recordBarrier();
+            }
+            else {
+                segments.back().push_back(*it);
+            }
+        }
+
+        std::vector< std::vector< std::vector<BSONObj> > > segmentWriterVectors(
+            segments.size(),
+            std::vector< std::vector<BSONObj> >(theReplSet->replWriterThreadCount));
+        for (size_t i = 0; i < segments.size(); i++) {
+            // The catalog is checked before anything in the batch is applied, so once a barrier
+            // has gone by it may no longer be right.
+            fillWriterVectors(segments[i], i == 0, &segmentWriterVectors[i]);
+        }
         LOG(2) << "replication batch size is " << ops.size() << endl;
         // We must grab this because we're going to grab write locks later.
         // We hold this mutex the entire time we're writing; it doesn't matter
@@ -182,12 +443,46 @@ namespace replset {
         // stop all readers until we're done
         Lock::ParallelBatchWriterMode pbwm;
 
-        applyOps(writerVectors, applyFunc);
+        for (size_t i = 0; i < segments.size(); i++) {
+            if (!segments[i].empty()) {
+                applyOps(segmentWriterVectors[i], applyFunc);
+            }
+        }
+
+        if (!ops.empty()) {
+            applyPartitionMetrics.recordApplied(ops.back());
+        }
     }
 
 
-    void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops, 
-                                              std::vector< std::vector<BSONObj> >* writerVectors) {
+    void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
+                                     bool byDocument,
+                                     std::vector< std::vector<BSONObj> >* writerVectors) {
+        // The namespaces whose ops are spread out by _id.  Every op on one in this batch must
+        // name the single document it writes, or they can't be told apart.
+        std::map<std::string, bool> partitioned;
+        if (byDocument && replApplyPartitionByDocument && writerVectors->size() > 1) {
+            for (std::deque<BSONObj>::const_iterator it = ops.begin();
+                 it != ops.end();
+                 ++it) {
+                const std::string ns = it->getStringField("ns");
+                if (documentIdForOp(*it).eoo()) {
+                    partitioned[ns] = false;
+                }
+                else {
+                    partitioned.insert(std::make_pair(ns, true));
+                }
+            }
+            for (std::map<std::string, bool>::iterator it = partitioned.begin();
+                 it != partitioned.end();
+                 ++it) {
+                if (it->second) {
+                    it->second = canPartitionByDocument(it->first);
+                }
+            }
+        }
+
+        long long byDocumentOps = 0;
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -198,8 +493,22 @@ namespace replset {
             uint32_t hash = 0;
             MurmurHash3_x86_32( ns, len, 0, &hash);
 
+            if (!partitioned.empty()) {
+                std::map<std::string, bool>::const_iterator p = partitioned.find(ns);
+                if (p != partitioned.end() && p->second) {
+                    // Numbers that compare equal hash the same, like they index the same.
+                    const long long idHash =
+                        BSONElementHasher::hash64(documentIdForOp(*it),
+                                                  BSONElementHasher::DEFAULT_HASH_SEED);
+                    MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+                    byDocumentOps++;
+                }
+            }
+
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
+
+        applyPartitionMetrics.recordWriterVectors(*writerVectors, byDocumentOps, byDocument);
     }
 
 
@@ -221,6 +530,7 @@ namespace replset {
 
         while( ts < minValid ) {
             OpQueue ops;
+            UnappliedBatchGuard unappliedGuard(_networkQueue, ops.getDeque());
 
             while (ops.getSize() < replBatchLimitBytes) {
                 if (tryPopAndWaitForMore(&ops)) {
@@ -256,6 +566,7 @@ namespace replset {
             // we want to keep a record of the last op applied, to compare with minvalid
             lastOp = ops.getDeque().back();
             OpTime tempTs = lastOp["ts"]._opTime();
+            unappliedGuard.dismiss();
             applyOpsToOplog(&ops.getDeque());
 
             ts = tempTs;
@@ -282,86 +593,292 @@ namespace replset {
         }
     }
 
+    SyncTail::OpQueueBatcher::OpQueueBatcher(SyncTail* syncTail)
+        : _syncTail(syncTail),
+          _haveReady(false),
+          _numHeld(0),
+          _numPopAttempts(0),
+          _maxOps(syncTail->_batchLimitOps),
+          _maxBytes(syncTail->_batchLimitBytes),
+          _shutdown(false),
+          _thread(boost::bind(&OpQueueBatcher::run, this)) {
+    }
+
+    SyncTail::OpQueueBatcher::~OpQueueBatcher() {
+        {
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _shutdown = true;
+            _cv.notify_all();
+        }
+        _thread.join();
+    }
+
+    bool SyncTail::OpQueueBatcher::getNextBatch(OpQueue* ops, int maxWaitMillis) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        const bool wasReady = _haveReady;
+        if (!_haveReady) {
+            _cv.timed_wait(lock, boost::posix_time::milliseconds(maxWaitMillis));
+        }
+        uassert(17517, str::stream() << "replSet batcher failed: " << _error, _error.empty());
+        if (!_haveReady) {
+            return false;
+        }
+        applyPipelineMetrics.recordBatchWaiting(wasReady);
+
+        *ops = _ready;
+        _ready = OpQueue();
+        _haveReady = false;
+        _cv.notify_all();
+        return true;
+    }
+
+    void SyncTail::OpQueueBatcher::setLimits(unsigned int maxOps, unsigned int maxBytes) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _maxOps = maxOps;
+        _maxBytes = maxBytes;
+    }
+
+    bool SyncTail::OpQueueBatcher::isIdle() {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (_haveReady || _numHeld > 0 || !_error.empty()) {
+            return false;
+        }
+        BSONObj op;
+        if (_syncTail->peek(&op)) {
+            return false;
+        }
+
+        // The thread may have consumed the last op after it last told us what it holds.  Once it
+        // has gone round again, anything it took before our peek is counted in _numHeld.
+        const unsigned long long numPopAttempts = _numPopAttempts;
+        while (_numPopAttempts == numPopAttempts) {
+            if (!_popCv.timed_wait(lock, boost::posix_time::seconds(2))) {
+                return false;
+            }
+        }
+        return !_haveReady && _numHeld == 0;
+    }
+
+    bool SyncTail::OpQueueBatcher::batchIsFull(const OpQueue& ops,
+                                               const Timer& batchTimer,
+                                               unsigned int maxOps,
+                                               unsigned int maxBytes) {
+        if (ops.empty()) {
+            return false;
+        }
+
+        // apply replication batch limits
+        if (batchTimer.seconds() > replBatchLimitSeconds)
+            return true;
+        if (ops.getDeque().size() >= maxOps)
+            return true;
+        if (ops.getSize() >= maxBytes)
+            return true;
+
+        const int slaveDelaySecs = theReplSet->myConfig().slaveDelay;
+        if (slaveDelaySecs > 0) {
+            const BSONObj& lastOp = ops.getDeque().back();
+            const unsigned int opTimestampSecs = lastOp["ts"]._opTime().getSecs();
+
+            // Stop the batch as the lastOp is too new to be applied. If we continue
+            // on, we can get ops that are way ahead of the delay and this will
+            // make this thread sleep longer when handleSlaveDelay is called
+            // and apply ops much sooner than we like.
+            if (opTimestampSecs > static_cast<unsigned int>(time(0) - slaveDelaySecs)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void SyncTail::OpQueueBatcher::run() {
+        Client::initThread("rsSyncBatcher");
+        replLocalAuth();
+
+        try {
+            gatherBatches();
+        }
+        catch (const DBException& e) {
+            // Handed to the applier, which gives up on this round of syncing like it would
+            // have had it gathered the batch itself.
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _error = e.toString();
+            _cv.notify_all();
+        }
+
+        {
+            // A batch nobody came for is dropped with the batcher.
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            if (_haveReady) {
+                _syncTail->_networkQueue->markApplied(_ready.getDeque().size());
+                _haveReady = false;
+            }
+        }
+        cc().shutdown();
+    }
+
+    void SyncTail::OpQueueBatcher::gatherBatches() {
+        while (true) {
+            unsigned int maxOps;
+            unsigned int maxBytes;
+            {
+                boost::unique_lock<boost::mutex> lock(_mutex);
+                if (_shutdown) {
+                    return;
+                }
+                maxOps = _maxOps;
+                maxBytes = _maxBytes;
+            }
+
+            OpQueue ops;
+            Timer batchTimer;
+            try {
+                // keep fetching more ops as long as we haven't filled up a full batch yet
+                while (!batchIsFull(ops, batchTimer, maxOps, maxBytes)) {
+                    // tryPopAndWaitForMore returns true when we need to end a batch early
+                    const bool endBatch = _syncTail->tryPopAndWaitForMore(&ops);
+                    {
+                        boost::unique_lock<boost::mutex> lock(_mutex);
+                        _numHeld = ops.getDeque().size();
+                        ++_numPopAttempts;
+                        _popCv.notify_all();
+                    }
+                    if (endBatch) {
+                        break;
+                    }
+                    if (ops.empty()) {
+                        // Nothing came within a second; see whether we are still wanted.
+                        break;
+                    }
+                }
+            }
+            catch (...) {
+                _syncTail->_networkQueue->markApplied(ops.getDeque().size());
+                throw;
+            }
+            if (ops.empty()) {
+                continue;
+            }
+
+            // Readers are shut out while the batch before is applied, so this mostly waits
+            // for that to be done, then gets ahead of this batch's page faults while the
+            // batch before is logged and the applier catches up.
+            _syncTail->prefetchOps(ops.getDeque());
+
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            while (_haveReady && !_shutdown) {
+                _cv.wait(lock);
+            }
+            if (_shutdown) {
+                // Only happens when oplogApplication() gives up on syncing, see there.
+                _syncTail->_networkQueue->markApplied(ops.getDeque().size());
+                _numHeld = 0;
+                return;
+            }
+            _ready = ops;
+            _haveReady = true;
+            _numHeld = 0;
+            _cv.notify_all();
+        }
+    }
+
+    void SyncTail::adjustBatchLimits(size_t numOps, size_t numBytes, int applyMillis) {
+        const int target = std::max(replApplyBatchTargetMillis, 1);
+        const unsigned int maxOps =
+            std::max(static_cast<unsigned int>(replApplyBatchMaxOperations), kMinBatchOperations);
+
+        if (applyMillis > target) {
+            // Too slow: shrink in proportion, so the next batch takes about the target time.
+            _batchLimitOps = std::max(
+                static_cast<unsigned int>(static_cast<long long>(_batchLimitOps) * target /
+                                          applyMillis),
+                kMinBatchOperations);
+            _batchLimitBytes = std::max(
+                static_cast<unsigned int>(static_cast<long long>(_batchLimitBytes) * target /
+                                          applyMillis),
+                kMinBatchBytes);
+        }
+        else if (applyMillis < target / 2 &&
+                 (numOps >= _batchLimitOps || numBytes >= _batchLimitBytes)) {
+            // A batch that was cut short by a limit went quickly: let the next ones be bigger.
+            _batchLimitOps = std::min(_batchLimitOps * 2, maxOps);
+            _batchLimitBytes = static_cast<unsigned int>(
+                std::min(static_cast<unsigned long long>(_batchLimitBytes) * 2,
+                         static_cast<unsigned long long>(replBatchLimitBytes)));
+        }
+        _batchLimitOps = std::min(_batchLimitOps, maxOps);
+
+        applyPipelineMetrics.recordBatch(applyMillis, _batchLimitOps, _batchLimitBytes);
+    }
+
     /* tail an oplog.  ok to return, will be re-called. */
     void SyncTail::oplogApplication() {
-        while( 1 ) {
-            OpQueue ops;
+        // Gathers and prefetches the next batch while this thread applies the current one.
+        OpQueueBatcher batcher(this);
+
+        Timer checkTimer;
+        int lastTimeChecked = -1;
 
+        while( 1 ) {
             verify( !Lock::isLocked() );
 
-            Timer batchTimer;
-            int lastTimeChecked = 0;
+            // occasionally check some things
+            int now = checkTimer.seconds();
+            if (now > lastTimeChecked) {
+                lastTimeChecked = now;
 
-            do {
                 if (theReplSet->isPrimary()) {
-                    massert(16620, "there are ops to sync, but I'm primary", ops.empty());
+                    // BackgroundSync waits for every op it handed out to be applied before
+                    // letting us become primary, so the batcher has nothing.
+                    BSONObj op;
+                    massert(16620, "there are ops to sync, but I'm primary", !peek(&op));
                     return;
                 }
 
-                int now = batchTimer.seconds();
-
-                // apply replication batch limits
-                if (!ops.empty()) {
-                    if (now > replBatchLimitSeconds)
-                        break;
-                    if (ops.getDeque().size() > replBatchLimitOperations)
-                        break;
-                }
-                // occasionally check some things
-                // (always checked in the first iteration of this do-while loop, because
-                // ops is empty)
-                if (ops.empty() || now > lastTimeChecked) {
-                    {
-                        boost::unique_lock<boost::mutex> lock(theReplSet->initialSyncMutex);
-                        if (theReplSet->initialSyncRequested) {
-                            // got a resync command
-                            return;
-                        }
-                    }
-                    lastTimeChecked = now;
-                    // can we become secondary?
-                    // we have to check this before calling mgr, as we must be a secondary to
-                    // become primary
-                    if (!theReplSet->isSecondary()) {
-                        OpTime minvalid;
-                        theReplSet->tryToGoLiveAsASecondary(minvalid);
+                {
+                    boost::unique_lock<boost::mutex> lock(theReplSet->initialSyncMutex);
+                    if (theReplSet->initialSyncRequested) {
+                        // got a resync command
+                        return;
                     }
+                }
+                // can we become secondary?
+                // we have to check this before calling mgr, as we must be a secondary to
+                // become primary
+                if (!theReplSet->isSecondary()) {
+                    OpTime minvalid;
+                    theReplSet->tryToGoLiveAsASecondary(minvalid);
+                }
 
-                    // normally msgCheckNewState gets called periodically, but in a single node
-                    // replset there are no heartbeat threads, so we do it here to be sure.  this is
-                    // relevant if the singleton member has done a stepDown() and needs to come back
-                    // up.
-                    if (theReplSet->config().members.size() == 1 &&
-                        theReplSet->myConfig().potentiallyHot()) {
-                        Manager* mgr = theReplSet->mgr;
-                        // When would mgr be null?  During replsettest'ing, in which case we should
-                        // fall through and actually apply ops as if we were a real secondary.
-                        if (mgr) { 
-                            mgr->send(boost::bind(&Manager::msgCheckNewState, theReplSet->mgr));
-                            sleepsecs(1);
-                            // There should never be ops to sync in a 1-member set, anyway
-                            return;
-                        }
+                // normally msgCheckNewState gets called periodically, but in a single node
+                // replset there are no heartbeat threads, so we do it here to be sure.  this is
+                // relevant if the singleton member has done a stepDown() and needs to come back
+                // up.
+                if (theReplSet->config().members.size() == 1 &&
+                    theReplSet->myConfig().potentiallyHot()) {
+                    Manager* mgr = theReplSet->mgr;
+                    // When would mgr be null?  During replsettest'ing, in which case we should
+                    // fall through and actually apply ops as if we were a real secondary.
+                    if (mgr) { 
+                        mgr->send(boost::bind(&Manager::msgCheckNewState, theReplSet->mgr));
+                        sleepsecs(1);
+                        // There should never be ops to sync in a 1-member set, anyway
+                        return;
                     }
                 }
+            }
 
-                const int slaveDelaySecs = theReplSet->myConfig().slaveDelay;
-                if (!ops.empty() && slaveDelaySecs > 0) {
-                    const BSONObj& lastOp = ops.getDeque().back();
-                    const unsigned int opTimestampSecs = lastOp["ts"]._opTime().getSecs();
-
-                    // Stop the batch as the lastOp is too new to be applied. If we continue
-                    // on, we can get ops that are way ahead of the delay and this will
-                    // make this thread sleep longer when handleSlaveDelay is called
-                    // and apply ops much sooner than we like.
-                    if (opTimestampSecs > static_cast<unsigned int>(time(0) - slaveDelaySecs)) {
-                        break;
-                    }
+            OpQueue ops;
+            UnappliedBatchGuard unappliedGuard(_networkQueue, ops.getDeque());
+            if (!batcher.getNextBatch(&ops, 1000)) {
+                // If we're just testing (no manager), don't keep looping once the batcher has
+                // exhausted the bgqueue
+                if (!theReplSet->mgr && batcher.isIdle()) {
+                    return;
                 }
-                // keep fetching more ops as long as we haven't filled up a full batch yet
-            } while (!tryPopAndWaitForMore(&ops) && // tryPopAndWaitForMore returns true 
-                                                    // when we need to end a batch early
-                   (ops.getSize() < replBatchLimitBytes));
+                lastTimeChecked = -1;
+                continue;
+            }
 
             // For pausing replication in tests
             while (MONGO_FAIL_POINT(rsSyncApplyStop)) {
@@ -381,23 +898,24 @@ namespace replset {
                 LOG(1) << "about to apply batch up to optime: "
                        << ops.getDeque().back()["ts"]._opTime().toStringPretty();
             }
-            
-            multiApply(ops.getDeque(), multiSyncApply);
+
+            const size_t numOps = ops.getDeque().size();
+            const size_t numBytes = ops.getSize();
+            Timer applyTimer;
+
+            // The batcher has prefetched it already.
+            applyBatch(ops.getDeque(), multiSyncApply);
+
+            adjustBatchLimits(numOps, numBytes, applyTimer.millis());
+            batcher.setLimits(_batchLimitOps, _batchLimitBytes);
 
             if (BackgroundSync::get()->isAssumingPrimary()) {
                 LOG(1) << "about to update oplog to optime: "
                        << ops.getDeque().back()["ts"]._opTime().toStringPretty();
             }
             
+            unappliedGuard.dismiss();
             applyOpsToOplog(&ops.getDeque());
-
-            // If we're just testing (no manager), don't keep looping if we exhausted the bgqueue
-            if (!theReplSet->mgr) {
-                BSONObj op;
-                if (!peek(&op)) {
-                    return;
-                }
-            }
         }
     }
 
@@ -474,7 +992,8 @@ namespace replset {
     }
 
     void SyncTail::applyOpsToOplog(std::deque<BSONObj>* ops) {
-        {
+        const size_t numOps = ops->size();
+        try {
             Lock::DBWrite lk("local");
             while (!ops->empty()) {
                 const BSONObj& op = ops->front();
@@ -483,11 +1002,18 @@ namespace replset {
                 ops->pop_front();
              }
         }
+        catch (...) {
+            // Dropped with this round of syncing; don't hold up BackgroundSync for it.
+            _networkQueue->markApplied(numOps);
+            throw;
+        }
 
         if (BackgroundSync::get()->isAssumingPrimary()) {
             LOG(1) << "notifying BackgroundSync";
         }
             
+        _networkQueue->markApplied(numOps);
+
         // Update write concern on primary
         BackgroundSync::notify();
     }
@@ -28,10 +28,15 @@
 
 #pragma once
 
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <deque>
 
+#include "mongo/base/disallow_copying.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/repl/sync.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 namespace replset {
@@ -109,16 +114,92 @@ namespace replset {
         static const int replBatchLimitSeconds = 1;
         static const unsigned int replBatchLimitOperations = 5000;
 
+        // oplogApplication() adapts its batch limits to how long batches take to apply, within
+        // these and the limits above.
+        static const unsigned int kMinBatchOperations = 100;
+        static const unsigned int kMinBatchBytes = 1024 * 1024;
+
         // Prefetch and write a deque of operations, using the supplied function.
         // Initial Sync and Sync Tail each use a different function.
         void multiApply(std::deque<BSONObj>& ops, MultiSyncApplyFunc applyFunc);
 
+        // multiApply() without the prefetching, for ops that have been prefetched already.
+        void applyBatch(std::deque<BSONObj>& ops, MultiSyncApplyFunc applyFunc);
+
+        // Assigns each op to one of the writer vectors.  Ops on the same document always go to
+        // the same writer, in order.  Ops on a collection that can't be split up by document
+        // (see the definition) all go to the same writer.  'byDocument' false forces the latter
+        // for every collection.
+        void fillWriterVectors(const std::deque<BSONObj>& ops,
+                               bool byDocument,
+                               std::vector< std::vector<BSONObj> >* writerVectors);
+
         // The version of the last op to be read
         int oplogVersion;
 
     private:
+        /**
+         * Gathers the next batch from the BackgroundSync queue, and prefetches its pages, on a
+         * thread of its own while oplogApplication() applies the batch before it.
+         */
+        class OpQueueBatcher {
+            MONGO_DISALLOW_COPYING(OpQueueBatcher);
+        public:
+            explicit OpQueueBatcher(SyncTail* syncTail);
+
+            // Stops the thread, dropping the batch it has gathered if there is one.
+            ~OpQueueBatcher();
+
+            // Moves the next batch into 'ops' if one is ready within 'maxWaitMillis'.  Returns
+            // whether there was one.
+            bool getNextBatch(OpQueue* ops, int maxWaitMillis);
+
+            // Sets the limits for the batches started from now on.
+            void setLimits(unsigned int maxOps, unsigned int maxBytes);
+
+            // True if there's no batch ready, none being gathered and nothing left to gather one
+            // from.  May wait for the thread to finish its current attempt to take an op.
+            bool isIdle();
+
+        private:
+            // Whether the batch being gathered is to end before its next op.
+            static bool batchIsFull(const OpQueue& ops,
+                                    const Timer& batchTimer,
+                                    unsigned int maxOps,
+                                    unsigned int maxBytes);
+
+            void run();
+            void gatherBatches();
+
+            SyncTail* const _syncTail;
+
+            // Guards the members that follow it.
+            boost::mutex _mutex;
+            boost::condition _cv;
+            OpQueue _ready;
+            bool _haveReady;
+            size_t _numHeld; // taken off the network queue for the batch being gathered
+            unsigned long long _numPopAttempts;
+            boost::condition _popCv; // signalled after each attempt to take an op
+            unsigned int _maxOps;
+            unsigned int _maxBytes;
+            bool _shutdown;
+            std::string _error; // why the thread stopped early, if it did
+
+            // Last, so that it starts once everything else is set up.
+            boost::thread _thread;
+        };
+        friend class OpQueueBatcher;
+
+        // Moves the batch limits toward batches that take replApplyBatchTargetMillis to apply.
+        void adjustBatchLimits(size_t numOps, size_t numBytes, int applyMillis);
+
         BackgroundSyncInterface* _networkQueue;
 
+        // The current batch limits of oplogApplication().
+        unsigned int _batchLimitOps;
+        unsigned int _batchLimitBytes;
+
         // Doles out all the work to the reader pool threads and waits for them to complete
         void prefetchOps(const std::deque<BSONObj>& ops);
         // Used by the thread pool readers to prefetch an op
@@ -128,8 +209,6 @@ namespace replset {
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors, 
                       MultiSyncApplyFunc applyFunc);
 
-        void fillWriterVectors(const std::deque<BSONObj>& ops, 
-                               std::vector< std::vector<BSONObj> >* writerVectors);
         void handleSlaveDelay(const BSONObj& op);
         void setOplogVersion(const BSONObj& op);
     };
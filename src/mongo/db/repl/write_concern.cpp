@@ -30,6 +30,10 @@
 
 #include "mongo/db/repl/write_concern.h"
 
+#include <iterator>
+#include <map>
+#include <set>
+
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/user_name.h"
 #include "mongo/db/client.h"
@@ -118,8 +122,6 @@ namespace mongo {
                     db.update( NS , i->first , i->second , true );
                 }
                 _currentlyUpdatingCache = false;
-
-                _threadsWaitingForReplication.notify_all();
             }
         }
 
@@ -128,6 +130,7 @@ namespace mongo {
                 return;
             scoped_lock mylk(_mutex);
             _slaves.clear();
+            _slaveOpTimes.clear();
         }
 
         bool update( const BSONObj& rid , const BSONObj config , const string& ns , OpTime last ) {
@@ -137,14 +140,23 @@ namespace mongo {
 
             scoped_lock mylk(_mutex);
 
-            if (last > _slaves[ident]) {
-                _slaves[ident] = last;
+            map<Ident,OpTime>::iterator slave = _slaves.find( ident );
+            if ( slave == _slaves.end() ) {
+                slave = _slaves.insert( make_pair( ident, OpTime() ) ).first;
+                _slaveOpTimes.insert( OpTime() );
+            }
+
+            if (last > slave->second) {
+                _slaveOpTimes.erase( _slaveOpTimes.find( slave->second ) );
+                _slaveOpTimes.insert( last );
+                slave->second = last;
                 _dirty = true;
 
                 // update write concern tags if this node is primary
                 if (theReplSet && theReplSet->isPrimary()) {
                     const Member* mem = theReplSet->findById(ident.obj["config"]["_id"].Int());
                     if (!mem) {
+                        _wakeSatisfiedWaiters_inlock();
                         return false;
                     }
                     ReplSetConfig::MemberCfg cfg = mem->config();
@@ -157,7 +169,7 @@ namespace mongo {
                     go();
                 }
 
-                _threadsWaitingForReplication.notify_all();
+                _wakeSatisfiedWaiters_inlock();
             }
             return true;
         }
@@ -207,7 +219,7 @@ namespace mongo {
             return _replicatedToNum_slaves_locked( op, w );
         }
 
-        bool waitForReplication(OpTime& op, int w, int maxSecondsToWait) {
+        bool waitForReplication(OpTime& op, int w, int maxMillis) {
             static const int noLongerMasterAssertCode = ErrorCodes::NotMaster;
             massert(noLongerMasterAssertCode, 
                     "waitForReplication called but not master anymore", _isMaster() );
@@ -217,33 +229,124 @@ namespace mongo {
 
             w--; // now this is the # of slaves i need
 
-            boost::xtime xt;
-            boost::xtime_get(&xt, MONGO_BOOST_TIME_UTC);
-            xt.sec += maxSecondsToWait;
-            
             scoped_lock mylk(_mutex);
-            while ( ! _replicatedToNum_slaves_locked( op, w ) ) {
-                if ( ! _threadsWaitingForReplication.timed_wait( mylk.boost() , xt ) ) {
-                    massert(noLongerMasterAssertCode,
-                            "waitForReplication called but not master anymore", _isMaster());
-                    return false;
-                }
-                massert(noLongerMasterAssertCode, 
-                        "waitForReplication called but not master anymore", _isMaster());
+            if ( ! _replicatedToNum_slaves_locked( op, w ) ) {
+                _wait_inlock( mylk, &_numWaiters[w], op, maxMillis );
             }
-            return true;
+            massert(noLongerMasterAssertCode, 
+                    "waitForReplication called but not master anymore", _isMaster());
+            return _replicatedToNum_slaves_locked( op, w );
+        }
+
+        bool waitForReplication(OpTime& op, const string& wStr, int maxMillis) {
+            if (!theReplSet) {
+                return false;
+            }
+            if (wStr == "majority") {
+                return waitForReplication(op, theReplSet->config().getMajority(), maxMillis);
+            }
+
+            scoped_lock mylk(_mutex);
+            // the tag rules' optimes are only moved forward under _mutex, by update()
+            if ( ! opReplicatedEnough( op, wStr ) ) {
+                _wait_inlock( mylk, &_modeWaiters[wStr], op, maxMillis );
+            }
+            return opReplicatedEnough( op, wStr );
         }
 
         bool _replicatedToNum_slaves_locked(OpTime& op, int numSlaves ) {
-            for ( map<Ident,OpTime>::iterator i=_slaves.begin(); i!=_slaves.end(); i++) {
-                OpTime s = i->second;
-                if ( s < op ) {
-                    continue;
+            if ( numSlaves <= 0 )
+                return true;
+            if ( _slaveOpTimes.size() < static_cast<size_t>( numSlaves ) )
+                return false;
+            return !( _kthHighestOpTime_inlock( numSlaves ) < op );
+        }
+
+        // The optime that at least k of the slaves have reached.  Needs k <= _slaves.size().
+        const OpTime& _kthHighestOpTime_inlock( int k ) const {
+            multiset<OpTime>::const_reverse_iterator i = _slaveOpTimes.rbegin();
+            std::advance( i, k - 1 );
+            return *i;
+        }
+
+        /**
+         * A thread waiting for an op to replicate.  It sits in a WaiterQueue, ordered by the op's
+         * optime, until an update moves the optime it waits on past the op.  Only then is it
+         * woken, rather than every waiter on every update.
+         */
+        struct Waiter {
+            Waiter() : woken(false) {}
+
+            bool woken;
+            boost::condition condition;
+        };
+
+        typedef multimap<OpTime, Waiter*> WaiterQueue;
+
+        // Waits up to 'maxMillis' in 'queue' for an update to wake us as the slaves catch up to
+        // 'op'.  The caller checks again.
+        void _wait_inlock( scoped_lock& mylk, WaiterQueue* queue, const OpTime& op, int maxMillis ) {
+            boost::xtime xt;
+            boost::xtime_get(&xt, MONGO_BOOST_TIME_UTC);
+            xt.sec += maxMillis / 1000;
+            xt.nsec += static_cast<long long>( maxMillis % 1000 ) * 1000000;
+            if ( xt.nsec >= 1000000000 ) {
+                xt.nsec -= 1000000000;
+                xt.sec++;
+            }
+
+            Waiter waiter;
+            WaiterQueue::iterator pos = queue->insert( make_pair( op, &waiter ) );
+            while ( ! waiter.woken ) {
+                if ( ! waiter.condition.timed_wait( mylk.boost(), xt ) ) {
+                    break;
                 }
-                if ( --numSlaves == 0 )
-                    return true;
             }
-            return numSlaves <= 0;
+            if ( ! waiter.woken ) {
+                // still queued; nobody else removes a waiter that hasn't been woken
+                queue->erase( pos );
+            }
+        }
+
+        // Wakes the waiters of 'queue' whose op is at or before 'upTo'.
+        static void _wakeUpTo_inlock( WaiterQueue* queue, const OpTime& upTo ) {
+            while ( !queue->empty() && !( upTo < queue->begin()->first ) ) {
+                Waiter* waiter = queue->begin()->second;
+                waiter->woken = true;
+                waiter->condition.notify_one();
+                queue->erase( queue->begin() );
+            }
+        }
+
+        void _wakeSatisfiedWaiters_inlock() {
+            // ascending by the number of slaves needed, so once there aren't enough slaves for
+            // one queue there aren't for the rest
+            for ( map<int,WaiterQueue>::iterator i = _numWaiters.begin();
+                  i != _numWaiters.end(); ) {
+                if ( _slaveOpTimes.size() < static_cast<size_t>( i->first ) )
+                    break;
+                _wakeUpTo_inlock( &i->second, _kthHighestOpTime_inlock( i->first ) );
+                if ( i->second.empty() )
+                    _numWaiters.erase( i++ );
+                else
+                    ++i;
+            }
+
+            if ( _modeWaiters.empty() || !theReplSet )
+                return;
+            const map<string,ReplSetConfig::TagRule*>& rules = theReplSet->config().rules;
+            for ( map<string,WaiterQueue>::iterator i = _modeWaiters.begin();
+                  i != _modeWaiters.end(); ) {
+                map<string,ReplSetConfig::TagRule*>::const_iterator rule = rules.find( i->first );
+                // if the mode went away in a reconfig, its waiters find out when they check again
+                _wakeUpTo_inlock( &i->second,
+                                  rule == rules.end() ? OpTime( 0xffffffff, 0xffffffff )
+                                                      : rule->second->last );
+                if ( i->second.empty() )
+                    _modeWaiters.erase( i++ );
+                else
+                    ++i;
+            }
         }
 
         std::vector<BSONObj> getHostsAtOp(const OpTime& op) {
@@ -271,9 +374,16 @@ namespace mongo {
 
         // need to be careful not to deadlock with this
         mutable mongo::mutex _mutex;
-        boost::condition _threadsWaitingForReplication;
 
         map<Ident,OpTime> _slaves;
+
+        // the optimes of _slaves, to find the k-th highest
+        multiset<OpTime> _slaveOpTimes;
+
+        // waiters on w:<n> by n - 1, the number of slaves they need, and on tag modes by mode
+        map<int,WaiterQueue> _numWaiters;
+        map<string,WaiterQueue> _modeWaiters;
+
         bool _dirty;
         bool _started;
         bool _currentlyUpdatingCache; // this is not thread safe, but ok for our purposes
@@ -353,7 +463,15 @@ namespace mongo {
     }
 
     bool waitForReplication( OpTime op , int w , int maxSecondsToWait ) {
-        return slaveTracking.waitForReplication( op, w, maxSecondsToWait );
+        return slaveTracking.waitForReplication( op, w, maxSecondsToWait * 1000 );
+    }
+
+    bool awaitReplication( OpTime op , int w , int maxMillis ) {
+        return slaveTracking.waitForReplication( op, w, maxMillis );
+    }
+
+    bool awaitReplication( OpTime op , const string& w , int maxMillis ) {
+        return slaveTracking.waitForReplication( op, w, maxMillis );
     }
 
     vector<BSONObj> getHostsWrittenTo( const OpTime& op ) {
@@ -52,6 +52,14 @@ namespace mongo {
 
     bool waitForReplication( OpTime op , int w , int maxSecondsToWait );
 
+    /**
+     * Waits up to maxMillis for op to make it to w servers.  The wait ends as soon as a position
+     * update gets op there; updates that don't, don't wake the waiter.
+     * @return true if op has made it to w servers
+     */
+    bool awaitReplication( OpTime op , int w , int maxMillis );
+    bool awaitReplication( OpTime op , const string& w , int maxMillis );
+
     std::vector<BSONObj> getHostsWrittenTo( const OpTime& op );
 
     void resetSlaveCache();
@@ -39,4 +39,17 @@ namespace mongo {
     RecordStore::~RecordStore() {
     }
 
+    Status RecordStore::insertRecords( TransactionExperiment* txn,
+                                       const std::vector<const DocWriter*>& docs,
+                                       int quotaMax,
+                                       std::vector<DiskLoc>* locs ) {
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            StatusWith<DiskLoc> loc = insertRecord( txn, docs[i], quotaMax );
+            if ( !loc.isOK() )
+                return loc.getStatus();
+            locs->push_back( loc.getValue() );
+        }
+        return Status::OK();
+    }
+
 }
@@ -134,6 +134,18 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   int quotaMax ) = 0;
 
+        /**
+         * Inserts 'docs' in order.  On success the new locations are appended to 'locs', in the
+         * same order.  Stops at the first failure; the records inserted before it are kept.
+         *
+         * The default inserts one record at a time.  Implementations that can reserve space for
+         * several records at once (see CappedRecordStoreV1) override this.
+         */
+        virtual Status insertRecords( TransactionExperiment* txn,
+                                      const std::vector<const DocWriter*>& docs,
+                                      int quotaMax,
+                                      std::vector<DiskLoc>* locs );
+
         /**
          * returned iterator owned by caller
          * canonical to get all would be
@@ -215,6 +215,85 @@ namespace mongo {
         return StatusWith<DiskLoc>( loc );
     }
 
+    Status CappedRecordStoreV1::insertRecords( TransactionExperiment* txn,
+                                               const std::vector<const DocWriter*>& docs,
+                                               int quotaMax,
+                                               std::vector<DiskLoc>* locs ) {
+        // allocRecord() only checks the document limit once per call, so a reservation could
+        // overshoot it.  Collections with a document limit insert one at a time.
+        if ( _details->maxCappedDocs() - _details->numRecords() <
+             static_cast<long long>( docs.size() ) ) {
+            return RecordStore::insertRecords( txn, docs, quotaMax, locs );
+        }
+
+        std::vector<int> lens( docs.size() );
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            int docSize = docs[i]->documentSize();
+            if ( docSize < 4 ) {
+                return Status( ErrorCodes::InvalidLength, "record has to be >= 4 bytes" );
+            }
+            int lenWHdr = docSize + Record::HeaderSize;
+            if ( docs[i]->addPadding() )
+                lenWHdr = getRecordAllocationSize( lenWHdr );
+            // same alignment allocRecord() applies
+            lens[i] = ( lenWHdr + 3 ) & 0xfffffffc;
+        }
+
+        size_t i = 0;
+        while ( i < docs.size() ) {
+            // An eighth of the cap extent keeps each reservation to about the space the
+            // individual inserts would have taken from the front of the extent.
+            const int maxRun = theCapExtent()->length / 8;
+
+            size_t end = i + 1;
+            int runLen = lens[i];
+            while ( end < docs.size() && runLen + lens[end] <= maxRun ) {
+                runLen += lens[end];
+                end++;
+            }
+
+            if ( end - i == 1 ) {
+                StatusWith<DiskLoc> loc = insertRecord( txn, docs[i], quotaMax );
+                if ( !loc.isOK() )
+                    return loc.getStatus();
+                locs->push_back( loc.getValue() );
+                i = end;
+                continue;
+            }
+
+            StatusWith<DiskLoc> region = allocRecord( txn, runLen, quotaMax );
+            if ( !region.isOK() )
+                return region.getStatus();
+
+            const int extentOfs = recordFor( region.getValue() )->extentOfs();
+            fassert( 17518, recordFor( region.getValue() )->lengthWithHeaders() == runLen );
+
+            long long dataSizeIncrement = 0;
+            int ofs = 0;
+            for ( size_t j = i; j < end; j++ ) {
+                DiskLoc loc = region.getValue();
+                loc.inc( ofs );
+
+                Record* r = reinterpret_cast<Record*>( txn->writingPtr( recordFor( loc ),
+                                                                        lens[j] ) );
+                r->lengthWithHeaders() = lens[j];
+                r->extentOfs() = extentOfs;
+                docs[j]->writeDocument( r->data() );
+
+                _addRecordToRecListInExtent( txn, r, loc );
+
+                dataSizeIncrement += r->netLength();
+                locs->push_back( loc );
+                ofs += lens[j];
+            }
+
+            _details->incrementStats( txn, dataSizeIncrement, end - i );
+            i = end;
+        }
+
+        return Status::OK();
+    }
+
     Status CappedRecordStoreV1::truncate(TransactionExperiment* txn) {
         setLastDelRecLastExtent( txn, DiskLoc() );
         setListOfAllDeletedRecords( txn, DiskLoc() );
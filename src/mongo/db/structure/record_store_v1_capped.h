@@ -53,6 +53,17 @@ namespace mongo {
 
         virtual Status truncate(TransactionExperiment* txn);
 
+        /**
+         * Reserves one contiguous region in the cap extent for a run of records and carves it
+         * up, instead of going through allocRecord() once per record.  Runs are kept well under
+         * the size of an extent so that a reservation never forces more deletes than the
+         * individual inserts would have.
+         */
+        virtual Status insertRecords( TransactionExperiment* txn,
+                                      const std::vector<const DocWriter*>& docs,
+                                      int quotaMax,
+                                      std::vector<DiskLoc>* locs );
+
         /**
          * Truncate documents newer than the document at 'end' from the capped
          * collection.  The collection cannot be completely emptied using this
@@ -91,4 +91,78 @@ namespace {
         simpleInsertTest("abcdefgh", 8);
     }
 
+    class FixedDocWriter : public DocWriter {
+    public:
+        FixedDocWriter( const char* buf, int size ) : _buf( buf ), _size( size ) {}
+        void writeDocument( char* buf ) const { memcpy( buf, _buf, _size ); }
+        size_t documentSize() const { return _size; }
+        bool addPadding() const { return false; }
+    private:
+        const char* _buf;
+        int _size;
+    };
+
+    TEST(CappedRecordStoreV1, InsertRecordsReservesOnce) {
+        DummyTransactionExperiment txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( true, 0 );
+        DummyCappedDocumentDeleteCallback cb;
+
+        CappedRecordStoreV1 rs( &txn, &cb, "test.batch", md, &em, false );
+        rs.increaseStorageSize( &txn, 1024, -1 );
+
+        FixedDocWriter a( "aaaaaaaa", 8 );
+        FixedDocWriter b( "bbbbbbbb", 8 );
+        vector<const DocWriter*> docs;
+        for ( int i = 0; i < 4; i++ ) {
+            docs.push_back( &a );
+            docs.push_back( &b );
+        }
+
+        vector<DiskLoc> locs;
+        ASSERT_OK( rs.insertRecords( &txn, docs, 10000, &locs ) );
+        ASSERT_EQUALS( docs.size(), locs.size() );
+        ASSERT_EQUALS( static_cast<long long>( docs.size() ), md->numRecords() );
+        ASSERT_EQUALS( 8LL * static_cast<long long>( docs.size() ), md->dataSize() );
+
+        for ( size_t i = 0; i < locs.size(); i++ ) {
+            Record* r = rs.recordFor( locs[i] );
+            ASSERT_EQUALS( Record::HeaderSize + 8, r->lengthWithHeaders() );
+            ASSERT_EQUALS( 0, memcmp( r->data(), i % 2 ? "bbbbbbbb" : "aaaaaaaa", 8 ) );
+            if ( i > 0 ) {
+                // linked in insertion order
+                ASSERT_EQUALS( locs[i], rs.getNextRecord( locs[i - 1] ) );
+            }
+        }
+    }
+
+    TEST(CappedRecordStoreV1, InsertRecordsWraps) {
+        DummyTransactionExperiment txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( true, 0 );
+        DummyCappedDocumentDeleteCallback cb;
+
+        CappedRecordStoreV1 rs( &txn, &cb, "test.batchwrap", md, &em, false );
+        rs.increaseStorageSize( &txn, 1024, -1 );
+
+        FixedDocWriter doc( "abcdefgh", 8 );
+        vector<const DocWriter*> docs( 10, &doc );
+
+        for ( int i = 0; i < 100; i++ ) {
+            vector<DiskLoc> locs;
+            ASSERT_OK( rs.insertRecords( &txn, docs, 10000, &locs ) );
+            ASSERT_EQUALS( docs.size(), locs.size() );
+        }
+
+        long long start = md->numRecords();
+        for ( int i = 0; i < 100; i++ ) {
+            vector<DiskLoc> locs;
+            ASSERT_OK( rs.insertRecords( &txn, docs, 10000, &locs ) );
+        }
+        ASSERT_EQUALS( start, md->numRecords() );
+        ASSERT_GREATER_THAN( start, 10 );
+        ASSERT_LESS_THAN( start, 1000 );
+        ASSERT( !cb.deleted.empty() );
+    }
+
 }
@@ -26,6 +26,8 @@
  *    it in the license file.
  */
 
+#include <map>
+
 #include "mongo/base/counter.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/kill_current_op.h"
@@ -43,6 +45,81 @@ namespace mongo {
     static Counter64 gleWtimeouts;
     static ServerStatusMetricField<Counter64> gleWtimeoutsDisplay( "getLastError.wtimeouts", &gleWtimeouts );
 
+    /**
+     * How long write concerns waited for replication, by w: per w, the number of waits, their
+     * total time, and how many took less than 1, 2, 4, ... ms.
+     */
+    class GleWtimeHistogram : public ServerStatusMetric {
+    public:
+        GleWtimeHistogram() : ServerStatusMetric( "getLastError.wtimeByW" ),
+                              _mutex( "GleWtimeHistogram" ) {
+        }
+
+        void record( const WriteConcernOptions& writeConcern, int millis ) {
+            const string w = writeConcern.wNumNodes > 0
+                ? BSONObjBuilder::numStr( writeConcern.wNumNodes ) : writeConcern.wMode;
+
+            int bucket = 0;
+            while ( bucket < kNumBuckets - 1 && millis >= ( 1 << bucket ) )
+                bucket++;
+
+            scoped_lock lk( _mutex );
+            Waits& waits = _byW[w];
+            waits.count++;
+            waits.totalMillis += millis;
+            waits.buckets[bucket]++;
+        }
+
+        virtual void appendAtLeaf( BSONObjBuilder& b ) const {
+            scoped_lock lk( _mutex );
+            BSONObjBuilder sub( b.subobjStart( _leafName ) );
+            for ( std::map<string,Waits>::const_iterator i = _byW.begin(); i != _byW.end(); ++i ) {
+                const Waits& waits = i->second;
+                BSONObjBuilder w( sub.subobjStart( i->first ) );
+                w.append( "count", waits.count );
+                w.append( "totalMillis", waits.totalMillis );
+                BSONArrayBuilder buckets( w.subarrayStart( "buckets" ) );
+                for ( int bucket = 0; bucket < kNumBuckets; bucket++ ) {
+                    if ( !waits.buckets[bucket] )
+                        continue;
+                    BSONObjBuilder entry( buckets.subobjStart() );
+                    if ( bucket < kNumBuckets - 1 )
+                        entry.append( "lessThanMillis", 1 << bucket );
+                    else
+                        entry.append( "atLeastMillis", 1 << ( bucket - 1 ) );
+                    entry.append( "count", waits.buckets[bucket] );
+                    entry.done();
+                }
+                buckets.done();
+                w.done();
+            }
+            sub.done();
+        }
+
+    private:
+        // the last one is for waits of 2^16 ms and more
+        static const int kNumBuckets = 18;
+
+        struct Waits {
+            Waits() : count( 0 ), totalMillis( 0 ) {
+                std::fill( buckets, buckets + kNumBuckets, 0 );
+            }
+
+            long long count;
+            long long totalMillis;
+            long long buckets[kNumBuckets];
+        };
+
+        mutable mongo::mutex _mutex;
+        std::map<string,Waits> _byW;
+    };
+
+    static GleWtimeHistogram gleWtimeHistogram;
+
+    // Longest a write concern sleeps between checks for interrupts and timeouts.  Replication
+    // progress that satisfies it wakes it sooner.
+    static const int kReplWaitSliceMillis = 100;
+
     Status validateWriteConcern( const WriteConcernOptions& writeConcern ) {
 
         const bool isJournalEnabled = getDur().isDurable();
@@ -206,7 +283,18 @@ namespace mongo {
                     break;
                 }
 
-                sleepmillis(1);
+                int waitMillis = kReplWaitSliceMillis;
+                if ( writeConcern.wTimeout > 0 ) {
+                    waitMillis = std::max( 1, std::min( waitMillis,
+                                                        static_cast<int>( writeConcern.wTimeout -
+                                                                          gleTimerHolder.millis() ) ) );
+                }
+                if ( writeConcern.wNumNodes > 0 ) {
+                    awaitReplication( replOpTime, writeConcern.wNumNodes, waitMillis );
+                }
+                else {
+                    awaitReplication( replOpTime, writeConcern.wMode, waitMillis );
+                }
                 killCurrentOp.checkForInterrupt();
             }
         }
@@ -218,6 +306,7 @@ namespace mongo {
         // Add stats
         result->writtenTo = getHostsWrittenTo( replOpTime );
         result->wTime = gleTimerHolder.recordMillis();
+        gleWtimeHistogram.record( writeConcern, result->wTime );
 
         return replStatus;
     }
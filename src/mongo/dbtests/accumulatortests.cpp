@@ -838,6 +838,255 @@ namespace AccumulatorTests {
         
     } // namespace Sum
 
+    namespace ApproxDistinct {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            void createAccumulator() {
+                _accumulator = AccumulatorApproxDistinct::create();
+                ASSERT_EQUALS(string("$approxDistinct"), _accumulator->getOpName());
+            }
+            Accumulator *accumulator() { return _accumulator.get(); }
+            long long estimate() { return accumulator()->getValue(false).getLong(); }
+            /** Assert that 'estimate' is within 'tolerance' (a fraction) of 'expected'. */
+            void assertClose( long long expected, long long estimate, double tolerance ) {
+                const long long error = estimate > expected ? estimate - expected
+                                                            : expected - estimate;
+                ASSERT_LESS_THAN_OR_EQUALS( error, expected * tolerance );
+            }
+        private:
+            intrusive_ptr<Accumulator> _accumulator;
+        };
+
+        /** No values evaluated. */
+        class None : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                ASSERT_EQUALS( 0, estimate() );
+            }
+        };
+
+        /** Missing values are not counted. */
+        class Missing : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                accumulator()->process(Value(), false);
+                ASSERT_EQUALS( 0, estimate() );
+            }
+        };
+
+        /** Repeated and numerically equal values are counted once, as by $addToSet. */
+        class Duplicates : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                for( int i = 0; i < 1000; ++i ) {
+                    accumulator()->process(Value(5), false);
+                    accumulator()->process(Value(5LL), false);
+                    accumulator()->process(Value(5.0), false);
+                }
+                ASSERT_EQUALS( 1, estimate() );
+            }
+        };
+
+        /** Small cardinalities are estimated almost exactly. */
+        class Small : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                for( int i = 0; i < 100; ++i ) {
+                    accumulator()->process(Value(i), false);
+                }
+                assertClose( 100, estimate(), 0.03 );
+            }
+        };
+
+        /** Large cardinalities are estimated within a few standard errors, in bounded memory. */
+        class Large : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                for( int i = 0; i < 100000; ++i ) {
+                    accumulator()->process(Value(string(str::stream() << "user" << i)), false);
+                }
+                assertClose( 100000, estimate(), 0.07 );
+                ASSERT_LESS_THAN( accumulator()->memUsageForSorter(),
+                                  int( 2 * AccumulatorApproxDistinct::kNumRegisters ) );
+            }
+        };
+
+        /** Merging overlapping sketches estimates the size of the union. */
+        class Merge : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> first = AccumulatorApproxDistinct::create();
+                intrusive_ptr<Accumulator> second = AccumulatorApproxDistinct::create();
+                for( int i = 0; i < 60000; ++i ) {
+                    first->process(Value(i), false);
+                    second->process(Value(i + 40000), false);
+                }
+                createAccumulator();
+                accumulator()->process(first->getValue(true), true);
+                accumulator()->process(second->getValue(true), true);
+                assertClose( 100000, estimate(), 0.07 );
+            }
+        };
+
+        /** Sparse sketches merge too. */
+        class MergeSparse : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> first = AccumulatorApproxDistinct::create();
+                intrusive_ptr<Accumulator> second = AccumulatorApproxDistinct::create();
+                for( int i = 0; i < 10; ++i ) {
+                    first->process(Value(i), false);
+                    second->process(Value(i + 5), false);
+                }
+                createAccumulator();
+                accumulator()->process(first->getValue(true), true);
+                accumulator()->process(second->getValue(true), true);
+                assertClose( 15, estimate(), 0.07 );
+            }
+        };
+
+    } // namespace ApproxDistinct
+
+    namespace ApproxPercentile {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            void createAccumulator() {
+                _accumulator = AccumulatorApproxPercentile::create();
+                ASSERT_EQUALS(string("$approxPercentile"), _accumulator->getOpName());
+            }
+            Accumulator *accumulator() { return _accumulator.get(); }
+            /** Process 0..10000 in a scrambled order, asking for percentile 'p'. */
+            void processRange( const Value& p ) {
+                for( int i = 0; i <= 10000; ++i ) {
+                    const int value = ( i * 7919 ) % 10001;
+                    accumulator()->process(Value(DOC("input" << value << "p" << p)), false);
+                }
+            }
+        private:
+            intrusive_ptr<Accumulator> _accumulator;
+        };
+
+        /** No values evaluated. */
+        class None : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                ASSERT_EQUALS( jstNULL, accumulator()->getValue(false).getType() );
+            }
+        };
+
+        /** A single value is every percentile. */
+        class One : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                accumulator()->process(Value(DOC("input" << 5 << "p" << 0.5)), false);
+                ASSERT_EQUALS( 5, accumulator()->getValue(false).getDouble() );
+            }
+        };
+
+        /** Non numeric values are ignored. */
+        class NonNumeric : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                accumulator()->process(Value(DOC("input" << "a" << "p" << 0.5)), false);
+                accumulator()->process(Value(DOC("input" << BSONNULL << "p" << 0.5)), false);
+                accumulator()->process(Value(DOC("p" << 0.5)), false);
+                accumulator()->process(Value(DOC("input" << 3 << "p" << 0.5)), false);
+                ASSERT_EQUALS( 3, accumulator()->getValue(false).getDouble() );
+            }
+        };
+
+        /** The median and tail percentiles of a uniform range are close to exact. */
+        class Accuracy : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                processRange( Value( DOC_ARRAY( 0 << 0.01 << 0.5 << 0.99 << 1 ) ) );
+                const vector<Value> result = accumulator()->getValue(false).getArray();
+                ASSERT_EQUALS( 5U, result.size() );
+                ASSERT_EQUALS( 0, result[0].getDouble() );
+                ASSERT_LESS_THAN_OR_EQUALS( std::abs( result[1].getDouble() - 100 ), 10 );
+                ASSERT_LESS_THAN_OR_EQUALS( std::abs( result[2].getDouble() - 5000 ), 50 );
+                ASSERT_LESS_THAN_OR_EQUALS( std::abs( result[3].getDouble() - 9900 ), 10 );
+                ASSERT_EQUALS( 10000, result[4].getDouble() );
+            }
+        };
+
+        /** Memory does not grow with the number of values. */
+        class BoundedMemory : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                for( int i = 0; i < 10; ++i ) {
+                    processRange( Value( 0.5 ) );
+                }
+                ASSERT_LESS_THAN( accumulator()->memUsageForSorter(), 16 * 1024 );
+            }
+        };
+
+        /** Digests from different shards merge. */
+        class Merge : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> evens = AccumulatorApproxPercentile::create();
+                intrusive_ptr<Accumulator> odds = AccumulatorApproxPercentile::create();
+                intrusive_ptr<Accumulator> empty = AccumulatorApproxPercentile::create();
+                for( int i = 0; i <= 10000; ++i ) {
+                    Accumulator* accumulator = ( i % 2 == 0 ) ? evens.get() : odds.get();
+                    accumulator->process(Value(DOC("input" << i << "p" << 0.5)), false);
+                }
+                createAccumulator();
+                accumulator()->process(evens->getValue(true), true);
+                accumulator()->process(empty->getValue(true), true);
+                accumulator()->process(odds->getValue(true), true);
+                ASSERT_LESS_THAN_OR_EQUALS(
+                        std::abs( accumulator()->getValue(false).getDouble() - 5000 ), 50 );
+            }
+        };
+
+        /** The operand must be an object. */
+        class NotAnObject : public Base {
+        public:
+            void run() {
+                createAccumulator();
+                ASSERT_THROWS( accumulator()->process(Value(5), false), UserException );
+            }
+        };
+
+        /** p must be a number in [0, 1] or a non-empty array of them. */
+        class InvalidPercentile : public Base {
+        public:
+            void run() {
+                assertInvalid( Value( 1.5 ) );
+                assertInvalid( Value( -1 ) );
+                assertInvalid( Value( "x" ) );
+                assertInvalid( Value() );
+                assertInvalid( Value( vector<Value>() ) );
+                assertInvalid( Value( DOC_ARRAY( 0.5 << 2 ) ) );
+            }
+        private:
+            void assertInvalid( const Value& p ) {
+                createAccumulator();
+                MutableDocument operand;
+                operand.addField("input", Value(1));
+                if (!p.missing())
+                    operand.addField("p", p);
+                ASSERT_THROWS( accumulator()->process(Value(operand.freeze()), false),
+                               UserException );
+            }
+        };
+
+    } // namespace ApproxPercentile
+
     class All : public Suite {
     public:
         All() : Suite( "accumulator" ) {
@@ -914,6 +1163,23 @@ namespace AccumulatorTests {
             add<Sum::IntNull>();
             add<Sum::IntUndefined>();
             add<Sum::NoOverflowBeforeDouble>();
+
+            add<ApproxDistinct::None>();
+            add<ApproxDistinct::Missing>();
+            add<ApproxDistinct::Duplicates>();
+            add<ApproxDistinct::Small>();
+            add<ApproxDistinct::Large>();
+            add<ApproxDistinct::Merge>();
+            add<ApproxDistinct::MergeSparse>();
+
+            add<ApproxPercentile::None>();
+            add<ApproxPercentile::One>();
+            add<ApproxPercentile::NonNumeric>();
+            add<ApproxPercentile::Accuracy>();
+            add<ApproxPercentile::BoundedMemory>();
+            add<ApproxPercentile::Merge>();
+            add<ApproxPercentile::NotAnObject>();
+            add<ApproxPercentile::InvalidPercentile>();
         }
     } myall;
 
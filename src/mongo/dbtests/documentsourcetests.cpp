@@ -147,6 +147,50 @@ namespace DocumentSourceTests {
                 }
             }
         };
+
+        class ParsedDepsExtractFields {
+        public:
+            void run() {
+                const BSONObj input = fromjson("{_id: 1, a: 2, b: {c: 3, d: 4}, e: [{c: 5}, 6],"
+                                               " f: 7, g: 8}");
+                {
+                    const char* array[] = {"a", "b.c", "e.c"}; // subfields, including in arrays
+                    DepsTracker deps;
+                    deps.fields = arrayToSet(array);
+                    ASSERT_EQUALS(deps.toParsedDeps()->extractFields(input).toBson(),
+                                  fromjson("{a: 2, b: {c: 3}, e: [{c: 5}]}"));
+                }
+                {
+                    const char* array[] = {"g", "_id"}; // order of the input is kept
+                    DepsTracker deps;
+                    deps.fields = arrayToSet(array);
+                    ASSERT_EQUALS(deps.toParsedDeps()->extractFields(input).toBson(),
+                                  BSON("_id" << 1 << "g" << 8));
+                }
+                {
+                    const char* array[] = {"a", "missing"}; // missing fields are skipped
+                    DepsTracker deps;
+                    deps.fields = arrayToSet(array);
+                    ASSERT_EQUALS(deps.toParsedDeps()->extractFields(input).toBson(),
+                                  BSON("a" << 2));
+                }
+                {
+                    // BSON doesn't guarantee unique field names, so a repeated field mustn't hide
+                    // a later one.
+                    const char* array[] = {"a", "b"};
+                    DepsTracker deps;
+                    deps.fields = arrayToSet(array);
+                    ASSERT_EQUALS(deps.toParsedDeps()->extractFields(BSON("a" << 1 << "a" << 2
+                                                                          << "b" << 3)).toBson(),
+                                  BSON("a" << 1 << "a" << 2 << "b" << 3));
+                }
+                {
+                    DepsTracker deps; // no fields needed at all
+                    ASSERT_EQUALS(deps.toParsedDeps()->extractFields(input).toBson(),
+                                  BSONObj());
+                }
+            }
+        };
     }
 
     namespace DocumentSourceCursor {
@@ -179,6 +223,8 @@ namespace DocumentSourceTests {
             }
             intrusive_ptr<ExpressionContext> ctx() { return _ctx; }
             DocumentSourceCursor* source() { return _source.get(); }
+            /** True until the source has been disposed of and released its runner. */
+            bool sourceHoldsRunner() const { return _runner.use_count() > 1; }
         private:
             // It is important that these are ordered to ensure correct destruction order.
             boost::shared_ptr<Runner> _runner;
@@ -446,12 +492,14 @@ namespace DocumentSourceTests {
                         new ExpressionContext(InterruptStatusMongod::status, NamespaceString(ns));
                 expressionContext->inShard = inShard;
                 expressionContext->tempDir = storageGlobalParams.dbpath + "/_tmp";
+                expressionContext->groupThreads = groupThreads();
 
                 _group = DocumentSourceGroup::createFromBson( specElement, expressionContext );
                 assertRoundTrips( _group );
                 _group->setSource( source() );
             }
             DocumentSource* group() { return _group.get(); }
+            virtual int groupThreads() const { return 1; }
             /** Assert that iterator state accessors consistently report the source is exhausted. */
             void assertExhausted( const intrusive_ptr<DocumentSource> &source ) const {
                 // It should be safe to check doneness multiple times
@@ -916,6 +964,141 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:[1,2,3],a:[[4,5,6]]}]"; }
         };
 
+        /** The input is grouped on several threads. */
+        class ParallelFourValuesTwoKeysTwoAccumulators : public FourValuesTwoKeysTwoAccumulators {
+            int groupThreads() const { return 3; }
+        };
+
+        /**
+         * Order sensitive accumulators give the same results when the input spans several batches
+         * and threads.
+         */
+        class ParallelOrderSensitiveAccumulators : public CheckResultsBase {
+            static const int nDocs = 10000;
+            static const int nKeys = 7;
+            int groupThreads() const { return 4; }
+            void populateData() {
+                for( int i = 0; i < nDocs; ++i ) {
+                    client.insert( ns, BSON( "i" << i << "k" << i % nKeys ) );
+                }
+            }
+            virtual BSONObj groupSpec() {
+                return fromjson( "{_id:'$k',first:{$first:'$i'},last:{$last:'$i'},"
+                                 "count:{$sum:1},avg:{$avg:'$i'}}" );
+            }
+            virtual BSONObj expectedResultSet() {
+                BSONArrayBuilder expected;
+                for( int k = 0; k < nKeys; ++k ) {
+                    int count = ( nDocs - k + nKeys - 1 ) / nKeys;
+                    int last = k + ( count - 1 ) * nKeys;
+                    expected << BSON( "_id" << k << "first" << k << "last" << last
+                                      << "count" << count << "avg" << ( k + last ) / 2.0 );
+                }
+                return expected.arr();
+            }
+        };
+
+        /** An error evaluating an expression on a worker thread is reported to the caller. */
+        class ParallelEvaluationError : public Base {
+        public:
+            void run() {
+                client.insert( ns, BSON( "a" << 1 ) );
+                client.insert( ns, BSON( "a" << "x" ) );
+                createSource();
+                createGroup( fromjson( "{_id:{$add:['$a',1]}}" ) );
+                ASSERT_THROWS( group()->getNext(), UserException );
+            }
+            int groupThreads() const { return 2; }
+        };
+
+        /** A $group that has absorbed an {$unwind: '$a'} gives the results of both stages. */
+        class AbsorbedUnwindBase : public CheckResultsBase {
+        public:
+            void run() {
+                populateData();
+                createSource();
+                createGroup( groupSpec() );
+                mongo::DocumentSourceGroup* absorbing =
+                        static_cast<mongo::DocumentSourceGroup*>( group() );
+                ASSERT( absorbing->absorbUnwind( mongo::FieldPath( "a" ) ) );
+                ASSERT( !absorbing->absorbUnwind( mongo::FieldPath( "b" ) ) );
+
+                // The $unwind is serialized in front of the $group.
+                vector<Value> serialized;
+                group()->serializeToArray( serialized );
+                ASSERT_EQUALS( 2U, serialized.size() );
+                ASSERT_EQUALS( BSON( "$unwind" << "$a" ), serialized[ 0 ].getDocument().toBson() );
+
+                checkResultSet( group() );
+            }
+        };
+
+        /** The _id doesn't depend on the array, so each input document's group is found once. */
+        class AbsorbedUnwindIdFromOtherField : public AbsorbedUnwindBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,k:1,a:[1,2,3]}" ) );
+                client.insert( ns, fromjson( "{_id:1,k:1,a:[4]}" ) );
+                client.insert( ns, fromjson( "{_id:2,k:2,a:[]}" ) );
+                client.insert( ns, fromjson( "{_id:3,k:2}" ) );
+                client.insert( ns, fromjson( "{_id:4,k:3,a:null}" ) );
+                client.insert( ns, fromjson( "{_id:5,a:[5,6]}" ) );
+            }
+            BSONObj groupSpec() {
+                return fromjson( "{_id:'$k',sum:{$sum:'$a'},n:{$sum:1}}" );
+            }
+            string expectedResultSetString() {
+                return "[{_id:null,sum:11,n:2},{_id:1,sum:10,n:4}]";
+            }
+        };
+
+        /** The _id is the unwound value. */
+        class AbsorbedUnwindIdFromArray : public AbsorbedUnwindBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,a:[1,2,1]}" ) );
+                client.insert( ns, fromjson( "{_id:1,a:[2]}" ) );
+            }
+            BSONObj groupSpec() { return fromjson( "{_id:'$a',n:{$sum:1}}" ); }
+            string expectedResultSetString() { return "[{_id:1,n:2},{_id:2,n:2}]"; }
+        };
+
+        /** The _id is a field inside the array's elements. */
+        class AbsorbedUnwindIdFromArrayElements : public AbsorbedUnwindBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,a:[{x:1,y:1},{x:2,y:2},{x:1,y:3}]}" ) );
+            }
+            BSONObj groupSpec() { return fromjson( "{_id:'$a.x',y:{$push:'$a.y'}}" ); }
+            string expectedResultSetString() { return "[{_id:1,y:[1,3]},{_id:2,y:[2]}]"; }
+        };
+
+        /** Documents kept by an accumulator aren't changed by the following elements. */
+        class AbsorbedUnwindPushRoot : public AbsorbedUnwindBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,a:[1,2,3]}" ) );
+            }
+            BSONObj groupSpec() { return fromjson( "{_id:null,docs:{$push:'$$ROOT'}}" ); }
+            string expectedResultSetString() {
+                return "[{_id:null,docs:[{_id:0,a:1},{_id:0,a:2},{_id:0,a:3}]}]";
+            }
+        };
+
+        /** The input is grouped on several threads. */
+        class ParallelAbsorbedUnwindIdFromOtherField : public AbsorbedUnwindIdFromOtherField {
+            int groupThreads() const { return 3; }
+        };
+
+        /** A value that isn't an array is an error, as it is for $unwind. */
+        class AbsorbedUnwindOfNonArray : public Base {
+        public:
+            void run() {
+                client.insert( ns, BSON( "a" << 1 ) );
+                createSource();
+                createGroup( fromjson( "{_id:null,n:{$sum:1}}" ) );
+                ASSERT( static_cast<mongo::DocumentSourceGroup*>( group() )->absorbUnwind(
+                                mongo::FieldPath( "a" ) ) );
+                ASSERT_THROWS( group()->getNext(), UserException );
+            }
+        };
+
     } // namespace DocumentSourceGroup
 
     namespace DocumentSourceProject {
@@ -1178,6 +1361,62 @@ namespace DocumentSourceTests {
             virtual BSONObj sortSpec() { return BSON( "a" << 1 ); }
         };
 
+        /**
+         * A source that, like the cursors of a DocumentSourceMergeCursors, keeps its resources
+         * past its last document until it is disposed of.
+         */
+        class HeldSource : public DocumentSource {
+        public:
+            static intrusive_ptr<HeldSource> create( const BSONArray& docs,
+                                                     const intrusive_ptr<ExpressionContext>& ctx ) {
+                return new HeldSource( docs, ctx );
+            }
+            virtual boost::optional<Document> getNext() {
+                if ( !_it.more() )
+                    return boost::none;
+                return Document( _it.next().Obj() );
+            }
+            virtual void dispose() { _disposed = true; }
+            virtual Value serialize( bool explain = false ) const { return Value(); }
+            bool disposed() const { return _disposed; }
+        private:
+            HeldSource( const BSONArray& docs, const intrusive_ptr<ExpressionContext>& ctx )
+                : DocumentSource( ctx ), _docs( docs ), _it( _docs ), _disposed( false ) {
+            }
+            BSONArray _docs;
+            BSONObjIterator _it;
+            bool _disposed;
+        };
+
+        /**
+         * A sort disposes of its source once all of the input is in the sorter, before the
+         * sorted output is streamed, and before its limit stops the output.
+         */
+        class DisposeSource : public Base {
+        public:
+            void run() {
+                intrusive_ptr<HeldSource> source =
+                        HeldSource::create( BSON_ARRAY( BSON( "a" << 3 ) << BSON( "a" << 1 )
+                                                        << BSON( "a" << 2 ) ), ctx() );
+                BSONObj spec = BSON( "$sort" << BSON( "a" << 1 ) );
+                intrusive_ptr<DocumentSource> sort =
+                        DocumentSourceSort::createFromBson( spec.firstElement(), ctx() );
+                ASSERT( sort->coalesce( mongo::DocumentSourceLimit::create( ctx(), 2 ) ) );
+                sort->setSource( source.get() );
+                ASSERT( !source->disposed() );
+
+                boost::optional<Document> next = sort->getNext();
+                ASSERT( bool( next ) );
+                ASSERT_EQUALS( Value( 1 ), next->getField( "a" ) );
+                ASSERT( source->disposed() );
+
+                next = sort->getNext();
+                ASSERT( bool( next ) );
+                ASSERT_EQUALS( Value( 2 ), next->getField( "a" ) );
+                ASSERT( !sort->getNext() );
+            }
+        };
+
         class InvalidSpecBase : public Base {
         public:
             virtual ~InvalidSpecBase() {
@@ -1904,6 +2143,7 @@ namespace DocumentSourceTests {
         }
         void setupTests() {
             add<DocumentSourceClass::Deps>();
+            add<DocumentSourceClass::ParsedDepsExtractFields>();
 
             add<DocumentSourceCursor::Empty>();
             add<DocumentSourceCursor::Iterate>();
@@ -1950,6 +2190,15 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::Dependencies>();
             add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
             add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+            add<DocumentSourceGroup::ParallelFourValuesTwoKeysTwoAccumulators>();
+            add<DocumentSourceGroup::ParallelOrderSensitiveAccumulators>();
+            add<DocumentSourceGroup::ParallelEvaluationError>();
+            add<DocumentSourceGroup::AbsorbedUnwindIdFromOtherField>();
+            add<DocumentSourceGroup::AbsorbedUnwindIdFromArray>();
+            add<DocumentSourceGroup::AbsorbedUnwindIdFromArrayElements>();
+            add<DocumentSourceGroup::AbsorbedUnwindPushRoot>();
+            add<DocumentSourceGroup::ParallelAbsorbedUnwindIdFromOtherField>();
+            add<DocumentSourceGroup::AbsorbedUnwindOfNonArray>();
 
             add<DocumentSourceProject::Inclusion>();
             add<DocumentSourceProject::Optimize>();
@@ -1979,6 +2228,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceSort::MissingObjectWithinArray>();
             add<DocumentSourceSort::ExtractArrayValues>();
             add<DocumentSourceSort::Dependencies>();
+            add<DocumentSourceSort::DisposeSource>();
 
             add<DocumentSourceUnwind::Empty>();
             add<DocumentSourceUnwind::MissingField>();
@@ -32,6 +32,7 @@
 
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/field_path.h"
+#include "mongo/db/pipeline/flat_value_set.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/dbtests/dbtests.h"
 
@@ -1410,6 +1411,92 @@ namespace DocumentTests {
         };
     } // namespace Value
 
+    namespace FlatValueSet {
+
+        using mongo::FlatValueSet;
+        using mongo::Value;
+
+        /** Values are found at the position they were inserted at. */
+        class InsertAndFind {
+        public:
+            void run() {
+                FlatValueSet set;
+                ASSERT(set.empty());
+                ASSERT_EQUALS(FlatValueSet::npos, set.find(Value(1)));
+
+                bool inserted;
+                ASSERT_EQUALS(0U, set.insert(Value(1), &inserted));
+                ASSERT(inserted);
+                ASSERT_EQUALS(1U, set.insert(Value("a"), &inserted));
+                ASSERT(inserted);
+                ASSERT_EQUALS(0U, set.insert(Value(1), &inserted));
+                ASSERT(!inserted);
+
+                ASSERT_EQUALS(2U, set.size());
+                ASSERT_EQUALS(1U, set.find(Value("a")));
+                ASSERT_EQUALS(FlatValueSet::npos, set.find(Value("b")));
+                ASSERT_EQUALS(Value("a"), set[1]);
+            }
+        };
+
+        /** Numerically equal Values of different types are the same member, as for Value::Hash. */
+        class NumericEquivalence {
+        public:
+            void run() {
+                FlatValueSet set;
+                bool inserted;
+                set.insert(Value(5), &inserted);
+                set.insert(Value(5LL), &inserted);
+                ASSERT(!inserted);
+                set.insert(Value(5.0), &inserted);
+                ASSERT(!inserted);
+                ASSERT_EQUALS(1U, set.size());
+            }
+        };
+
+        /** The table grows past its initial size and keeps insertion order. */
+        class ManyValues {
+        public:
+            void run() {
+                FlatValueSet set;
+                bool inserted;
+                const int n = 10000;
+                for (int i = 0; i < n; i++) {
+                    ASSERT_EQUALS(size_t(i), set.insert(Value(i), &inserted));
+                    ASSERT(inserted);
+                }
+                for (int i = 0; i < n; i++) {
+                    ASSERT_EQUALS(size_t(i), set.find(Value(i)));
+                    ASSERT_EQUALS(Value(i), set.values()[i]);
+                }
+                ASSERT_EQUALS(FlatValueSet::npos, set.find(Value(n)));
+            }
+        };
+
+        /** clear() empties the set and releases its memory. */
+        class Clear {
+        public:
+            void run() {
+                FlatValueSet set;
+                const size_t emptyUsage = set.memUsage();
+                bool inserted;
+                for (int i = 0; i < 100; i++) {
+                    set.insert(Value(i), &inserted);
+                }
+                ASSERT_GREATER_THAN(set.memUsage(), emptyUsage);
+
+                set.clear();
+                ASSERT(set.empty());
+                ASSERT_EQUALS(emptyUsage, set.memUsage());
+                ASSERT_EQUALS(FlatValueSet::npos, set.find(Value(1)));
+
+                ASSERT_EQUALS(0U, set.insert(Value(1), &inserted));
+                ASSERT(inserted);
+            }
+        };
+
+    } // namespace FlatValueSet
+
     class All : public Suite {
     public:
         All() : Suite( "document" ) {
@@ -1506,6 +1593,11 @@ namespace DocumentTests {
             add<Value::Compare>();
             add<Value::SubFields>();
             add<Value::SerializationOfMissingForSorter>();
+
+            add<FlatValueSet::InsertAndFind>();
+            add<FlatValueSet::NumericEquivalence>();
+            add<FlatValueSet::ManyValues>();
+            add<FlatValueSet::Clear>();
         }
     } myall;
     
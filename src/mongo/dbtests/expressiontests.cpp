@@ -32,6 +32,7 @@
 
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/dbtests/dbtests.h"
 
 namespace ExpressionTests {
@@ -3436,6 +3437,189 @@ namespace ExpressionTests {
 
     } // namespace AllAnyElements
 
+    namespace Program {
+
+        /** Parse, optimize and compile an expression, checking that it was compiled. */
+        static intrusive_ptr<Expression> compile(const intrusive_ptr<Expression>& tree) {
+            intrusive_ptr<Expression> compiled = ExpressionProgram::compile(tree);
+            ASSERT(dynamic_cast<ExpressionProgram*>(compiled.get()));
+            return compiled;
+        }
+
+        static intrusive_ptr<Expression> parse(const BSONObj& spec) {
+            VariablesIdGenerator idGenerator;
+            VariablesParseState vps(&idGenerator);
+            return Expression::parseExpression(spec.firstElement(), vps)->optimize();
+        }
+
+        /** Evaluate 'expression' on 'root', describing either the result or the error. */
+        static BSONObj evaluate(const intrusive_ptr<Expression>& expression,
+                                const Document& root) {
+            try {
+                return toBson(expression->evaluate(root));
+            }
+            catch (const UserException& e) {
+                return BSON("error" << e.getCode());
+            }
+        }
+
+        /**
+         * Every expression evaluates to exactly the same result, including numeric type and
+         * error code, whether compiled or evaluated as a tree.
+         */
+        class EquivalenceBase {
+        public:
+            virtual ~EquivalenceBase() {}
+            void run() {
+                const vector<BSONObj> specs = expressions();
+                const vector<Document> roots = documents();
+                for (size_t i = 0; i < specs.size(); i++) {
+                    const intrusive_ptr<Expression> tree = parse(specs[i]);
+                    const intrusive_ptr<Expression> compiled = compile(tree);
+                    for (size_t j = 0; j < roots.size(); j++) {
+                        const BSONObj expected = evaluate(tree, roots[j]);
+                        const BSONObj actual = evaluate(compiled, roots[j]);
+                        if (!expected.binaryEqual(actual)) {
+                            FAIL(str::stream() << "for expression " << specs[i]
+                                               << " on " << roots[j].toString()
+                                               << " expected: " << expected
+                                               << " but got: " << actual);
+                        }
+                    }
+                }
+            }
+        protected:
+            virtual vector<BSONObj> expressions() = 0;
+
+            /** Operands 'a' and 'b' of many types and edge cases. */
+            vector<Document> documents() {
+                vector<Document> roots;
+                roots.push_back(fromBson(BSON("a" << 1 << "b" << 2)));
+                roots.push_back(fromBson(BSON("a" << -7 << "b" << 3)));
+                roots.push_back(fromBson(BSON("a" << numeric_limits<int>::max() << "b" << 1)));
+                roots.push_back(fromBson(BSON("a" << numeric_limits<int>::min() << "b" << 2)));
+                roots.push_back(fromBson(BSON("a" << 5LL << "b" << 3)));
+                roots.push_back(fromBson(BSON("a" << 7.5 << "b" << 2)));
+                roots.push_back(fromBson(BSON("a" << 10 << "b" << 3.0)));
+                roots.push_back(fromBson(BSON("a" << 10 << "b" << 2.5)));
+                roots.push_back(fromBson(BSON("a" << 6 << "b" << 0)));
+                roots.push_back(fromBson(BSON("a" << 0.0 << "b" << 0.0)));
+                roots.push_back(fromBson(BSON("a" << numeric_limits<double>::quiet_NaN()
+                                              << "b" << 1)));
+                roots.push_back(fromBson(BSON("a" << BSONNULL << "b" << 1)));
+                roots.push_back(fromBson(BSON("b" << 1)));
+                roots.push_back(fromBson(BSON("a" << 1 << "b" << BSONNULL)));
+                roots.push_back(fromBson(BSON("a" << "str" << "b" << 1)));
+                roots.push_back(fromBson(BSON("a" << Date_t(1000) << "b" << 10)));
+                roots.push_back(fromBson(BSON("a" << Date_t(1000) << "b" << Date_t(10))));
+                roots.push_back(fromBson(BSON("a" << true << "b" << false)));
+                roots.push_back(fromBson(BSON("a" << true << "b" << 1)));
+                return roots;
+            }
+        };
+
+        class Arithmetic : public EquivalenceBase {
+            vector<BSONObj> expressions() {
+                vector<BSONObj> specs;
+                specs.push_back(fromjson("{$add:['$a','$b']}"));
+                specs.push_back(fromjson("{$add:['$a','$b',1,'$a']}"));
+                specs.push_back(fromjson("{$add:['$a',{$multiply:['$b',2147483647]}]}"));
+                specs.push_back(fromjson("{$multiply:['$a','$b']}"));
+                specs.push_back(fromjson("{$multiply:['$a','$b',0.5]}"));
+                specs.push_back(fromjson("{$subtract:['$a','$b']}"));
+                specs.push_back(fromjson("{$subtract:['$b',{$subtract:['$a',-1]}]}"));
+                specs.push_back(fromjson("{$divide:['$a','$b']}"));
+                specs.push_back(fromjson("{$mod:['$a','$b']}"));
+                specs.push_back(fromjson("{$mod:[{$add:['$a',100]},'$b']}"));
+                return specs;
+            }
+        };
+
+        class Comparison : public EquivalenceBase {
+            vector<BSONObj> expressions() {
+                vector<BSONObj> specs;
+                specs.push_back(fromjson("{$cmp:['$a','$b']}"));
+                specs.push_back(fromjson("{$eq:['$a','$b']}"));
+                specs.push_back(fromjson("{$ne:['$a','$b']}"));
+                specs.push_back(fromjson("{$gt:['$a','$b']}"));
+                specs.push_back(fromjson("{$gte:['$a','$b']}"));
+                specs.push_back(fromjson("{$lt:['$a','$b']}"));
+                specs.push_back(fromjson("{$lte:['$a',{$add:['$b',1]}]}"));
+                return specs;
+            }
+        };
+
+        class Logical : public EquivalenceBase {
+            vector<BSONObj> expressions() {
+                vector<BSONObj> specs;
+                specs.push_back(fromjson("{$and:['$a','$b']}"));
+                specs.push_back(fromjson("{$or:['$a','$b']}"));
+                specs.push_back(fromjson("{$not:['$a']}"));
+                specs.push_back(fromjson("{$or:[{$and:['$a',{$not:['$b']}]},"
+                                               "{$gt:['$a',1]}]}"));
+                specs.push_back(fromjson("{$cond:[{$gt:['$a','$b']},"
+                                                 "{$subtract:['$a','$b']},"
+                                                 "{$add:['$a',{$multiply:['$b',2]}]}]}"));
+                specs.push_back(fromjson("{$cond:{if:{$and:[{$gte:['$a',0]},{$lt:['$a',100]}]},"
+                                                 "then:{$divide:['$a',4]},"
+                                                 "else:{$concat:['x']}}}"));
+                // The division isn't reached when 'b' is falsy.
+                specs.push_back(fromjson("{$and:['$b',{$divide:['$a','$b']}]}"));
+                return specs;
+            }
+        };
+
+        /** Operators that are not compiled, or that would use too many registers, are left alone. */
+        class NotCompiled {
+        public:
+            void run() {
+                intrusive_ptr<Expression> ifNull = parse(fromjson("{$ifNull:['$a',1]}"));
+                ASSERT_EQUALS(ifNull, ExpressionProgram::compile(ifNull));
+
+                // Each nested $subtract needs one more register.
+                BSONObj spec = fromjson("{$subtract:['$a',1]}");
+                for (unsigned i = 0; i < ExpressionProgram::kMaxRegisters; i++) {
+                    spec = BSON("$subtract" << BSON_ARRAY("$a" << spec));
+                }
+                intrusive_ptr<Expression> deep = parse(spec);
+                ASSERT_EQUALS(deep, ExpressionProgram::compile(deep));
+            }
+        };
+
+        /** A program serializes as the tree it was compiled from. */
+        class Serialize {
+        public:
+            void run() {
+                intrusive_ptr<Expression> tree =
+                        parse(fromjson("{$cond:[{$gt:['$a',1]},{$add:['$a','$b']},null]}"));
+                intrusive_ptr<Expression> compiled = compile(tree);
+                assertBinaryEqual(expressionToBson(tree), expressionToBson(compiled));
+
+                DepsTracker dependencies;
+                compiled->addDependencies(&dependencies);
+                ASSERT_EQUALS(2U, dependencies.fields.size());
+                ASSERT_EQUALS(1U, dependencies.fields.count("a"));
+                ASSERT_EQUALS(1U, dependencies.fields.count("b"));
+            }
+        };
+
+        /** An object expression still evaluates its sub expressions once they are compiled. */
+        class ObjectOptimize {
+        public:
+            void run() {
+                intrusive_ptr<ExpressionObject> expression = ExpressionObject::createRoot();
+                expression->includePath("a");
+                expression->addField(mongo::FieldPath("b"),
+                                     parse(fromjson("{$add:['$a',{$multiply:['$a',2]}]}")));
+                expression->optimize();
+                Variables vars(0, fromBson(BSON("a" << 3)));
+                assertBinaryEqual(BSON("b" << 9),
+                                  toBson(expression->evaluateDocument(&vars)));
+            }
+        };
+
+    } // namespace Program
+
     class All : public Suite {
     public:
         All() : Suite( "expression" ) {
@@ -3739,6 +3923,13 @@ namespace ExpressionTests {
             add<AllAnyElements::TrueViaInt>();
             add<AllAnyElements::FalseViaInt>();
             add<AllAnyElements::Null>();
+
+            add<Program::Arithmetic>();
+            add<Program::Comparison>();
+            add<Program::Logical>();
+            add<Program::NotCompiled>();
+            add<Program::Serialize>();
+            add<Program::ObjectOptimize>();
         }
     } myall;
 
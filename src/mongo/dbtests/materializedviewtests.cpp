@@ -0,0 +1,228 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/materialized_view.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace MaterializedViewTests {
+
+    static const char* const sourceNs = "unittests.materializedviewsource";
+    static const char* const targetNs = "unittests.materializedviewtarget";
+    static DBDirectClient client;
+
+    class Base {
+    public:
+        Base() : _view(NamespaceString(sourceNs), NamespaceString(targetNs), pipeline()) {
+            dropAll();
+        }
+        virtual ~Base() {
+            dropAll();
+        }
+    protected:
+        static BSONObj pipeline() {
+            return BSON_ARRAY(BSON("$match" << BSON("x" << BSON("$gte" << 0)))
+                           << BSON("$group" << BSON("_id" << "$k"
+                                                 << "total" << BSON("$sum" << "$x")
+                                                 << "n" << BSON("$sum" << 1)
+                                                 << "avg" << BSON("$avg" << "$x"))));
+        }
+
+        void refresh(int id) {
+            BSONObj idObj = BSON("_id" << id);
+            _view.refresh(&client, idObj.firstElement());
+        }
+
+        /** Asserts that the group 'key' in the target is {total, n, avg}. */
+        void assertGroup(const string& key, long long total, long long n, double avg) {
+            BSONObj group = client.findOne(targetNs, QUERY("_id" << key));
+            ASSERT(!group.isEmpty());
+            ASSERT_EQUALS(total, group["total"].numberLong());
+            ASSERT_EQUALS(n, group["n"].numberLong());
+            ASSERT_EQUALS(avg, group["avg"].numberDouble());
+        }
+
+        void assertNoGroup(const string& key) {
+            ASSERT(client.findOne(targetNs, QUERY("_id" << key)).isEmpty());
+        }
+
+        unsigned long long numGroups() {
+            return client.count(targetNs);
+        }
+
+        MaterializedView _view;
+
+    private:
+        void dropAll() {
+            client.dropCollection(sourceNs);
+            client.dropCollection(targetNs);
+            client.dropCollection(_view.getContributionsNs().ns());
+        }
+    };
+
+    /** rebuild() computes the same groups as the aggregation would. */
+    class Rebuild : public Base {
+    public:
+        void run() {
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 1));
+            client.insert(sourceNs, BSON("_id" << 2 << "k" << "a" << "x" << 4));
+            client.insert(sourceNs, BSON("_id" << 3 << "k" << "b" << "x" << 2));
+            client.insert(sourceNs, BSON("_id" << 4 << "k" << "b" << "x" << -5)); // no match
+            _view.rebuild(&client);
+
+            ASSERT_EQUALS(2ULL, numGroups());
+            assertGroup("a", 5, 2, 2.5);
+            assertGroup("b", 2, 1, 2);
+            ASSERT_EQUALS(3ULL, client.count(_view.getContributionsNs().ns()));
+
+            // A second rebuild replaces rather than adds to the first.
+            _view.rebuild(&client);
+            assertGroup("a", 5, 2, 2.5);
+        }
+    };
+
+    /** An inserted document is added to its group, creating the group if needed. */
+    class RefreshInsert : public Base {
+    public:
+        void run() {
+            _view.rebuild(&client);
+            ASSERT_EQUALS(0ULL, numGroups());
+
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 3));
+            refresh(1);
+            assertGroup("a", 3, 1, 3);
+
+            client.insert(sourceNs, BSON("_id" << 2 << "k" << "a" << "x" << 6));
+            refresh(2);
+            assertGroup("a", 9, 2, 4.5);
+        }
+    };
+
+    /** An update that changes the group key moves the document between groups. */
+    class RefreshUpdate : public Base {
+    public:
+        void run() {
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 3));
+            client.insert(sourceNs, BSON("_id" << 2 << "k" << "a" << "x" << 5));
+            _view.rebuild(&client);
+
+            client.update(sourceNs, QUERY("_id" << 2), BSON("$set" << BSON("k" << "b")));
+            refresh(2);
+            assertGroup("a", 3, 1, 3);
+            assertGroup("b", 5, 1, 5);
+
+            client.update(sourceNs, QUERY("_id" << 1), BSON("$inc" << BSON("x" << 1)));
+            refresh(1);
+            assertGroup("a", 4, 1, 4);
+        }
+    };
+
+    /** A deleted document is subtracted, and its group removed once it is empty. */
+    class RefreshDelete : public Base {
+    public:
+        void run() {
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 3));
+            client.insert(sourceNs, BSON("_id" << 2 << "k" << "b" << "x" << 5));
+            _view.rebuild(&client);
+
+            client.remove(sourceNs, QUERY("_id" << 1));
+            refresh(1);
+            assertNoGroup("a");
+            assertGroup("b", 5, 1, 5);
+            ASSERT_EQUALS(1ULL, client.count(_view.getContributionsNs().ns()));
+        }
+    };
+
+    /** A document that stops matching the $match leaves its group. */
+    class RefreshNoLongerMatches : public Base {
+    public:
+        void run() {
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 3));
+            client.insert(sourceNs, BSON("_id" << 2 << "k" << "a" << "x" << 5));
+            _view.rebuild(&client);
+
+            client.update(sourceNs, QUERY("_id" << 1), BSON("$set" << BSON("x" << -1)));
+            refresh(1);
+            assertGroup("a", 5, 1, 5);
+        }
+    };
+
+    /** Refreshing a document more than once, as replaying the oplog does, changes nothing. */
+    class RefreshIsIdempotent : public Base {
+    public:
+        void run() {
+            _view.rebuild(&client);
+            client.insert(sourceNs, BSON("_id" << 1 << "k" << "a" << "x" << 3));
+            refresh(1);
+            refresh(1);
+            assertGroup("a", 3, 1, 3);
+
+            client.remove(sourceNs, QUERY("_id" << 1));
+            refresh(1);
+            refresh(1);
+            assertNoGroup("a");
+        }
+    };
+
+    /** Pipelines that can't be maintained incrementally are rejected. */
+    class Unsupported {
+    public:
+        void run() {
+            assertRejected(BSON_ARRAY(BSON("$project" << BSON("x" << 1))));
+            assertRejected(BSON_ARRAY(BSON("$match" << BSON("x" << 1))));
+            assertRejected(BSON_ARRAY(BSON("$group" << BSON("_id" << "$k"
+                                                          << "m" << BSON("$max" << "$x")))));
+            assertRejected(BSON_ARRAY(BSON("$group" << BSON("_id" << "$k"))
+                                   << BSON("$match" << BSON("_id" << 1))));
+        }
+    private:
+        void assertRejected(const BSONObj& pipeline) {
+            ASSERT_THROWS(MaterializedView(NamespaceString(sourceNs),
+                                           NamespaceString(targetNs),
+                                           pipeline),
+                          UserException);
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "materializedview" ) {
+        }
+        void setupTests() {
+            add<Rebuild>();
+            add<RefreshInsert>();
+            add<RefreshUpdate>();
+            add<RefreshDelete>();
+            add<RefreshNoLongerMatches>();
+            add<RefreshIsIdempotent>();
+            add<Unsupported>();
+        }
+    } myall;
+
+} // namespace MaterializedViewTests
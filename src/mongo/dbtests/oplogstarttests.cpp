@@ -35,6 +35,23 @@
 
 namespace OplogStartTests {
 
+    /**
+     * Sets oplogStartIndexSampleBytes for the life of a test, and puts it back however the test
+     * ends.
+     */
+    class SampleBytesSetting {
+    public:
+        explicit SampleBytesSetting(int sampleBytes) : _old(oplogStartIndexSampleBytes) {
+            oplogStartIndexSampleBytes = sampleBytes;
+        }
+        ~SampleBytesSetting() {
+            oplogStartIndexSampleBytes = _old;
+        }
+
+    private:
+        const int _old;
+    };
+
     class Base {
     public:
         Base() : _context(ns()) {
@@ -340,6 +357,159 @@ namespace OplogStartTests {
         virtual int tsGte() const { return 0; }
      };
 
+    /**
+     * The OplogStartIndex answers with the newest sampled entry before the query's timestamp.
+     */
+    class OplogStartIndexLookup : public Base {
+    public:
+        void run() {
+            SampleBytesSetting sampleEveryInsert(1);
+
+            vector<DiskLoc> locs;
+            for (int i = 0; i < 10; ++i) {
+                locs.push_back(insertWithTs(i));
+            }
+
+            OplogStartIndex index(collection());
+
+            // seeded with the first entry of the only extent, which every query here matches
+            setupFromQuery(BSON( "ts" << BSON( "$gte" << OpTime(1000, 1) )));
+            ASSERT(index.findStart(_cq->root()).isNull());
+            ASSERT_EQUALS(1U, index.numEntries());
+
+            for (int i = 10; i < 20; ++i) {
+                locs.push_back(insertWithTs(i));
+                index.noteInsert(locs.back(), collection()->docFor(locs.back()).objsize());
+            }
+            ASSERT_EQUALS(11U, index.numEntries());
+
+            setupFromQuery(BSON( "ts" << BSON( "$gte" << OpTime(1015, 1) )));
+            ASSERT_EQUALS(locs[14], index.findStart(_cq->root()));
+
+            setupFromQuery(BSON( "ts" << BSON( "$gt" << OpTime(1015, 1) )));
+            ASSERT_EQUALS(locs[15], index.findStart(_cq->root()));
+
+            // past the newest entry: start from it
+            setupFromQuery(BSON( "ts" << BSON( "$gt" << OpTime(2000, 1) )));
+            ASSERT_EQUALS(locs[19], index.findStart(_cq->root()));
+
+            // deleting the oldest entries drops them from the index
+            index.noteCappedDelete(locs[0]);
+            ASSERT_EQUALS(10U, index.numEntries());
+            index.noteCappedDelete(locs[12]);
+            ASSERT_EQUALS(7U, index.numEntries());
+
+            setupFromQuery(BSON( "ts" << BSON( "$gte" << OpTime(1013, 1) )));
+            ASSERT(index.findStart(_cq->root()).isNull());
+
+            index.reset();
+            ASSERT_EQUALS(0U, index.numEntries());
+        }
+
+    private:
+        DiskLoc insertWithTs(int i) {
+            DurTransaction txn;
+            StatusWith<DiskLoc> loc =
+                collection()->insertDocument(&txn, BSON( "_id" << i << "ts" << OpTime(1000 + i, 1) ),
+                                             true);
+            ASSERT_OK(loc.getStatus());
+            return loc.getValue();
+        }
+    };
+
+    /**
+     * On an oplog collection, OplogStart asks the collection's OplogStartIndex before it scans.
+     */
+    class OplogStartIndexStage {
+    public:
+        OplogStartIndexStage() : _context(ns()) {
+            DurTransaction txn;
+            CollectionOptions options;
+            options.capped = true;
+            options.cappedSize = 1024 * 1024;
+            ASSERT(_context.db()->createCollection(&txn, ns(), options, true, false));
+        }
+
+        ~OplogStartIndexStage() {
+            _client.dropCollection(ns());
+        }
+
+        void run() {
+            SampleBytesSetting sampleEveryInsert(1);
+            ASSERT(collection()->getOplogStartIndex());
+
+            for (int i = 0; i < 10; ++i) {
+                insertWithTs(i);
+            }
+
+            // The first lookup seeds the index with the first entry of the only extent.
+            ASSERT_EQUALS(workOnce(BSON( "ts" << BSON( "$gte" << OpTime(1005, 1) ))),
+                          PlanStage::ADVANCED);
+            ASSERT(_stage->usedIndex());
+            assertStartId(0);
+
+            // Later inserts are sampled as they happen.
+            for (int i = 10; i < 20; ++i) {
+                insertWithTs(i);
+            }
+
+            ASSERT_EQUALS(workOnce(BSON( "ts" << BSON( "$gte" << OpTime(1015, 1) ))),
+                          PlanStage::ADVANCED);
+            ASSERT(_stage->usedIndex());
+            assertStartId(14);
+
+            // Every indexed entry matches, so the stage scans backwards instead.
+            ASSERT_EQUALS(workOnce(BSON( "ts" << BSON( "$gte" << OpTime(1000, 1) ))),
+                          PlanStage::NEED_TIME);
+            ASSERT(!_stage->usedIndex());
+            ASSERT(_stage->isBackwardsScanning());
+        }
+
+    private:
+        static const char* ns() {
+            return "local.oplog.oplogstarttests";
+        }
+
+        Collection* collection() {
+            return _context.db()->getCollection(ns());
+        }
+
+        void insertWithTs(int i) {
+            DurTransaction txn;
+            StatusWith<DiskLoc> loc =
+                collection()->insertDocument(&txn, BSON( "_id" << i << "ts" << OpTime(1000 + i, 1) ),
+                                             true);
+            ASSERT_OK(loc.getStatus());
+        }
+
+        PlanStage::StageState workOnce(const BSONObj& query) {
+            CanonicalQuery* cq;
+            ASSERT_OK(CanonicalQuery::canonicalize(ns(), query, &cq));
+            _stage.reset();
+            _cq.reset(cq);
+            _ws.reset(new WorkingSet());
+            _stage.reset(new OplogStart(collection(), _cq->root(), _ws.get()));
+            return _stage->work(&_id);
+        }
+
+        void assertStartId(int expectedId) {
+            WorkingSetMember* member = _ws->get(_id);
+            ASSERT_EQUALS(member->obj["_id"].numberInt(), expectedId);
+        }
+
+        Lock::GlobalWrite _lk;
+        Client::Context _context;
+        scoped_ptr<CanonicalQuery> _cq;
+        scoped_ptr<WorkingSet> _ws;
+        scoped_ptr<OplogStart> _stage;
+        WorkingSetID _id;
+
+        static DBDirectClient _client;
+    };
+
+    // static
+    DBDirectClient OplogStartIndexStage::_client;
+
     class All : public Suite {
     public:
         All() : Suite("oplogstart") { }
@@ -355,6 +525,8 @@ namespace OplogStartTests {
             add< OplogStartOneFullExtent >();
             add< OplogStartFirstExtentEmpty >();
             add< OplogStartEOF >();
+            add< OplogStartIndexLookup >();
+            add< OplogStartIndexStage >();
         }
     } oplogStart;
 
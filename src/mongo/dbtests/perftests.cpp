@@ -46,6 +46,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/structure/btree/key.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/taskqueue.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/dbtests/framework_options.h"
@@ -483,6 +484,32 @@ namespace PerfTests {
         }
     };
 
+    /** An arithmetic and $cond heavy aggregation expression, as a tree or compiled. */
+    template <bool Compiled>
+    class AggExpression : public NonDurTest {
+    public:
+        string name() { return Compiled ? "AggExpressionCompiled" : "AggExpressionTree"; }
+        AggExpression() : n(0), vars(0, Document(BSON("a" << 3 << "b" << 4.5 << "c" << 7))) {
+            BSONObj spec = fromjson("{$cond:[{$gt:['$a',{$mod:['$c',5]}]},"
+                                            "{$add:[{$multiply:['$a','$b',2]},"
+                                                   "{$divide:['$c',{$subtract:['$a',1]}]}]},"
+                                            "{$subtract:['$c','$b']}]}");
+            VariablesIdGenerator idGenerator;
+            VariablesParseState vps(&idGenerator);
+            expression = Expression::parseExpression(spec.firstElement(), vps)->optimize();
+            if (Compiled)
+                expression = ExpressionProgram::compile(expression);
+        }
+        void timed() {
+            if (expression->evaluate(&vars).getDouble() > 0)
+                n++;
+        }
+    private:
+        int n;
+        intrusive_ptr<Expression> expression;
+        Variables vars;
+    };
+
     class KeyTest : public B {
     public:
         KeyV1Owned a,b,c;
@@ -1426,6 +1453,8 @@ namespace PerfTests {
                 add< BSONIter >();
                 add< BSONGetFields1 >();
                 add< BSONGetFields2 >();
+                add< AggExpression<false> >();
+                add< AggExpression<true> >();
                 //add< TaskQueueTest >();
                 add< InsertDup >();
                 add< Insert1 >();
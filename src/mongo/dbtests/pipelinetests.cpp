@@ -235,6 +235,144 @@ namespace PipelineTests {
     namespace Optimizations {
         using namespace mongo;
 
+        namespace Local {
+            class Base {
+            public:
+                // These return json arrays of pipeline operators
+                virtual string inputPipeJson() = 0;
+                virtual string outputPipeJson() = 0;
+
+                BSONObj pipelineFromJsonArray(const string& array) {
+                    return fromjson("{pipeline: " + array + "}");
+                }
+                virtual void run() {
+                    const BSONObj inputBson = pipelineFromJsonArray(inputPipeJson());
+                    const BSONObj outputPipeExpected = pipelineFromJsonArray(outputPipeJson());
+
+                    intrusive_ptr<ExpressionContext> ctx =
+                        new ExpressionContext(InterruptStatusMongod::status,
+                                              NamespaceString("a.collection"));
+                    string errmsg;
+                    intrusive_ptr<Pipeline> outputPipe =
+                        Pipeline::parseCommand(errmsg, inputBson, ctx);
+                    ASSERT_EQUALS(errmsg, "");
+                    ASSERT(outputPipe != NULL);
+
+                    ASSERT_EQUALS(outputPipe->serialize()["pipeline"],
+                                  Value(outputPipeExpected["pipeline"]));
+                }
+
+                virtual ~Base() {};
+            };
+
+            namespace moveMatchEarlier {
+
+                class BeforeSorts : public Base {
+                    string inputPipeJson() {
+                        return "[{$sort: {a: 1}}, {$sort: {b: 1}}, {$match: {a: 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {a: 1}}, {$sort: {a: 1}}, {$sort: {b: 1}}]";
+                    }
+                };
+
+                class BeforeProjectRename : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {b: '$a', c: 1}}, {$match: {'b.x': 1, c: 2}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {'a.x': 1, c: 2}}, {$project: {b: '$a', c: true}}]";
+                    }
+                };
+
+                class NotBeforeProjectComputedField : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {b: {$add: ['$a', 1]}}}, {$match: {b: 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$project: {b: {$add: ['$a', {$const: 1}]}}}, {$match: {b: 1}}]";
+                    }
+                };
+
+                class NotBeforeProjectExcludedId : public Base {
+                    string inputPipeJson() {
+                        return "[{$project: {_id: 0, a: 1}}, {$match: {_id: 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$project: {_id: false, a: true}}, {$match: {_id: 1}}]";
+                    }
+                };
+
+                class BeforeUnwind : public Base {
+                    string inputPipeJson() {
+                        return "[{$unwind: '$a'}, {$match: {b: 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {b: 1}}, {$unwind: '$a'}]";
+                    }
+                };
+
+                class NotBeforeUnwindOfSameField : public Base {
+                    string inputPipeJson() {
+                        return "[{$unwind: '$a.b'}, {$match: {'a.c': 1}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$unwind: '$a.b'}, {$match: {'a.c': 1}}]";
+                    }
+                };
+
+                class BeforeGroup : public Base {
+                    string inputPipeJson() {
+                        return "[{$group: {_id: '$a', n: {$sum: 1}}},"
+                               " {$match: {$or: [{_id: {$gt: 5}}, {_id: 1}]}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {$or: [{a: {$gt: 5}}, {a: 1}]}},"
+                               " {$group: {_id: '$a', n: {$sum: {$const: 1}}}}]";
+                    }
+                };
+
+                class NotBeforeGroupOnAccumulator : public Base {
+                    string inputPipeJson() {
+                        return "[{$group: {_id: '$a', n: {$sum: 1}}}, {$match: {n: 2}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$group: {_id: '$a', n: {$sum: {$const: 1}}}}, {$match: {n: 2}}]";
+                    }
+                };
+
+                class NotBeforeGroupIfMissingDiffersFromNull : public Base {
+                    string inputPipeJson() {
+                        return "[{$group: {_id: '$a'}}, {$match: {_id: {$exists: true}}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$group: {_id: '$a'}}, {$match: {_id: {$exists: true}}}]";
+                    }
+                };
+
+                class NotBeforeGroupIfTypeSensitive : public Base {
+                    string inputPipeJson() {
+                        return "[{$group: {_id: '$a'}}, {$match: {_id: {$type: 1}}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$group: {_id: '$a'}}, {$match: {_id: {$type: 1}}}]";
+                    }
+                };
+
+                /** The moved match ends up next to the initial one and the two are combined. */
+                class ThroughSeveralStages : public Base {
+                    string inputPipeJson() {
+                        return "[{$match: {x: 1}}, {$project: {a: 1, x: 1}}, {$sort: {a: 1}},"
+                               " {$match: {a: 2}}]";
+                    }
+                    string outputPipeJson() {
+                        return "[{$match: {$and: [{x: 1}, {a: 2}]}}, {$project: {a: true, x: true}},"
+                               " {$sort: {a: 1}}]";
+                    }
+                };
+            } // namespace moveMatchEarlier
+        } // namespace Local
+
         namespace Sharded {
             class Base {
             public:
@@ -420,6 +558,17 @@ namespace PipelineTests {
             add<FieldPath::Tail>();
             add<FieldPath::TailThreeFields>();
 
+            add<Optimizations::Local::moveMatchEarlier::BeforeSorts>();
+            add<Optimizations::Local::moveMatchEarlier::BeforeProjectRename>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeProjectComputedField>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeProjectExcludedId>();
+            add<Optimizations::Local::moveMatchEarlier::BeforeUnwind>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeUnwindOfSameField>();
+            add<Optimizations::Local::moveMatchEarlier::BeforeGroup>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeGroupOnAccumulator>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeGroupIfMissingDiffersFromNull>();
+            add<Optimizations::Local::moveMatchEarlier::NotBeforeGroupIfTypeSensitive>();
+            add<Optimizations::Local::moveMatchEarlier::ThroughSeveralStages>();
             add<Optimizations::Sharded::Empty>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::OneUnwind>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::TwoUnwind>();
@@ -38,6 +38,7 @@
 #include "mongo/db/instance.h"
 #include "mongo/db/json.h"
 #include "mongo/db/query/get_runner.h"
+#include "mongo/db/query/plan_cost_model.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
@@ -713,6 +714,53 @@ namespace PlanRankingTests {
         }
     };
 
+    /**
+     * The cost model should throw out a plan over an unselective index before the trial run
+     * when another plan's index bounds are small.
+     */
+    class PlanRankingCostModelPrunes : public PlanRankingTestBase {
+    public:
+        void run() {
+            // 'a' is very selective, 'b' is not.
+            for (int i = 0; i < N; ++i) {
+                insert(BSON("a" << i << "b" << 1));
+            }
+
+            addIndex(BSON("a" << 1));
+            addIndex(BSON("b" << 1));
+
+            CanonicalQuery* rawCq;
+            ASSERT(CanonicalQuery::canonicalize(ns, BSON("a" << 5 << "b" << 1), &rawCq).isOK());
+            scoped_ptr<CanonicalQuery> cq(rawCq);
+
+            Client::ReadContext ctx(ns);
+            Collection* collection = ctx.ctx().db()->getCollection(ns);
+
+            QueryPlannerParams plannerParams;
+            fillOutPlannerParams(collection, cq.get(), &plannerParams);
+            plannerParams.options &= ~QueryPlannerParams::KEEP_MUTATIONS;
+
+            vector<QuerySolution*> solutions;
+            ASSERT(QueryPlanner::plan(*cq, plannerParams, &solutions).isOK());
+            ASSERT_EQUALS(solutions.size(), 2U);
+
+            ASSERT_EQUALS(1U, PlanCostModel::pruneSolutions(collection, &solutions));
+            ASSERT_EQUALS(1U, solutions.size());
+            scoped_ptr<QuerySolution> soln(solutions[0]);
+
+            ASSERT(QueryPlannerTestLib::solutionMatches(
+                        "{fetch: {node: {ixscan: {pattern: {a: 1}}}}}",
+                        soln->root.get()));
+
+            // One key for the ixscan, one fetch.
+            ASSERT(NULL != soln->costEstimate.get());
+            ASSERT(soln->costEstimate->exact);
+            ASSERT_EQUALS(2.0, soln->costEstimate->works);
+            ASSERT_EQUALS(1U, soln->costEstimate->candidatesPruned);
+            ASSERT_EQUALS(1, soln->costEstimate->indexKeys["a_1"].numberInt());
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_plan_ranking" ) {}
@@ -734,6 +782,7 @@ namespace PlanRankingTests {
             // add<PlanRankingChooseBetweenIxisectPlans>();
             add<PlanRankingAvoidBlockingSort>();
             add<PlanRankingWorkPlansLongEnough>();
+            add<PlanRankingCostModelPrunes>();
         }
     } planRankingAll;
 
@@ -120,6 +120,8 @@ namespace ReplSetTests {
         virtual void consume() {
             _queue.pop();
         }
+        virtual void markApplied(size_t numOps) {
+        }
         virtual Member* getSyncTarget() {
             return 0;
         }
@@ -567,6 +569,91 @@ namespace ReplSetTests {
         }
     };
 
+    class PartitionByDocument : public Base {
+        class PartitioningTail : public replset::SyncTail {
+        public:
+            PartitioningTail() : SyncTail(NULL) {}
+
+            void fill(const std::deque<BSONObj>& ops, std::vector< std::vector<BSONObj> >* out) {
+                fillWriterVectors(ops, true, out);
+            }
+        };
+
+        BSONObj op(const string& opType, const BSONObj& o, const BSONObj& o2 = BSONObj(),
+                   const string& opNs = ns()) {
+            BSONObjBuilder b;
+            b.appendTimestamp("ts", OpTime(getNextGlobalOptime()).asLL());
+            b.append("op", opType);
+            b.append("ns", opNs);
+            b.append("o", o);
+            if (!o2.isEmpty()) {
+                b.append("o2", o2);
+            }
+            return b.obj();
+        }
+
+        // Returns the number of writer vectors that got any of 'ops'.
+        int fill(const std::deque<BSONObj>& ops,
+                 std::vector< std::vector<BSONObj> >* writerVectors) {
+            writerVectors->assign(8, std::vector<BSONObj>());
+            PartitioningTail tail;
+            tail.fill(ops, writerVectors);
+
+            int used = 0;
+            for (size_t i = 0; i < writerVectors->size(); i++) {
+                if (!(*writerVectors)[i].empty()) {
+                    used++;
+                }
+            }
+            return used;
+        }
+
+    public:
+        void run() {
+            drop();
+            insert(BSON("_id" << -1));
+
+            std::deque<BSONObj> ops;
+            for (int i = 0; i < 100; i++) {
+                ops.push_back(op("i", BSON("_id" << i)));
+            }
+            ops.push_back(op("u", BSON("$set" << BSON("x" << 1)), BSON("_id" << 7)));
+            ops.push_back(op("d", BSON("_id" << 7.0)));
+
+            // The documents are spread out, but each one's ops stay together and in order.
+            std::vector< std::vector<BSONObj> > writerVectors;
+            ASSERT_GREATER_THAN(fill(ops, &writerVectors), 1);
+            for (size_t i = 0; i < writerVectors.size(); i++) {
+                const std::vector<BSONObj>& v = writerVectors[i];
+                for (size_t j = 0; j < v.size(); j++) {
+                    if (v[j]["o"]["_id"].numberInt() != 7) {
+                        continue;
+                    }
+                    ASSERT_EQUALS(j + 3, v.size());
+                    ASSERT_EQUALS("i", v[j]["op"].String());
+                    ASSERT_EQUALS("u", v[j + 1]["op"].String());
+                    ASSERT_EQUALS("d", v[j + 2]["op"].String());
+                    break;
+                }
+            }
+
+            // An op that doesn't name its document keeps the whole collection together.
+            ops.push_back(op("u", BSON("$set" << BSON("x" << 2)), BSON("x" << 1)));
+            ASSERT_EQUALS(1, fill(ops, &writerVectors));
+            ops.pop_back();
+
+            // So does a unique secondary index.
+            client()->ensureIndex(ns(), BSON("x" << 1), true);
+            ASSERT_EQUALS(1, fill(ops, &writerVectors));
+            drop();
+
+            // And being capped.
+            client()->createCollection(ns(), 1024 * 1024, true);
+            ASSERT_EQUALS(1, fill(ops, &writerVectors));
+            drop();
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "replset" ) {
@@ -580,6 +667,7 @@ namespace ReplSetTests {
             add< CappedUpdate >();
             add< CappedInsert >();
             add< TestRSSync >();
+            add< PartitionByDocument >();
         }
     } myall;
 }